@@ -0,0 +1,114 @@
+//-----------------------------------------------------------------------------
+// File: Animation.h
+//
+// Desc: Sprite sheet layout and frame based animation playback. Frame
+//		rectangles are computed once from the sheet metadata, and all running
+//		animations are advanced together from the game's frame time.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _ANIMATION_H_
+#define _ANIMATION_H_
+
+//-----------------------------------------------------------------------------
+// Animation Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int MAX_SHEET_FRAMES		= 64;	// Maximum frames on a single sheet
+const int MAX_ANIM_CLIPS		= 16;	// Maximum number of distinct clips
+const int MAX_ANIM_INSTANCES	= 4096;	// Maximum animations playing at once
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CSpriteSheet (Class)
+// Desc : Frame layout of a sprite sheet. Frames are stored row by row,
+//		iColumns frames per row, starting from the first frame rectangle.
+//-----------------------------------------------------------------------------
+class CSpriteSheet
+{
+public:
+	CSpriteSheet(const RECT& rcFirstFrame, int iColumns, int iRows, int iFrameCount);
+
+	const RECT&	GetFrame(int iIndex) const	{ return m_Frames[iIndex]; }
+	int			GetFrameCount() const		{ return m_FrameCount; }
+	int			GetFrameWidth() const		{ return m_FrameWidth; }
+	int			GetFrameHeight() const		{ return m_FrameHeight; }
+
+private:
+	RECT	m_Frames[MAX_SHEET_FRAMES];
+	int		m_FrameCount;
+	int		m_FrameWidth;
+	int		m_FrameHeight;
+};
+
+//-----------------------------------------------------------------------------
+// Name : CAnimator (Class)
+// Desc : Plays animation clips. Every playing instance is kept in flat
+//		arrays and Update advances all of them in a single pass. Handles
+//		carry a generation count, so a handle to an animation that has
+//		finished (and whose slot was reused) simply reports it is not playing.
+//-----------------------------------------------------------------------------
+class CAnimator
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CAnimator();
+	virtual ~CAnimator();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	int			AddClip(int iFirstFrame, int iFrameCount, float fFrameTime, bool bLoop);
+	int			AddClip(int iFirstFrame, int iFrameCount, const float *pFrameTimes, bool bLoop);
+
+	int			Play(int iClip);
+	void		Stop(int hAnim);
+	void		Update(float dt);
+
+	bool		IsPlaying(int hAnim) const;
+	int			GetFrame(int hAnim) const;
+	int			GetPlayingCount() const		{ return m_ActiveCount; }
+
+private:
+	typedef struct
+	{
+		int		iFirstFrame;					// First sheet frame of the clip
+		int		iFrameCount;					// Number of frames in the clip
+		float	fFrameTime[MAX_SHEET_FRAMES];	// Duration of each frame (seconds)
+		bool	bLoop;
+	} sAnimClip;
+
+	//-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+	int			Slot(int hAnim) const;
+	void		Release(int iActive);
+
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	sAnimClip	m_Clips[MAX_ANIM_CLIPS];
+	int			m_ClipCount;
+
+	// Per instance state, indexed by slot
+	int			m_Clip[MAX_ANIM_INSTANCES];
+	int			m_Frame[MAX_ANIM_INSTANCES];
+	float		m_Time[MAX_ANIM_INSTANCES];
+	USHORT		m_Generation[MAX_ANIM_INSTANCES];
+	int			m_ActiveIndex[MAX_ANIM_INSTANCES];	// Position in m_Active, -1 if free
+
+	int			m_Active[MAX_ANIM_INSTANCES];		// Dense list of playing slots
+	int			m_ActiveCount;
+	int			m_Free[MAX_ANIM_INSTANCES];			// Stack of free slots
+	int			m_FreeCount;
+};
+
+#endif // _ANIMATION_H_
@@ -4,6 +4,10 @@
 #ifndef BACKBUFFER_H
 #define BACKBUFFER_H
 #include "main.h"
+#include "Upscaler.h"
+
+// Smallest fraction of the window size the scene can be drawn at
+const float MIN_RENDER_SCALE = 0.25f;
 
 class BackBuffer
 {
@@ -14,12 +18,35 @@ public:
 	void present();
 	void reset();
 
+	// Draws the scene at a fraction of the window size. GDI calls
+	// keep using window coordinates, a world transform scales them
+	// down; the software blitters must multiply by getRenderScale
+	// themselves. resolve stretches the scene back up for present.
+	void setRenderScale(float scale, EBlitFilter filter = BLIT_BILINEAR);
+	float getRenderScale() const { return mScale; }
+	void resolve();
+
 	HDC getDC() const { return mhDC; }
 	HWND getHWND() const { return mhWnd; }
 
+	// Size of the surface the scene is drawn into
 	int width() const { return mWidth; }
 	int height() const { return mHeight; }
 
+	// Size of the window area it is presented to
+	int viewWidth() const { return mViewWidth; }
+	int viewHeight() const { return mViewHeight; }
+
+	// Direct access to the top-down 32 bit surface. Call GdiFlush
+	// before touching it if GDI has drawn since the last flush.
+	DWORD* getBits() const { return mpBits; }
+	int pitch() const { return mWidth; }
+
+	// The window sized image present shows. The same surface as
+	// getBits at full scale, otherwise only valid after resolve.
+	DWORD* getViewBits() const { return mScale < 1.0f ? mpViewBits : mpBits; }
+	int viewPitch() const { return mViewWidth; }
+
 private:
 	// Make copy constructor and assignment operator private
 	// so client cannot copy BackBuffers. We do this because
@@ -31,12 +58,26 @@ private:
 	BackBuffer(const BackBuffer& rhs);
 	BackBuffer& operator=(const BackBuffer& rhs);
 
+	HBITMAP createSurface(int width, int height, DWORD** ppBits);
+
 private:
 	HWND mhWnd;
 	HDC mhDC;
 	HBITMAP mhSurface;
 	HBITMAP mhOldObject;
+	DWORD* mpBits;
 	int mWidth;
 	int mHeight;
+
+	// Reduced resolution rendering
+	int mViewWidth;
+	int mViewHeight;
+	float mScale;
+	EBlitFilter mFilter;
+	CUpscaler mUpscaler;
+	HDC mhViewDC;
+	HBITMAP mhViewSurface;
+	HBITMAP mhViewOldObject;
+	DWORD* mpViewBits;
 };
-#endif // BACKBUFFER_H
\ No newline at end of file
+#endif // BACKBUFFER_H
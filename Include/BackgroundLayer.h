@@ -0,0 +1,70 @@
+//-----------------------------------------------------------------------------
+// File: BackgroundLayer.h
+//
+// Desc: Scrolling background layer. The scroll offset wraps around the
+//		image size, and painting only blits the spans that are on screen,
+//		so a layer costs about one screen of pixels whatever its size.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _BACKGROUNDLAYER_H_
+#define _BACKGROUNDLAYER_H_
+
+//-----------------------------------------------------------------------------
+// CBackgroundLayer Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "ImageFile.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int MAX_BACKGROUND_LAYERS = 4;	// Maximum number of parallax layers
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CBackgroundLayer (Class)
+// Desc : Image that tiles the view from a wrapping scroll offset. Layers
+//		drawn over another one can use a colour key; the speed scales the
+//		scroll amount to give parallax between layers.
+//-----------------------------------------------------------------------------
+class CBackgroundLayer : public CImageFile
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CBackgroundLayer();
+	virtual ~CBackgroundLayer() {}
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	void		SetSpeed(float fSpeed)		{ m_fSpeed = fSpeed; }
+	float		GetSpeed() const			{ return m_fSpeed; }
+	void		SetTransparentColor(COLORREF crTransparentColor);
+
+	void		Scroll(float dx, float dy);
+
+	// The offset Scroll(dx, dy) would leave, without moving the layer
+	void		GetScrolledOffset(float dx, float dy, float &fOffsetX, float &fOffsetY) const;
+	float		GetOffsetX() const			{ return m_fOffsetX; }
+	float		GetOffsetY() const			{ return m_fOffsetY; }
+
+	void		PaintLayer(HDC hdc, int iViewWidth, int iViewHeight);
+	void		PaintLayer(HDC hdc, int iViewWidth, int iViewHeight, float fOffsetX, float fOffsetY);
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	float		m_fOffsetX;			// Scroll offset, always inside the image
+	float		m_fOffsetY;
+	float		m_fSpeed;			// Scroll scale relative to the camera
+	bool		m_bTransparent;		// Skip m_crTransparent pixels when painting
+	COLORREF	m_crTransparent;
+};
+
+#endif // _BACKGROUNDLAYER_H_
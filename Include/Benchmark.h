@@ -0,0 +1,33 @@
+//-----------------------------------------------------------------------------
+// File: Benchmark.h
+//
+// Desc: Helpers shared by the command line benchmarks: a repeatable random
+//		number generator, the performance counter and the report file each
+//		benchmark writes.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+//-----------------------------------------------------------------------------
+// Benchmark Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+// Small LCG so every run works on the same data, in [0, 1)
+float	BenchRandom		( ULONG &nSeed );
+
+// Performance counter ticks, and the seconds between two of them
+__int64	BenchTime		( );
+double	BenchSeconds	( __int64 nStart, __int64 nEnd );
+
+// Opens a report for writing, NULL on failure. BenchClose closes it and
+// returns bPassed, or false if anything failed to write.
+FILE*	BenchOpen		( LPCSTR strFileName );
+bool	BenchClose		( FILE *pFile, bool bPassed = true );
+
+#endif // _BENCHMARK_H_
@@ -0,0 +1,102 @@
+//-----------------------------------------------------------------------------
+// File: Blitter.h
+//
+// Desc: Software blitting into 32 bit surfaces. Used for the sprite draws
+//		GDI cannot do, such as rotating and scaling a sprite.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _BLITTER_H_
+#define _BLITTER_H_
+
+//-----------------------------------------------------------------------------
+// Blitter Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Main Type Declarations
+//-----------------------------------------------------------------------------
+// A block of top-down 0x00RRGGBB pixels, such as a DIB section
+typedef struct
+{
+	DWORD	*pBits;
+	int		iWidth;
+	int		iHeight;
+	int		iPitch;			// Distance between rows, in pixels
+} sSurface;
+
+// The same for one byte per pixel palette indices
+typedef struct
+{
+	BYTE	*pBits;
+	int		iWidth;
+	int		iHeight;
+	int		iPitch;
+} sSurface8;
+
+enum EBlitFilter
+{
+	BLIT_NEAREST,
+	BLIT_BILINEAR
+};
+
+// How a sprite is composited onto the backbuffer
+enum EBlendMode
+{
+	BLEND_MASK,			// Binary mask, drawn by GDI
+	BLEND_ALPHA,		// Premultiplied alpha: dst = src + dst * (1 - a)
+	BLEND_ADDITIVE		// dst = dst + src, for fire and glow
+};
+
+// How the source rectangle is placed on the destination
+typedef struct
+{
+	float		fCenterX;		// Destination point the source center maps to
+	float		fCenterY;
+	float		fAngle;			// Rotation around the center, radians (clockwise on screen)
+	float		fScaleX;		// Scale along the source x and y axes
+	float		fScaleY;
+	EBlitFilter	eFilter;
+} sBlitTransform;
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+// Draws rcSrc of src rotated and scaled onto dst. Source pixels are skipped
+// where the mask is white (same layout as src, black = opaque) or, without a
+// mask, where they match dwColorKey when bColorKey is set. Only the rows and
+// spans the transformed rectangle covers are visited.
+void BlitAffine(const sSurface &dst, const sSurface &src, const RECT &rcSrc,
+				const sSurface *pMask, bool bColorKey, DWORD dwColorKey,
+				const sBlitTransform &xf);
+
+// BlitAffine for an indexed source. Samples are expanded through the
+// premultiplied ARGB palette and composited as BlitIndexed does it.
+void BlitAffineIndexed(const sSurface &dst, const sSurface8 &src, const RECT &rcSrc,
+					   const DWORD *pPalette, EBlendMode eMode, const sBlitTransform &xf);
+
+// Composites rcSrc of a premultiplied ARGB source with its top-left corner at
+// (x, y) on dst, clipped to dst. eMode must be BLEND_ALPHA or BLEND_ADDITIVE.
+void BlitBlend(const sSurface &dst, int x, int y, const sSurface &src, const RECT &rcSrc,
+			   EBlendMode eMode);
+
+// Expands rcSrc of an indexed source through a premultiplied ARGB palette and
+// composites it like BlitBlend. BLEND_MASK is drawn as BLEND_ALPHA.
+void BlitIndexed(const sSurface &dst, int x, int y, const sSurface8 &src, const RECT &rcSrc,
+				 const DWORD *pPalette, EBlendMode eMode);
+
+// BlitBlend and BlitIndexed for a destination drawn at a reduced resolution:
+// rcSrc is scaled by fScale with its top-left corner at (fX, fY) on dst,
+// using nearest sampling.
+void BlitBlendScaled(const sSurface &dst, float fX, float fY, float fScale, const sSurface &src,
+					 const RECT &rcSrc, EBlendMode eMode);
+void BlitIndexedScaled(const sSurface &dst, float fX, float fY, float fScale, const sSurface8 &src,
+					   const RECT &rcSrc, const DWORD *pPalette, EBlendMode eMode);
+
+// Times BlitAffine's scalar, SSE2 and AVX2 span functions against GDI's
+// PlgBlt for a few rotations and scales, checks each SIMD path against the
+// scalar one, and writes the results to a text file.
+bool RunBlitBenchmark(LPCSTR strFileName);
+
+#endif // _BLITTER_H_
@@ -0,0 +1,175 @@
+//-----------------------------------------------------------------------------
+// File: BroadPhase.h
+//
+// Desc: Collision broad phase. Every frame the game adds the bounds of the
+//		things that can collide, each on a collision layer, and gets back the
+//		pairs whose boxes overlap and whose layers are meant to meet. The
+//		boxes are sorted into a spatial hash of uniform grid cells, so only
+//		neighbours are ever tested against each other. A single box can
+//		also be tested against all of them at once. Long boxes, such as
+//		the path a fast shot covered in a frame, can instead be sorted
+//		along one axis and swept (sweep and prune), and a moving box can be
+//		swept against a still one to find when they first touch.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _BROADPHASE_H_
+#define _BROADPHASE_H_
+
+//-----------------------------------------------------------------------------
+// CBroadPhase Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const float	DEFAULT_COLLISION_CELL	= 128.0f;	// Pixels, about the size of a plane
+
+//-----------------------------------------------------------------------------
+// Main Type Declarations
+//-----------------------------------------------------------------------------
+// Two proxies whose boxes overlap, iA < iB
+typedef struct
+{
+	int		iA;
+	int		iB;
+} sCollisionPair;
+
+// Where a proxy starts along the sweep axis, for FindPairsSweep
+typedef struct
+{
+	float	fMin;
+	int		iProxy;
+} sSweepEntry;
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+// Moves box A by (fDeltaX, fDeltaY) over t = 0 to 1 and returns true when
+// it overlaps the still box B somewhere along the way, with fEnter and
+// fExit the first and last t of the overlap (fEnter is 0 when they already
+// overlap). For two moving boxes pass A's motion less B's.
+bool SweepBox(float fMinX, float fMinY, float fMaxX, float fMaxY, float fDeltaX, float fDeltaY,
+			  float fOtherMinX, float fOtherMinY, float fOtherMaxX, float fOtherMaxY,
+			  float &fEnter, float &fExit);
+inline bool SweepRect(const RECT &rc, float fDeltaX, float fDeltaY, const RECT &rcOther, float &fEnter, float &fExit)
+{ return SweepBox((float)rc.left, (float)rc.top, (float)rc.right, (float)rc.bottom, fDeltaX, fDeltaY,
+				  (float)rcOther.left, (float)rcOther.top, (float)rcOther.right, (float)rcOther.bottom, fEnter, fExit); }
+
+// Times FindPairs and FindPairsSweep against FindPairsBrute from 100 to
+// 100k boxes, checks that all three find the same pairs, times SweepBox
+// over the job system with 1 thread up to one per core, and writes the
+// results to a text file.
+bool RunBroadPhaseBenchmark(LPCSTR strFileName);
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CBroadPhase (Class)
+// Desc : Finds the overlapping boxes among up to nCapacity proxies. A proxy
+//		is an axis aligned box with a layer bit saying what it is, a mask
+//		saying which layers it collides with, and a value for the caller.
+//		Two proxies are paired only when each one's mask has the other's
+//		layer. The proxies are cleared and added again every frame, so
+//		there is nothing to keep in step with the game objects.
+//-----------------------------------------------------------------------------
+class CBroadPhase
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CBroadPhase( int nCapacity, float fCellSize = DEFAULT_COLLISION_CELL );
+	virtual ~CBroadPhase();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	void		Clear		( )	{ m_nCount = 0; m_nPairs = 0; }
+
+	// Returns the proxy index, or -1 when the broad phase is full. Boxes
+	// touch only when they overlap by more than an edge.
+	int			Add			( float fMinX, float fMinY, float fMaxX, float fMaxY,
+							  UINT nLayer, UINT nMask, int nUserData );
+	int			AddCentered	( float fX, float fY, float fHalfWidth, float fHalfHeight,
+							  UINT nLayer, UINT nMask, int nUserData )
+	{ return Add(fX - fHalfWidth, fY - fHalfHeight, fX + fHalfWidth, fY + fHalfHeight, nLayer, nMask, nUserData); }
+	int			AddRect		( const RECT &rc, UINT nLayer, UINT nMask, int nUserData )
+	{ return Add((float)rc.left, (float)rc.top, (float)rc.right, (float)rc.bottom, nLayer, nMask, nUserData); }
+
+	// Fills the pair list from the grid. Returns the number of pairs.
+	int			FindPairs		( );
+
+	// The same pairs by sorting the proxies along the axis they are most
+	// spread over and sweeping it. Unlike the grid it does not mind long
+	// boxes, so it suits the swept bounds of fast shots.
+	int			FindPairsSweep	( );
+
+	// The same pairs by testing every proxy against every other, for
+	// checking FindPairs. The pairs come in a different order.
+	int			FindPairsBrute	( );
+
+	// Tests one box, that is not added, against every proxy with the batch
+	// overlap test and keeps the ones whose layers meet, in proxy order.
+	// For things like the player that meet most of the scene.
+	int			QueryBox		( float fMinX, float fMinY, float fMaxX, float fMaxY, UINT nLayer, UINT nMask );
+	int			QueryRect		( const RECT &rc, UINT nLayer, UINT nMask )
+	{ return QueryBox((float)rc.left, (float)rc.top, (float)rc.right, (float)rc.bottom, nLayer, nMask); }
+	const int*	GetQueryResults	( ) const	{ return m_pQueryResults; }
+
+	const sCollisionPair*	GetPairs	( ) const	{ return m_pPairs; }
+	int			GetPairCount( ) const			{ return m_nPairs; }
+	int			GetCount	( ) const			{ return m_nCount; }
+	int			GetCapacity	( ) const			{ return m_nCapacity; }
+
+	UINT		GetLayer	( int iProxy ) const	{ return m_pLayer[iProxy]; }
+	int			GetUserData	( int iProxy ) const	{ return m_pUserData[iProxy]; }
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+	bool		Collide		( int iA, int iB ) const;
+	void		AddPair		( int iA, int iB );
+	int			CellOf		( float fValue ) const	{ return (int)floorf(fValue * m_fInvCellSize); }
+	int			Bucket		( int nCellX, int nCellY ) const
+	{ return (int)(((UINT)nCellX * 73856093U ^ (UINT)nCellY * 19349663U) & (UINT)(m_nBuckets - 1)); }
+
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	int				m_nCapacity;
+	int				m_nCount;
+	float			m_fInvCellSize;
+
+	// Per proxy fields
+	float			*m_pMinX;
+	float			*m_pMinY;
+	float			*m_pMaxX;
+	float			*m_pMaxY;
+	UINT			*m_pLayer;
+	UINT			*m_pMask;
+	int				*m_pUserData;
+
+	// Spatial hash, the proxies of bucket b are m_pEntries[m_pBucketStart[b]]
+	// up to m_pEntries[m_pBucketStart[b + 1]] - 1, in proxy order
+	int				m_nBuckets;					// Power of two
+	int				*m_pBucketStart;
+	int				*m_pBucketFill;
+	int				*m_pBucketStamp;			// Last proxy put in each bucket
+	int				*m_pEntries;
+	int				m_nMaxEntries;
+
+	sCollisionPair	*m_pPairs;
+	int				m_nPairs;
+	int				m_nMaxPairs;
+
+	sSweepEntry		*m_pSweep;					// Proxies in sweep order
+
+	BYTE			*m_pHitBits;				// One bit per proxy for QueryBox
+	int				*m_pQueryResults;
+};
+
+#endif // _BROADPHASE_H_
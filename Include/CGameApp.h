@@ -16,12 +16,39 @@
 #include "CTimer.h"
 #include "CPlayer.h"
 #include "BackBuffer.h"
+#include "Blitter.h"
 #include "ImageFile.h"
+#include "BackgroundLayer.h"
+#include "SpriteAtlas.h"
+#include "Animation.h"
+#include "FramePipeline.h"
+#include "FrameCapture.h"
+#include "GoldenFrames.h"
+#include "Profiler.h"
+#include "Telemetry.h"
+#include "EntityStore.h"
+#include "Projectiles.h"
+#include "BroadPhase.h"
+#include "OverlapBatch.h"
+#include "JobSystem.h"
+#include "VecMath.h"
 
 //-----------------------------------------------------------------------------
 // Forward Declarations
 //-----------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------
+// Main Type Declarations
+//-----------------------------------------------------------------------------
+// A player shot that reached an enemy this frame, fTime is how far through
+// the frame. Hits are settled in time order, so a shot is spent on the
+// first plane along its path.
+typedef struct
+{
+	float	fTime;
+	int		iEnemy;
+	int		iShot;
+} sSweptHit;
 
 //-----------------------------------------------------------------------------
 // Main Class Declarations
@@ -54,33 +81,97 @@ private:
 	bool		BuildObjects	  ( );
 	void		ReleaseObjects	( );
 	void		FrameAdvance	  ( );
+	void		RunFrame		  ( );
+	void		SimulateTick	  ( );
+	void		ScrollBackground  ( );
 	bool		CreateDisplay	 ( );
 	void		ChangeDevice	  ( );
 	void		SetupGameState	( );
 	void		AnimateObjects	( );
-	void		DrawObjects	   ( );
-	void		DrawMenu()		();
+	void		UpdatePlayer	( );
+	void		Collide			( );
+	void		AddSweptHit		( float fTime, int iEnemy, int iShot );
+	void		BuildFrame		  ( sFramePacket *pFrame, float fAlpha );
+	void		DrawObjects	   ( const sFramePacket &Frame );
+	void		DrawMenu		  ( const sFramePacket &Frame );
+	bool		StartRenderThread ( );
+	void		StopRenderThread  ( );
+	int			RunBenchmark	  ( );
+	float		MeasureThroughput ( bool bPipelined, ULONG &nSimulated, ULONG &nDrawn );
+	void		PollInput		  ( );
 	void		ProcessInput	  ( );
-	void		attack			(CPlayer* m_pPlayer, CPlayer* obj, int val);
-	void		AI				();
-	void	   colision         (CPlayer* obj, CPlayer* obj2);
+	void		GetPlayfieldSize  ( int &iWidth, int &iHeight );
+	float		GetTickTime		  ( );
+	int			RunGoldenTest	  ( );
+	int			RunTickBenchmark  ( );
+	ULONGLONG	HashGameState	  ( );
+	void		UpdateEnemies	  ( );
+	void		ExplodeEntity	  ( int iIndex );
+	void		PlayerHit		  ( );
 
 	//-------------------------------------------------------------------------
 	// Private Static Functions For This Class
 	//-------------------------------------------------------------------------
 	static LRESULT CALLBACK StaticWndProc(HWND hWnd, UINT Message, WPARAM wParam, LPARAM lParam);
+	static DWORD WINAPI		RenderThreadProc(LPVOID pParam);
+	static void				IntegrateEntitiesJob(void *pContext, int iBegin, int iEnd);
+	static void				IntegrateShotsJob(void *pContext, int iBegin, int iEnd);
 
 	//-------------------------------------------------------------------------
 	// Private Variables For This Class
 	//-------------------------------------------------------------------------
 	CTimer				  m_Timer;			// Game timer
+	CAnimator				m_Animator;		 // Advances every sprite animation
 	ULONG				   m_LastFrameRate;	// Used for making sure we update only when fps changes.
+	float					m_fTitleTime;		// Time since the title bar statistics were refreshed
 	
 	HWND					m_hWnd;			 // Main window HWND
 	HICON				   m_hIcon;			// Window Icon
 	HMENU				   m_hMenu;			// Window Menu
 	
 	bool					m_bActive;		  // Is the application active ?
+	bool					m_bPipelined;		// Render on a separate thread (off with -serial)
+	bool					m_bBenchmark;		// Run the throughput benchmark and exit (-benchmark)
+	bool					m_bEntityBenchmark;	// Time the entity store and exit (-entitybench)
+	bool					m_bCollisionBenchmark;	// Time the broad phase and exit (-collisionbench)
+	bool					m_bOverlapBenchmark;	// Time the batch overlap tests and exit (-overlapbench)
+	bool					m_bBlitBenchmark;	// Time the affine blitter against GDI and exit (-blitbench)
+	bool					m_bJobBenchmark;	// Time the job system and exit (-jobbench)
+	bool					m_bVectorBenchmark;	// Time the batch vector functions and exit (-vecbench)
+	bool					m_bTrigBenchmark;	// Time the fast trigonometry and exit (-trigbench)
+	bool					m_bTickBenchmark;	// Run the simulation alone as fast as it goes and exit (-tickbench)
+	bool					m_bPresent;			// Copy finished frames to the window
+
+	CFrameExchange			m_FrameExchange;	// Simulation to render thread hand-off
+	sFramePacket			m_SerialFrame;		// Frame packet used without the render thread
+	ULONG					m_nFrame;			// Simulation frame counter
+	HANDLE					m_hRenderThread;
+	HANDLE					m_hFrameEvent;		// Signalled when a frame is published
+	volatile LONG			m_lRenderQuit;
+	volatile LONG			m_lFramesDrawn;		// Frames the render thread has drawn
+
+	CFrameCapture			m_Capture;			// Video of presented frames (-capture, -rawcapture)
+	ECaptureFormat			m_eCaptureFormat;
+	bool					m_bCapture;
+
+	CTelemetry				m_Telemetry;		// Per-frame metrics log (-telemetry, -telemetrycsv)
+	ETelemetryFormat		m_eTelemetryFormat;
+	bool					m_bTelemetry;
+
+	bool					m_bGolden;			// Scripted golden frame run (-golden, -goldenrecord)
+	bool					m_bRecordGolden;	// Store the hashes instead of checking them
+	ULONG					m_nGoldenFrames;	// Length of the golden run (-frames N)
+	float					m_fFixedStep;		// Seconds of game time per simulation tick
+	float					m_fTickTime;		// Frame time not yet simulated, less than a tick
+	float					m_fScroll;			// Background scroll speed of the last tick
+	UCHAR					m_pKeyBuffer[256];	// Keyboard state for this frame
+	POINT					m_ptCursor;			// Cursor position for this frame
+
+	CHud					m_Hud;				// Performance overlay, F3 toggles it
+	bool					m_bShowHud;
+	volatile float			m_fDrawMs;			// Time the last frame took to draw
+
+	float					m_fRenderScale;		// Fraction of the window size drawn (-scale, F5 / F6)
 
 	ULONG				   m_nViewX;		   // X Position of render viewport
 	ULONG				   m_nViewY;		   // Y Position of render viewport
@@ -90,29 +181,44 @@ private:
 	POINT				   m_OldCursorPos;	 // Old cursor position for tracking
 	HINSTANCE				m_hInstance;
 
-	CImageFile				m_imgBackground;
-	CImageFile				m_imgBackground2;
+	CBackgroundLayer		m_Background[MAX_BACKGROUND_LAYERS];	// Back to front
+	int						m_BackgroundCount;
 
 	BackBuffer*				m_pBBuffer;
+	CSpriteAtlas*			m_pAtlas;			// Shared storage for all sprite images
 	CPlayer*				m_pPlayer;
 
-	CPlayer*				m_pPlayer1;
-	CPlayer*				m_pPlayer2;
-	CPlayer*				m_pPlayer3;
-	CPlayer*				m_pPlayer4;
-	CPlayer*				m_pPlayer5;
-	CPlayer*				m_pPlayer6;
-	CPlayer*				m_pPlayer7;
-
-	CPlayer*				missile;
-	CPlayer*				missile1;
-	CPlayer*				missile2;
-	CPlayer*				missile3;
-	CPlayer*				missile4;
-	CPlayer*				missile5;
-	CPlayer*				missile6;
-	CPlayer*				missile7;
-	CPlayer*				bullet;
+	CEntityStore*			m_pEntities;		// Enemies and their explosions
+	Sprite*					m_pEnemySprite;
+	Sprite*					m_pMissileSprite;
+	AnimatedSprite*			m_pExplosionSprite;
+	int						m_iEnemySprite;		// Sprite ids in the entity store
+	int						m_iExplosionSprite;
+	int						m_iExplosionClip;
+
+	CProjectilePool*		m_pProjectiles;		// Every bullet and missile in flight
+	Sprite*					m_pBulletSprite;
+	int						m_iBulletSprite;	// Sprite ids in the projectile pool
+	int						m_iMissileSprite;
+	CEmitter				m_PlayerGun;		// Fires while numpad 0 is held
+	int						m_iPlayerGun;		// Pattern in use, F7 picks the next
+	CEmitter				m_EnemyGun;			// Shared clock of the enemy volleys
+
+	CBroadPhase*			m_pBroadPhase;		// Rebuilt every frame to find what collides
+	sSweptHit*				m_pSweptHits;		// This frame's shot hits, before they are settled
+	int						m_nSweptHits;
+	int						m_nMaxSweptHits;
+
+	CJobSystem*				m_pJobs;			// Runs each tick as a graph of jobs
+	sJob*					m_pTickJob;			// The running tick's update stage
+
+	CImageFile				menu_background;
+	Sprite*					button_play;
+	Sprite*					button_playH;
+	Sprite*					button_settings;
+	Sprite*					button_settingsH;
+	Sprite*					button_exit;
+	Sprite*					button_exitH;
 };
 
 #endif // _CGAMEAPP_H_
\ No newline at end of file
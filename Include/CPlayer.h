@@ -15,6 +15,13 @@
 //-----------------------------------------------------------------------------
 #include "Main.h"
 #include "Sprite.h"
+#include "Animation.h"
+#include "FramePipeline.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const float EXPLOSION_FRAME_TIME = 0.25f;	// Seconds each explosion frame is shown
 
 //-----------------------------------------------------------------------------
 // Main Class Definitions
@@ -53,7 +60,7 @@ public:
 	//-------------------------------------------------------------------------
 	// Constructors & Destructors for This Class.
 	//-------------------------------------------------------------------------
-			 CPlayer(const BackBuffer *pBackBuffer,valuesImage IMAGE);
+			 CPlayer(const BackBuffer *pBackBuffer, CSpriteAtlas *pAtlas, CAnimator *pAnimator, valuesImage IMAGE);
 	virtual ~CPlayer();
 
 	//-------------------------------------------------------------------------
@@ -61,12 +68,14 @@ public:
 	//-------------------------------------------------------------------------
 	void					Update( float dt );
 	void					Draw();
+	void					Record(sFramePacket *pFrame, float fAlpha = 1.0f) const;
 	void					Move(ULONG ulDirection);
 	void					stop();
-	Vec2&					Position();
-	Vec2&					Velocity();
+	Vec2f&					Position();
+	Vec2f&					Velocity();
+	Sprite*					GetSprite() const	{ return m_pSprite; }
 
-	void					Explode();
+	void					Explode(bool bSound = true);
 	bool					AdvanceExplosion();
 
 private:
@@ -74,12 +83,15 @@ private:
 	// Private Variables for This Class.
 	//-------------------------------------------------------------------------
 	Sprite*					m_pSprite;
+	Vec2f					m_PrevPosition;		// Before the last Update, for drawing between updates
 	ESpeedStates			m_eSpeedState;
 	float					m_fTimer;
 	
 	bool					m_bExplosion;
 	AnimatedSprite*			m_pExplosionSprite;
-	int						m_iExplosionFrame;
+	CAnimator*				m_pAnimator;
+	int						m_iExplosionClip;
+	int						m_hExplosion;		// Playing explosion animation
 };
 
 #endif // _CPLAYER_H_
\ No newline at end of file
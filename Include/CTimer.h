@@ -20,6 +20,32 @@
 // Definitions, Macros & Constants
 //-----------------------------------------------------------------------------
 const ULONG MAX_SAMPLE_COUNT = 50; // Maximum frame time sample count
+const float MIN_SPIN_TIME	 = 0.00025f;	// Shortest spin at the end of a locked frame (seconds)
+const float MAX_SPIN_TIME	 = 0.004f;		// Longest spin at the end of a locked frame (seconds)
+
+const ULONG MAX_HISTORY_COUNT		= 3600;		// Longest statistics window, one minute at 60 FPS
+const ULONG DEFAULT_STATS_WINDOW	= 600;
+const ULONG HISTOGRAM_BUCKETS		= 1000;		// Plus one for everything longer
+const float HISTOGRAM_RESOLUTION	= 0.0001f;	// Width of a bucket (seconds), 0.1ms up to 100ms
+const float STUTTER_FACTOR			= 2.0f;		// A stutter is this many times the average frame
+
+//-----------------------------------------------------------------------------
+// Main Type Declarations
+//-----------------------------------------------------------------------------
+// Frame time statistics over the last GetStatsWindow frames, in seconds.
+// The percentiles are rounded up to the histogram resolution.
+typedef struct
+{
+	ULONG	nFrames;			// Frames in the window
+	float	fMin;
+	float	fMean;
+	float	fP50;
+	float	fP95;
+	float	fP99;
+	float	fMax;
+	ULONG	nStutters;			// Frames in the window over STUTTER_FACTOR times the average
+	ULONG	nTotalStutters;		// Since the timer was created
+} sFrameStats;
 
 //-----------------------------------------------------------------------------
 // Main Class Declarations
@@ -45,6 +71,14 @@ public:
 	void			Tick( float fLockFPS = 0.0f );
 	unsigned long	GetFrameRate( LPTSTR lpszString = NULL, size_t size = 0 ) const;
 	float			GetTimeElapsed() const;
+	float			GetLastFrameTime() const;
+	float			GetFrameJitter() const;
+	float			GetCpuUsage() const;
+
+	void			SetStatsWindow( ULONG nFrames );
+	ULONG			GetStatsWindow() const { return m_StatsWindow; }
+	void			GetFrameStats( sFrameStats *pStats ) const;
+	ULONG			GetFrameHistory( float *pTimes, ULONG nMaxTimes ) const;
 
 private:
 	//------------------------------------------------------------
@@ -53,20 +87,47 @@ private:
 	bool			m_PerfHardware;			 // Has Performance Counter
 	float			m_TimeScale;				// Amount to scale counter
 	float			m_TimeElapsed;			  // Time elapsed since previous frame
+	float			m_LastFrameTime;		// Unsmoothed length of the last frame
 	__int64			m_CurrentTime;			  // Current Performance Counter
 	__int64			m_LastTime;				 // Performance Counter last frame
 	__int64			m_PerfFreq;				 // Performance Frequency
 
-	float			m_FrameTime[MAX_SAMPLE_COUNT];
+	float			m_FrameTime[MAX_SAMPLE_COUNT];	// Ring of the frames that are averaged
 	ULONG			m_SampleCount;
+	ULONG			m_SampleNext;			// Slot the next sample goes in
+	double			m_SampleSum;			// Running sums of the ring, for the mean
+	double			m_SampleSumSq;			// and the jitter
+
+	float			m_History[MAX_HISTORY_COUNT];	// Ring of every frame, for the statistics
+	bool			m_Stutter[MAX_HISTORY_COUNT];
+	ULONG			m_HistoryCount;
+	ULONG			m_HistoryNext;
+	ULONG			m_StatsWindow;			// Frames the statistics cover
+	ULONG			m_Histogram[HISTOGRAM_BUCKETS + 1];	// Frames in the window per bucket
+	ULONG			m_StutterCount;			// Stutters in the window
+	ULONG			m_TotalStutters;
 
 	unsigned long	m_FrameRate;				// Stores current framerate
 	unsigned long	m_FPSFrameCount;			// Elapsed frames in any given second
 	float			m_FPSTimeElapsed;		// How much time has passed during FPS sample
-	
+
+	HANDLE			m_hWaitTimer;			// Timer used to sleep off spare frame time
+	bool			m_RaisedPeriod;			// timeBeginPeriod was needed for short sleeps
+	float			m_SleepError;			// Running estimate of how late sleeps wake up
+	__int64			m_CpuTime;				// Process CPU time at the last FPS sample (100ns)
+	__int64			m_CpuSampleTime;		// Counter value at the last FPS sample
+	float			m_CpuUsage;				// CPU time / wall time over the last FPS sample
+
 	//------------------------------------------------------------
 	// Private Functions For This Class
 	//------------------------------------------------------------
+	__int64			ReadCounter() const;
+	__int64			ReadCpuTime() const;
+	void			WaitForFrame( float fFrameTime );
+	void			AddSample( float fFrameTime );
+	void			AddHistory( float fFrameTime, bool bStutter );
+	void			DropOldestHistory();
+	float			GetPercentile( float fFraction, float fMax ) const;
 };
 
 #endif // _CTIMER_H_
\ No newline at end of file
@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------
+// File: CollisionMask.h
+//
+// Desc: One bit per pixel collision masks. A mask is built once when an
+//		image is loaded, a set bit for every pixel that is drawn, and packed
+//		64 pixels to a word so two sprites are tested 64 pixels at a time.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _COLLISIONMASK_H_
+#define _COLLISIONMASK_H_
+
+//-----------------------------------------------------------------------------
+// CCollisionMask Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int	COLLISION_ALPHA_THRESHOLD	= 128;	// Pixels at least this opaque are solid
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CCollisionMask (Class)
+// Desc : A packed bitmap the size of an image. Each row starts on a new
+//		word, pixel x of a row is bit (x & 63) of word (x >> 6), and the
+//		bits past the right edge are clear. Animated sheets keep one mask
+//		for the whole sheet and are tested one frame rectangle at a time.
+//-----------------------------------------------------------------------------
+class CCollisionMask
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CCollisionMask();
+	virtual ~CCollisionMask();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	// Builds the mask from 32 bit ARGB pixels, nPitch pixels apart per row,
+	// setting the bits whose alpha is at least COLLISION_ALPHA_THRESHOLD
+	bool		Build		( const DWORD *pPixels, int nPitch, int nWidth, int nHeight );
+	void		Release		( );
+
+	int			GetWidth	( ) const	{ return m_nWidth; }
+	int			GetHeight	( ) const	{ return m_nHeight; }
+	bool		IsSolid		( int x, int y ) const
+	{ return ((m_pBits[y * m_nWords + (x >> 6)] >> (x & 63)) & 1) != 0; }
+
+	// Tests rcA of mask A drawn with its top left at (nAX, nAY) against rcB
+	// of mask B drawn at (nBX, nBY). Only the rows both cover are visited,
+	// each one as a few shifted 64 bit ANDs.
+	static bool	Overlap		( const CCollisionMask &A, const RECT &rcA, int nAX, int nAY,
+							  const CCollisionMask &B, const RECT &rcB, int nBX, int nBY );
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+	ULONGLONG	Extract		( int nRow, int nColumn ) const;
+
+	// Make copy constructor and assignment operator private, the mask owns
+	// its bits.
+	CCollisionMask(const CCollisionMask& rhs);
+	CCollisionMask& operator=(const CCollisionMask& rhs);
+
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	ULONGLONG	*m_pBits;
+	int			m_nWidth;
+	int			m_nHeight;
+	int			m_nWords;					// Words per row
+};
+
+#endif // _COLLISIONMASK_H_
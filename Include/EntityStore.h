@@ -0,0 +1,129 @@
+//-----------------------------------------------------------------------------
+// File: EntityStore.h
+//
+// Desc: Storage for the game's many small objects (enemies and their
+//		explosions). Every field lives in its own packed array, so one pass
+//		over the store updates all of them.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _ENTITYSTORE_H_
+#define _ENTITYSTORE_H_
+
+//-----------------------------------------------------------------------------
+// CEntityStore Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "Sprite.h"
+#include "Animation.h"
+#include "FramePipeline.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int	MAX_ENTITY_SPRITES		= 16;		// Distinct sprites entities can use
+const float	ENTITY_NO_LIFETIME		= 0.0f;		// Lives until it is destroyed
+
+// What an entity is doing. The store only keeps the value, the game
+// decides what each state means.
+enum EEntityState
+{
+	ENTITY_ENEMY,			// Enemy plane
+	ENTITY_EXPLODING		// Playing its explosion, removed when it ends
+};
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+// Times the store's update pass from 100 to 100k entities against one heap
+// object per entity, and writes the results to a text file.
+bool RunEntityBenchmark(LPCSTR strFileName);
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CEntityStore (Class)
+// Desc : Structure of arrays entity storage. Live entities are packed at
+//		indices 0 to GetCount() - 1; destroying one moves the last entity
+//		into its place, so an index is only good until the next Create or
+//		DestroyAt.
+//-----------------------------------------------------------------------------
+class CEntityStore
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CEntityStore( int nCapacity, CAnimator *pAnimator = NULL );
+	virtual ~CEntityStore();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	// The store does not own the sprites, the caller deletes them
+	int			AddSprite	( Sprite *pSprite );
+	Sprite*		GetSprite	( int iSprite ) const	{ return m_pSprites[iSprite]; }
+
+	// Returns the new entity's index, or -1 when the store is full. A
+	// positive lifetime counts down in Update and removes the entity at 0.
+	int			Create		( EEntityState eState, int iSprite, float fX, float fY,
+							  float fVelX = 0.0f, float fVelY = 0.0f, float fLifetime = ENTITY_NO_LIFETIME );
+	void		DestroyAt	( int iIndex );
+	void		Clear		( );
+
+	int			GetCount	( ) const	{ return m_nCount; }
+	int			GetCapacity	( ) const	{ return m_nCapacity; }
+
+	// Moves every entity and ages the ones with a lifetime
+	void		Update		( float dt );
+
+	// The two halves of Update. Integrate only touches entities iBegin to
+	// iEnd - 1, so ranges of it can run on different threads; Age removes
+	// entities and must run alone, after them.
+	void		Integrate	( int iBegin, int iEnd, float dt );
+	void		Age			( float dt );
+
+	// Adds a draw command per entity, in index order, fAlpha of the way
+	// from where it was before the last Update to where it is now
+	void		Record		( sFramePacket *pFrame, float fAlpha = 1.0f ) const;
+
+	//-------------------------------------------------------------------------
+	// Field arrays, indexed 0 to GetCount() - 1
+	//-------------------------------------------------------------------------
+	float*		PositionX	( )		{ return m_pPosX; }
+	float*		PositionY	( )		{ return m_pPosY; }
+	const float* PreviousX	( ) const	{ return m_pPrevX; }	// Before the last Update
+	const float* PreviousY	( ) const	{ return m_pPrevY; }
+	float*		VelocityX	( )		{ return m_pVelX; }
+	float*		VelocityY	( )		{ return m_pVelY; }
+	float*		Lifetime	( )		{ return m_pLifetime; }
+	UCHAR*		SpriteId	( )		{ return m_pSprite; }
+	UCHAR*		State		( )		{ return m_pState; }
+	int*		Animation	( )		{ return m_pAnim; }		// Animator handle, -1 for none
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	CAnimator	*m_pAnimator;				// Stops the animations of destroyed entities
+	Sprite		*m_pSprites[MAX_ENTITY_SPRITES];
+	int			m_nSprites;
+
+	int			m_nCapacity;
+	int			m_nCount;
+
+	// Per entity fields, packed
+	float		*m_pPosX;
+	float		*m_pPosY;
+	float		*m_pPrevX;
+	float		*m_pPrevY;
+	float		*m_pVelX;
+	float		*m_pVelY;
+	float		*m_pLifetime;
+	UCHAR		*m_pSprite;
+	UCHAR		*m_pState;
+	int			*m_pAnim;
+};
+
+#endif // _ENTITYSTORE_H_
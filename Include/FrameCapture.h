@@ -0,0 +1,92 @@
+//-----------------------------------------------------------------------------
+// File: FrameCapture.h
+//
+// Desc: Records presented frames to a Y4M or raw YUV 4:2:0 video file. The
+//		game only copies each frame into a ring of preallocated buffers, a
+//		writer thread converts and writes them.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _FRAMECAPTURE_H_
+#define _FRAMECAPTURE_H_
+
+//-----------------------------------------------------------------------------
+// CFrameCapture Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int CAPTURE_RING_SIZE = 8;		// Frames that can wait for the writer
+
+enum ECaptureFormat
+{
+	CAPTURE_Y4M,			// YUV4MPEG2 stream, plays in most video tools
+	CAPTURE_RAW				// Bare I420 planes, one frame after another
+};
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+// Converts a block of top-down 0x00RRGGBB pixels to BT.601 limited range
+// I420. iWidth and iHeight must be even; the U and V planes are half size.
+void ConvertToI420(const DWORD *pSrc, int iPitch, int iWidth, int iHeight,
+				   BYTE *pY, BYTE *pU, BYTE *pV);
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CFrameCapture (Class)
+// Desc : Single producer, single consumer frame ring. Submit never waits: if
+//		every slot is still queued for the writer, the frame is dropped and
+//		counted instead.
+//-----------------------------------------------------------------------------
+class CFrameCapture
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CFrameCapture();
+	virtual ~CFrameCapture();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	bool		Start( LPCSTR strFileName, ECaptureFormat eFormat, int iWidth, int iHeight, int iFrameRate );
+	void		Stop( );
+	void		Submit( const DWORD *pBits, int iWidth, int iHeight, int iPitch );
+
+	bool		IsCapturing( ) const	{ return m_hThread != NULL; }
+	ULONG		GetFramesWritten( ) const	{ return (ULONG)m_lRead; }
+	ULONG		GetFramesDropped( ) const	{ return (ULONG)m_lDropped; }
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+	void		WritePending( );
+	static DWORD WINAPI	WriterThreadProc( LPVOID pParam );
+
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	FILE				*m_pFile;
+	ECaptureFormat		m_eFormat;
+	int					m_iWidth;			// Captured size, rounded down to even
+	int					m_iHeight;
+
+	DWORD				*m_pSlots[CAPTURE_RING_SIZE];
+	BYTE				*m_pYUV;			// Converted frame, Y then U then V
+
+	HANDLE				m_hThread;
+	HANDLE				m_hWakeEvent;		// Signalled when a frame is queued
+	volatile LONG		m_lWritten;			// Frames submitted to the ring
+	volatile LONG		m_lRead;			// Frames the writer has finished
+	volatile LONG		m_lDropped;
+	volatile LONG		m_lQuit;
+};
+
+#endif // _FRAMECAPTURE_H_
@@ -0,0 +1,102 @@
+//-----------------------------------------------------------------------------
+// File: FramePipeline.h
+//
+// Desc: Hand-off between the simulation and the renderer. The simulation
+//		describes each frame as a packet of draw commands and the renderer
+//		draws from the newest complete packet, so both can run on separate
+//		threads without sharing any mutable game state.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _FRAMEPIPELINE_H_
+#define _FRAMEPIPELINE_H_
+
+//-----------------------------------------------------------------------------
+// CFrameExchange Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "Sprite.h"
+#include "BackgroundLayer.h"
+#include "Hud.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int MAX_DRAW_COMMANDS = 4096;		// Sprites drawn in a single frame
+
+//-----------------------------------------------------------------------------
+// Main Type Declarations
+//-----------------------------------------------------------------------------
+// One sprite draw. Only the sprite's images are shared with the renderer,
+// its position and animation frame are copied here.
+typedef struct
+{
+	Sprite		*pSprite;
+	float		fX;				// Centre position
+	float		fY;
+	int			iFrame;			// Sheet frame of animated sprites, -1 for others
+} sDrawCommand;
+
+// Everything the renderer needs to draw one frame
+typedef struct
+{
+	ULONG			nFrame;									// Simulation frame number
+	float			fLayerX[MAX_BACKGROUND_LAYERS];			// Background scroll offsets
+	float			fLayerY[MAX_BACKGROUND_LAYERS];
+	bool			bMenu;									// Draw the pause menu
+	POINT			ptCursor;								// Menu input
+	bool			bMouseDown;
+	sDrawCommand	Commands[MAX_DRAW_COMMANDS];
+	int				nCommands;
+	float			fRenderScale;							// Resolution the scene is drawn at
+	bool			bHud;									// Draw the performance overlay
+	sHudStats		HudStats;
+} sFramePacket;
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+void AddDrawCommand(sFramePacket *pFrame, Sprite *pSprite, float fX, float fY, int iFrame);
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CFrameExchange (Class)
+// Desc : Lock-free triple buffer with one producer and one consumer. The
+//		producer always has a packet of its own to fill, the consumer always
+//		has one to draw, and the third holds the newest published frame.
+//		Publishing swaps the producer's packet with that one; acquiring
+//		swaps the consumer's. Neither side ever waits for the other, and a
+//		frame that is superseded before it is drawn is simply dropped.
+//-----------------------------------------------------------------------------
+class CFrameExchange
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CFrameExchange();
+	virtual ~CFrameExchange() {}
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	// Producer side
+	sFramePacket*	GetWriteFrame()			{ return &m_Frames[m_iWrite]; }
+	void			Publish();
+
+	// Consumer side, returns NULL when nothing new was published
+	sFramePacket*	AcquireLatest();
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	sFramePacket	m_Frames[3];
+	int				m_iWrite;			// Owned by the producer
+	int				m_iRead;			// Owned by the consumer
+	volatile LONG	m_Latest;			// Index of the newest frame, plus FRESH_FRAME if unread
+};
+
+#endif // _FRAMEPIPELINE_H_
@@ -0,0 +1,73 @@
+//-----------------------------------------------------------------------------
+// File: GoldenFrames.h
+//
+// Desc: Support for the golden frame regression run. A fixed input script
+//		drives the game, every rendered frame is hashed and the hashes are
+//		compared with a stored list, so a renderer change can be proven to
+//		leave the output untouched.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _GOLDENFRAMES_H_
+#define _GOLDENFRAMES_H_
+
+//-----------------------------------------------------------------------------
+// CGoldenLog Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int MAX_GOLDEN_FRAMES		= 3600;		// One minute at 60 frames per second
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+// 64 bit FNV-1a hash of the colour bytes of a 32 bit surface. The unused top
+// byte is ignored, GDI does not keep it consistent.
+ULONGLONG	HashFrame(const DWORD *pBits, int iWidth, int iHeight, int iPitch);
+
+// Writes a 32 bit surface to a bottom-up 24 bit .bmp file
+bool		SaveFrameBitmap(LPCSTR strFileName, const DWORD *pBits, int iWidth, int iHeight, int iPitch);
+
+// Fills the keyboard state (GetKeyboardState layout) and cursor position the
+// scripted scenario uses for frame nFrame.
+void		GetScriptedInput(ULONG nFrame, UCHAR *pKeys, POINT *pCursor);
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CGoldenLog (Class)
+// Desc : The list of expected frame hashes. Stored as text, one "frame hash"
+//		pair per line, so a changed frame shows up plainly in a diff.
+//-----------------------------------------------------------------------------
+class CGoldenLog
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CGoldenLog();
+	virtual ~CGoldenLog() {}
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	bool		Load( LPCSTR strFileName );
+	bool		Save( LPCSTR strFileName ) const;
+
+	void		SetHash( ULONG nFrame, ULONGLONG Hash );
+	bool		GetHash( ULONG nFrame, ULONGLONG &Hash ) const;
+	ULONG		GetFrameCount( ) const	{ return m_nFrames; }
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	ULONGLONG	m_Hashes[MAX_GOLDEN_FRAMES];
+	ULONG		m_nFrames;
+};
+
+#endif // _GOLDENFRAMES_H_
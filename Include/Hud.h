@@ -0,0 +1,91 @@
+//-----------------------------------------------------------------------------
+// File: Hud.h
+//
+// Desc: Performance overlay drawn straight into the back buffer: frame rate,
+//		frame time percentiles, per-phase timings and a rolling frame time
+//		graph, written with a cached bitmap font.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _HUD_H_
+#define _HUD_H_
+
+//-----------------------------------------------------------------------------
+// CHud Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "Blitter.h"
+#include "CTimer.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int HUD_GRAPH_SAMPLES		= 120;		// Frames shown in the graph
+const int HUD_FIRST_GLYPH		= 32;		// Printable ASCII only
+const int HUD_LAST_GLYPH		= 126;
+const int HUD_MAX_GLYPH_SIZE	= 32;		// One DWORD of bits per glyph row
+
+//-----------------------------------------------------------------------------
+// Main Type Declarations
+//-----------------------------------------------------------------------------
+// Everything the overlay shows, copied into each frame packet so that the
+// render thread never reads the live statistics.
+typedef struct
+{
+	float	fFrameMs[HUD_GRAPH_SAMPLES];		// Oldest first
+	int		nSamples;
+	ULONG	nFrameRate;
+	float	fMinMs;
+	float	fP50Ms;
+	float	fP95Ms;
+	float	fP99Ms;
+	float	fMaxMs;
+	ULONG	nStutters;							// In the timer's statistics window
+	float	fSimMs;								// Input, animation and frame recording
+	float	fDrawMs;							// Last drawn frame, including the overlay
+	float	fCpuUsage;
+} sHudStats;
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CHud (Class)
+// Desc : Collects frame timings on the simulation thread and draws them on
+//		the render thread with a font cached as glyph bit rows.
+//-----------------------------------------------------------------------------
+class CHud
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CHud();
+	virtual ~CHud() {}
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	bool		BuildFont	( LPCTSTR strFace, int iHeight );
+
+	void		SetPhaseTimes( float fSimMs, float fDrawMs );
+	void		GetStats	( sHudStats *pStats, const CTimer &Timer ) const;
+
+	void		Draw		( const sSurface &dst, const sHudStats &Stats ) const;
+	int			DrawString	( const sSurface &dst, int x, int y, LPCSTR strText, DWORD dwColor ) const;
+
+	int			GetLineHeight( ) const	{ return m_iGlyphHeight + 2; }
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	DWORD		m_Glyphs[HUD_LAST_GLYPH - HUD_FIRST_GLYPH + 1][HUD_MAX_GLYPH_SIZE];	// Bit 0 = left column
+	int			m_iGlyphWidth;
+	int			m_iGlyphHeight;
+
+	float		m_fSimMs;
+	float		m_fDrawMs;
+};
+
+#endif // _HUD_H_
@@ -27,6 +27,7 @@ protected:
 	BITMAPINFOHEADER m_biInfo;
 	RGBQUAD *m_pRGB;
 	HBITMAP m_hBMP;
+	bool m_bDirty;		// m_pRGB changed since it was last copied to m_hBMP
 
 	LONG &height;
 	LONG &width;
@@ -38,13 +39,17 @@ public:
 
 	bool LoadBitmapFromFile(const char* szFileName, HDC hdc);
 	virtual void Paint(HDC hdc, int x, int y);
+	void PaintRect(HDC hdc, int x, int y, int srcX, int srcY, int w, int h);
 
 	LONG Height() const { return height; }
 	LONG Width() const { return width; }
 
-	void Clear() { ZeroMemory(m_pRGB, sizeof(RGBQUAD) * width * height); }
+	void Clear() { ZeroMemory(m_pRGB, sizeof(RGBQUAD) * width * height); m_bDirty = true; }
 	void Reload(HDC hdc);
 
 	BYTE* CopyMonoImage(EColorChannel chn, const RECT* rc = NULL);
 	void PasteMonoImage(const BYTE *img, EColorChannel chn, const RECT* rc = NULL);
+
+protected:
+	bool Upload(HDC hdc);
 };
\ No newline at end of file
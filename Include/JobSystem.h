@@ -0,0 +1,184 @@
+//-----------------------------------------------------------------------------
+// File: JobSystem.h
+//
+// Desc: Work stealing job system. Every thread, the one that created the
+//		system included, owns a queue of jobs. A thread runs the jobs of its
+//		own queue newest first and steals the oldest job of another queue
+//		when its own is empty. Jobs can be split over a range of indices
+//		(parallel for), can wait on child jobs and can start other jobs when
+//		they finish, which chains whole frames of work into a graph.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _JOBSYSTEM_H_
+#define _JOBSYSTEM_H_
+
+//-----------------------------------------------------------------------------
+// CJobSystem Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int	MAX_JOB_THREADS			= 32;		// Threads in a system, the creating one included
+const int	JOB_QUEUE_SIZE			= 4096;		// Jobs waiting in one queue, a power of two
+const int	JOB_POOL_SIZE			= 4096;		// Jobs a thread creates before its pool wraps, a power of two
+const int	MAX_JOB_SPLITS			= 1024;		// A parallel for makes at most twice this many pieces
+const int	MAX_JOB_CONTINUATIONS	= 4;		// Jobs started by one job finishing
+const int	JOB_SPIN_COUNT			= 4096;		// Empty looks for work before a worker sleeps
+
+//-----------------------------------------------------------------------------
+// Main Type Declarations
+//-----------------------------------------------------------------------------
+// Runs indices iBegin to iEnd - 1. Jobs without a range get 0, 0.
+typedef void (*LPJOBFUNCTION)(void *pContext, int iBegin, int iEnd);
+
+// Jobs come from the pools of the system and are only handed out as
+// pointers. A job is finished when it and all its children have run.
+typedef struct _sJob
+{
+	LPJOBFUNCTION	pFunction;
+	void			*pContext;
+	int				iBegin;
+	int				iEnd;
+	int				nGrain;							// Split while the range is longer, 0 never
+	struct _sJob	*pParent;
+	volatile LONG	lUnfinished;					// This job and its unfinished children
+	volatile LONG	lContinuations;
+	struct _sJob	*pContinuations[MAX_JOB_CONTINUATIONS];
+} sJob;
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+// Times a parallel for over shot integration with 1 thread up to one per
+// core, checks each result against the single thread one, and writes the
+// scaling to a text file.
+bool RunJobBenchmark(LPCSTR strFileName);
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CJobQueue (Class)
+// Desc : Chase-Lev work stealing deque of fixed size. The owning thread
+//		pushes and pops at the bottom without locking; other threads steal
+//		from the top, and a compare and swap on the top settles the race for
+//		the last job.
+//-----------------------------------------------------------------------------
+class CJobQueue
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CJobQueue( ) { m_lTop = 0; m_lBottom = 0; }
+	virtual ~CJobQueue( ) {}
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	// Owner only. Push returns false when the queue is full.
+	bool		Push	( sJob *pJob );
+	sJob*		Pop		( );
+
+	// Any thread
+	sJob*		Steal	( );
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	volatile LONG	m_lTop;
+	volatile LONG	m_lBottom;
+	sJob			*m_pJobs[JOB_QUEUE_SIZE];
+};
+
+//-----------------------------------------------------------------------------
+// Name : CJobSystem (Class)
+// Desc : Starts nThreads - 1 worker threads; the creating thread is the
+//		first one and runs jobs while it waits. Jobs may only be created and
+//		run from threads of the system. A thread's pool is a ring, so no
+//		thread may have more than JOB_POOL_SIZE jobs alive at once.
+//
+//		Results only depend on the scheduling when jobs share data, so jobs
+//		that each write their own range give the same answer on any number
+//		of threads.
+//-----------------------------------------------------------------------------
+class CJobSystem
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	// 0 threads uses one per core
+			 CJobSystem( int nThreads = 0 );
+	virtual ~CJobSystem();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	// A child keeps its parent from finishing until the child has run.
+	// pFunction may be NULL for a job that only groups its children.
+	sJob*		CreateJob		( LPJOBFUNCTION pFunction, void *pContext, sJob *pParent = NULL );
+
+	// Runs pFunction over 0 to nCount - 1 in pieces of at most nGrain, or
+	// of nCount / MAX_JOB_SPLITS when that is larger, splitting the range
+	// in halves as threads steal it.
+	sJob*		CreateParallelFor( LPJOBFUNCTION pFunction, void *pContext, int nCount, int nGrain, sJob *pParent = NULL );
+
+	// pContinuation is run once pJob has finished. Call before pJob runs.
+	void		AddContinuation	( sJob *pJob, sJob *pContinuation );
+
+	void		Run				( sJob *pJob );
+
+	// Runs jobs until pJob has finished
+	void		Wait			( const sJob *pJob );
+
+	// Create, run and wait in one
+	void		ParallelFor		( LPJOBFUNCTION pFunction, void *pContext, int nCount, int nGrain );
+
+	int			GetThreadCount	( ) const	{ return m_nThreads; }
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Type Declarations
+	//-------------------------------------------------------------------------
+	typedef struct
+	{
+		CJobQueue	Queue;
+		sJob		*pJobs;				// Pool, JOB_POOL_SIZE jobs
+		ULONG		nAllocated;
+		ULONG		nSeed;				// Picks the queue to steal from
+		HANDLE		hThread;			// NULL for the creating thread
+		CJobSystem	*pSystem;
+		int			iIndex;
+	} sWorker;
+
+	//-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+	sJob*		AllocateJob		( );
+	sJob*		CreateRangeJob	( LPJOBFUNCTION pFunction, void *pContext, int iBegin, int iEnd, int nGrain, sJob *pParent );
+	sJob*		GetJob			( sWorker *pWorker );
+	void		Execute			( sJob *pJob );
+	void		Finish			( sJob *pJob );
+	sWorker*	GetWorker		( );
+
+	//-------------------------------------------------------------------------
+	// Private Static Functions For This Class
+	//-------------------------------------------------------------------------
+	static DWORD WINAPI	WorkerThreadProc( LPVOID pParam );
+
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	sWorker			*m_pWorkers;
+	int				m_nThreads;
+	HANDLE			m_hWake;			// Semaphore the idle workers sleep on
+	volatile LONG	m_lSleeping;
+	volatile LONG	m_lQuit;
+};
+
+#endif // _JOBSYSTEM_H_
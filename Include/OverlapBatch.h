@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------
+// File: OverlapBatch.h
+//
+// Desc: Batched overlap tests. One box or circle is tested against a whole
+//		structure of arrays batch of boxes or circles, four or eight at a
+//		time with SSE2 or AVX2, and the answer comes back as a hit bitmask
+//		that can be turned into a list of indices.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _OVERLAPBATCH_H_
+#define _OVERLAPBATCH_H_
+
+//-----------------------------------------------------------------------------
+// OverlapBatch Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Main Type Declarations
+//-----------------------------------------------------------------------------
+// Boxes as four arrays of nCount edges. Boxes overlap only when they
+// share more than an edge, as in the broad phase.
+typedef struct
+{
+	const float	*pMinX;
+	const float	*pMinY;
+	const float	*pMaxX;
+	const float	*pMaxY;
+	int			nCount;
+} sBoxBatch;
+
+// Circles as centre and radius arrays. Circles overlap when their centres
+// are closer than the sum of their radii.
+typedef struct
+{
+	const float	*pX;
+	const float	*pY;
+	const float	*pRadius;
+	int			nCount;
+} sCircleBatch;
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+// Bit (i & 7) of pHitBits[i >> 3] is set when entry i overlaps the query
+// and cleared otherwise. pHitBits needs (nCount + 7) / 8 bytes. Both
+// return the number of hits.
+int OverlapBoxBatch		( float fMinX, float fMinY, float fMaxX, float fMaxY, const sBoxBatch &Batch, BYTE *pHitBits );
+int OverlapCircleBatch	( float fX, float fY, float fRadius, const sCircleBatch &Batch, BYTE *pHitBits );
+
+// Writes the indices of the set bits in ascending order, returns how many
+int HitBitsToIndices	( const BYTE *pHitBits, int nCount, int *pIndices );
+
+// Times the scalar, SSE2 and AVX2 tests over several batch sizes and
+// writes the results to a text file.
+bool RunOverlapBenchmark( LPCSTR strFileName );
+
+#endif // _OVERLAPBATCH_H_
@@ -0,0 +1,31 @@
+//-----------------------------------------------------------------------------
+// File: Palette.h
+//
+// Desc: Colour quantization for indexed sprites. Images are reduced to a
+//		256 entry palette at load time with median cut.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _PALETTE_H_
+#define _PALETTE_H_
+
+//-----------------------------------------------------------------------------
+// Palette Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int PALETTE_SIZE = 256;	// Entries in a sprite palette, index 0 is transparent
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+// Builds a palette for iCount ARGB pixels and writes one index per pixel.
+// Pixels equal to 0 (fully transparent) always map to index 0, images with
+// fewer than PALETTE_SIZE colours are reproduced exactly. pPalette must hold
+// PALETTE_SIZE entries; returns the number of entries used.
+int QuantizeImage(const DWORD *pPixels, int iCount, DWORD *pPalette, BYTE *pIndices);
+
+#endif // _PALETTE_H_
@@ -0,0 +1,89 @@
+//-----------------------------------------------------------------------------
+// File: Profiler.h
+//
+// Desc: Scoped timing zones for the hot paths. Each thread records into a
+//		buffer of its own without locks; a capture is written out as Chrome
+//		trace event JSON, which chrome://tracing and Perfetto can open.
+//
+//		The zones are only compiled in when ENABLE_PROFILER is defined in
+//		the project's preprocessor settings. Without it PROFILE_ZONE and
+//		friends expand to nothing and cost nothing.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+//-----------------------------------------------------------------------------
+// Profiler Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "JobSystem.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+// Threads that can record zones: every job thread, the main one among
+// them, and the render, capture and telemetry threads
+const int PROFILE_MAX_THREADS	= MAX_JOB_THREADS + 3;
+const int PROFILE_MAX_EVENTS	= 65536;	// Zones kept per thread and capture
+const int PROFILE_NAME_LENGTH	= 32;		// Longest thread name
+
+#define PROFILE_CONCAT_(a, b)	a##b
+#define PROFILE_CONCAT(a, b)	PROFILE_CONCAT_(a, b)
+
+#if defined(ENABLE_PROFILER)
+	// Times the rest of the enclosing scope. strName must be a string literal
+	// or otherwise outlive the capture, only the pointer is stored.
+	#define PROFILE_ZONE(strName)			CProfileZone PROFILE_CONCAT(ProfileZone, __LINE__)(strName)
+	#define PROFILE_FUNCTION()				PROFILE_ZONE(__FUNCTION__)
+	#define PROFILE_THREAD_NAME(strName)	ProfilerSetThreadName(strName)
+#else
+	#define PROFILE_ZONE(strName)
+	#define PROFILE_FUNCTION()
+	#define PROFILE_THREAD_NAME(strName)
+#endif
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+// Starts a capture, dropping what earlier ones recorded. Zones are only
+// recorded while a capture runs. Call it while no other thread records.
+void	ProfilerStart();
+void	ProfilerStop();
+bool	ProfilerIsRecording();
+
+// Writes the stopped capture as a Chrome trace. Returns false if the file
+// cannot be written. Call it once the recording threads have stopped.
+bool	ProfilerWriteTrace(LPCSTR strFileName);
+
+// Names the calling thread in the trace
+void	ProfilerSetThreadName(LPCSTR strName);
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CProfileZone (Class)
+// Desc : Reads the counter when it is created and records a zone on the
+//		calling thread's buffer when it goes out of scope. Use the
+//		PROFILE_ZONE macro rather than this class, so that it compiles out.
+//-----------------------------------------------------------------------------
+class CProfileZone
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+	 CProfileZone(LPCSTR strName);
+	~CProfileZone();
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	LPCSTR		m_strName;
+	__int64		m_nStart;				// 0 when no capture was running
+};
+
+#endif // _PROFILER_H_
@@ -0,0 +1,200 @@
+//-----------------------------------------------------------------------------
+// File: Projectiles.h
+//
+// Desc: Bullets and missiles. Projectiles live in a fixed size pool that is
+//		moved and culled in one pass per frame, and are spawned by emitters
+//		that play firing patterns described by plain data tables.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _PROJECTILES_H_
+#define _PROJECTILES_H_
+
+//-----------------------------------------------------------------------------
+// CProjectilePool Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "Sprite.h"
+#include "FramePipeline.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int MAX_PROJECTILE_SPRITES	= 8;
+const int MAX_EMITTER_SHOTS			= 16;		// Shots one Update can make up for
+
+// Who fired a projectile, and so what it can hit
+enum EProjectileTeam
+{
+	PROJECTILE_PLAYER,
+	PROJECTILE_ENEMY
+};
+
+enum EEmitterPattern
+{
+	EMIT_STREAM,			// One projectile per shot along the emitter's angle
+	EMIT_SPREAD,			// nCount projectiles fanned over fSpread around the angle
+	EMIT_RING,				// nCount projectiles evenly around a full circle
+	EMIT_AIMED				// A spread centred on the aim point instead of the angle
+};
+
+//-----------------------------------------------------------------------------
+// Main Type Declarations
+//-----------------------------------------------------------------------------
+// A firing pattern. Angles are in radians, 0 points right and positive
+// angles turn down the screen.
+typedef struct
+{
+	EEmitterPattern	ePattern;
+	int				nCount;			// Projectiles per shot
+	float			fSpread;		// Arc covered by a spread
+	float			fAngle;			// Direction of streams, spreads and the first ring projectile
+	float			fSpin;			// Added to the angle after every shot
+	float			fSpeed;			// Pixels per second
+	float			fRate;			// Shots per second
+	float			fLifetime;		// Seconds before an unculled projectile is removed
+} sEmitterDesc;
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+// Fires a stream for two ticks the way the game's tick does, integrating
+// the pool before emitting, and checks that a shot fired exactly at the
+// end of a tick is at the muzzle.
+bool CheckShotTiming();
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CProjectilePool (Class)
+// Desc : Structure of arrays projectile storage with a fixed capacity. The
+//		live projectiles are packed at the front and the free space is the
+//		rest of the arrays, so spawning is an append and Update compacts
+//		the survivors in place. Nothing is allocated after construction.
+//-----------------------------------------------------------------------------
+class CProjectilePool
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CProjectilePool( int nCapacity );
+	virtual ~CProjectilePool();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	// The pool does not own the sprites, the caller deletes them
+	int			AddSprite	( Sprite *pSprite );
+	Sprite*		GetSprite	( int iSprite ) const	{ return m_pSprites[iSprite]; }
+
+	// Returns false, and counts the projectile as dropped, when the pool is
+	// full. A projectile that has already flown for fAge seconds starts
+	// that far from (fX, fY), which is kept as where it was so collision
+	// tests the whole path. Spawn only appends, so it can run while
+	// Integrate moves the projectiles that were already there.
+	bool		Spawn		( EProjectileTeam eTeam, int iSprite, float fX, float fY,
+							  float fVelX, float fVelY, float fLifetime, float fAge = 0.0f );
+
+	// Marks a projectile as spent, the next Update removes it
+	void		Kill		( int iIndex )	{ m_pLife[iIndex] = 0.0f; }
+	void		Clear		( )				{ m_nCount = 0; }
+
+	// Moves every projectile, then removes the spent ones, the expired
+	// ones and those outside rcBounds
+	void		Update		( float dt, const RECT &rcBounds );
+
+	// The two halves of Update. Integrate moves and ages projectiles iBegin
+	// to iEnd - 1 only, so ranges of it can run on different threads;
+	// Compact removes projectiles and must run alone, after them.
+	void		Integrate	( int iBegin, int iEnd, float dt );
+	void		Compact		( const RECT &rcBounds );
+
+	// Draws each projectile fAlpha of the way from its previous position
+	// to its current one, 1 draws them where they are
+	void		Record		( sFramePacket *pFrame, float fAlpha = 1.0f ) const;
+
+	int			GetCount	( ) const	{ return m_nCount; }
+	int			GetCapacity	( ) const	{ return m_nCapacity; }
+	ULONG		GetDropped	( ) const	{ return m_nDropped; }
+
+	//-------------------------------------------------------------------------
+	// Field arrays, indexed 0 to GetCount() - 1
+	//-------------------------------------------------------------------------
+	const float*	PositionX	( ) const	{ return m_pPosX; }
+	const float*	PositionY	( ) const	{ return m_pPosY; }
+	const float*	PreviousX	( ) const	{ return m_pPrevX; }		// Before the last Update
+	const float*	PreviousY	( ) const	{ return m_pPrevY; }
+	const float*	Life		( ) const	{ return m_pLife; }		// 0 once killed
+	const UCHAR*	SpriteId	( ) const	{ return m_pSprite; }
+	const UCHAR*	Team		( ) const	{ return m_pTeam; }
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	Sprite		*m_pSprites[MAX_PROJECTILE_SPRITES];
+	int			m_nSprites;
+
+	int			m_nCapacity;
+	int			m_nCount;
+	ULONG		m_nDropped;
+
+	float		*m_pPosX;
+	float		*m_pPosY;
+	float		*m_pPrevX;
+	float		*m_pPrevY;
+	float		*m_pVelX;
+	float		*m_pVelY;
+	float		*m_pLife;					// Seconds left
+	UCHAR		*m_pSprite;
+	UCHAR		*m_pTeam;
+};
+
+//-----------------------------------------------------------------------------
+// Name : CEmitter (Class)
+// Desc : Plays an sEmitterDesc. Update keeps the firing clock and says how
+//		many shots are due; Emit spawns them from a position. Emit does not
+//		change the emitter, so one clock can fire a volley from many guns.
+//		Shots that fell due part way through a frame are moved forward by
+//		the time they have already been flying, so streams stay evenly
+//		spaced at any frame rate.
+//-----------------------------------------------------------------------------
+class CEmitter
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CEmitter();
+	virtual ~CEmitter() {}
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	void		SetPattern	( const sEmitterDesc *pDesc, EProjectileTeam eTeam, int iSprite );
+	const sEmitterDesc*	GetPattern( ) const	{ return m_pDesc; }
+
+	// Advances the clock while the trigger is held, returns the shots due.
+	// A released trigger lets the next shot go as soon as it is pressed.
+	int			Update		( float dt, bool bTrigger );
+
+	// Spawns nShots shots, as returned by Update, from (fX, fY). Aimed
+	// patterns point at (fAimX, fAimY). Returns the projectiles spawned.
+	// The shots are placed where they are at the end of the tick, so call
+	// it once the pool has been integrated for the tick.
+	int			Emit		( CProjectilePool *pPool, float fX, float fY, float fAimX, float fAimY, int nShots ) const;
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	const sEmitterDesc	*m_pDesc;
+	EProjectileTeam		m_eTeam;
+	int					m_iSprite;
+	float				m_fTimer;		// Seconds until the next shot
+	float				m_fSpinAngle;	// Spin added by the shots so far
+};
+
+#endif // _PROJECTILES_H_
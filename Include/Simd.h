@@ -0,0 +1,33 @@
+//-----------------------------------------------------------------------------
+// File: Simd.h
+//
+// Desc: SIMD instruction set selection shared by the software renderer and
+//		the batch math code. SSE2 is used whenever the compiler targets it,
+//		AVX2 paths are compiled in and picked at run time if the CPU has it.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define SIMD_SSE2
+	#include <emmintrin.h>
+#endif
+
+// MSVC lets any translation unit use AVX2 intrinsics, other compilers only
+// when the whole file is built for AVX2.
+#if defined(SIMD_SSE2) && (defined(_MSC_VER) || defined(__AVX2__))
+	#define SIMD_AVX2
+	#include <immintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+bool CpuHasAVX2();		// True if the CPU and OS both support AVX2
+
+#endif // _SIMD_H_
@@ -5,8 +5,11 @@
 #define SPRITE_H
 
 #include "main.h"
-#include "Vec2.h"
+#include "VecMath.h"
 #include "BackBuffer.h"
+#include "SpriteAtlas.h"
+#include "Animation.h"
+#include "Blitter.h"
 
 class Sprite
 {
@@ -14,6 +17,10 @@ public:
 	Sprite(int imageID, int maskID);
 	Sprite(const char *szImageFile, const char *szMaskFile);
 	Sprite(const char *szImageFile, COLORREF crTransparentColor);
+	Sprite(CSpriteAtlas *pAtlas, const char *szImageFile, const char *szMaskFile);
+	Sprite(CSpriteAtlas *pAtlas, const char *szImageFile, COLORREF crTransparentColor);
+	Sprite(CSpriteAtlas *pAtlas, const char *szImageFile, const char *szMaskFile, EAtlasFormat eFormat);
+	Sprite(CSpriteAtlas *pAtlas, const char *szImageFile, COLORREF crTransparentColor, EAtlasFormat eFormat);
 
 	virtual ~Sprite();
 
@@ -22,13 +29,42 @@ public:
 	void update(float dt);
 
 	void setBackBuffer(const BackBuffer *pBackBuffer);
-	virtual void draw();
+	void draw();
+
+	// Draws at an explicit centre position instead of mPosition; iFrame
+	// selects the sheet frame of animated sprites, -1 keeps the current one.
+	virtual void drawAt(float fX, float fY, int iFrame);
+
+	// Rotation (radians) and scale around the sprite's center. Only
+	// atlas sprites can be transformed, others keep drawing upright.
+	void setTransform(float fAngle, float fScaleX, float fScaleY);
+	void setFilter(EBlitFilter eFilter) { meFilter = eFilter; }
+
+	// Alpha and additive blending use the atlas alpha channel and
+	// are only available to upright atlas sprites. Indexed sprites
+	// always blend, transformed or not.
+	void setBlendMode(EBlendMode eBlend) { meBlend = eBlend; }
+
+	// Screen rectangle covered when drawn with drawAt at (fX, fY).
+	void getBounds(float fX, float fY, int iFrame, RECT &rc) const;
+
+	// Pixel accurate test against another sprite, both placed as drawAt
+	// would place them. Sprites outside an atlas have no collision mask
+	// and count as solid rectangles.
+	bool collides(float fX, float fY, int iFrame, const Sprite &other, float fOtherX, float fOtherY, int iOtherFrame) const;
+
+	// Swept version of collides for fast movers: the sprite travels from
+	// (fFromX, fFromY) to (fToX, fToY) while the other one stays put, so
+	// nothing is skipped however far it moved. fTime is the fraction of
+	// the move at the first contact found.
+	bool sweeps(float fFromX, float fFromY, float fToX, float fToY, int iFrame,
+				const Sprite &other, float fOtherX, float fOtherY, int iOtherFrame, float &fTime) const;
 
 public:
 	// Keep these public because they need to be
 	// modified externally frequently.
-	Vec2 mPosition;
-	Vec2 mVelocity;
+	Vec2f mPosition;
+	Vec2f mVelocity;
 
 private:
 	// Make copy constructor and assignment operator private
@@ -47,9 +83,29 @@ protected:
 	HDC mhSpriteDC;
 	const BackBuffer *mpBackBuffer;
 
+	// Set when the sprite's pixels live in a shared atlas page
+	// instead of its own bitmaps; mhImage and mhMask are 0 then.
+	const CSpriteAtlas *mpAtlas;
+	int miAtlasEntry;
+
+	float mfAngle;
+	float mfScaleX;
+	float mfScaleY;
+	EBlitFilter meFilter;
+	EBlendMode meBlend;
+
 	COLORREF mcTransparentColor;
-	void drawTransparent();
-	void drawMask();
+	void drawTransparent(float fX, float fY);
+	void drawMask(float fX, float fY);
+	void blitMasked(int x, int y, int w, int h, int srcX, int srcY);
+	bool blitTransformed(int x, int y, int w, int h, int srcX, int srcY);
+	bool blitBlended(int x, int y, int w, int h, int srcX, int srcY);
+	void blitIndexed(int x, int y, int w, int h, int srcX, int srcY);
+	void initTransform();
+	void initAtlas(CSpriteAtlas *pAtlas, int iEntry);
+
+	// Rectangle of a frame inside the image, -1 for the current frame.
+	virtual void getFrameRect(int iFrame, RECT &rc) const;
 };
 
 // AnimatedSprite
@@ -58,22 +114,24 @@ protected:
 class AnimatedSprite : public Sprite
 {
 public:
-	//NOTE: The animation is on a single row.
-	AnimatedSprite(const char *szImageFile, const char *szMaskFile, const RECT& rcFirstFrame, int iFrameCount);
+	//NOTE: Frames are laid out row by row, iColumns frames per row.
+	AnimatedSprite(const char *szImageFile, const char *szMaskFile, const RECT& rcFirstFrame, int iColumns, int iRows, int iFrameCount);
+	AnimatedSprite(CSpriteAtlas *pAtlas, const char *szImageFile, const char *szMaskFile, const RECT& rcFirstFrame, int iColumns, int iRows, int iFrameCount);
 	virtual ~AnimatedSprite() { }
 
 public:
 	void SetFrame(int iIndex);
-	int GetFrameCount() { return miFrameCount; }
+	int GetFrameCount() { return mSheet.GetFrameCount(); }
 
-	virtual void draw();
+	virtual void drawAt(float fX, float fY, int iFrame);
 	
 protected:
-	POINT mptFrameStartCrop;// first point of the frame (upper-left corner)
+	virtual void getFrameRect(int iFrame, RECT &rc) const;
+
+	CSpriteSheet mSheet;	// precomputed frame rectangles
 	POINT mptFrameCrop;		// crop point of frame
 	int miFrameWidth;		// width
 	int miFrameHeight;		// height
-	int miFrameCount;		// number of frames
 };
 
 
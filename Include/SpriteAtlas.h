@@ -0,0 +1,162 @@
+//-----------------------------------------------------------------------------
+// File: SpriteAtlas.h
+//
+// Desc: Load-time sprite atlas. Sprite images and their masks are packed into
+//		a few large 32 bit pages so that drawing never has to switch the
+//		bitmap selected into a DC and neighbouring sprites share memory.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _SPRITEATLAS_H_
+#define _SPRITEATLAS_H_
+
+//-----------------------------------------------------------------------------
+// CSpriteAtlas Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "Palette.h"
+#include "CollisionMask.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int ATLAS_PAGE_SIZE	 = 1024;	// Width and height of every atlas page
+const int ATLAS_MAX_PAGES	 = 4;		// Maximum number of pages
+const int ATLAS_MAX_ENTRIES	 = 64;		// Maximum number of packed images
+const int ATLAS_PADDING		 = 1;		// Empty gutter kept around each image
+
+// How an image is stored in its page
+enum EAtlasFormat
+{
+	ATLAS_RGB,			// 32 bit premultiplied ARGB, with a GDI mask page
+	ATLAS_INDEXED		// One byte per pixel plus a per image palette
+};
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CSkylinePacker (Class)
+// Desc : Bottom-left skyline rectangle packer. Keeps the top edge of the
+//		already packed area as a list of horizontal segments and places each
+//		new rectangle at the lowest position it fits.
+//-----------------------------------------------------------------------------
+class CSkylinePacker
+{
+	typedef struct
+	{
+		int x, y;			// Left end and height of the segment
+		int width;			// Length of the segment
+	} sSkylineNode;
+
+public:
+	CSkylinePacker(int iWidth, int iHeight);
+
+	// Reserve a w x h rectangle, returns false when the bin is full
+	bool Insert(int w, int h, int &x, int &y);
+
+private:
+	int  Fit(int iNode, int w, int h) const;
+	void AddLevel(int iNode, int x, int y, int w, int h);
+	void RemoveNode(int iNode);
+
+	sSkylineNode m_Nodes[ATLAS_MAX_ENTRIES + 1];
+	int m_NodeCount;
+	int m_Width;
+	int m_Height;
+};
+
+//-----------------------------------------------------------------------------
+// Name : CSpriteAtlas (Class)
+// Desc : Owns the atlas pages. Images are packed as soon as they are added,
+//		and adding the same file twice returns the already packed entry.
+//		Masks live at the same coordinates in a parallel mask page; colour
+//		keyed images get a mask generated from their key at load time.
+//		Image pages also carry the mask as premultiplied alpha in the top
+//		byte of every pixel, for the software blenders. Indexed images are
+//		quantized at load and go to their own byte-per-pixel pages, which
+//		only the software blitters can draw. Every image also gets a one
+//		bit collision mask of its solid pixels.
+//-----------------------------------------------------------------------------
+class CSpriteAtlas
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CSpriteAtlas();
+	virtual ~CSpriteAtlas();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	int			AddImage(const char *szImageFile, const char *szMaskFile, EAtlasFormat eFormat);
+	int			AddImage(const char *szImageFile, COLORREF crTransparentColor, EAtlasFormat eFormat);
+
+	int			GetPage(int iEntry) const		{ return m_Entries[iEntry].iPage; }
+	const RECT& GetRect(int iEntry) const		{ return m_Entries[iEntry].rc; }
+	int			GetPageCount() const			{ return m_PageCount; }
+	EAtlasFormat GetFormat(int iEntry) const	{ return m_Entries[iEntry].eFormat; }
+	const DWORD* GetPalette(int iEntry) const	{ return m_Entries[iEntry].dwPalette; }
+	const CCollisionMask* GetCollisionMask(int iEntry) const	{ return m_Entries[iEntry].pCollision; }
+
+	HDC			GetImageDC(int iPage) const		{ return m_Pages[iPage].hImageDC; }
+	HDC			GetMaskDC(int iPage) const		{ return m_Pages[iPage].hMaskDC; }
+	DWORD*		GetImageBits(int iPage) const	{ return m_Pages[iPage].pImageBits; }
+	DWORD*		GetMaskBits(int iPage) const	{ return m_Pages[iPage].pMaskBits; }
+	BYTE*		GetIndexBits(int iPage) const	{ return m_Pages[iPage].pIndexBits; }
+
+private:
+	typedef struct
+	{
+		char		szImageFile[MAX_PATH];
+		char		szMaskFile[MAX_PATH];	// Empty for colour keyed images
+		COLORREF	crTransparentColor;
+		EAtlasFormat eFormat;
+		int			iPage;
+		RECT		rc;						// Location of the image inside the page
+		DWORD		dwPalette[PALETTE_SIZE];	// Indexed images only
+		CCollisionMask *pCollision;			// Solid pixels, in image coordinates
+	} sAtlasEntry;
+
+	typedef struct
+	{
+		EAtlasFormat	eFormat;
+		BYTE			*pIndexBits;		// Indexed pages only
+		HBITMAP			hImage;
+		HBITMAP			hMask;
+		HGDIOBJ			hOldImage;
+		HGDIOBJ			hOldMask;
+		HDC				hImageDC;
+		HDC				hMaskDC;
+		DWORD			*pImageBits;
+		DWORD			*pMaskBits;
+		CSkylinePacker	*pPacker;
+	} sAtlasPage;
+
+	//-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+	int			FindEntry(const char *szImageFile, const char *szMaskFile, COLORREF crTransparentColor, EAtlasFormat eFormat) const;
+	int			AddEntry(const char *szImageFile, const char *szMaskFile, COLORREF crTransparentColor, EAtlasFormat eFormat);
+	bool		Allocate(int w, int h, EAtlasFormat eFormat, int &iPage, int &x, int &y);
+	bool		CreatePage(EAtlasFormat eFormat);
+
+	static DWORD* LoadBits(const char *szFileName, int &w, int &h);
+
+	// Make copy constructor and assignment operator private, the atlas
+	// owns GDI objects that must not be released twice.
+	CSpriteAtlas(const CSpriteAtlas& rhs);
+	CSpriteAtlas& operator=(const CSpriteAtlas& rhs);
+
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	sAtlasPage	m_Pages[ATLAS_MAX_PAGES];
+	int			m_PageCount;
+
+	sAtlasEntry	m_Entries[ATLAS_MAX_ENTRIES];
+	int			m_EntryCount;
+};
+
+#endif // _SPRITEATLAS_H_
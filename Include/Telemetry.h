@@ -0,0 +1,135 @@
+//-----------------------------------------------------------------------------
+// File: Telemetry.h
+//
+// Desc: Per-frame metrics logged to a compact binary or CSV file, so frame
+//		budgets can be compared across machines offline. The game only fills
+//		a record into a preallocated ring; a writer thread flushes the ring
+//		to disk in batches. Tools/TelemetryReader.cpp summarizes a log.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+//-----------------------------------------------------------------------------
+// CTelemetry Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int	TELEMETRY_RING_SIZE		= 4096;		// Records that can wait for the writer
+const int	TELEMETRY_FLUSH_RECORDS	= 256;		// Records queued before the writer wakes up
+const char	TELEMETRY_MAGIC[4]		= { 'P', 'G', 'T', 'L' };
+const ULONG	TELEMETRY_VERSION		= 1;
+
+enum ETelemetryFormat
+{
+	TELEMETRY_BINARY,		// sTelemetryHeader, then raw sTelemetryRecords
+	TELEMETRY_CSV			// A header line, then one line per record
+};
+
+// Counters bumped wherever the event happens, from any thread
+enum ETelemetryCounter
+{
+	TELEMETRY_SPRITES,		// Sprite draws
+	TELEMETRY_PIXELS,		// Destination pixels the sprite draws covered
+	TELEMETRY_ALLOCATIONS,	// Heap allocations (debug CRT builds only)
+	TELEMETRY_SOUNDS,		// Sounds started
+	TELEMETRY_COUNTERS
+};
+
+//-----------------------------------------------------------------------------
+// Main Type Declarations
+//-----------------------------------------------------------------------------
+// One frame. The counts are the counter increase since the previous record,
+// so work done by the render thread shows up a frame late.
+typedef struct
+{
+	ULONG	nFrame;
+	float	fFrameMs;				// Whole frame, as measured by the timer
+	float	fSimMs;					// Input and animation
+	float	fDrawMs;				// Last frame the renderer finished
+	USHORT	nEntities;				// Objects recorded for drawing
+	USHORT	nSpritesDrawn;
+	ULONG	nPixelsBlitted;
+	USHORT	nAllocations;
+	USHORT	nSoundsPlayed;
+} sTelemetryRecord;
+
+// Start of a binary log
+typedef struct
+{
+	char	Magic[4];				// TELEMETRY_MAGIC
+	ULONG	nVersion;
+	ULONG	nRecordSize;			// sizeof(sTelemetryRecord)
+} sTelemetryHeader;
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+// Adds to a counter. Does nothing until TelemetryEnableCounters is called,
+// so the counters cost one read when no log is being written.
+void	TelemetryCount(ETelemetryCounter eCounter, LONG nAmount = 1);
+ULONG	TelemetryReadCounter(ETelemetryCounter eCounter);
+void	TelemetryEnableCounters(bool bEnable);
+
+// Writes one record as a CSV line, or the column names with NULL
+void	TelemetryWriteCsv(FILE *pFile, const sTelemetryRecord *pRecord);
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CTelemetry (Class)
+// Desc : Single producer, single consumer record ring, like CFrameCapture.
+//		Record never waits: with the ring full the record is dropped and
+//		counted instead.
+//-----------------------------------------------------------------------------
+class CTelemetry
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CTelemetry();
+	virtual ~CTelemetry();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	bool		Start( LPCSTR strFileName, ETelemetryFormat eFormat );
+	void		Stop( );
+
+	// Fills in the counter fields and queues the record
+	void		Record( sTelemetryRecord &Record );
+
+	bool		IsRecording( ) const		{ return m_hThread != NULL; }
+	ULONG		GetRecordsWritten( ) const	{ return (ULONG)m_lRead; }
+	ULONG		GetRecordsDropped( ) const	{ return (ULONG)m_lDropped; }
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+	void		WritePending( );
+	static DWORD WINAPI	WriterThreadProc( LPVOID pParam );
+
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	FILE				*m_pFile;
+	ETelemetryFormat	m_eFormat;
+	sTelemetryRecord	*m_pRing;
+	ULONG				m_nLastCounters[TELEMETRY_COUNTERS];	// At the previous record
+
+	HANDLE				m_hThread;
+	HANDLE				m_hWakeEvent;		// Signalled every TELEMETRY_FLUSH_RECORDS
+	volatile LONG		m_lWritten;			// Records queued
+	volatile LONG		m_lRead;			// Records the writer has finished
+	volatile LONG		m_lDropped;
+	volatile LONG		m_lQuit;
+};
+
+#endif // _TELEMETRY_H_
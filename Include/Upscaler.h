@@ -0,0 +1,71 @@
+//-----------------------------------------------------------------------------
+// File: Upscaler.h
+//
+// Desc: Stretches a frame rendered at a reduced resolution up to the window
+//		size. Uses the ResizeEngine filters to place the samples, reduced to
+//		two taps per axis so that each pass is a single lerp.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _UPSCALER_H_
+#define _UPSCALER_H_
+
+//-----------------------------------------------------------------------------
+// CUpscaler Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "Blitter.h"
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CUpscaler (Class)
+// Desc : Separable 2-tap upscaler. Init builds a source index and an 8 bit
+//		weight for every destination column and row; Upscale filters each
+//		source row horizontally once, into a cache of two rows, and blends
+//		the cached pair for every destination row that falls between them.
+//-----------------------------------------------------------------------------
+class CUpscaler
+{
+public:
+	//-------------------------------------------------------------------------
+	// Constructors & Destructors for This Class.
+	//-------------------------------------------------------------------------
+			 CUpscaler();
+	virtual ~CUpscaler();
+
+	//-------------------------------------------------------------------------
+	// Public Functions for This Class
+	//-------------------------------------------------------------------------
+	// Both source sizes must be at least 2 and no larger than the destination
+	bool		Init		( int iSrcWidth, int iSrcHeight, int iDstWidth, int iDstHeight, EBlitFilter eFilter );
+	void		Release		( );
+
+	void		Upscale		( const sSurface &dst, const sSurface &src );
+
+private:
+	//-------------------------------------------------------------------------
+	// Private Functions for This Class
+	//-------------------------------------------------------------------------
+	void		BuildTaps	( int iDstSize, int iSrcSize, EBlitFilter eFilter, int *pIndex, int *pWeight ) const;
+	const DWORD *GetRow		( const sSurface &src, int iRow );
+
+	//-------------------------------------------------------------------------
+	// Private Variables for This Class
+	//-------------------------------------------------------------------------
+	int			m_iSrcWidth;
+	int			m_iSrcHeight;
+	int			m_iDstWidth;
+	int			m_iDstHeight;
+
+	int			*m_pColIndex;		// Left source pixel of each destination column
+	int			*m_pColWeight;		// Weight of the right one, 0 to 256
+	int			*m_pRowIndex;
+	int			*m_pRowWeight;
+
+	DWORD		*m_pRows[2];		// Horizontally scaled source rows, by row parity
+	int			m_iCachedRow[2];
+};
+
+#endif // _UPSCALER_H_
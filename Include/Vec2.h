@@ -19,25 +19,25 @@ public:
 		Vec2(int a, int b) { x=a; y=b; }
 		~Vec2(){ };
 
-		Vec2& operator-();
+		Vec2 operator-() const;
 
-		bool operator==(Vec2 v);
-		bool operator!=(Vec2 v);
+		bool operator==(const Vec2 &v) const;
+		bool operator!=(const Vec2 &v) const;
 
-		Vec2  operator+(Vec2 v);	// +translate
-		Vec2  operator-(Vec2 v);	// -translate
-		Vec2& operator+=(Vec2 v);	// inc translate
-		Vec2& operator-=(Vec2 v);	// dec translate
+		Vec2  operator+(const Vec2 &v) const;	// +translate
+		Vec2  operator-(const Vec2 &v) const;	// -translate
+		Vec2& operator+=(const Vec2 &v);		// inc translate
+		Vec2& operator-=(const Vec2 &v);		// dec translate
 
-		double operator*(Vec2 v);		// dot product
-		Vec2 operator*(double s);		// scale
-		Vec2 operator/(double s);		// scale
+		double operator*(const Vec2 &v) const;	// dot product
+		Vec2 operator*(double s) const;			// scale
+		Vec2 operator/(double s) const;			// scale
 		void Rotate(double radians);
 
-		Vec2 Normalize(){ return *this * (1/Magnitude()); }
+		Vec2 Normalize() const { return *this * (1/Magnitude()); }
 		double Magnitude() const;			// Polar magnitude
 		double Argument() const;			// Polar argument
-		double Distance(Vec2 v) const;		// Distance
+		double Distance(const Vec2 &v) const;	// Distance
 };
 
 Vec2 Polar(double r, double radians);
@@ -0,0 +1,124 @@
+//-----------------------------------------------------------------------------
+// File: VecMath.h
+//
+// Desc: Float vector math. Vec2f is a small value type whose operators
+//		take const references and can be evaluated at compile time, and the
+//		batch functions work on structure of arrays positions (an x array
+//		and a y array), four or eight vectors at a time with SSE2 or AVX2.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef _VECMATH_H_
+#define _VECMATH_H_
+
+//-----------------------------------------------------------------------------
+// VecMath Specific Includes
+//-----------------------------------------------------------------------------
+#include "Main.h"
+#include "Vec2.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+// constexpr where the compiler has it (Visual C++ 2015 on), inline before
+#if (defined(_MSC_VER) && _MSC_VER >= 1900) || __cplusplus >= 201103L
+	#define VEC_CONSTEXPR constexpr
+#else
+	#define VEC_CONSTEXPR inline
+#endif
+
+// Largest absolute error of the fast trigonometry against double precision,
+// as RunTrigBenchmark checks it. Sine and cosine hold it for angles up to
+// TRIG_MAX_ANGLE either way (about 7.8e-8 measured, under one float step at
+// 1), the arctangent for any finite (x, y) (about 3.0e-7 measured).
+const float	TRIG_MAX_ANGLE			= 1024.0f;
+const float	TRIG_SINCOS_MAX_ERROR	= 1.0e-7f;
+const float	TRIG_ATAN2_MAX_ERROR	= 4.0e-7f;
+
+//-----------------------------------------------------------------------------
+// Main Class Declarations
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : Vec2f (Class)
+// Desc : Two floats. Nothing here changes *this except the assignment
+//		operators, so the others can be used in constant expressions.
+//-----------------------------------------------------------------------------
+class Vec2f
+{
+public:
+	float x, y;
+
+	VEC_CONSTEXPR Vec2f( ) : x(0.0f), y(0.0f) { }
+	VEC_CONSTEXPR Vec2f( float fX, float fY ) : x(fX), y(fY) { }
+	explicit Vec2f( const Vec2 &v ) : x((float)v.x), y((float)v.y) { }
+
+	VEC_CONSTEXPR Vec2f operator-( ) const					{ return Vec2f(-x, -y); }
+	VEC_CONSTEXPR Vec2f operator+( const Vec2f &v ) const	{ return Vec2f(x + v.x, y + v.y); }
+	VEC_CONSTEXPR Vec2f operator-( const Vec2f &v ) const	{ return Vec2f(x - v.x, y - v.y); }
+	VEC_CONSTEXPR Vec2f operator*( float s ) const			{ return Vec2f(x * s, y * s); }
+	VEC_CONSTEXPR Vec2f operator/( float s ) const			{ return Vec2f(x / s, y / s); }
+	VEC_CONSTEXPR bool operator==( const Vec2f &v ) const	{ return x == v.x && y == v.y; }
+	VEC_CONSTEXPR bool operator!=( const Vec2f &v ) const	{ return x != v.x || y != v.y; }
+
+	Vec2f& operator+=( const Vec2f &v )	{ x += v.x; y += v.y; return *this; }
+	Vec2f& operator-=( const Vec2f &v )	{ x -= v.x; y -= v.y; return *this; }
+	Vec2f& operator*=( float s )		{ x *= s; y *= s; return *this; }
+
+	VEC_CONSTEXPR float Dot( const Vec2f &v ) const		{ return x * v.x + y * v.y; }
+	VEC_CONSTEXPR float Cross( const Vec2f &v ) const	{ return x * v.y - y * v.x; }
+	VEC_CONSTEXPR float LengthSquared( ) const			{ return x * x + y * y; }
+	float Length( ) const								{ return sqrtf(x * x + y * y); }
+	float Distance( const Vec2f &v ) const				{ return (*this - v).Length(); }
+
+	// A zero vector stays zero
+	Vec2f Normalized( ) const
+	{ float fLength = Length(); return fLength > 0.0f ? Vec2f(x / fLength, y / fLength) : *this; }
+
+	// Counter-clockwise in a y-up frame, as Vec2::Rotate
+	Vec2f Rotated( float fRadians ) const
+	{ float c = cosf(fRadians), s = sinf(fRadians); return Vec2f(c * x - s * y, s * x + c * y); }
+
+	Vec2 ToVec2( ) const	{ return Vec2((double)x, (double)y); }
+};
+
+VEC_CONSTEXPR Vec2f operator*( float s, const Vec2f &v )	{ return Vec2f(s * v.x, s * v.y); }
+
+//-----------------------------------------------------------------------------
+// Global Function Declarations
+//-----------------------------------------------------------------------------
+// Batch functions over nCount vectors held as separate x and y arrays. The
+// SSE2 and AVX2 paths give exactly the scalar results.
+
+// p += v * dt
+void IntegrateMany	( float *pX, float *pY, const float *pVelX, const float *pVelY, float dt, int nCount );
+
+// p *= fScale
+void ScaleMany		( float *pX, float *pY, float fScale, int nCount );
+
+// p /= |p|, zero vectors are left as they are
+void NormalizeMany	( float *pX, float *pY, int nCount );
+
+// pDistance[i] = |p - (fX, fY)|
+void DistanceMany	( const float *pX, const float *pY, float fX, float fY, float *pDistance, int nCount );
+
+// Rotates every vector by the same angle
+void RotateMany		( float *pX, float *pY, float fRadians, int nCount );
+
+// Polynomial arctangent, within the error above, the same bits as the
+// arctangent kernel. (0, 0) gives an angle of 0.
+float FastAtan2		( float fY, float fX );
+
+// Rotates every vector by its own angle, p = (cos a, sin a) * r
+void RotateMany		( float *pX, float *pY, const float *pRadians, int nCount );
+void PolarMany		( const float *pRadius, const float *pRadians, float *pX, float *pY, int nCount );
+
+// Times every batch function on each path against a loop of Vec2
+// operations doing the same work, and writes the results to a text file.
+bool RunVectorBenchmark( LPCSTR strFileName );
+
+// Measures the error of the fast trigonometry over dense sweeps, checks
+// it against the limits above and each SIMD path against the scalar one,
+// then times every path and libm, and writes the results to a text file.
+bool RunTrigBenchmark( LPCSTR strFileName );
+
+#endif // _VECMATH_H_
@@ -0,0 +1,235 @@
+//-----------------------------------------------------------------------------
+// File: Animation.cpp
+//
+// Desc: Sprite sheet layout and frame based animation playback. Frame
+//		rectangles are computed once from the sheet metadata, and all running
+//		animations are advanced together from the game's frame time.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Animation Specific Includes
+//-----------------------------------------------------------------------------
+#include "Animation.h"
+
+//-----------------------------------------------------------------------------
+// CSpriteSheet Member Functions
+//-----------------------------------------------------------------------------
+CSpriteSheet::CSpriteSheet(const RECT& rcFirstFrame, int iColumns, int iRows, int iFrameCount)
+{
+	assert(iColumns > 0 && iRows > 0 && "Sprite sheet needs at least one row and column!");
+	assert(iFrameCount > 0 && iFrameCount <= iColumns * iRows && iFrameCount <= MAX_SHEET_FRAMES);
+
+	m_FrameWidth	= rcFirstFrame.right - rcFirstFrame.left;
+	m_FrameHeight	= rcFirstFrame.bottom - rcFirstFrame.top;
+	m_FrameCount	= iFrameCount;
+
+	for(int i = 0; i < iFrameCount; i++)
+	{
+		RECT &rc	= m_Frames[i];
+		rc.left		= rcFirstFrame.left + (i % iColumns) * m_FrameWidth;
+		rc.top		= rcFirstFrame.top + (i / iColumns) * m_FrameHeight;
+		rc.right	= rc.left + m_FrameWidth;
+		rc.bottom	= rc.top + m_FrameHeight;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// CAnimator Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CAnimator () (Constructor)
+// Desc : CAnimator Class Constructor
+//-----------------------------------------------------------------------------
+CAnimator::CAnimator()
+{
+	m_ClipCount		= 0;
+	m_ActiveCount	= 0;
+	m_FreeCount		= MAX_ANIM_INSTANCES;
+
+	for(int i = 0; i < MAX_ANIM_INSTANCES; i++)
+	{
+		// hand out low slots first
+		m_Free[i]			= MAX_ANIM_INSTANCES - 1 - i;
+		m_ActiveIndex[i]	= -1;
+		m_Generation[i]		= 0;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CAnimator () (Destructor)
+// Desc : CAnimator Class Destructor
+//-----------------------------------------------------------------------------
+CAnimator::~CAnimator()
+{
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddClip ()
+// Desc : Registers a clip whose frames all last fFrameTime seconds.
+//-----------------------------------------------------------------------------
+int CAnimator::AddClip(int iFirstFrame, int iFrameCount, float fFrameTime, bool bLoop)
+{
+	float fFrameTimes[MAX_SHEET_FRAMES];
+	for(int i = 0; i < iFrameCount && i < MAX_SHEET_FRAMES; i++)
+		fFrameTimes[i] = fFrameTime;
+
+	return AddClip(iFirstFrame, iFrameCount, fFrameTimes, bLoop);
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddClip ()
+// Desc : Registers a clip with individual frame durations. Adding a clip
+//		identical to an existing one returns the existing clip.
+//-----------------------------------------------------------------------------
+int CAnimator::AddClip(int iFirstFrame, int iFrameCount, const float *pFrameTimes, bool bLoop)
+{
+	assert(iFrameCount > 0 && iFrameCount <= MAX_SHEET_FRAMES);
+
+	for(int i = 0; i < m_ClipCount; i++)
+	{
+		const sAnimClip &c = m_Clips[i];
+		if(c.iFirstFrame == iFirstFrame && c.iFrameCount == iFrameCount && c.bLoop == bLoop &&
+		   memcmp(c.fFrameTime, pFrameTimes, iFrameCount * sizeof(float)) == 0)
+			return i;
+	}
+
+	if(m_ClipCount >= MAX_ANIM_CLIPS)
+		return -1;
+
+	sAnimClip &c = m_Clips[m_ClipCount];
+	c.iFirstFrame	= iFirstFrame;
+	c.iFrameCount	= iFrameCount;
+	c.bLoop			= bLoop;
+	for(int i = 0; i < iFrameCount; i++)
+	{
+		// a zero length frame would stall Update
+		assert(pFrameTimes[i] > 0.0f && "Animation frame time must be positive!");
+		c.fFrameTime[i] = pFrameTimes[i];
+	}
+
+	return m_ClipCount++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Play ()
+// Desc : Starts a new instance of a clip, returns its handle or -1.
+//-----------------------------------------------------------------------------
+int CAnimator::Play(int iClip)
+{
+	if(iClip < 0 || iClip >= m_ClipCount || m_FreeCount == 0)
+		return -1;
+
+	int i = m_Free[--m_FreeCount];
+
+	m_Clip[i]			= iClip;
+	m_Frame[i]			= 0;
+	m_Time[i]			= 0.0f;
+	m_ActiveIndex[i]	= m_ActiveCount;
+	m_Active[m_ActiveCount++] = i;
+
+	return ((m_Generation[i] & 0x7FFF) << 16) | i;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Stop ()
+// Desc : Stops an instance before it finishes, stale handles are ignored.
+//-----------------------------------------------------------------------------
+void CAnimator::Stop(int hAnim)
+{
+	int i = Slot(hAnim);
+	if(i >= 0)
+		Release(m_ActiveIndex[i]);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Update ()
+// Desc : Advances every playing instance by dt seconds. Instances of clips
+//		that do not loop are released once their last frame has elapsed.
+//-----------------------------------------------------------------------------
+void CAnimator::Update(float dt)
+{
+	for(int k = 0; k < m_ActiveCount; )
+	{
+		int i = m_Active[k];
+		const sAnimClip &c = m_Clips[m_Clip[i]];
+
+		float fTime	= m_Time[i] + dt;
+		int iFrame	= m_Frame[i];
+		bool bDone	= false;
+
+		// a long frame time may skip several frames at once
+		while(fTime >= c.fFrameTime[iFrame])
+		{
+			fTime -= c.fFrameTime[iFrame];
+			if(++iFrame == c.iFrameCount)
+			{
+				if(!c.bLoop)
+				{
+					bDone = true;
+					break;
+				}
+				iFrame = 0;
+			}
+		}
+
+		if(bDone)
+		{
+			// the last active slot is swapped into k, so do not advance
+			Release(k);
+			continue;
+		}
+
+		m_Time[i]	= fTime;
+		m_Frame[i]	= iFrame;
+		k++;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : IsPlaying ()
+// Desc : Returns false once the instance has finished or was stopped.
+//-----------------------------------------------------------------------------
+bool CAnimator::IsPlaying(int hAnim) const
+{
+	return Slot(hAnim) >= 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetFrame ()
+// Desc : Returns the sheet frame index the instance is currently showing.
+//-----------------------------------------------------------------------------
+int CAnimator::GetFrame(int hAnim) const
+{
+	int i = Slot(hAnim);
+	if(i < 0)
+		return -1;
+
+	return m_Clips[m_Clip[i]].iFirstFrame + m_Frame[i];
+}
+
+int CAnimator::Slot(int hAnim) const
+{
+	if(hAnim < 0)
+		return -1;
+
+	int i = hAnim & 0xFFFF;
+	if(i >= MAX_ANIM_INSTANCES || m_ActiveIndex[i] < 0 || (m_Generation[i] & 0x7FFF) != (hAnim >> 16))
+		return -1;
+
+	return i;
+}
+
+void CAnimator::Release(int iActive)
+{
+	int i = m_Active[iActive];
+
+	// keep the active list dense by moving the last entry into the hole
+	int iLast = m_Active[--m_ActiveCount];
+	m_Active[iActive]		= iLast;
+	m_ActiveIndex[iLast]	= iActive;
+
+	m_ActiveIndex[i] = -1;
+	m_Generation[i]++;
+	m_Free[m_FreeCount++] = i;
+}
@@ -2,6 +2,7 @@
 // By Frank Luna
 // August 24, 2004.
 #include "BackBuffer.h"
+#include "Profiler.h"
 
 
 BackBuffer::BackBuffer(HWND hWnd, int width, int height)
@@ -16,19 +17,38 @@ BackBuffer::BackBuffer(HWND hWnd, int width, int height)
 	// Save the backbuffer dimensions.
 	mWidth = width;
 	mHeight = height;
+	mViewWidth = width;
+	mViewHeight = height;
+	mScale = 1.0f;
+	mFilter = BLIT_BILINEAR;
 
 	// Create system memory device context that is compatible
 	// with the window one.
 	mhDC = CreateCompatibleDC(hWndDC);
 
-	// Create the backbuffer surface bitmap that is compatible
-	// with the window device context bitmap format. That is
-	// the surface we will render onto.
-	mhSurface = CreateCompatibleBitmap(hWndDC, width, height);
-
 	// Done with window DC.
 	ReleaseDC(hWnd, hWndDC);
 
+	// Create the backbuffer surface. That is the surface we
+	// will render onto.
+	mhSurface = createSurface(width, height, &mpBits);
+
+	// Select the backbuffer bitmap into the DC once, it stays
+	// there for the lifetime of the BackBuffer.
+	mhOldObject = (HBITMAP)SelectObject(mhDC, mhSurface);
+
+	// World transforms need the advanced graphics mode. Sprites
+	// shrunk by the transform drop pixels rather than blend them,
+	// which keeps their masks binary.
+	SetGraphicsMode(mhDC, GM_ADVANCED);
+	SetStretchBltMode(mhDC, COLORONCOLOR);
+
+	// The window sized surface is only made once it is needed.
+	mhViewDC = NULL;
+	mhViewSurface = NULL;
+	mhViewOldObject = NULL;
+	mpViewBits = NULL;
+
 	// At this point, the back buffer surface is uninitialized,
 	// so lets clear it to some non-zero value. Note that it
 	// needs to be non-zero. If it is zero then it will mess
@@ -36,17 +56,31 @@ BackBuffer::BackBuffer(HWND hWnd, int width, int height)
 	reset();
 }
 
-void BackBuffer::reset()
+HBITMAP BackBuffer::createSurface(int width, int height, DWORD** ppBits)
 {
-	// Select the backbuffer bitmap into the DC.
-	mhOldObject = (HBITMAP)SelectObject(mhDC, mhSurface);
+	// A top-down 32 bit DIB section, so the software blitters
+	// can write its pixels directly.
+	BITMAPINFO bmi;
+	ZeroMemory(&bmi, sizeof(bmi));
+	bmi.bmiHeader.biSize		= sizeof(BITMAPINFOHEADER);
+	bmi.bmiHeader.biWidth		= width;
+	bmi.bmiHeader.biHeight		= -height;
+	bmi.bmiHeader.biPlanes		= 1;
+	bmi.bmiHeader.biBitCount	= 32;
+	bmi.bmiHeader.biCompression	= BI_RGB;
+
+	*ppBits = NULL;
+	return CreateDIBSection(mhDC, &bmi, DIB_RGB_COLORS, (void**)ppBits, NULL, 0);
+}
 
+void BackBuffer::reset()
+{
 	// Select a white brush.
 	HBRUSH white = (HBRUSH)GetStockObject(WHITE_BRUSH);
 	HBRUSH oldBrush = (HBRUSH)SelectObject(mhDC, white);
 
-	// Clear the backbuffer rectangle.
-	Rectangle(mhDC, 0, 0, mWidth, mHeight);
+	// Clear the backbuffer rectangle, in window coordinates.
+	Rectangle(mhDC, 0, 0, mViewWidth, mViewHeight);
 
 	// Restore the original brush.
 	SelectObject(mhDC, oldBrush);
@@ -54,21 +88,98 @@ void BackBuffer::reset()
 
 BackBuffer::~BackBuffer()
 {
+	if(mhViewDC)
+	{
+		SelectObject(mhViewDC, mhViewOldObject);
+		DeleteObject(mhViewSurface);
+		DeleteDC(mhViewDC);
+	}
+
 	SelectObject(mhDC, mhOldObject);
 	DeleteObject(mhSurface);
 	DeleteDC(mhDC);
 }
 
+void BackBuffer::setRenderScale(float scale, EBlitFilter filter)
+{
+	scale = max(MIN_RENDER_SCALE, min(scale, 1.0f));
+	if(scale == mScale && filter == mFilter)
+		return;
+
+	int width = max(2, (int)(mViewWidth * scale + 0.5f));
+	int height = max(2, (int)(mViewHeight * scale + 0.5f));
+
+	if(scale < 1.0f && !mUpscaler.Init(width, height, mViewWidth, mViewHeight, filter))
+		return;
+
+	// The window sized surface resolve stretches into.
+	if(scale < 1.0f && mhViewDC == NULL)
+	{
+		mhViewDC = CreateCompatibleDC(mhDC);
+		mhViewSurface = createSurface(mViewWidth, mViewHeight, &mpViewBits);
+		if(mhViewSurface == NULL)
+		{
+			DeleteDC(mhViewDC);
+			mhViewDC = NULL;
+			return;
+		}
+		mhViewOldObject = (HBITMAP)SelectObject(mhViewDC, mhViewSurface);
+	}
+
+	// Swap the surface in the same DC, so the sprites that made
+	// their own DCs from it stay valid.
+	if(width != mWidth || height != mHeight)
+	{
+		DWORD* pBits = NULL;
+		HBITMAP hSurface = createSurface(width, height, &pBits);
+		if(hSurface == NULL)
+			return;
+
+		SelectObject(mhDC, hSurface);
+		DeleteObject(mhSurface);
+		mhSurface = hSurface;
+		mpBits = pBits;
+		mWidth = width;
+		mHeight = height;
+	}
+
+	mScale = scale;
+	mFilter = filter;
+
+	XFORM xf = { scale, 0.0f, 0.0f, scale, 0.0f, 0.0f };
+	SetWorldTransform(mhDC, &xf);
+
+	reset();
+}
+
+void BackBuffer::resolve()
+{
+	if(mScale >= 1.0f)
+		return;
+
+	PROFILE_ZONE("BackBuffer::resolve");
+
+	// Make sure GDI has finished drawing into the backbuffer
+	// before reading its pixels directly.
+	GdiFlush();
+
+	sSurface src = { mpBits, mWidth, mHeight, mWidth };
+	sSurface dst = { mpViewBits, mViewWidth, mViewHeight, mViewWidth };
+	mUpscaler.Upscale(dst, src);
+}
+
 void BackBuffer::present()
 {
+	PROFILE_ZONE("BackBuffer::present");
+
 	// Get a handle to the device context associated with
 	// the window.
 	HDC hWndDC = GetDC(mhWnd);
 
-	// Copy the backbuffer contents over to the
-	// window client area.
-	BitBlt(hWndDC, 0, 0, mWidth, mHeight, mhDC, 0, 0, SRCCOPY);
+	// Copy the backbuffer contents over to the window client
+	// area, or the stretched copy made by resolve.
+	BitBlt(hWndDC, 0, 0, mViewWidth, mViewHeight, mScale < 1.0f ? mhViewDC : mhDC, 0, 0, SRCCOPY);
 
 	// Always free window DC when done.
 	ReleaseDC(mhWnd, hWndDC);
-}
\ No newline at end of file
+}
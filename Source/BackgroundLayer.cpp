@@ -0,0 +1,121 @@
+//-----------------------------------------------------------------------------
+// File: BackgroundLayer.cpp
+//
+// Desc: Scrolling background layer. The scroll offset wraps around the
+//		image size, and painting only blits the spans that are on screen,
+//		so a layer costs about one screen of pixels whatever its size.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CBackgroundLayer Specific Includes
+//-----------------------------------------------------------------------------
+#include "BackgroundLayer.h"
+#include "Profiler.h"
+
+// TransparentBlt lives in msimg32
+#pragma comment(lib, "msimg32.lib")
+
+//-----------------------------------------------------------------------------
+// Name : CBackgroundLayer () (Constructor)
+// Desc : CBackgroundLayer Class Constructor
+//-----------------------------------------------------------------------------
+CBackgroundLayer::CBackgroundLayer()
+{
+	m_fOffsetX		= 0.0f;
+	m_fOffsetY		= 0.0f;
+	m_fSpeed		= 1.0f;
+	m_bTransparent	= false;
+	m_crTransparent	= 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetTransparentColor ()
+// Desc : Pixels of this colour let the layers underneath show through.
+//-----------------------------------------------------------------------------
+void CBackgroundLayer::SetTransparentColor(COLORREF crTransparentColor)
+{
+	m_bTransparent	= true;
+	m_crTransparent	= crTransparentColor;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Scroll ()
+// Desc : Moves the view over the layer by (dx, dy) scaled by the layer
+//		speed. Positive dx moves the image to the left on screen.
+//-----------------------------------------------------------------------------
+void CBackgroundLayer::Scroll(float dx, float dy)
+{
+	GetScrolledOffset(dx, dy, m_fOffsetX, m_fOffsetY);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetScrolledOffset ()
+// Desc : Adds the scaled move to the offset and wraps it inside the image.
+//-----------------------------------------------------------------------------
+void CBackgroundLayer::GetScrolledOffset(float dx, float dy, float &fOffsetX, float &fOffsetY) const
+{
+	fOffsetX = m_fOffsetX;
+	fOffsetY = m_fOffsetY;
+	if(width <= 0 || height <= 0)
+		return;
+
+	fOffsetX = fmodf(m_fOffsetX + dx * m_fSpeed, (float)width);
+	if(fOffsetX < 0.0f) fOffsetX += width;
+
+	fOffsetY = fmodf(m_fOffsetY + dy * m_fSpeed, (float)height);
+	if(fOffsetY < 0.0f) fOffsetY += height;
+}
+
+//-----------------------------------------------------------------------------
+// Name : PaintLayer ()
+// Desc : Fills the view with the layer at its current scroll offset.
+//-----------------------------------------------------------------------------
+void CBackgroundLayer::PaintLayer(HDC hdc, int iViewWidth, int iViewHeight)
+{
+	PaintLayer(hdc, iViewWidth, iViewHeight, m_fOffsetX, m_fOffsetY);
+}
+
+//-----------------------------------------------------------------------------
+// Name : PaintLayer ()
+// Desc : Fills the view with the layer. The view is cut at the image's
+//		wrap point, so normally this is one or two blits of visible pixels.
+//		The offset is passed in so a renderer can paint a snapshot taken
+//		while the simulation keeps scrolling.
+//-----------------------------------------------------------------------------
+void CBackgroundLayer::PaintLayer(HDC hdc, int iViewWidth, int iViewHeight, float fOffsetX, float fOffsetY)
+{
+	PROFILE_FUNCTION();
+
+	if(!Upload(hdc))
+		return;
+
+	HDC mdc = CreateCompatibleDC(hdc);
+	HGDIOBJ oldObj = SelectObject(mdc, m_hBMP);
+
+	// rounding may land exactly on the image size
+	int iStartX = (int)fOffsetX % width;
+	int iStartY = (int)fOffsetY % height;
+
+	for(int y = 0, srcY = iStartY; y < iViewHeight; srcY = 0)
+	{
+		int h = min(height - srcY, iViewHeight - y);
+
+		for(int x = 0, srcX = iStartX; x < iViewWidth; srcX = 0)
+		{
+			int w = min(width - srcX, iViewWidth - x);
+
+			if(m_bTransparent)
+				TransparentBlt(hdc, x, y, w, h, mdc, srcX, srcY, w, h, m_crTransparent);
+			else
+				BitBlt(hdc, x, y, w, h, mdc, srcX, srcY, SRCCOPY);
+
+			x += w;
+		}
+
+		y += h;
+	}
+
+	SelectObject(mdc, oldObj);
+	DeleteDC(mdc);
+}
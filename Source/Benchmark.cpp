@@ -0,0 +1,68 @@
+//-----------------------------------------------------------------------------
+// File: Benchmark.cpp
+//
+// Desc: Helpers shared by the command line benchmarks: a repeatable random
+//		number generator, the performance counter and the report file each
+//		benchmark writes.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Benchmark Specific Includes
+//-----------------------------------------------------------------------------
+#include "Benchmark.h"
+
+//-----------------------------------------------------------------------------
+// Name : BenchRandom ()
+// Desc : Next value of the sequence started by nSeed, in [0, 1).
+//-----------------------------------------------------------------------------
+float BenchRandom(ULONG &nSeed)
+{
+	nSeed = nSeed * 1664525UL + 1013904223UL;
+	return (nSeed >> 8) * (1.0f / 16777216.0f);
+}
+
+//-----------------------------------------------------------------------------
+// Name : BenchTime ()
+// Desc : Current value of the performance counter.
+//-----------------------------------------------------------------------------
+__int64 BenchTime()
+{
+	__int64 nTime;
+	QueryPerformanceCounter((LARGE_INTEGER*)&nTime);
+	return nTime;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BenchSeconds ()
+// Desc : Seconds between two BenchTime values.
+//-----------------------------------------------------------------------------
+double BenchSeconds(__int64 nStart, __int64 nEnd)
+{
+	__int64 nFreq;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&nFreq);
+	return (double)(nEnd - nStart) / nFreq;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BenchOpen ()
+// Desc : Creates the report file, replacing any earlier one.
+//-----------------------------------------------------------------------------
+FILE* BenchOpen(LPCSTR strFileName)
+{
+	FILE *pFile = NULL;
+	if(fopen_s(&pFile, strFileName, "w") != 0)
+		return NULL;
+	return pFile;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BenchClose ()
+// Desc : Closes the report. Returns bPassed if every write succeeded.
+//-----------------------------------------------------------------------------
+bool BenchClose(FILE *pFile, bool bPassed)
+{
+	bool bResult = ferror(pFile) == 0 && bPassed;
+	fclose(pFile);
+	return bResult;
+}
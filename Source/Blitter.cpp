@@ -0,0 +1,1160 @@
+//-----------------------------------------------------------------------------
+// File: Blitter.cpp
+//
+// Desc: Software blitting into 32 bit surfaces. Used for the sprite draws
+//		GDI cannot do, such as rotating and scaling a sprite.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Blitter Specific Includes
+//-----------------------------------------------------------------------------
+#include "Blitter.h"
+#include "Benchmark.h"
+#include "Simd.h"
+
+//-----------------------------------------------------------------------------
+// Local Types
+//-----------------------------------------------------------------------------
+// One destination row of an affine blit, already clipped so that every
+// pixel in it samples inside the source rectangle.
+typedef struct
+{
+	DWORD		*pDst;			// First destination pixel
+	int			iCount;			// Number of destination pixels
+	int			u, v;			// 16.16 source position of the first pixel
+	int			du, dv;			// 16.16 source step per destination pixel
+	const DWORD	*pSrc;			// Source rectangle origin
+	const DWORD	*pMask;			// Mask rectangle origin, NULL for none
+	int			iPitch;			// Pitch of both source and mask
+	bool		bColorKey;
+	DWORD		dwColorKey;
+	const BYTE	*pIndex;		// Indexed source rectangle origin, used instead of pSrc
+	const DWORD	*pPalette;
+	EBlendMode	eBlend;			// How indexed texels are composited
+} sAffineSpan;
+
+typedef void (*AFFINE_SPAN_FUNC)(const sAffineSpan &s);
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int	BENCHMARK_PAGE			= 256;			// Side of the benchmark source page
+const int	BENCHMARK_SPRITE		= 64;			// Side of the sprite blitted from it
+const int	BENCHMARK_TARGET		= 512;			// Side of the benchmark destination
+const int	BENCHMARK_BLITS			= 2000;			// Blits timed per case and path
+
+// Rotations and scales the benchmark times, from upright and enlarged to
+// turned and shrunk
+const float	BENCHMARK_ANGLES[]		= { 0.0f, 0.6f, 0.6f, 2.2f };
+const float	BENCHMARK_SCALES[]		= { 1.5f, 1.0f, 2.0f, 0.5f };
+
+//-----------------------------------------------------------------------------
+// Scalar Span Functions
+//-----------------------------------------------------------------------------
+// These are the reference implementation and also finish the pixels left
+// over by the SIMD loops, so both must produce identical results.
+static inline bool IsOpaque(const sAffineSpan &s, int idx)
+{
+	if(s.pMask)
+		return (s.pMask[idx] & 0xFF) < 0x80;
+	if(s.bColorKey)
+		return (s.pSrc[idx] & 0x00FFFFFF) != s.dwColorKey;
+	return true;
+}
+
+static inline DWORD Bilerp(const DWORD *p, int iPitch, int fx, int fy)
+{
+	DWORD t00 = p[0], t10 = p[1], t01 = p[iPitch], t11 = p[iPitch + 1];
+	DWORD r = 0;
+
+	for(int c = 0; c < 32; c += 8)
+	{
+		int top = (((t00 >> c) & 0xFF) * (256 - fx) + ((t10 >> c) & 0xFF) * fx) >> 8;
+		int bot = (((t01 >> c) & 0xFF) * (256 - fx) + ((t11 >> c) & 0xFF) * fx) >> 8;
+		r |= (DWORD)((top * (256 - fy) + bot * fy) >> 8) << c;
+	}
+
+	return r;
+}
+
+static void SpanNearestScalar(const sAffineSpan &s, int iFirst)
+{
+	int u = s.u + s.du * iFirst;
+	int v = s.v + s.dv * iFirst;
+
+	for(int i = iFirst; i < s.iCount; i++, u += s.du, v += s.dv)
+	{
+		int idx = (v >> 16) * s.iPitch + (u >> 16);
+		if(IsOpaque(s, idx))
+			s.pDst[i] = s.pSrc[idx];
+	}
+}
+
+static void SpanBilinearScalar(const sAffineSpan &s, int iFirst)
+{
+	int u = s.u + s.du * iFirst;
+	int v = s.v + s.dv * iFirst;
+
+	for(int i = iFirst; i < s.iCount; i++, u += s.du, v += s.dv)
+	{
+		// transparency follows the nearest texel, colour is filtered
+		int iNearest = ((v + 0x8000) >> 16) * s.iPitch + ((u + 0x8000) >> 16);
+		if(IsOpaque(s, iNearest))
+			s.pDst[i] = Bilerp(&s.pSrc[(v >> 16) * s.iPitch + (u >> 16)], s.iPitch, (u >> 8) & 0xFF, (v >> 8) & 0xFF);
+	}
+}
+
+static void SpanNearest(const sAffineSpan &s)	{ SpanNearestScalar(s, 0); }
+static void SpanBilinear(const sAffineSpan &s)	{ SpanBilinearScalar(s, 0); }
+
+#if defined(SIMD_SSE2)
+//-----------------------------------------------------------------------------
+// SSE2 Span Functions
+//-----------------------------------------------------------------------------
+// SSE2 has no gather, so texels are fetched with scalar loads and all the
+// index, mask and filter arithmetic is done four pixels at a time.
+static inline __m128i Fetch4(const DWORD *p, const int *idx, int iOffset)
+{
+	return _mm_setr_epi32(p[idx[0] + iOffset], p[idx[1] + iOffset], p[idx[2] + iOffset], p[idx[3] + iOffset]);
+}
+
+// iv * pitch + iu in one multiply-add, both coordinates fit in 16 bits
+static inline __m128i Index4(__m128i vu, __m128i vv, __m128i vPitch)
+{
+	__m128i iu = _mm_srai_epi32(vu, 16);
+	__m128i iv = _mm_srai_epi32(vv, 16);
+	return _mm_madd_epi16(_mm_or_si128(iv, _mm_slli_epi32(iu, 16)), vPitch);
+}
+
+static inline __m128i Opaque4(const sAffineSpan &s, __m128i src, const int *idx)
+{
+	if(s.pMask)
+	{
+		__m128i m = _mm_and_si128(Fetch4(s.pMask, idx, 0), _mm_set1_epi32(0xFF));
+		return _mm_cmplt_epi32(m, _mm_set1_epi32(0x80));
+	}
+	if(s.bColorKey)
+	{
+		__m128i k = _mm_cmpeq_epi32(_mm_and_si128(src, _mm_set1_epi32(0x00FFFFFF)), _mm_set1_epi32(s.dwColorKey));
+		return _mm_xor_si128(k, _mm_set1_epi32(-1));
+	}
+	return _mm_set1_epi32(-1);
+}
+
+static inline void Store4(DWORD *pDst, __m128i src, __m128i opaque)
+{
+	__m128i d = _mm_loadu_si128((const __m128i*)pDst);
+	_mm_storeu_si128((__m128i*)pDst, _mm_or_si128(_mm_and_si128(opaque, src), _mm_andnot_si128(opaque, d)));
+}
+
+// (a * (256 - w) + b * w) >> 8 on 16 bit channels, same rounding as Bilerp
+static inline __m128i Lerp16(__m128i a, __m128i b, __m128i w)
+{
+	__m128i wa = _mm_sub_epi16(_mm_set1_epi16(256), w);
+	return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(a, wa), _mm_mullo_epi16(b, w)), 8);
+}
+
+static void SpanNearestSSE2(const sAffineSpan &s)
+{
+	const __m128i vPitch	= _mm_set1_epi32(s.iPitch | (1 << 16));
+	const __m128i vdu		= _mm_set1_epi32(4 * s.du);
+	const __m128i vdv		= _mm_set1_epi32(4 * s.dv);
+	__m128i vu = _mm_setr_epi32(s.u, s.u + s.du, s.u + 2 * s.du, s.u + 3 * s.du);
+	__m128i vv = _mm_setr_epi32(s.v, s.v + s.dv, s.v + 2 * s.dv, s.v + 3 * s.dv);
+	int idx[4];
+
+	int i = 0;
+	for(; i + 4 <= s.iCount; i += 4)
+	{
+		_mm_storeu_si128((__m128i*)idx, Index4(vu, vv, vPitch));
+
+		__m128i src = Fetch4(s.pSrc, idx, 0);
+		Store4(&s.pDst[i], src, Opaque4(s, src, idx));
+
+		vu = _mm_add_epi32(vu, vdu);
+		vv = _mm_add_epi32(vv, vdv);
+	}
+
+	SpanNearestScalar(s, i);
+}
+
+static void SpanBilinearSSE2(const sAffineSpan &s)
+{
+	const __m128i vPitch	= _mm_set1_epi32(s.iPitch | (1 << 16));
+	const __m128i vHalf		= _mm_set1_epi32(0x8000);
+	const __m128i vFrac		= _mm_set1_epi32(0xFF);
+	const __m128i vZero		= _mm_setzero_si128();
+	const __m128i vdu		= _mm_set1_epi32(4 * s.du);
+	const __m128i vdv		= _mm_set1_epi32(4 * s.dv);
+	__m128i vu = _mm_setr_epi32(s.u, s.u + s.du, s.u + 2 * s.du, s.u + 3 * s.du);
+	__m128i vv = _mm_setr_epi32(s.v, s.v + s.dv, s.v + 2 * s.dv, s.v + 3 * s.dv);
+	int idx[4], idxNearest[4];
+
+	int i = 0;
+	for(; i + 4 <= s.iCount; i += 4)
+	{
+		_mm_storeu_si128((__m128i*)idx, Index4(vu, vv, vPitch));
+		_mm_storeu_si128((__m128i*)idxNearest, Index4(_mm_add_epi32(vu, vHalf), _mm_add_epi32(vv, vHalf), vPitch));
+
+		__m128i t00 = Fetch4(s.pSrc, idx, 0);
+		__m128i t10 = Fetch4(s.pSrc, idx, 1);
+		__m128i t01 = Fetch4(s.pSrc, idx, s.iPitch);
+		__m128i t11 = Fetch4(s.pSrc, idx, s.iPitch + 1);
+
+		// 8 bit fractions, replicated over the four channels of each pixel
+		__m128i fx = _mm_and_si128(_mm_srli_epi32(vu, 8), vFrac);
+		__m128i fy = _mm_and_si128(_mm_srli_epi32(vv, 8), vFrac);
+		fx = _mm_or_si128(fx, _mm_slli_epi32(fx, 16));
+		fy = _mm_or_si128(fy, _mm_slli_epi32(fy, 16));
+		__m128i fxLo = _mm_unpacklo_epi32(fx, fx), fxHi = _mm_unpackhi_epi32(fx, fx);
+		__m128i fyLo = _mm_unpacklo_epi32(fy, fy), fyHi = _mm_unpackhi_epi32(fy, fy);
+
+		__m128i topLo = Lerp16(_mm_unpacklo_epi8(t00, vZero), _mm_unpacklo_epi8(t10, vZero), fxLo);
+		__m128i topHi = Lerp16(_mm_unpackhi_epi8(t00, vZero), _mm_unpackhi_epi8(t10, vZero), fxHi);
+		__m128i botLo = Lerp16(_mm_unpacklo_epi8(t01, vZero), _mm_unpacklo_epi8(t11, vZero), fxLo);
+		__m128i botHi = Lerp16(_mm_unpackhi_epi8(t01, vZero), _mm_unpackhi_epi8(t11, vZero), fxHi);
+
+		__m128i res = _mm_packus_epi16(Lerp16(topLo, botLo, fyLo), Lerp16(topHi, botHi, fyHi));
+		Store4(&s.pDst[i], res, Opaque4(s, Fetch4(s.pSrc, idxNearest, 0), idxNearest));
+
+		vu = _mm_add_epi32(vu, vdu);
+		vv = _mm_add_epi32(vv, vdv);
+	}
+
+	SpanBilinearScalar(s, i);
+}
+#endif // SIMD_SSE2
+
+#if defined(SIMD_AVX2)
+//-----------------------------------------------------------------------------
+// AVX2 Span Functions
+//-----------------------------------------------------------------------------
+// Same as the SSE2 versions eight pixels at a time, with hardware gathers.
+static inline __m256i Index8(__m256i vu, __m256i vv, __m256i vPitch)
+{
+	return _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srai_epi32(vv, 16), vPitch), _mm256_srai_epi32(vu, 16));
+}
+
+static inline __m256i Gather8(const DWORD *p, __m256i idx)
+{
+	return _mm256_i32gather_epi32((const int*)p, idx, 4);
+}
+
+static inline __m256i Opaque8(const sAffineSpan &s, __m256i src, __m256i idx)
+{
+	if(s.pMask)
+	{
+		__m256i m = _mm256_and_si256(Gather8(s.pMask, idx), _mm256_set1_epi32(0xFF));
+		return _mm256_cmpgt_epi32(_mm256_set1_epi32(0x80), m);
+	}
+	if(s.bColorKey)
+	{
+		__m256i k = _mm256_cmpeq_epi32(_mm256_and_si256(src, _mm256_set1_epi32(0x00FFFFFF)), _mm256_set1_epi32(s.dwColorKey));
+		return _mm256_xor_si256(k, _mm256_set1_epi32(-1));
+	}
+	return _mm256_set1_epi32(-1);
+}
+
+static inline void Store8(DWORD *pDst, __m256i src, __m256i opaque)
+{
+	__m256i d = _mm256_loadu_si256((const __m256i*)pDst);
+	_mm256_storeu_si256((__m256i*)pDst, _mm256_blendv_epi8(d, src, opaque));
+}
+
+static inline __m256i Lerp16x16(__m256i a, __m256i b, __m256i w)
+{
+	__m256i wa = _mm256_sub_epi16(_mm256_set1_epi16(256), w);
+	return _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(a, wa), _mm256_mullo_epi16(b, w)), 8);
+}
+
+static inline __m256i Ramp8(int x, int dx)
+{
+	return _mm256_add_epi32(_mm256_set1_epi32(x), _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(dx)));
+}
+
+static void SpanNearestAVX2(const sAffineSpan &s)
+{
+	const __m256i vPitch	= _mm256_set1_epi32(s.iPitch);
+	const __m256i vdu		= _mm256_set1_epi32(8 * s.du);
+	const __m256i vdv		= _mm256_set1_epi32(8 * s.dv);
+	__m256i vu = Ramp8(s.u, s.du);
+	__m256i vv = Ramp8(s.v, s.dv);
+
+	int i = 0;
+	for(; i + 8 <= s.iCount; i += 8)
+	{
+		__m256i idx = Index8(vu, vv, vPitch);
+		__m256i src = Gather8(s.pSrc, idx);
+		Store8(&s.pDst[i], src, Opaque8(s, src, idx));
+
+		vu = _mm256_add_epi32(vu, vdu);
+		vv = _mm256_add_epi32(vv, vdv);
+	}
+
+	SpanNearestScalar(s, i);
+}
+
+static void SpanBilinearAVX2(const sAffineSpan &s)
+{
+	const __m256i vPitch	= _mm256_set1_epi32(s.iPitch);
+	const __m256i vHalf		= _mm256_set1_epi32(0x8000);
+	const __m256i vFrac		= _mm256_set1_epi32(0xFF);
+	const __m256i vZero		= _mm256_setzero_si256();
+	const __m256i vdu		= _mm256_set1_epi32(8 * s.du);
+	const __m256i vdv		= _mm256_set1_epi32(8 * s.dv);
+	__m256i vu = Ramp8(s.u, s.du);
+	__m256i vv = Ramp8(s.v, s.dv);
+
+	int i = 0;
+	for(; i + 8 <= s.iCount; i += 8)
+	{
+		__m256i idx = Index8(vu, vv, vPitch);
+		__m256i idxNearest = Index8(_mm256_add_epi32(vu, vHalf), _mm256_add_epi32(vv, vHalf), vPitch);
+
+		__m256i t00 = Gather8(s.pSrc, idx);
+		__m256i t10 = Gather8(s.pSrc + 1, idx);
+		__m256i t01 = Gather8(s.pSrc + s.iPitch, idx);
+		__m256i t11 = Gather8(s.pSrc + s.iPitch + 1, idx);
+
+		// the unpacks work per 128 bit lane, pixels {0,1,4,5} end up in
+		// the low halves and {2,3,6,7} in the high ones, for weights too
+		__m256i fx = _mm256_and_si256(_mm256_srli_epi32(vu, 8), vFrac);
+		__m256i fy = _mm256_and_si256(_mm256_srli_epi32(vv, 8), vFrac);
+		fx = _mm256_or_si256(fx, _mm256_slli_epi32(fx, 16));
+		fy = _mm256_or_si256(fy, _mm256_slli_epi32(fy, 16));
+		__m256i fxLo = _mm256_unpacklo_epi32(fx, fx), fxHi = _mm256_unpackhi_epi32(fx, fx);
+		__m256i fyLo = _mm256_unpacklo_epi32(fy, fy), fyHi = _mm256_unpackhi_epi32(fy, fy);
+
+		__m256i topLo = Lerp16x16(_mm256_unpacklo_epi8(t00, vZero), _mm256_unpacklo_epi8(t10, vZero), fxLo);
+		__m256i topHi = Lerp16x16(_mm256_unpackhi_epi8(t00, vZero), _mm256_unpackhi_epi8(t10, vZero), fxHi);
+		__m256i botLo = Lerp16x16(_mm256_unpacklo_epi8(t01, vZero), _mm256_unpacklo_epi8(t11, vZero), fxLo);
+		__m256i botHi = Lerp16x16(_mm256_unpackhi_epi8(t01, vZero), _mm256_unpackhi_epi8(t11, vZero), fxHi);
+
+		__m256i res = _mm256_packus_epi16(Lerp16x16(topLo, botLo, fyLo), Lerp16x16(topHi, botHi, fyHi));
+		Store8(&s.pDst[i], res, Opaque8(s, Gather8(s.pSrc, idxNearest), idxNearest));
+
+		vu = _mm256_add_epi32(vu, vdu);
+		vv = _mm256_add_epi32(vv, vdv);
+	}
+
+	SpanBilinearScalar(s, i);
+}
+#endif // SIMD_AVX2
+
+//-----------------------------------------------------------------------------
+// Local Functions
+//-----------------------------------------------------------------------------
+// Narrows [tMin, tMax] to the t where 0 <= p0 + dp * t < fLimit
+static void ClipAxis(double p0, double dp, double fLimit, double &tMin, double &tMax)
+{
+	if(fabs(dp) < 1e-12)
+	{
+		if(p0 < 0.0 || p0 >= fLimit)
+			tMax = tMin - 1.0;
+		return;
+	}
+
+	double t0 = -p0 / dp;
+	double t1 = (fLimit - p0) / dp;
+	if(t0 > t1) { double t = t0; t0 = t1; t1 = t; }
+
+	tMin = max(tMin, t0);
+	tMax = min(tMax, t1);
+}
+
+static inline bool InRange(int u, int v, int iLimitU, int iLimitV)
+{
+	return u >= 0 && v >= 0 && (u >> 16) < iLimitU && (v >> 16) < iLimitV;
+}
+
+static void SelectSpanFuncs(AFFINE_SPAN_FUNC &pfnNearest, AFFINE_SPAN_FUNC &pfnBilinear)
+{
+	pfnNearest	= SpanNearest;
+	pfnBilinear	= SpanBilinear;
+
+#if defined(SIMD_SSE2)
+	pfnNearest	= SpanNearestSSE2;
+	pfnBilinear	= SpanBilinearSSE2;
+#endif
+
+#if defined(SIMD_AVX2)
+	if(CpuHasAVX2())
+	{
+		pfnNearest	= SpanNearestAVX2;
+		pfnBilinear	= SpanBilinearAVX2;
+	}
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Name : WalkAffine ()
+// Desc : Walks the destination bounding box of a w x h source rectangle
+//		transformed by xf row by row. Each row is clipped analytically to
+//		the span whose source position lies inside the rectangle, so the
+//		span functions never test bounds per pixel. The source fields of
+//		span must be set; the rest are filled in for each row.
+//-----------------------------------------------------------------------------
+static void WalkAffine(const sSurface &dst, int w, int h, const sBlitTransform &xf, bool bBilinear,
+					   sAffineSpan &span, AFFINE_SPAN_FUNC pfnSpan)
+{
+	// Bilinear filtering reads one texel right and below, so it samples
+	// between texel centres and needs at least two of them on each axis.
+	double fOffset	= bBilinear ? 0.5 : 0.0;
+	int iLimitU		= bBilinear ? w - 1 : w;
+	int iLimitV		= bBilinear ? h - 1 : h;
+
+	// Inverse mapping from a destination offset to the source rectangle
+	double c = cos(xf.fAngle), s = sin(xf.fAngle);
+	double dudx =  c / xf.fScaleX, dudy = s / xf.fScaleX;
+	double dvdx = -s / xf.fScaleY, dvdy = c / xf.fScaleY;
+
+	// Destination bounding box of the rotated rectangle
+	double hw = 0.5 * w * fabs(xf.fScaleX), hh = 0.5 * h * fabs(xf.fScaleY);
+	double ex = fabs(c) * hw + fabs(s) * hh;
+	double ey = fabs(s) * hw + fabs(c) * hh;
+
+	int x0 = max(0, (int)floor(xf.fCenterX - ex));
+	int x1 = min(dst.iWidth, (int)ceil(xf.fCenterX + ex));
+	int y0 = max(0, (int)floor(xf.fCenterY - ey));
+	int y1 = min(dst.iHeight, (int)ceil(xf.fCenterY + ey));
+	if(x0 >= x1 || y0 >= y1)
+		return;
+
+	span.du	= (int)floor(dudx * 65536.0 + 0.5);
+	span.dv	= (int)floor(dvdx * 65536.0 + 0.5);
+
+	for(int y = y0; y < y1; y++)
+	{
+		// source position of the centre of the first pixel in the row
+		double dx = x0 + 0.5 - xf.fCenterX;
+		double dy = y + 0.5 - xf.fCenterY;
+		double u0 = dudx * dx + dudy * dy + 0.5 * w - fOffset;
+		double v0 = dvdx * dx + dvdy * dy + 0.5 * h - fOffset;
+
+		double tMin = 0.0, tMax = x1 - x0;
+		ClipAxis(u0, dudx, iLimitU, tMin, tMax);
+		ClipAxis(v0, dvdx, iLimitV, tMin, tMax);
+		if(tMax < tMin)
+			continue;
+
+		int u = (int)floor(u0 * 65536.0 + 0.5);
+		int v = (int)floor(v0 * 65536.0 + 0.5);
+
+		// Widen by a pixel for rounding, then settle the ends on the
+		// fixed point positions the span functions will actually use.
+		int iStart	= max(0, (int)floor(tMin) - 1);
+		int iEnd	= min(x1 - x0, (int)ceil(tMax) + 1);
+		while(iStart < iEnd && !InRange(u + span.du * iStart, v + span.dv * iStart, iLimitU, iLimitV))
+			iStart++;
+		while(iEnd > iStart && !InRange(u + span.du * (iEnd - 1), v + span.dv * (iEnd - 1), iLimitU, iLimitV))
+			iEnd--;
+		if(iStart >= iEnd)
+			continue;
+
+		span.pDst	= &dst.pBits[y * dst.iPitch + x0 + iStart];
+		span.iCount	= iEnd - iStart;
+		span.u		= u + span.du * iStart;
+		span.v		= v + span.dv * iStart;
+		pfnSpan(span);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : BlitAffineSpans ()
+// Desc : BlitAffine with the span functions given, so the benchmark can
+//		run every path.
+//-----------------------------------------------------------------------------
+static void BlitAffineSpans(const sSurface &dst, const sSurface &src, const RECT &rcSrc,
+							const sSurface *pMask, bool bColorKey, DWORD dwColorKey,
+							const sBlitTransform &xf, AFFINE_SPAN_FUNC pfnNearest, AFFINE_SPAN_FUNC pfnBilinear)
+{
+	int w = rcSrc.right - rcSrc.left;
+	int h = rcSrc.bottom - rcSrc.top;
+	if(w <= 0 || h <= 0 || xf.fScaleX == 0.0f || xf.fScaleY == 0.0f)
+		return;
+
+	// the SSE2 index multiply works on 16 bit values
+	assert(src.iPitch < 32768 && src.iHeight < 32768);
+	assert(!pMask || pMask->iPitch == src.iPitch);
+
+	sAffineSpan span;
+	span.pSrc		= &src.pBits[rcSrc.top * src.iPitch + rcSrc.left];
+	span.pMask		= pMask ? &pMask->pBits[rcSrc.top * pMask->iPitch + rcSrc.left] : NULL;
+	span.iPitch		= src.iPitch;
+	span.bColorKey	= bColorKey;
+	span.dwColorKey	= dwColorKey & 0x00FFFFFF;
+	span.pIndex		= NULL;
+	span.pPalette	= NULL;
+	span.eBlend		= BLEND_MASK;
+
+	bool bBilinear = xf.eFilter == BLIT_BILINEAR && w > 1 && h > 1;
+	WalkAffine(dst, w, h, xf, bBilinear, span, bBilinear ? pfnBilinear : pfnNearest);
+}
+
+//-----------------------------------------------------------------------------
+// Name : BlitAffine ()
+// Desc : Sets up the source of the span functions and leaves the rows to
+//		WalkAffine.
+//-----------------------------------------------------------------------------
+void BlitAffine(const sSurface &dst, const sSurface &src, const RECT &rcSrc,
+				const sSurface *pMask, bool bColorKey, DWORD dwColorKey,
+				const sBlitTransform &xf)
+{
+	static AFFINE_SPAN_FUNC pfnNearest = NULL, pfnBilinear = NULL;
+	if(!pfnNearest)
+		SelectSpanFuncs(pfnNearest, pfnBilinear);
+
+	BlitAffineSpans(dst, src, rcSrc, pMask, bColorKey, dwColorKey, xf, pfnNearest, pfnBilinear);
+}
+
+//-----------------------------------------------------------------------------
+// Blend Row Functions
+//-----------------------------------------------------------------------------
+// Sources are premultiplied, so alpha blending is dst * (255 - a) / 255 + src
+// per channel. The division by 255 is done as (t + (t >> 8)) >> 8 with
+// t = x * (255 - a) + 128, which is exact for all 8 bit inputs and fits in
+// 16 bits. The SIMD versions use the same arithmetic as the scalar ones.
+typedef void (*BLEND_ROW_FUNC)(DWORD *pDst, const DWORD *pSrc, int iCount);
+
+static inline DWORD BlendAlpha(DWORD s, DWORD d)
+{
+	DWORD ia = 255 - (s >> 24);
+	DWORD r = 0;
+
+	for(int c = 0; c < 32; c += 8)
+	{
+		DWORD t = ((d >> c) & 0xFF) * ia + 128;
+		DWORD v = ((t + (t >> 8)) >> 8) + ((s >> c) & 0xFF);
+		r |= min(v, (DWORD)255) << c;
+	}
+
+	return r;
+}
+
+static inline DWORD BlendAdd(DWORD s, DWORD d)
+{
+	DWORD r = 0;
+
+	for(int c = 0; c < 32; c += 8)
+		r |= min(((d >> c) & 0xFF) + ((s >> c) & 0xFF), (DWORD)255) << c;
+
+	return r;
+}
+
+static void RowAlphaScalar(DWORD *pDst, const DWORD *pSrc, int iFirst, int iCount)
+{
+	for(int i = iFirst; i < iCount; i++)
+		pDst[i] = BlendAlpha(pSrc[i], pDst[i]);
+}
+
+static void RowAddScalar(DWORD *pDst, const DWORD *pSrc, int iFirst, int iCount)
+{
+	for(int i = iFirst; i < iCount; i++)
+		pDst[i] = BlendAdd(pSrc[i], pDst[i]);
+}
+
+static void RowAlpha(DWORD *pDst, const DWORD *pSrc, int iCount)	{ RowAlphaScalar(pDst, pSrc, 0, iCount); }
+static void RowAdd(DWORD *pDst, const DWORD *pSrc, int iCount)		{ RowAddScalar(pDst, pSrc, 0, iCount); }
+
+#if defined(SIMD_SSE2)
+// dst * (255 - a) / 255 for four unpacked pixels, a taken from channel 3
+static inline __m128i Attenuate8(__m128i d, __m128i s)
+{
+	__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(d, _mm_sub_epi16(_mm_set1_epi16(255), a)), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static void RowAlphaSSE2(DWORD *pDst, const DWORD *pSrc, int iCount)
+{
+	const __m128i vZero	= _mm_setzero_si128();
+	const __m128i vOpaque	= _mm_set1_epi32(0xFF000000);
+
+	int i = 0;
+	for(; i + 4 <= iCount; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*)&pSrc[i]);
+
+		// most of a sprite is either fully transparent or fully opaque
+		if(_mm_movemask_epi8(_mm_cmpeq_epi32(s, vZero)) == 0xFFFF)
+			continue;
+		if(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, vOpaque), vOpaque)) == 0xFFFF)
+		{
+			_mm_storeu_si128((__m128i*)&pDst[i], s);
+			continue;
+		}
+
+		__m128i d	= _mm_loadu_si128((const __m128i*)&pDst[i]);
+		__m128i lo	= Attenuate8(_mm_unpacklo_epi8(d, vZero), _mm_unpacklo_epi8(s, vZero));
+		__m128i hi	= Attenuate8(_mm_unpackhi_epi8(d, vZero), _mm_unpackhi_epi8(s, vZero));
+		_mm_storeu_si128((__m128i*)&pDst[i], _mm_adds_epu8(_mm_packus_epi16(lo, hi), s));
+	}
+
+	RowAlphaScalar(pDst, pSrc, i, iCount);
+}
+
+static void RowAddSSE2(DWORD *pDst, const DWORD *pSrc, int iCount)
+{
+	int i = 0;
+	for(; i + 4 <= iCount; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*)&pSrc[i]);
+		__m128i d = _mm_loadu_si128((const __m128i*)&pDst[i]);
+		_mm_storeu_si128((__m128i*)&pDst[i], _mm_adds_epu8(d, s));
+	}
+
+	RowAddScalar(pDst, pSrc, i, iCount);
+}
+#endif // SIMD_SSE2
+
+#if defined(SIMD_AVX2)
+static inline __m256i Attenuate16(__m256i d, __m256i s)
+{
+	__m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m256i t = _mm256_add_epi16(_mm256_mullo_epi16(d, _mm256_sub_epi16(_mm256_set1_epi16(255), a)), _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+static void RowAlphaAVX2(DWORD *pDst, const DWORD *pSrc, int iCount)
+{
+	const __m256i vZero	= _mm256_setzero_si256();
+	const __m256i vOpaque	= _mm256_set1_epi32(0xFF000000);
+
+	int i = 0;
+	for(; i + 8 <= iCount; i += 8)
+	{
+		__m256i s = _mm256_loadu_si256((const __m256i*)&pSrc[i]);
+
+		if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(s, vZero)) == -1)
+			continue;
+		if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(s, vOpaque), vOpaque)) == -1)
+		{
+			_mm256_storeu_si256((__m256i*)&pDst[i], s);
+			continue;
+		}
+
+		__m256i d	= _mm256_loadu_si256((const __m256i*)&pDst[i]);
+		__m256i lo	= Attenuate16(_mm256_unpacklo_epi8(d, vZero), _mm256_unpacklo_epi8(s, vZero));
+		__m256i hi	= Attenuate16(_mm256_unpackhi_epi8(d, vZero), _mm256_unpackhi_epi8(s, vZero));
+		_mm256_storeu_si256((__m256i*)&pDst[i], _mm256_adds_epu8(_mm256_packus_epi16(lo, hi), s));
+	}
+
+	RowAlphaScalar(pDst, pSrc, i, iCount);
+}
+
+static void RowAddAVX2(DWORD *pDst, const DWORD *pSrc, int iCount)
+{
+	int i = 0;
+	for(; i + 8 <= iCount; i += 8)
+	{
+		__m256i s = _mm256_loadu_si256((const __m256i*)&pSrc[i]);
+		__m256i d = _mm256_loadu_si256((const __m256i*)&pDst[i]);
+		_mm256_storeu_si256((__m256i*)&pDst[i], _mm256_adds_epu8(d, s));
+	}
+
+	RowAddScalar(pDst, pSrc, i, iCount);
+}
+#endif // SIMD_AVX2
+
+static void SelectBlendFuncs(BLEND_ROW_FUNC &pfnAlpha, BLEND_ROW_FUNC &pfnAdd)
+{
+	pfnAlpha	= RowAlpha;
+	pfnAdd		= RowAdd;
+
+#if defined(SIMD_SSE2)
+	pfnAlpha	= RowAlphaSSE2;
+	pfnAdd		= RowAddSSE2;
+#endif
+
+#if defined(SIMD_AVX2)
+	if(CpuHasAVX2())
+	{
+		pfnAlpha	= RowAlphaAVX2;
+		pfnAdd		= RowAddAVX2;
+	}
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Name : BlitBlend ()
+// Desc : Clips the source rectangle against the destination once, then
+//		blends it a row at a time.
+//-----------------------------------------------------------------------------
+void BlitBlend(const sSurface &dst, int x, int y, const sSurface &src, const RECT &rcSrc,
+			   EBlendMode eMode)
+{
+	static BLEND_ROW_FUNC pfnAlpha = NULL, pfnAdd = NULL;
+	if(!pfnAlpha)
+		SelectBlendFuncs(pfnAlpha, pfnAdd);
+
+	assert((eMode == BLEND_ALPHA || eMode == BLEND_ADDITIVE) && "BlitBlend needs a blending mode!");
+
+	int sx = rcSrc.left, sy = rcSrc.top;
+	int w = rcSrc.right - rcSrc.left;
+	int h = rcSrc.bottom - rcSrc.top;
+
+	if(x < 0) { sx -= x; w += x; x = 0; }
+	if(y < 0) { sy -= y; h += y; y = 0; }
+	w = min(w, dst.iWidth - x);
+	h = min(h, dst.iHeight - y);
+	if(w <= 0 || h <= 0)
+		return;
+
+	BLEND_ROW_FUNC pfnRow = (eMode == BLEND_ADDITIVE) ? pfnAdd : pfnAlpha;
+
+	for(int j = 0; j < h; j++)
+		pfnRow(&dst.pBits[(y + j) * dst.iPitch + x], &src.pBits[(sy + j) * src.iPitch + sx], w);
+}
+
+//-----------------------------------------------------------------------------
+// Indexed Affine Span Functions
+//-----------------------------------------------------------------------------
+// Each sample is expanded through the palette and composited like
+// BlitIndexed does it. Scalar only: the texels are bytes, which the 32 bit
+// gathers cannot fetch without reading past the end of the page.
+static inline DWORD CompositeIndexed(const sAffineSpan &s, DWORD dwTexel, DWORD dwDst)
+{
+	return s.eBlend == BLEND_ADDITIVE ? BlendAdd(dwTexel, dwDst) : BlendAlpha(dwTexel, dwDst);
+}
+
+static void SpanNearestIndexed(const sAffineSpan &s)
+{
+	int u = s.u, v = s.v;
+
+	for(int i = 0; i < s.iCount; i++, u += s.du, v += s.dv)
+	{
+		DWORD dwTexel = s.pPalette[s.pIndex[(v >> 16) * s.iPitch + (u >> 16)]];
+		if(dwTexel)
+			s.pDst[i] = CompositeIndexed(s, dwTexel, s.pDst[i]);
+	}
+}
+
+static void SpanBilinearIndexed(const sAffineSpan &s)
+{
+	int u = s.u, v = s.v;
+
+	for(int i = 0; i < s.iCount; i++, u += s.du, v += s.dv)
+	{
+		// Bilerp's layout with a pitch of 2
+		const BYTE *p = &s.pIndex[(v >> 16) * s.iPitch + (u >> 16)];
+		DWORD dwTexels[4] = { s.pPalette[p[0]], s.pPalette[p[1]], s.pPalette[p[s.iPitch]], s.pPalette[p[s.iPitch + 1]] };
+
+		DWORD dwTexel = Bilerp(dwTexels, 2, (u >> 8) & 0xFF, (v >> 8) & 0xFF);
+		if(dwTexel)
+			s.pDst[i] = CompositeIndexed(s, dwTexel, s.pDst[i]);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : BlitAffineIndexed ()
+// Desc : BlitAffine's row walk with the indexed span functions.
+//-----------------------------------------------------------------------------
+void BlitAffineIndexed(const sSurface &dst, const sSurface8 &src, const RECT &rcSrc,
+					   const DWORD *pPalette, EBlendMode eMode, const sBlitTransform &xf)
+{
+	int w = rcSrc.right - rcSrc.left;
+	int h = rcSrc.bottom - rcSrc.top;
+	if(w <= 0 || h <= 0 || xf.fScaleX == 0.0f || xf.fScaleY == 0.0f)
+		return;
+
+	sAffineSpan span;
+	span.pSrc		= NULL;
+	span.pMask		= NULL;
+	span.iPitch		= src.iPitch;
+	span.bColorKey	= false;
+	span.dwColorKey	= 0;
+	span.pIndex		= &src.pBits[rcSrc.top * src.iPitch + rcSrc.left];
+	span.pPalette	= pPalette;
+	span.eBlend		= eMode;
+
+	bool bBilinear = xf.eFilter == BLIT_BILINEAR && w > 1 && h > 1;
+	WalkAffine(dst, w, h, xf, bBilinear, span, bBilinear ? SpanBilinearIndexed : SpanNearestIndexed);
+}
+
+//-----------------------------------------------------------------------------
+// Palette Expansion Functions
+//-----------------------------------------------------------------------------
+typedef void (*EXPAND_ROW_FUNC)(DWORD *pDst, const BYTE *pSrc, const DWORD *pPalette, int iCount);
+
+const int MAX_EXPAND_WIDTH = 1024;	// Widest indexed row expanded at once
+
+static void ExpandRowScalar(DWORD *pDst, const BYTE *pSrc, const DWORD *pPalette, int iFirst, int iCount)
+{
+	for(int i = iFirst; i < iCount; i++)
+		pDst[i] = pPalette[pSrc[i]];
+}
+
+static void ExpandRow(DWORD *pDst, const BYTE *pSrc, const DWORD *pPalette, int iCount)
+{
+	ExpandRowScalar(pDst, pSrc, pPalette, 0, iCount);
+}
+
+#if defined(SIMD_AVX2)
+static void ExpandRowAVX2(DWORD *pDst, const BYTE *pSrc, const DWORD *pPalette, int iCount)
+{
+	int i = 0;
+	for(; i + 8 <= iCount; i += 8)
+	{
+		__m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&pSrc[i]));
+		_mm256_storeu_si256((__m256i*)&pDst[i], _mm256_i32gather_epi32((const int*)pPalette, idx, 4));
+	}
+
+	ExpandRowScalar(pDst, pSrc, pPalette, i, iCount);
+}
+#endif // SIMD_AVX2
+
+//-----------------------------------------------------------------------------
+// Name : BlitIndexed ()
+// Desc : Each row is expanded into a small ARGB buffer that stays in the
+//		cache and then goes through the same row blenders as BlitBlend. A
+//		256 entry palette is too big for a byte shuffle, so expansion uses
+//		AVX2 gathers where available and table lookups otherwise.
+//-----------------------------------------------------------------------------
+void BlitIndexed(const sSurface &dst, int x, int y, const sSurface8 &src, const RECT &rcSrc,
+				 const DWORD *pPalette, EBlendMode eMode)
+{
+	static BLEND_ROW_FUNC pfnAlpha = NULL, pfnAdd = NULL;
+	static EXPAND_ROW_FUNC pfnExpand = NULL;
+	if(!pfnAlpha)
+	{
+		SelectBlendFuncs(pfnAlpha, pfnAdd);
+
+		pfnExpand = ExpandRow;
+#if defined(SIMD_AVX2)
+		if(CpuHasAVX2())
+			pfnExpand = ExpandRowAVX2;
+#endif
+	}
+
+	int sx = rcSrc.left, sy = rcSrc.top;
+	int w = rcSrc.right - rcSrc.left;
+	int h = rcSrc.bottom - rcSrc.top;
+
+	if(x < 0) { sx -= x; w += x; x = 0; }
+	if(y < 0) { sy -= y; h += y; y = 0; }
+	w = min(w, dst.iWidth - x);
+	h = min(h, dst.iHeight - y);
+	if(w <= 0 || h <= 0)
+		return;
+
+	BLEND_ROW_FUNC pfnRow = (eMode == BLEND_ADDITIVE) ? pfnAdd : pfnAlpha;
+	DWORD row[MAX_EXPAND_WIDTH];
+
+	// Rows wider than the buffer go through it a piece at a time
+	for(int j = 0; j < h; j++)
+	{
+		const BYTE *pSrc	= &src.pBits[(sy + j) * src.iPitch + sx];
+		DWORD *pDst			= &dst.pBits[(y + j) * dst.iPitch + x];
+		for(int i = 0; i < w; i += MAX_EXPAND_WIDTH)
+		{
+			int iCount = min(w - i, MAX_EXPAND_WIDTH);
+			pfnExpand(row, &pSrc[i], pPalette, iCount);
+			pfnRow(&pDst[i], row, iCount);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Scaled Blending
+//-----------------------------------------------------------------------------
+// Maps one axis of a scaled blit: finds the destination pixels whose centres
+// fall inside the source span and the source offset each one samples.
+// Returns the number of destination pixels, starting at iFirst.
+static int ScaleAxis(float fPos, float fScale, int iSrcSize, int iDstSize, int &iFirst, int *pOffsets)
+{
+	int i0 = max((int)ceil(fPos - 0.5f), 0);
+	int i1 = min((int)ceil(fPos + iSrcSize * fScale - 0.5f), iDstSize);
+	i1 = min(i1, i0 + MAX_EXPAND_WIDTH);
+
+	for(int i = i0; i < i1; i++)
+	{
+		int iOffset = (int)((i + 0.5f - fPos) / fScale);
+		pOffsets[i - i0] = max(0, min(iOffset, iSrcSize - 1));
+	}
+
+	iFirst = i0;
+	return max(i1 - i0, 0);
+}
+
+//-----------------------------------------------------------------------------
+// Name : BlitBlendScaled ()
+// Desc : Samples each destination row into a small buffer, then blends it
+//		with the same row functions as BlitBlend.
+//-----------------------------------------------------------------------------
+void BlitBlendScaled(const sSurface &dst, float fX, float fY, float fScale, const sSurface &src,
+					 const RECT &rcSrc, EBlendMode eMode)
+{
+	static BLEND_ROW_FUNC pfnAlpha = NULL, pfnAdd = NULL;
+	if(!pfnAlpha)
+		SelectBlendFuncs(pfnAlpha, pfnAdd);
+
+	int cols[MAX_EXPAND_WIDTH], rows[MAX_EXPAND_WIDTH];
+	int x, y;
+	int w = ScaleAxis(fX, fScale, rcSrc.right - rcSrc.left, dst.iWidth, x, cols);
+	int h = ScaleAxis(fY, fScale, rcSrc.bottom - rcSrc.top, dst.iHeight, y, rows);
+	if(w <= 0 || h <= 0)
+		return;
+
+	BLEND_ROW_FUNC pfnRow = (eMode == BLEND_ADDITIVE) ? pfnAdd : pfnAlpha;
+	DWORD row[MAX_EXPAND_WIDTH];
+
+	for(int j = 0; j < h; j++)
+	{
+		const DWORD *pSrc = &src.pBits[(rcSrc.top + rows[j]) * src.iPitch + rcSrc.left];
+		for(int i = 0; i < w; i++)
+			row[i] = pSrc[cols[i]];
+		pfnRow(&dst.pBits[(y + j) * dst.iPitch + x], row, w);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : BlitIndexedScaled ()
+// Desc : BlitBlendScaled for an indexed source, expanding as it samples.
+//-----------------------------------------------------------------------------
+void BlitIndexedScaled(const sSurface &dst, float fX, float fY, float fScale, const sSurface8 &src,
+					   const RECT &rcSrc, const DWORD *pPalette, EBlendMode eMode)
+{
+	static BLEND_ROW_FUNC pfnAlpha = NULL, pfnAdd = NULL;
+	if(!pfnAlpha)
+		SelectBlendFuncs(pfnAlpha, pfnAdd);
+
+	int cols[MAX_EXPAND_WIDTH], rows[MAX_EXPAND_WIDTH];
+	int x, y;
+	int w = ScaleAxis(fX, fScale, rcSrc.right - rcSrc.left, dst.iWidth, x, cols);
+	int h = ScaleAxis(fY, fScale, rcSrc.bottom - rcSrc.top, dst.iHeight, y, rows);
+	if(w <= 0 || h <= 0)
+		return;
+
+	BLEND_ROW_FUNC pfnRow = (eMode == BLEND_ADDITIVE) ? pfnAdd : pfnAlpha;
+	DWORD row[MAX_EXPAND_WIDTH];
+
+	for(int j = 0; j < h; j++)
+	{
+		const BYTE *pSrc = &src.pBits[(rcSrc.top + rows[j]) * src.iPitch + rcSrc.left];
+		for(int i = 0; i < w; i++)
+			row[i] = pPalette[pSrc[cols[i]]];
+		pfnRow(&dst.pBits[(y + j) * dst.iPitch + x], row, w);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : TimeAffine ()
+// Desc : Microseconds per blit of one span function. Returns -1 when the
+//		destination differs from what the scalar span function draws.
+//-----------------------------------------------------------------------------
+static double TimeAffine(AFFINE_SPAN_FUNC pfnSpan, AFFINE_SPAN_FUNC pfnScalar, const sSurface &dst, DWORD *pCheck,
+						 const sSurface &src, const sSurface &mask, const RECT &rcSrc, const sBlitTransform &xf)
+{
+	__int64 nStart, nEnd;
+	int nBytes = dst.iPitch * dst.iHeight * (int)sizeof(DWORD);
+
+	memset(pCheck, 0x40, nBytes);
+	memset(dst.pBits, 0x40, nBytes);
+	sSurface Check = { pCheck, dst.iWidth, dst.iHeight, dst.iPitch };
+	BlitAffineSpans(Check, src, rcSrc, &mask, false, 0, xf, pfnScalar, pfnScalar);
+	BlitAffineSpans(dst, src, rcSrc, &mask, false, 0, xf, pfnSpan, pfnSpan);
+	if(memcmp(pCheck, dst.pBits, nBytes) != 0)
+		return -1.0;
+
+	nStart = BenchTime();
+	for(int i = 0; i < BENCHMARK_BLITS; i++)
+		BlitAffineSpans(dst, src, rcSrc, &mask, false, 0, xf, pfnSpan, pfnSpan);
+	nEnd = BenchTime();
+
+	return BenchSeconds(nStart, nEnd) * 1e6 / BENCHMARK_BLITS;
+}
+
+//-----------------------------------------------------------------------------
+// Name : TimeGdi ()
+// Desc : Microseconds per blit of the same transform with PlgBlt and a
+//		monochrome mask, or -1 when GDI fails.
+//-----------------------------------------------------------------------------
+static double TimeGdi(HDC hDstDC, HDC hSrcDC, HBITMAP hMask, const RECT &rcSrc, const sBlitTransform &xf)
+{
+	__int64 nStart, nEnd;
+	float fHalfW	= (rcSrc.right - rcSrc.left) * 0.5f;
+	float fHalfH	= (rcSrc.bottom - rcSrc.top) * 0.5f;
+	float c			= cosf(xf.fAngle), s = sinf(xf.fAngle);
+
+	// Upper-left, upper-right and lower-left corners, mapped the way
+	// BlitAffine maps them
+	POINT ptCorners[3];
+	const float fCornerU[3] = { -fHalfW, fHalfW, -fHalfW };
+	const float fCornerV[3] = { -fHalfH, -fHalfH, fHalfH };
+	for(int i = 0; i < 3; i++)
+	{
+		float u = fCornerU[i] * xf.fScaleX, v = fCornerV[i] * xf.fScaleY;
+		ptCorners[i].x = (LONG)floorf(xf.fCenterX + c * u - s * v + 0.5f);
+		ptCorners[i].y = (LONG)floorf(xf.fCenterY + s * u + c * v + 0.5f);
+	}
+
+	SetStretchBltMode(hDstDC, xf.eFilter == BLIT_BILINEAR ? HALFTONE : COLORONCOLOR);
+	SetBrushOrgEx(hDstDC, 0, 0, NULL);
+
+	int w = rcSrc.right - rcSrc.left, h = rcSrc.bottom - rcSrc.top;
+	if(!PlgBlt(hDstDC, ptCorners, hSrcDC, rcSrc.left, rcSrc.top, w, h, hMask, rcSrc.left, rcSrc.top))
+		return -1.0;
+	GdiFlush();
+
+	nStart = BenchTime();
+	for(int i = 0; i < BENCHMARK_BLITS; i++)
+		PlgBlt(hDstDC, ptCorners, hSrcDC, rcSrc.left, rcSrc.top, w, h, hMask, rcSrc.left, rcSrc.top);
+	GdiFlush();
+	nEnd = BenchTime();
+
+	return BenchSeconds(nStart, nEnd) * 1e6 / BENCHMARK_BLITS;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CreateBenchmarkDIB ()
+// Desc : Top-down 32 bit DIB section selected into a new memory DC.
+//-----------------------------------------------------------------------------
+static HBITMAP CreateBenchmarkDIB(int iSize, HDC &hDC, DWORD *&pBits)
+{
+	BITMAPINFO bmi;
+	ZeroMemory(&bmi, sizeof(bmi));
+	bmi.bmiHeader.biSize		= sizeof(BITMAPINFOHEADER);
+	bmi.bmiHeader.biWidth		= iSize;
+	bmi.bmiHeader.biHeight		= -iSize;
+	bmi.bmiHeader.biPlanes		= 1;
+	bmi.bmiHeader.biBitCount	= 32;
+	bmi.bmiHeader.biCompression	= BI_RGB;
+
+	pBits = NULL;
+	hDC = CreateCompatibleDC(NULL);
+	HBITMAP hBitmap = hDC ? CreateDIBSection(hDC, &bmi, DIB_RGB_COLORS, (void**)&pBits, NULL, 0) : NULL;
+	if(hBitmap)
+		SelectObject(hDC, hBitmap);
+	return hBitmap;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunBlitBenchmark ()
+// Desc : Draws a masked sprite from a page at each rotation and scale with
+//		both filters, and writes microseconds per blit for GDI's PlgBlt and
+//		every span path. The SIMD paths are first checked against the
+//		scalar one.
+//-----------------------------------------------------------------------------
+bool RunBlitBenchmark(LPCSTR strFileName)
+{
+	FILE *pFile = BenchOpen(strFileName);
+	if(!pFile)
+		return false;
+
+	DWORD *pPage	= new DWORD[BENCHMARK_PAGE * BENCHMARK_PAGE];
+	DWORD *pMask	= new DWORD[BENCHMARK_PAGE * BENCHMARK_PAGE];
+	DWORD *pTarget	= new DWORD[BENCHMARK_TARGET * BENCHMARK_TARGET];
+	DWORD *pCheck	= new DWORD[BENCHMARK_TARGET * BENCHMARK_TARGET];
+	BYTE *pMaskBits	= new BYTE[BENCHMARK_PAGE * BENCHMARK_PAGE / 8];
+	ULONG nSeed		= 1;
+
+	// A disc of noise, so the mask has edges in every direction. The
+	// monochrome GDI mask has a set bit where the sprite is drawn.
+	const int iRadius = BENCHMARK_SPRITE / 2;
+	memset(pMaskBits, 0, BENCHMARK_PAGE * BENCHMARK_PAGE / 8);
+	for(int y = 0; y < BENCHMARK_PAGE; y++)
+	{
+		for(int x = 0; x < BENCHMARK_PAGE; x++)
+		{
+			int dx = x % BENCHMARK_SPRITE - iRadius, dy = y % BENCHMARK_SPRITE - iRadius;
+			bool bOpaque = dx * dx + dy * dy < iRadius * iRadius;
+
+			pPage[y * BENCHMARK_PAGE + x] = (DWORD)(BenchRandom(nSeed) * 16777216.0f);
+			pMask[y * BENCHMARK_PAGE + x] = bOpaque ? 0 : 0x00FFFFFF;
+			if(bOpaque)
+				pMaskBits[(y * BENCHMARK_PAGE + x) >> 3] |= (BYTE)(0x80 >> (x & 7));
+		}
+	}
+
+	sSurface Page	= { pPage, BENCHMARK_PAGE, BENCHMARK_PAGE, BENCHMARK_PAGE };
+	sSurface Mask	= { pMask, BENCHMARK_PAGE, BENCHMARK_PAGE, BENCHMARK_PAGE };
+	sSurface Target	= { pTarget, BENCHMARK_TARGET, BENCHMARK_TARGET, BENCHMARK_TARGET };
+	RECT rcSrc		= { BENCHMARK_SPRITE, BENCHMARK_SPRITE, 2 * BENCHMARK_SPRITE, 2 * BENCHMARK_SPRITE };
+
+	// GDI gets the same pixels in DIB sections. Without them its column
+	// stays empty and the span paths are still timed.
+	HDC hSrcDC = NULL, hDstDC = NULL;
+	DWORD *pSrcBits = NULL, *pDstBits = NULL;
+	HBITMAP hSrc	= CreateBenchmarkDIB(BENCHMARK_PAGE, hSrcDC, pSrcBits);
+	HBITMAP hDst	= CreateBenchmarkDIB(BENCHMARK_TARGET, hDstDC, pDstBits);
+	HBITMAP hMask	= CreateBitmap(BENCHMARK_PAGE, BENCHMARK_PAGE, 1, 1, pMaskBits);
+	bool bGdi		= hSrc && hDst && hMask;
+	if(bGdi)
+		memcpy(pSrcBits, pPage, BENCHMARK_PAGE * BENCHMARK_PAGE * sizeof(DWORD));
+
+	AFFINE_SPAN_FUNC pfnNearest[3]	= { SpanNearest, NULL, NULL };
+	AFFINE_SPAN_FUNC pfnBilinear[3]	= { SpanBilinear, NULL, NULL };
+#if defined(SIMD_SSE2)
+	pfnNearest[1]	= SpanNearestSSE2;
+	pfnBilinear[1]	= SpanBilinearSSE2;
+#endif
+#if defined(SIMD_AVX2)
+	if(CpuHasAVX2())
+	{
+		pfnNearest[2]	= SpanNearestAVX2;
+		pfnBilinear[2]	= SpanBilinearAVX2;
+	}
+#endif
+
+	bool bMatch = true;
+	fprintf(pFile, "Microseconds per %dx%d masked sprite blit, - where the path is not\n", BENCHMARK_SPRITE, BENCHMARK_SPRITE);
+	fprintf(pFile, "available and WRONG where it disagrees with the scalar path\n\n");
+	fprintf(pFile, "filter    angle  scale     gdi  scalar    sse2    avx2\n");
+	for(int nFilter = 0; nFilter < 2; nFilter++)
+	{
+		for(int i = 0; i < (int)(sizeof(BENCHMARK_ANGLES) / sizeof(BENCHMARK_ANGLES[0])); i++)
+		{
+			sBlitTransform xf;
+			xf.fCenterX	= BENCHMARK_TARGET * 0.5f;
+			xf.fCenterY	= BENCHMARK_TARGET * 0.5f;
+			xf.fAngle	= BENCHMARK_ANGLES[i];
+			xf.fScaleX	= BENCHMARK_SCALES[i];
+			xf.fScaleY	= BENCHMARK_SCALES[i];
+			xf.eFilter	= nFilter == 0 ? BLIT_NEAREST : BLIT_BILINEAR;
+
+			fprintf(pFile, "%-8s  %5.2f  %5.2f", nFilter == 0 ? "nearest" : "bilinear", xf.fAngle, xf.fScaleX);
+
+			double fGdi = bGdi ? TimeGdi(hDstDC, hSrcDC, hMask, rcSrc, xf) : -1.0;
+			if(fGdi >= 0.0)
+				fprintf(pFile, "  %6.2f", fGdi);
+			else
+				fprintf(pFile, "  %6s", "-");
+
+			AFFINE_SPAN_FUNC *pfnPaths = nFilter == 0 ? pfnNearest : pfnBilinear;
+			for(int nPath = 0; nPath < 3; nPath++)
+			{
+				if(!pfnPaths[nPath])
+				{
+					fprintf(pFile, "  %6s", "-");
+					continue;
+				}
+
+				double fUs = TimeAffine(pfnPaths[nPath], pfnPaths[0], Target, pCheck, Page, Mask, rcSrc, xf);
+				bMatch = bMatch && fUs >= 0.0;
+				if(fUs >= 0.0)
+					fprintf(pFile, "  %6.2f", fUs);
+				else
+					fprintf(pFile, "  %6s", "WRONG");
+			}
+			fprintf(pFile, "\n");
+		}
+	}
+
+	if(hSrcDC) DeleteDC(hSrcDC);
+	if(hDstDC) DeleteDC(hDstDC);
+	if(hSrc) DeleteObject(hSrc);
+	if(hDst) DeleteObject(hDst);
+	if(hMask) DeleteObject(hMask);
+
+	delete []pPage;
+	delete []pMask;
+	delete []pTarget;
+	delete []pCheck;
+	delete []pMaskBits;
+
+	return BenchClose(pFile, bMatch);
+}
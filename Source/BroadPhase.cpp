@@ -0,0 +1,695 @@
+//-----------------------------------------------------------------------------
+// File: BroadPhase.cpp
+//
+// Desc: Collision broad phase. Every frame the game adds the bounds of the
+//		things that can collide, each on a collision layer, and gets back the
+//		pairs whose boxes overlap and whose layers are meant to meet. The
+//		boxes are sorted into a spatial hash of uniform grid cells, so only
+//		neighbours are ever tested against each other. A single box can
+//		also be tested against all of them at once. Long boxes, such as
+//		the path a fast shot covered in a frame, can instead be sorted
+//		along one axis and swept (sweep and prune), and a moving box can be
+//		swept against a still one to find when they first touch.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CBroadPhase Specific Includes
+//-----------------------------------------------------------------------------
+#include "BroadPhase.h"
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "OverlapBatch.h"
+#include "Profiler.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int	MIN_COLLISION_BUCKETS	= 64;
+
+const int	BENCHMARK_SIZES[]		= { 100, 1000, 10000, 100000 };
+const int	BENCHMARK_GRID_BOXES	= 2000000;		// Boxes put through FindPairs and FindPairsSweep per size
+const double BENCHMARK_BRUTE_TESTS	= 2e8;			// Box tests made by FindPairsBrute per size
+const float	BENCHMARK_SPACING		= 48.0f;		// World side is this times sqrt(boxes)
+const float	BENCHMARK_MIN_HALF		= 4.0f;			// Bullets ...
+const float	BENCHMARK_MAX_HALF		= 32.0f;		// ... up to planes
+
+// Player, enemies, player shots and enemy shots, each with what it hits
+const UINT	BENCHMARK_LAYERS[]		= { 1, 2, 4, 8 };
+const UINT	BENCHMARK_MASKS[]		= { 2 | 8, 1 | 4, 2, 1 };
+
+const int	BENCHMARK_SHOTS			= 1 << 20;		// Shots swept per pass of the threaded sweep
+const int	BENCHMARK_SHOT_GRAIN	= 4096;
+const int	BENCHMARK_SWEEP_PASSES	= 20;
+const int	BENCHMARK_TARGETS		= 32;			// Boxes each shot is swept against
+const float	BENCHMARK_TIME_STEP		= 1.0f / 60.0f;
+
+//-----------------------------------------------------------------------------
+// CBroadPhase Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CBroadPhase () (Constructor)
+// Desc : CBroadPhase Class Constructor
+//-----------------------------------------------------------------------------
+CBroadPhase::CBroadPhase(int nCapacity, float fCellSize)
+{
+	assert(nCapacity > 0 && fCellSize > 0.0f);
+
+	m_nCapacity		= nCapacity;
+	m_nCount		= 0;
+	m_fInvCellSize	= 1.0f / fCellSize;
+
+	m_pMinX			= new float[nCapacity];
+	m_pMinY			= new float[nCapacity];
+	m_pMaxX			= new float[nCapacity];
+	m_pMaxY			= new float[nCapacity];
+	m_pLayer		= new UINT[nCapacity];
+	m_pMask			= new UINT[nCapacity];
+	m_pUserData		= new int[nCapacity];
+
+	// About two buckets per proxy keeps most buckets to one cell
+	m_nBuckets = MIN_COLLISION_BUCKETS;
+	while(m_nBuckets < 2 * nCapacity)
+		m_nBuckets <<= 1;
+
+	m_pBucketStart	= new int[m_nBuckets + 1];
+	m_pBucketFill	= new int[m_nBuckets];
+	m_pBucketStamp	= new int[m_nBuckets];
+
+	// Most proxies cover up to four cells, the arrays grow if they do not
+	m_nMaxEntries	= 4 * nCapacity;
+	m_pEntries		= new int[m_nMaxEntries];
+
+	m_nMaxPairs		= nCapacity;
+	m_nPairs		= 0;
+	m_pPairs		= new sCollisionPair[m_nMaxPairs];
+
+	m_pSweep		= new sSweepEntry[nCapacity];
+
+	m_pHitBits		= new BYTE[(nCapacity + 7) / 8];
+	m_pQueryResults	= new int[nCapacity];
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CBroadPhase () (Destructor)
+// Desc : CBroadPhase Class Destructor
+//-----------------------------------------------------------------------------
+CBroadPhase::~CBroadPhase()
+{
+	delete []m_pMinX;
+	delete []m_pMinY;
+	delete []m_pMaxX;
+	delete []m_pMaxY;
+	delete []m_pLayer;
+	delete []m_pMask;
+	delete []m_pUserData;
+	delete []m_pBucketStart;
+	delete []m_pBucketFill;
+	delete []m_pBucketStamp;
+	delete []m_pEntries;
+	delete []m_pPairs;
+	delete []m_pSweep;
+	delete []m_pHitBits;
+	delete []m_pQueryResults;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Add ()
+// Desc : Adds a box for this frame.
+//-----------------------------------------------------------------------------
+int CBroadPhase::Add(float fMinX, float fMinY, float fMaxX, float fMaxY, UINT nLayer, UINT nMask, int nUserData)
+{
+	if(m_nCount >= m_nCapacity)
+		return -1;
+
+	int i = m_nCount++;
+	m_pMinX[i]		= fMinX;
+	m_pMinY[i]		= fMinY;
+	m_pMaxX[i]		= fMaxX;
+	m_pMaxY[i]		= fMaxY;
+	m_pLayer[i]		= nLayer;
+	m_pMask[i]		= nMask;
+	m_pUserData[i]	= nUserData;
+	return i;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Collide () (Private)
+// Desc : Layer filter first, it is cheaper than the box test.
+//-----------------------------------------------------------------------------
+bool CBroadPhase::Collide(int iA, int iB) const
+{
+	return (m_pLayer[iA] & m_pMask[iB]) && (m_pLayer[iB] & m_pMask[iA]) &&
+		   m_pMinX[iA] < m_pMaxX[iB] && m_pMinX[iB] < m_pMaxX[iA] &&
+		   m_pMinY[iA] < m_pMaxY[iB] && m_pMinY[iB] < m_pMaxY[iA];
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddPair () (Private)
+// Desc : Appends a pair, doubling the list when it is full. Once the list
+//		has grown to the busiest frame it is not allocated again.
+//-----------------------------------------------------------------------------
+void CBroadPhase::AddPair(int iA, int iB)
+{
+	if(m_nPairs >= m_nMaxPairs)
+	{
+		sCollisionPair *pPairs = new sCollisionPair[m_nMaxPairs * 2];
+		memcpy(pPairs, m_pPairs, m_nPairs * sizeof(sCollisionPair));
+		delete []m_pPairs;
+		m_pPairs	= pPairs;
+		m_nMaxPairs	*= 2;
+	}
+
+	m_pPairs[m_nPairs].iA = iA;
+	m_pPairs[m_nPairs].iB = iB;
+	m_nPairs++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : FindPairs ()
+// Desc : Counting sorts the proxies into the buckets of every cell they
+//		cover, then tests the proxies sharing a bucket. A pair sharing
+//		several cells is kept only in the bucket of the cell holding the top
+//		left corner of their overlap, so it is reported once. Cells that
+//		hash to the same bucket just add a few tests.
+//-----------------------------------------------------------------------------
+int CBroadPhase::FindPairs()
+{
+	PROFILE_FUNCTION();
+
+	m_nPairs = 0;
+	for(int b = 0; b < m_nBuckets; b++)
+	{
+		m_pBucketFill[b]	= 0;
+		m_pBucketStamp[b]	= -1;
+	}
+
+	// Count the entries of each bucket. The stamp stops a proxy going into
+	// one bucket twice when two of its cells hash to it.
+	int nEntries = 0;
+	for(int i = 0; i < m_nCount; i++)
+	{
+		int nX0 = CellOf(m_pMinX[i]), nX1 = CellOf(m_pMaxX[i]);
+		int nY0 = CellOf(m_pMinY[i]), nY1 = CellOf(m_pMaxY[i]);
+		for(int y = nY0; y <= nY1; y++)
+		{
+			for(int x = nX0; x <= nX1; x++)
+			{
+				int b = Bucket(x, y);
+				if(m_pBucketStamp[b] != i)
+				{
+					m_pBucketStamp[b] = i;
+					m_pBucketFill[b]++;
+					nEntries++;
+				}
+			}
+		}
+	}
+
+	if(nEntries > m_nMaxEntries)
+	{
+		delete []m_pEntries;
+		m_nMaxEntries	= nEntries * 2;
+		m_pEntries		= new int[m_nMaxEntries];
+	}
+
+	m_pBucketStart[0] = 0;
+	for(int b = 0; b < m_nBuckets; b++)
+	{
+		m_pBucketStart[b + 1]	= m_pBucketStart[b] + m_pBucketFill[b];
+		m_pBucketFill[b]		= m_pBucketStart[b];
+		m_pBucketStamp[b]		= -1;
+	}
+
+	// Same walk again, this time writing the proxies into place
+	for(int i = 0; i < m_nCount; i++)
+	{
+		int nX0 = CellOf(m_pMinX[i]), nX1 = CellOf(m_pMaxX[i]);
+		int nY0 = CellOf(m_pMinY[i]), nY1 = CellOf(m_pMaxY[i]);
+		for(int y = nY0; y <= nY1; y++)
+		{
+			for(int x = nX0; x <= nX1; x++)
+			{
+				int b = Bucket(x, y);
+				if(m_pBucketStamp[b] != i)
+				{
+					m_pBucketStamp[b] = i;
+					m_pEntries[m_pBucketFill[b]++] = i;
+				}
+			}
+		}
+	}
+
+	for(int b = 0; b < m_nBuckets; b++)
+	{
+		int nEnd = m_pBucketStart[b + 1];
+		for(int j = m_pBucketStart[b]; j < nEnd; j++)
+		{
+			int iA = m_pEntries[j];
+			for(int k = j + 1; k < nEnd; k++)
+			{
+				int iB = m_pEntries[k];
+				if(!Collide(iA, iB))
+					continue;
+
+				int nCellX = CellOf(max(m_pMinX[iA], m_pMinX[iB]));
+				int nCellY = CellOf(max(m_pMinY[iA], m_pMinY[iB]));
+				if(Bucket(nCellX, nCellY) == b)
+					AddPair(iA, iB);
+			}
+		}
+	}
+
+	return m_nPairs;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CompareSweep ()
+// Desc : qsort order for FindPairsSweep, the proxy index breaks ties so the
+//		pairs come out the same on every run.
+//-----------------------------------------------------------------------------
+static int CompareSweep(const void *pA, const void *pB)
+{
+	const sSweepEntry *pEntryA = (const sSweepEntry*)pA;
+	const sSweepEntry *pEntryB = (const sSweepEntry*)pB;
+
+	if(pEntryA->fMin != pEntryB->fMin)
+		return pEntryA->fMin < pEntryB->fMin ? -1 : 1;
+	return pEntryA->iProxy - pEntryB->iProxy;
+}
+
+//-----------------------------------------------------------------------------
+// Name : FindPairsSweep ()
+// Desc : Picks the axis the box centres spread over the most, sorts the
+//		proxies by where they start along it and walks the list. Each proxy
+//		is tested only against those that start before it ends, so only the
+//		boxes sharing a stretch of the axis meet.
+//-----------------------------------------------------------------------------
+int CBroadPhase::FindPairsSweep()
+{
+	PROFILE_FUNCTION();
+
+	m_nPairs = 0;
+	if(m_nCount < 2)
+		return 0;
+
+	// Variance of the centres on each axis, doubled centres are fine for
+	// the comparison
+	double fSumX = 0.0, fSumY = 0.0, fSumXX = 0.0, fSumYY = 0.0;
+	for(int i = 0; i < m_nCount; i++)
+	{
+		double fX = (double)m_pMinX[i] + m_pMaxX[i];
+		double fY = (double)m_pMinY[i] + m_pMaxY[i];
+		fSumX += fX;	fSumXX += fX * fX;
+		fSumY += fY;	fSumYY += fY * fY;
+	}
+
+	bool bAxisX = fSumXX - fSumX * fSumX / m_nCount >= fSumYY - fSumY * fSumY / m_nCount;
+	const float *pMin = bAxisX ? m_pMinX : m_pMinY;
+	const float *pMax = bAxisX ? m_pMaxX : m_pMaxY;
+
+	for(int i = 0; i < m_nCount; i++)
+	{
+		m_pSweep[i].fMin	= pMin[i];
+		m_pSweep[i].iProxy	= i;
+	}
+
+	qsort(m_pSweep, m_nCount, sizeof(sSweepEntry), CompareSweep);
+
+	for(int j = 0; j < m_nCount; j++)
+	{
+		int iA		= m_pSweep[j].iProxy;
+		float fEnd	= pMax[iA];
+		for(int k = j + 1; k < m_nCount && m_pSweep[k].fMin < fEnd; k++)
+		{
+			int iB = m_pSweep[k].iProxy;
+			if(Collide(iA, iB))
+				AddPair(min(iA, iB), max(iA, iB));
+		}
+	}
+
+	return m_nPairs;
+}
+
+//-----------------------------------------------------------------------------
+// Name : FindPairsBrute ()
+// Desc : Tests every proxy against every later one.
+//-----------------------------------------------------------------------------
+int CBroadPhase::FindPairsBrute()
+{
+	m_nPairs = 0;
+	for(int iA = 0; iA < m_nCount; iA++)
+	{
+		for(int iB = iA + 1; iB < m_nCount; iB++)
+		{
+			if(Collide(iA, iB))
+				AddPair(iA, iB);
+		}
+	}
+
+	return m_nPairs;
+}
+
+//-----------------------------------------------------------------------------
+// Name : QueryBox ()
+// Desc : The proxy fields are already structure of arrays, so they are
+//		handed to the batch test as they are. Layers are checked on the
+//		hits only.
+//-----------------------------------------------------------------------------
+int CBroadPhase::QueryBox(float fMinX, float fMinY, float fMaxX, float fMaxY, UINT nLayer, UINT nMask)
+{
+	sBoxBatch Batch = { m_pMinX, m_pMinY, m_pMaxX, m_pMaxY, m_nCount };
+	if(OverlapBoxBatch(fMinX, fMinY, fMaxX, fMaxY, Batch, m_pHitBits) == 0)
+		return 0;
+
+	int nHits = HitBitsToIndices(m_pHitBits, m_nCount, m_pQueryResults);
+	int nResults = 0;
+	for(int i = 0; i < nHits; i++)
+	{
+		int iProxy = m_pQueryResults[i];
+		if((m_pLayer[iProxy] & nMask) && (nLayer & m_pMask[iProxy]))
+			m_pQueryResults[nResults++] = iProxy;
+	}
+
+	return nResults;
+}
+
+//-----------------------------------------------------------------------------
+// Global Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : SweepBox ()
+// Desc : Slab test. On each axis works out the span of t over which the
+//		moving box overlaps the other one, and the answer is where the two
+//		spans meet. An axis without motion either always overlaps or never.
+//-----------------------------------------------------------------------------
+bool SweepBox(float fMinX, float fMinY, float fMaxX, float fMaxY, float fDeltaX, float fDeltaY,
+			  float fOtherMinX, float fOtherMinY, float fOtherMaxX, float fOtherMaxY,
+			  float &fEnter, float &fExit)
+{
+	float fMins[2]		= { fMinX, fMinY };
+	float fMaxs[2]		= { fMaxX, fMaxY };
+	float fDeltas[2]	= { fDeltaX, fDeltaY };
+	float fOtherMins[2]	= { fOtherMinX, fOtherMinY };
+	float fOtherMaxs[2]	= { fOtherMaxX, fOtherMaxY };
+
+	fEnter	= 0.0f;
+	fExit	= 1.0f;
+	for(int nAxis = 0; nAxis < 2; nAxis++)
+	{
+		float fDelta = fDeltas[nAxis];
+		if(fDelta == 0.0f)
+		{
+			// Boxes that only share an edge do not touch
+			if(fMins[nAxis] >= fOtherMaxs[nAxis] || fOtherMins[nAxis] >= fMaxs[nAxis])
+				return false;
+			continue;
+		}
+
+		float fInvDelta	= 1.0f / fDelta;
+		float fTimeA	= (fOtherMins[nAxis] - fMaxs[nAxis]) * fInvDelta;
+		float fTimeB	= (fOtherMaxs[nAxis] - fMins[nAxis]) * fInvDelta;
+		if(fDelta < 0.0f)
+		{
+			float fSwap = fTimeA;
+			fTimeA = fTimeB;
+			fTimeB = fSwap;
+		}
+
+		fEnter	= max(fEnter, fTimeA);
+		fExit	= min(fExit, fTimeB);
+		if(fEnter >= fExit)
+			return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : AddBenchBoxes ()
+// Desc : Scatters nCount boxes over a square that grows with the count, so
+//		each box has about as many neighbours at every size, as in the game.
+//-----------------------------------------------------------------------------
+static void AddBenchBoxes(CBroadPhase &Broad, int nCount)
+{
+	ULONG nSeed = 1;
+	float fSide = BENCHMARK_SPACING * sqrtf((float)nCount);
+
+	Broad.Clear();
+	for(int i = 0; i < nCount; i++)
+	{
+		float fX	= BenchRandom(nSeed) * fSide;
+		float fY	= BenchRandom(nSeed) * fSide;
+		float fHalf	= BENCHMARK_MIN_HALF + BenchRandom(nSeed) * (BENCHMARK_MAX_HALF - BENCHMARK_MIN_HALF);
+		int nLayer	= i & 3;
+
+		Broad.AddCentered(fX, fY, fHalf, fHalf, BENCHMARK_LAYERS[nLayer], BENCHMARK_MASKS[nLayer], i);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : ComparePairs ()
+// Desc : qsort order of the benchmark's pair lists, by iA then iB.
+//-----------------------------------------------------------------------------
+static int ComparePairs(const void *pA, const void *pB)
+{
+	const sCollisionPair *pPairA = (const sCollisionPair*)pA;
+	const sCollisionPair *pPairB = (const sCollisionPair*)pB;
+
+	if(pPairA->iA != pPairB->iA)
+		return pPairA->iA - pPairB->iA;
+	return pPairA->iB - pPairB->iB;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CopySortedPairs ()
+// Desc : The pairs the last search found, each with its lower index first
+//		and the list sorted, so searches that find them in different orders
+//		can be compared.
+//-----------------------------------------------------------------------------
+static sCollisionPair* CopySortedPairs(const CBroadPhase &Broad, int nPairs)
+{
+	sCollisionPair *pPairs = new sCollisionPair[max(nPairs, 1)];
+	const sCollisionPair *pFound = Broad.GetPairs();
+
+	for(int i = 0; i < nPairs; i++)
+	{
+		pPairs[i].iA = min(pFound[i].iA, pFound[i].iB);
+		pPairs[i].iB = max(pFound[i].iA, pFound[i].iB);
+	}
+
+	qsort(pPairs, nPairs, sizeof(sCollisionPair), ComparePairs);
+	return pPairs;
+}
+
+// What the threaded sweep works on, each shot only writes its own count
+typedef struct
+{
+	float	*pX;
+	float	*pY;
+	float	*pVelX;
+	float	*pVelY;
+	int		*pHits;
+	float	fTargets[BENCHMARK_TARGETS][4];
+} sSweepScene;
+
+//-----------------------------------------------------------------------------
+// Name : ResetSweepScene ()
+// Desc : Scatters the shots and the boxes they are swept against.
+//-----------------------------------------------------------------------------
+static void ResetSweepScene(sSweepScene &Scene)
+{
+	ULONG nSeed = 1;
+	for(int i = 0; i < BENCHMARK_SHOTS; i++)
+	{
+		Scene.pX[i]		= BenchRandom(nSeed) * 1280.0f;
+		Scene.pY[i]		= BenchRandom(nSeed) * 720.0f;
+		Scene.pVelX[i]	= BenchRandom(nSeed) * 600.0f - 300.0f;
+		Scene.pVelY[i]	= BenchRandom(nSeed) * 600.0f - 300.0f;
+		Scene.pHits[i]	= 0;
+	}
+
+	for(int i = 0; i < BENCHMARK_TARGETS; i++)
+	{
+		float fX = BenchRandom(nSeed) * 1280.0f;
+		float fY = BenchRandom(nSeed) * 720.0f;
+		Scene.fTargets[i][0] = fX;
+		Scene.fTargets[i][1] = fY;
+		Scene.fTargets[i][2] = fX + 64.0f;
+		Scene.fTargets[i][3] = fY + 64.0f;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : SweepBenchJob ()
+// Desc : Sweeps each shot's next move against every target and counts the
+//		targets it would reach.
+//-----------------------------------------------------------------------------
+static void SweepBenchJob(void *pContext, int iBegin, int iEnd)
+{
+	sSweepScene *pScene = (sSweepScene*)pContext;
+	float fEnter, fExit;
+
+	for(int i = iBegin; i < iEnd; i++)
+	{
+		float fX = pScene->pX[i], fY = pScene->pY[i];
+		float fDeltaX = pScene->pVelX[i] * BENCHMARK_TIME_STEP;
+		float fDeltaY = pScene->pVelY[i] * BENCHMARK_TIME_STEP;
+
+		int nHits = 0;
+		for(int t = 0; t < BENCHMARK_TARGETS; t++)
+		{
+			const float *pTarget = pScene->fTargets[t];
+			if(SweepBox(fX - 2.0f, fY - 4.0f, fX + 2.0f, fY + 4.0f, fDeltaX, fDeltaY,
+						pTarget[0], pTarget[1], pTarget[2], pTarget[3], fEnter, fExit))
+				nHits++;
+		}
+
+		pScene->pHits[i] += nHits;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : WriteSweepScaling ()
+// Desc : Sweeps the shots with 1 thread up to one per core and writes the
+//		milliseconds per pass. Returns false if any run counts different
+//		hits from the single thread one.
+//-----------------------------------------------------------------------------
+static bool WriteSweepScaling(FILE *pFile)
+{
+	SYSTEM_INFO Info;
+	GetSystemInfo(&Info);
+	int nCores = max(1, min((int)Info.dwNumberOfProcessors, MAX_JOB_THREADS));
+
+	sSweepScene Scene;
+	Scene.pX		= new float[BENCHMARK_SHOTS];
+	Scene.pY		= new float[BENCHMARK_SHOTS];
+	Scene.pVelX		= new float[BENCHMARK_SHOTS];
+	Scene.pVelY		= new float[BENCHMARK_SHOTS];
+	Scene.pHits		= new int[BENCHMARK_SHOTS];
+
+	int *pExpectedHits	= new int[BENCHMARK_SHOTS];
+	double fBase		= 0.0;
+	bool bMatch			= true;
+	__int64 nStart, nEnd;
+
+	fprintf(pFile, "\n%d shots swept against %d boxes, grain %d, %d cores\n", BENCHMARK_SHOTS, BENCHMARK_TARGETS,
+			BENCHMARK_SHOT_GRAIN, nCores);
+	fprintf(pFile, "threads  sweep ms  speed-up  match\n");
+	for(int nThreads = 1; ; nThreads = min(nThreads * 2, nCores))
+	{
+		CJobSystem Jobs(nThreads);
+
+		ResetSweepScene(Scene);
+		nStart = BenchTime();
+		for(int nPass = 0; nPass < BENCHMARK_SWEEP_PASSES; nPass++)
+			Jobs.ParallelFor(SweepBenchJob, &Scene, BENCHMARK_SHOTS, BENCHMARK_SHOT_GRAIN);
+		nEnd = BenchTime();
+		double fSweep = BenchSeconds(nStart, nEnd) * 1000.0 / BENCHMARK_SWEEP_PASSES;
+
+		bool bSame = true;
+		if(nThreads == 1)
+		{
+			memcpy(pExpectedHits, Scene.pHits, BENCHMARK_SHOTS * sizeof(int));
+			fBase = fSweep;
+		}
+		else
+			bSame = memcmp(pExpectedHits, Scene.pHits, BENCHMARK_SHOTS * sizeof(int)) == 0;
+
+		bMatch = bMatch && bSame;
+		fprintf(pFile, "%7d  %8.3f  %7.2fx  %s\n", Jobs.GetThreadCount(), fSweep, fBase / fSweep, bSame ? "yes" : "NO");
+
+		if(nThreads == nCores)
+			break;
+	}
+
+	delete []Scene.pX;
+	delete []Scene.pY;
+	delete []Scene.pVelX;
+	delete []Scene.pVelY;
+	delete []Scene.pHits;
+	delete []pExpectedHits;
+
+	return bMatch;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunBroadPhaseBenchmark ()
+// Desc : Writes the time to rebuild the boxes and find their pairs for each
+//		size, with the grid, by sweeping and by brute force, and whether all
+//		three found the same pairs. Then times SweepBox over the job system.
+//-----------------------------------------------------------------------------
+bool RunBroadPhaseBenchmark(LPCSTR strFileName)
+{
+	FILE *pFile = BenchOpen(strFileName);
+	if(!pFile)
+		return false;
+
+	__int64 nStart, nEnd;
+
+	bool bMatch = true;
+	fprintf(pFile, "   boxes    pairs   grid ms  sweep ms   brute ms  speed-up  match\n");
+	for(int i = 0; i < (int)(sizeof(BENCHMARK_SIZES) / sizeof(BENCHMARK_SIZES[0])); i++)
+	{
+		int nCount			= BENCHMARK_SIZES[i];
+		int nGridPasses		= max(BENCHMARK_GRID_BOXES / nCount, 1);
+		int nBrutePasses	= max((int)(BENCHMARK_BRUTE_TESTS / (0.5 * nCount * nCount)), 1);
+		CBroadPhase Broad(nCount);
+
+		// Warm up once so the grid has grown its arrays
+		AddBenchBoxes(Broad, nCount);
+		Broad.FindPairs();
+
+		int nGridPairs = 0;
+		nStart = BenchTime();
+		for(int nPass = 0; nPass < nGridPasses; nPass++)
+		{
+			AddBenchBoxes(Broad, nCount);
+			nGridPairs = Broad.FindPairs();
+		}
+		nEnd = BenchTime();
+		double fGrid = BenchSeconds(nStart, nEnd) * 1000.0 / nGridPasses;
+		sCollisionPair *pGridPairs = CopySortedPairs(Broad, nGridPairs);
+
+		int nSweepPairs = 0;
+		nStart = BenchTime();
+		for(int nPass = 0; nPass < nGridPasses; nPass++)
+		{
+			AddBenchBoxes(Broad, nCount);
+			nSweepPairs = Broad.FindPairsSweep();
+		}
+		nEnd = BenchTime();
+		double fSweep = BenchSeconds(nStart, nEnd) * 1000.0 / nGridPasses;
+		sCollisionPair *pSweepPairs = CopySortedPairs(Broad, nSweepPairs);
+
+		int nBrutePairs = 0;
+		nStart = BenchTime();
+		for(int nPass = 0; nPass < nBrutePasses; nPass++)
+		{
+			AddBenchBoxes(Broad, nCount);
+			nBrutePairs = Broad.FindPairsBrute();
+		}
+		nEnd = BenchTime();
+		double fBrute = BenchSeconds(nStart, nEnd) * 1000.0 / nBrutePasses;
+		sCollisionPair *pBrutePairs = CopySortedPairs(Broad, nBrutePairs);
+
+		// The same pairs, not only as many of them
+		int nBytes = nBrutePairs * (int)sizeof(sCollisionPair);
+		bool bSizeMatch = nGridPairs == nBrutePairs && nSweepPairs == nBrutePairs &&
+						  memcmp(pGridPairs, pBrutePairs, nBytes) == 0 &&
+						  memcmp(pSweepPairs, pBrutePairs, nBytes) == 0;
+		bMatch = bMatch && bSizeMatch;
+		fprintf(pFile, "%8d  %7d  %8.3f  %8.3f  %9.3f  %7.1fx  %s\n", nCount, nGridPairs, fGrid, fSweep, fBrute,
+				fBrute / fGrid, bSizeMatch ? "yes" : "NO");
+
+		delete []pGridPairs;
+		delete []pSweepPairs;
+		delete []pBrutePairs;
+	}
+
+	bMatch = WriteSweepScaling(pFile) && bMatch;
+	return BenchClose(pFile, bMatch);
+}
@@ -12,7 +12,91 @@
 #include "CGameApp.h"
 
 extern HINSTANCE g_hInst;
-float eps, eps2;
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const float BACKGROUND_SCROLL_SPEED = 210.0f;	// Pixels per second at the screen edges
+const float FRAME_RATE_LIMIT		= 60.0f;	// Frames per second the game is locked to
+const float SIMULATION_TIME_STEP	= 1.0f / 60.0f;	// Seconds of game time per simulation tick
+const float MAX_FRAME_TIME			= 0.25f;	// Longest frame the simulation catches up on
+const ULONG	TICK_BENCHMARK_TICKS	= 36000;	// Ten minutes of game time
+LPCSTR		TICK_BENCHMARK_FILE		= "tick_benchmark.txt";
+const float BENCHMARK_SECONDS		= 5.0f;		// Length of each benchmark run
+const int	GOLDEN_WIDTH			= 1280;		// Fixed render size of the golden run
+const int	GOLDEN_HEIGHT			= 720;
+const ULONG	GOLDEN_DEFAULT_FRAMES	= 600;
+const float	GOLDEN_TIME_STEP		= 1.0f / 60.0f;
+const int	GOLDEN_MAX_DUMPS		= 8;		// Mismatching frames saved as bitmaps
+LPCSTR		GOLDEN_FILE				= "Data/golden.txt";
+LPCSTR		GOLDEN_REPORT_FILE		= "golden_report.txt";
+const int	HUD_FONT_HEIGHT			= 14;
+const float	RENDER_SCALE_STEP		= 0.125f;	// F5 / F6 change the render scale by this
+const char	PROFILE_FILE[]			= "profile.json";	// Chrome trace written by -profile
+const int	MAX_GAME_ENTITIES		= 4096;		// Enemies, missiles and explosions alive at once
+const int	ENEMY_COUNT				= 7;		// Planes in the starting row
+const float	ENEMY_START_X			= 100.0f;
+const float	ENEMY_START_Y			= 100.0f;
+const float	ENEMY_SPACING			= 200.0f;
+const float	ENEMY_SPEED				= 25.0f;	// Pixels per second, straight down
+LPCSTR		ENTITY_BENCHMARK_FILE	= "entity_benchmark.txt";
+const int	MAX_PROJECTILES			= 8192;		// Bullets and missiles in flight at once
+const LONG	PROJECTILE_CULL_MARGIN	= 64;		// Pixels off the playfield before a projectile is removed
+const float	HALF_PI					= (float)(PI / 2.0);
+LPCSTR		COLLISION_BENCHMARK_FILE = "collision_benchmark.txt";
+LPCSTR		OVERLAP_BENCHMARK_FILE	= "overlap_benchmark.txt";
+LPCSTR		BLIT_BENCHMARK_FILE		= "blit_benchmark.txt";
+LPCSTR		JOB_BENCHMARK_FILE		= "job_benchmark.txt";
+LPCSTR		VECTOR_BENCHMARK_FILE	= "vector_benchmark.txt";
+LPCSTR		TRIG_BENCHMARK_FILE		= "trig_benchmark.txt";
+const int	SIMULATION_JOB_GRAIN	= 1024;		// Entities or shots moved per job
+
+// Collision layers, each thing only collides with the layers in its mask
+const UINT	COLLISION_PLAYER		= 0x01;
+const UINT	COLLISION_ENEMY			= 0x02;
+const UINT	COLLISION_PLAYER_SHOT	= 0x04;
+const UINT	COLLISION_ENEMY_SHOT	= 0x08;
+
+// Player gun patterns, F7 picks the next one. Aimed shots go at the cursor.
+const sEmitterDesc PLAYER_GUNS[] =
+{
+	//	pattern		count	spread	angle		spin	speed	rate	lifetime
+	{ EMIT_STREAM,	1,		0.0f,	-HALF_PI,	0.0f,	300.0f,	8.0f,	4.0f },
+	{ EMIT_SPREAD,	5,		0.8f,	-HALF_PI,	0.0f,	300.0f,	6.0f,	4.0f },
+	{ EMIT_RING,	32,		0.0f,	-HALF_PI,	0.1f,	250.0f,	10.0f,	4.0f },
+	{ EMIT_AIMED,	3,		0.1f,	0.0f,		0.0f,	400.0f,	12.0f,	4.0f },
+};
+const int PLAYER_GUN_COUNT = sizeof(PLAYER_GUNS) / sizeof(PLAYER_GUNS[0]);
+
+// Every enemy drops a missile straight down every few seconds
+const sEmitterDesc ENEMY_GUN =
+	{ EMIT_STREAM,	1,		0.0f,	HALF_PI,	0.0f,	100.0f,	0.2f,	15.0f };
+
+//-----------------------------------------------------------------------------
+// Local Functions
+//-----------------------------------------------------------------------------
+// Performance counter in milliseconds, for timing the phases of a frame
+static double ReadMilliseconds()
+{
+	static __int64 nFreq = 0;
+	__int64 nTime;
+
+	if ( !nFreq ) QueryPerformanceFrequency( (LARGE_INTEGER*)&nFreq );
+	QueryPerformanceCounter( (LARGE_INTEGER*)&nTime );
+	return nTime * 1000.0 / nFreq;
+}
+
+// qsort order of the shot hits, earliest first. Equal times fall back to
+// the indices so a frame always settles the same way.
+static int CompareSweptHit( const void *pA, const void *pB )
+{
+	const sSweptHit *pHitA = (const sSweptHit*)pA;
+	const sSweptHit *pHitB = (const sSweptHit*)pB;
+
+	if ( pHitA->fTime != pHitB->fTime ) return pHitA->fTime < pHitB->fTime ? -1 : 1;
+	if ( pHitA->iShot != pHitB->iShot ) return pHitA->iShot - pHitB->iShot;
+	return pHitA->iEnemy - pHitB->iEnemy;
+}
 
 //-----------------------------------------------------------------------------
 // CGameApp Member Functions
@@ -28,27 +112,74 @@ CGameApp::CGameApp()
 	m_hIcon			= NULL;
 	m_hMenu			= NULL;
 	m_pBBuffer		= NULL;
+	m_pAtlas		= NULL;
 	m_pPlayer		= NULL;
-	m_pPlayer1		= NULL;
-	m_pPlayer2		= NULL;
-	m_pPlayer3		= NULL;
-	m_pPlayer4		= NULL;
-	m_pPlayer5		= NULL;
-	m_pPlayer6		= NULL;
-	m_pPlayer7		= NULL;
-	
-	missile			= NULL;
-	missile1		= NULL;
-	missile2		= NULL;
-	missile3		= NULL;
-	missile4		= NULL;
-	missile5		= NULL;
-	missile6		= NULL;
-	missile7		= NULL;
-
-	bullet			= NULL;
 
+	m_pEntities			= NULL;
+	m_pEnemySprite		= NULL;
+	m_pMissileSprite	= NULL;
+	m_pExplosionSprite	= NULL;
+	m_iEnemySprite		= -1;
+	m_iMissileSprite	= -1;
+	m_iExplosionSprite	= -1;
+	m_iExplosionClip	= -1;
+
+	m_pProjectiles		= NULL;
+	m_pBroadPhase		= NULL;
+	m_pSweptHits		= NULL;
+	m_nSweptHits		= 0;
+	m_nMaxSweptHits		= 0;
+	m_pJobs				= NULL;
+	m_pTickJob			= NULL;
+	m_pBulletSprite		= NULL;
+	m_iBulletSprite		= -1;
+	m_iPlayerGun		= 0;
+
+	button_play		 = NULL;
+	button_playH	 = NULL;
+	button_settings	 = NULL;
+	button_settingsH = NULL;
+	button_exit		 = NULL;
+	button_exitH	 = NULL;
+
+	m_BackgroundCount = 0;
 	m_LastFrameRate = 0;
+	m_fTitleTime = 0.0f;
+
+	m_bActive		= false;
+	m_bPipelined	= true;
+	m_bBenchmark	= false;
+	m_bEntityBenchmark = false;
+	m_bCollisionBenchmark = false;
+	m_bOverlapBenchmark = false;
+	m_bBlitBenchmark = false;
+	m_bJobBenchmark = false;
+	m_bVectorBenchmark = false;
+	m_bTrigBenchmark = false;
+	m_bTickBenchmark = false;
+	m_bPresent		= true;
+	m_nFrame		= 0;
+	m_hRenderThread	= NULL;
+	m_hFrameEvent	= NULL;
+	m_lRenderQuit	= 0;
+	m_lFramesDrawn	= 0;
+	m_bCapture		= false;
+	m_eCaptureFormat= CAPTURE_Y4M;
+	m_bTelemetry	= false;
+	m_eTelemetryFormat = TELEMETRY_BINARY;
+	m_bGolden		= false;
+	m_bRecordGolden	= false;
+	m_nGoldenFrames	= GOLDEN_DEFAULT_FRAMES;
+	m_fFixedStep	= SIMULATION_TIME_STEP;
+	m_fTickTime		= 0.0f;
+	m_fScroll		= 0.0f;
+	m_ptCursor.x	= 0;
+	m_ptCursor.y	= 0;
+	ZeroMemory( m_pKeyBuffer, sizeof(m_pKeyBuffer) );
+	m_bShowHud		= false;
+	m_fDrawMs		= 0.0f;
+	m_fRenderScale	= 1.0f;
+	ZeroMemory( &m_SerialFrame, sizeof(sFramePacket) );
 }
 
 //-----------------------------------------------------------------------------
@@ -67,6 +198,69 @@ CGameApp::~CGameApp()
 //-----------------------------------------------------------------------------
 bool CGameApp::InitInstance( LPCTSTR lpCmdLine, int iCmdShow )
 {
+	// -serial draws on the main thread, -benchmark measures both modes
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-serial") ) ) m_bPipelined = false;
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-benchmark") ) ) m_bBenchmark = true;
+
+	// -entitybench times the entity store on its own, no window is needed
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-entitybench") ) ) { m_bEntityBenchmark = true; return true; }
+
+	// -collisionbench times the broad phase against testing every pair, and the
+	// threaded sweep from one thread up to one per core
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-collisionbench") ) ) { m_bCollisionBenchmark = true; return true; }
+
+	// -overlapbench times the scalar and SIMD batch overlap tests
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-overlapbench") ) ) { m_bOverlapBenchmark = true; return true; }
+
+	// -blitbench times the scalar and SIMD affine blitter against GDI
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-blitbench") ) ) { m_bBlitBenchmark = true; return true; }
+
+	// -jobbench times the job system from one thread up to one per core
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-jobbench") ) ) { m_bJobBenchmark = true; return true; }
+
+	// -vecbench times the batch vector functions against Vec2
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-vecbench") ) ) { m_bVectorBenchmark = true; return true; }
+
+	// -trigbench checks the error of the fast trigonometry and times it against libm
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-trigbench") ) ) { m_bTrigBenchmark = true; return true; }
+
+	// -capture records capture.y4m, -rawcapture bare I420 frames to capture.yuv
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-rawcapture") ) ) { m_bCapture = true; m_eCaptureFormat = CAPTURE_RAW; }
+	else if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-capture") ) ) m_bCapture = true;
+
+	// -golden checks a scripted run against Data/golden.txt, -goldenrecord rewrites it
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-goldenrecord") ) ) m_bGolden = m_bRecordGolden = true;
+	else if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-golden") ) ) m_bGolden = true;
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-frames") ) )
+	{
+		int iFrames = _tstoi( _tcsstr( lpCmdLine, _T("-frames") ) + 7 );
+		if ( iFrames > 0 ) m_nGoldenFrames = (ULONG)iFrames;
+	}
+	if ( m_bGolden ) m_bBenchmark = false;
+
+	// -tickbench runs the simulation alone, as fast as it goes, on the golden script
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-tickbench") ) ) { m_bTickBenchmark = true; m_bBenchmark = m_bGolden = false; }
+
+#if defined(ENABLE_PROFILER)
+	// -profile records the zones of the whole run and writes them on exit
+	PROFILE_THREAD_NAME( "Main" );
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-profile") ) ) ProfilerStart();
+#endif
+
+	// -telemetry logs per-frame metrics to telemetry.bin, -telemetrycsv to telemetry.csv
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-telemetrycsv") ) ) { m_bTelemetry = true; m_eTelemetryFormat = TELEMETRY_CSV; }
+	else if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-telemetry") ) ) m_bTelemetry = true;
+
+	// -hud starts with the performance overlay shown
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-hud") ) ) m_bShowHud = true;
+
+	// -scale S draws the scene at S times the window size and stretches it up
+	if ( lpCmdLine && _tcsstr( lpCmdLine, _T("-scale") ) )
+	{
+		float fScale = (float)_tstof( _tcsstr( lpCmdLine, _T("-scale") ) + 6 );
+		if ( fScale > 0.0f ) m_fRenderScale = max( MIN_RENDER_SCALE, min( fScale, 1.0f ) );
+	}
+
 	// Create the primary display device
 	if (!CreateDisplay()) { ShutDown(); return false; }
 
@@ -81,6 +275,19 @@ bool CGameApp::InitInstance( LPCTSTR lpCmdLine, int iCmdShow )
 	// Set up all required game states
 	SetupGameState();
 
+	// Capturing is only a diagnostic, the game runs on without it
+	if ( m_bCapture && !m_bBenchmark && !m_bGolden && !m_bTickBenchmark )
+		m_Capture.Start( m_eCaptureFormat == CAPTURE_RAW ? "capture.yuv" : "capture.y4m", m_eCaptureFormat,
+						 m_pBBuffer->viewWidth(), m_pBBuffer->viewHeight(), (int)FRAME_RATE_LIMIT );
+
+	// Like capturing, a log that fails to open only loses the metrics
+	if ( m_bTelemetry )
+		m_Telemetry.Start( m_eTelemetryFormat == TELEMETRY_CSV ? "telemetry.csv" : "telemetry.bin", m_eTelemetryFormat );
+
+	// Start rendering on its own thread
+	if ( m_bGolden || m_bTickBenchmark ) m_bPipelined = false;
+	if ( m_bPipelined && !m_bBenchmark && !StartRenderThread() ) m_bPipelined = false;
+
 	// Success!
 	return true;
 }
@@ -101,6 +308,10 @@ bool CGameApp::CreateDisplay()
 	USHORT			Height			= mi.rcMonitor.left;
 	RECT			rc;
 	WNDCLASSEX		wcex;
+	bool			bHeadless		= m_bBenchmark || m_bGolden || m_bTickBenchmark;
+
+	// The golden and tick runs always use the same size, whatever the monitor
+	if ( m_bGolden || m_bTickBenchmark ) SetRect( &mi.rcMonitor, 0, 0, GOLDEN_WIDTH, GOLDEN_HEIGHT );
 
 	wcex.cbSize			= sizeof(WNDCLASSEX);
 	wcex.style			= CS_HREDRAW | CS_VREDRAW;
@@ -118,6 +329,14 @@ bool CGameApp::CreateDisplay()
 	if(RegisterClassEx(&wcex)==0)
 		return false;
 
+	// The benchmark and golden runs work without showing anything
+	m_hWnd = CreateWindow(WindowClass, WindowTitle, bHeadless ? WS_POPUP : WS_POPUP | WS_VISIBLE,
+	mi.rcMonitor.left, mi.rcMonitor.top, mi.rcMonitor.right - mi.rcMonitor.left,
+	mi.rcMonitor.bottom - mi.rcMonitor.top, NULL, NULL, g_hInst, this);
+
+	if (!m_hWnd)
+		return false;
+
 	// Retrieve the final client size of the window
 	::GetClientRect( m_hWnd, &rc );
 	m_nViewX		= rc.left;
@@ -125,17 +344,8 @@ bool CGameApp::CreateDisplay()
 	m_nViewWidth	= rc.right - rc.left;
 	m_nViewHeight	= rc.bottom - rc.top;
 
-	
-
-	m_hWnd = CreateWindow(WindowClass, WindowTitle, WS_POPUP | WS_VISIBLE,
-	mi.rcMonitor.left, mi.rcMonitor.top, mi.rcMonitor.right - mi.rcMonitor.left,
-	mi.rcMonitor.bottom - mi.rcMonitor.top, NULL, NULL, g_hInst, this);
-
-	if (!m_hWnd)
-		return false;
-
 	// Show the window
-	ShowWindow(m_hWnd, SW_SHOW);
+	if ( !bHeadless ) ShowWindow(m_hWnd, SW_SHOW);
 
 	// Success!!
 	return true;
@@ -150,6 +360,17 @@ int CGameApp::BeginGame()
 {
 	MSG		msg;
 
+	if ( m_bEntityBenchmark ) return RunEntityBenchmark( ENTITY_BENCHMARK_FILE ) ? 0 : 1;
+	if ( m_bCollisionBenchmark ) return RunBroadPhaseBenchmark( COLLISION_BENCHMARK_FILE ) ? 0 : 1;
+	if ( m_bOverlapBenchmark ) return RunOverlapBenchmark( OVERLAP_BENCHMARK_FILE ) ? 0 : 1;
+	if ( m_bBlitBenchmark ) return RunBlitBenchmark( BLIT_BENCHMARK_FILE ) ? 0 : 1;
+	if ( m_bJobBenchmark ) return RunJobBenchmark( JOB_BENCHMARK_FILE ) ? 0 : 1;
+	if ( m_bVectorBenchmark ) return RunVectorBenchmark( VECTOR_BENCHMARK_FILE ) ? 0 : 1;
+	if ( m_bTrigBenchmark ) return RunTrigBenchmark( TRIG_BENCHMARK_FILE ) ? 0 : 1;
+	if ( m_bBenchmark ) return RunBenchmark();
+	if ( m_bGolden ) return RunGoldenTest();
+	if ( m_bTickBenchmark ) return RunTickBenchmark();
+
 	// Start main loop
 	while(true) 
 	{
@@ -160,6 +381,11 @@ int CGameApp::BeginGame()
 			TranslateMessage( &msg );
 			DispatchMessage ( &msg );
 		} 
+		else if ( !m_bActive )
+		{
+			// Nothing to draw while minimized, sleep until a message arrives
+			WaitMessage();
+		}
 		else 
 		{
 			// Advance Game Frame.
@@ -178,6 +404,22 @@ int CGameApp::BeginGame()
 //-----------------------------------------------------------------------------
 bool CGameApp::ShutDown()
 {
+	// The render thread draws the objects, stop it first
+	StopRenderThread ( );
+
+	// Write out the frames still queued for capture
+	m_Capture.Stop ( );
+	m_Telemetry.Stop ( );
+
+#if defined(ENABLE_PROFILER)
+	// Every thread that records zones has stopped by now
+	if ( ProfilerIsRecording() )
+	{
+		ProfilerStop();
+		ProfilerWriteTrace( PROFILE_FILE );
+	}
+#endif
+
 	// Release any previously built objects
 	ReleaseObjects ( );
 	
@@ -225,8 +467,6 @@ LRESULT CALLBACK CGameApp::StaticWndProc(HWND hWnd, UINT Message, WPARAM wParam,
 //-----------------------------------------------------------------------------
 LRESULT CGameApp::DisplayWndProc( HWND hWnd, UINT Message, WPARAM wParam, LPARAM lParam )
 {
-	static UINT			fTimer;	
-
 	// Determine message type
 	switch (Message)
 	{
@@ -291,28 +531,28 @@ LRESULT CGameApp::DisplayWndProc( HWND hWnd, UINT Message, WPARAM wParam, LPARAM
 				PostQuitMessage(0);
 				break;
 			case VK_RETURN:
-				fTimer = SetTimer(m_hWnd, 1, 250, NULL);
 				m_pPlayer->Explode();
 				break;
+			case VK_F3:
+				m_bShowHud = !m_bShowHud;
+				break;
+			case VK_F5:
+				m_fRenderScale = max( MIN_RENDER_SCALE, m_fRenderScale - RENDER_SCALE_STEP );
+				break;
+			case VK_F6:
+				m_fRenderScale = min( 1.0f, m_fRenderScale + RENDER_SCALE_STEP );
+				break;
+			case VK_F7:
+				m_iPlayerGun = (m_iPlayerGun + 1) % PLAYER_GUN_COUNT;
+				m_PlayerGun.SetPattern( &PLAYER_GUNS[m_iPlayerGun], PROJECTILE_PLAYER, m_iBulletSprite );
+				break;
 			/*case VK_CONTROL:
-				fTimer= SetTimer(m_hWnd, 1, 250, NULL);
 				m_pPlayer1->Explode();
 				break; */
 			}
 			
 			break;
 
-		case WM_TIMER:
-			switch(wParam)
-			{
-			case 1:
-				if(!m_pPlayer->AdvanceExplosion())
-					KillTimer(m_hWnd, 1);
-				/*if(!m_pPlayer1->AdvanceExplosion())
-					KillTimer(m_hWnd, 1); */
-				break;
-			}
-
 		case WM_COMMAND:
 			break;
 
@@ -330,47 +570,66 @@ LRESULT CGameApp::DisplayWndProc( HWND hWnd, UINT Message, WPARAM wParam, LPARAM
 //-----------------------------------------------------------------------------
 bool CGameApp::BuildObjects()
 {
+	PROFILE_FUNCTION();
+
 	m_pBBuffer = new BackBuffer(m_hWnd, m_nViewWidth, m_nViewHeight);
-	m_pPlayer = new CPlayer(m_pBBuffer, CPlayer::image);
-	m_pPlayer1 = new CPlayer(m_pBBuffer, CPlayer::image1);
-	m_pPlayer2 = new CPlayer(m_pBBuffer, CPlayer::image1);
-	m_pPlayer2 = new CPlayer(m_pBBuffer, CPlayer::image1);
-	m_pPlayer3 = new CPlayer(m_pBBuffer, CPlayer::image1);
-	m_pPlayer4 = new CPlayer(m_pBBuffer, CPlayer::image1);
-	m_pPlayer5 = new CPlayer(m_pBBuffer, CPlayer::image1);
-	m_pPlayer6 = new CPlayer(m_pBBuffer, CPlayer::image1);
-	m_pPlayer7= new CPlayer(m_pBBuffer, CPlayer::image1);
-   
-	missile  = new CPlayer(m_pBBuffer,CPlayer::image2);
-	missile1  = new CPlayer(m_pBBuffer,CPlayer::image2);
-	missile2  = new CPlayer(m_pBBuffer,CPlayer::image2);
-	missile3  = new CPlayer(m_pBBuffer,CPlayer::image2);
-	missile4  = new CPlayer(m_pBBuffer,CPlayer::image2);
-	missile5  = new CPlayer(m_pBBuffer,CPlayer::image2);
-	missile6  = new CPlayer(m_pBBuffer,CPlayer::image2);
-	missile7  = new CPlayer(m_pBBuffer,CPlayer::image2);
-
-	bullet = new CPlayer(m_pBBuffer,CPlayer::image3);
+	m_pAtlas = new CSpriteAtlas();
+	m_pPlayer = new CPlayer(m_pBBuffer, m_pAtlas, &m_Animator, CPlayer::image);
+	// Enemies and their missiles share one sprite each, the explosion
+	// frames are picked per entity from the animator
+	RECT r = { 0, 0, 128, 128 };
+	m_pEnemySprite = new Sprite(m_pAtlas, "data/planeimgandmask2.bmp", RGB(0xff, 0x00, 0xff), ATLAS_INDEXED);
+	m_pEnemySprite->setBackBuffer(m_pBBuffer);
+	m_pMissileSprite = new Sprite(m_pAtlas, "data/Missile.bmp", "data/Missile_mask.bmp", ATLAS_INDEXED);
+	m_pMissileSprite->setBackBuffer(m_pBBuffer);
+	m_pExplosionSprite = new AnimatedSprite(m_pAtlas, "data/explosion.bmp", "data/explosionmask.bmp", r, 4, 4, 16);
+	m_pExplosionSprite->setBackBuffer(m_pBBuffer);
+	m_pExplosionSprite->setBlendMode(BLEND_ALPHA);
+	m_iExplosionClip = m_Animator.AddClip(0, m_pExplosionSprite->GetFrameCount(), EXPLOSION_FRAME_TIME, false);
+
+	m_pEntities = new CEntityStore(MAX_GAME_ENTITIES, &m_Animator);
+	m_iEnemySprite		= m_pEntities->AddSprite(m_pEnemySprite);
+	m_iExplosionSprite	= m_pEntities->AddSprite(m_pExplosionSprite);
+
+	// All shots come out of one pool
+	m_pBulletSprite = new Sprite(m_pAtlas, "data/bullet.bmp", "data/bullet_mask.bmp", ATLAS_INDEXED);
+	m_pBulletSprite->setBackBuffer(m_pBBuffer);
+
+	m_pProjectiles = new CProjectilePool(MAX_PROJECTILES);
+	m_iBulletSprite		= m_pProjectiles->AddSprite(m_pBulletSprite);
+	m_iMissileSprite	= m_pProjectiles->AddSprite(m_pMissileSprite);
+
+	// Room for the player, every entity and every shot
+	m_pBroadPhase = new CBroadPhase(1 + MAX_GAME_ENTITIES + MAX_PROJECTILES);
+	m_nMaxSweptHits	= MAX_PROJECTILES;
+	m_pSweptHits	= new sSweptHit[m_nMaxSweptHits];
+
+	// One thread per core runs the tick's job graph
+	m_pJobs = new CJobSystem();
 
     menu_background.LoadBitmapFromFile("data/menu-background.bmp", GetDC(m_hWnd));
-    button_play = new Sprite("data/Play.bmp",RGB(0xff, 0xff, 0xff));
+    button_play = new Sprite(m_pAtlas, "data/Play.bmp",RGB(0xff, 0xff, 0xff));
     button_play->setBackBuffer(m_pBBuffer);
-    button_playH = new Sprite("data/Play-High.bmp", RGB(0xff, 0xff, 0xff));
+    button_playH = new Sprite(m_pAtlas, "data/Play-High.bmp", RGB(0xff, 0xff, 0xff));
     button_playH->setBackBuffer(m_pBBuffer);
-    button_settings = new Sprite("data/Settings.bmp", RGB(0xff, 0xff, 0xff));
+    button_settings = new Sprite(m_pAtlas, "data/Settings.bmp", RGB(0xff, 0xff, 0xff));
     button_settings->setBackBuffer(m_pBBuffer);
-    button_settingsH = new Sprite("data/Settings-High.bmp", RGB(0xff, 0xff, 0xff));
+    button_settingsH = new Sprite(m_pAtlas, "data/Settings-High.bmp", RGB(0xff, 0xff, 0xff));
     button_settingsH->setBackBuffer(m_pBBuffer);
-    button_exit = new Sprite("data/Exit.bmp", RGB(0xff, 0xff, 0xff));
+    button_exit = new Sprite(m_pAtlas, "data/Exit.bmp", RGB(0xff, 0xff, 0xff));
     button_exit->setBackBuffer(m_pBBuffer);
-    button_exitH = new Sprite("data/Exit-High.bmp", RGB(0xff, 0xff, 0xff));
+    button_exitH = new Sprite(m_pAtlas, "data/Exit-High.bmp", RGB(0xff, 0xff, 0xff));
     button_exitH->setBackBuffer(m_pBBuffer);
 
-	if(!m_imgBackground.LoadBitmapFromFile("data/star.bmp", GetDC(m_hWnd)))
-		return false;
-	
-	if(!m_imgBackground2.LoadBitmapFromFile("data/star.bmp", GetDC(m_hWnd)))
+	// Layers are painted back to front; further layers can be added with a
+	// transparent colour and a lower speed for parallax.
+	if(!m_Background[0].LoadBitmapFromFile("data/star.bmp", GetDC(m_hWnd)))
 		return false;
+	m_Background[0].SetSpeed(1.0f);
+	m_BackgroundCount = 1;
+
+	// The overlay is optional, the game runs without its font
+	m_Hud.BuildFont(_T("Consolas"), HUD_FONT_HEIGHT);
 
 	// Success!
 	return true;
@@ -384,25 +643,15 @@ bool CGameApp::BuildObjects()
 //-----------------------------------------------------------------------------
 void CGameApp::SetupGameState()
 {
-	m_pPlayer->Position() = Vec2(650, 650);
-	m_pPlayer1->Position() = Vec2(100, 100);
-	m_pPlayer2->Position() = Vec2(300, 100);
-	m_pPlayer3->Position() = Vec2(500, 100);
-	m_pPlayer4->Position() = Vec2(700, 100);
-	m_pPlayer5->Position() = Vec2(900, 100);
-	m_pPlayer6->Position() = Vec2(1100, 100);
-	m_pPlayer7->Position() = Vec2(1300, 100);
+	m_pPlayer->Position() = Vec2f(650.0f, 650.0f);
 
-	missile->Velocity().y = 0;
-	missile1->Velocity().y = 0;
-	missile2->Velocity().y = 0;
-	missile3->Velocity().y = 0;
-	missile4->Velocity().y = 0;
-	missile5->Velocity().y = 0;
-	missile6->Velocity().y = 0;
-	missile7->Velocity().y = 0;
+	m_pEntities->Clear();
+	for(int i = 0; i < ENEMY_COUNT; i++)
+		m_pEntities->Create(ENTITY_ENEMY, m_iEnemySprite, ENEMY_START_X + i * ENEMY_SPACING, ENEMY_START_Y, 0.0f, ENEMY_SPEED);
 
-	bullet->Velocity().y  = 0;
+	m_pProjectiles->Clear();
+	m_PlayerGun.SetPattern(&PLAYER_GUNS[m_iPlayerGun], PROJECTILE_PLAYER, m_iBulletSprite);
+	m_EnemyGun.SetPattern(&ENEMY_GUN, PROJECTILE_ENEMY, m_iMissileSprite);
 }
 
 //-----------------------------------------------------------------------------
@@ -418,52 +667,89 @@ void CGameApp::ReleaseObjects( )
 		m_pPlayer = NULL;
 	}
 
-	if(m_pPlayer1 != NULL)
+	// The store and the pool only refer to the sprites, delete them first
+	if(m_pEntities != NULL)
 	{
-		delete m_pPlayer1;
-		m_pPlayer1 = NULL;
+		delete m_pEntities;
+		m_pEntities = NULL;
 	}
-	if(m_pPlayer2 != NULL)
+	if(m_pProjectiles != NULL)
 	{
-		delete m_pPlayer2;
-		m_pPlayer2 = NULL;
+		delete m_pProjectiles;
+		m_pProjectiles = NULL;
 	}
-	if(m_pPlayer3 != NULL)
+	if(m_pBroadPhase != NULL)
 	{
-		delete m_pPlayer3;
-		m_pPlayer3 = NULL;
+		delete m_pBroadPhase;
+		m_pBroadPhase = NULL;
 	}
-	if(m_pPlayer4 != NULL)
+	if(m_pSweptHits != NULL)
 	{
-		delete m_pPlayer4;
-		m_pPlayer4 = NULL;
+		delete []m_pSweptHits;
+		m_pSweptHits = NULL;
 	}
-	if(m_pPlayer5 != NULL)
+	if(m_pJobs != NULL)
 	{
-		delete m_pPlayer5;
-		m_pPlayer5 = NULL;
+		delete m_pJobs;
+		m_pJobs = NULL;
 	}
-	if(m_pPlayer6 != NULL)
+	if(m_pBulletSprite != NULL)
 	{
-		delete m_pPlayer6;
-		m_pPlayer6 = NULL;
+		delete m_pBulletSprite;
+		m_pBulletSprite = NULL;
 	}
-	if(m_pPlayer7 != NULL)
+	if(m_pEnemySprite != NULL)
 	{
-		delete m_pPlayer7;
-		m_pPlayer7 = NULL;
+		delete m_pEnemySprite;
+		m_pEnemySprite = NULL;
+	}
+	if(m_pMissileSprite != NULL)
+	{
+		delete m_pMissileSprite;
+		m_pMissileSprite = NULL;
+	}
+	if(m_pExplosionSprite != NULL)
+	{
+		delete m_pExplosionSprite;
+		m_pExplosionSprite = NULL;
 	}
 
-	if(missile!= NULL)
+	if(button_play != NULL)
 	{
-		delete missile;
-		missile = NULL;
+		delete button_play;
+		button_play = NULL;
 	}
-	
-	if(bullet!= NULL)
+	if(button_playH != NULL)
+	{
+		delete button_playH;
+		button_playH = NULL;
+	}
+	if(button_settings != NULL)
+	{
+		delete button_settings;
+		button_settings = NULL;
+	}
+	if(button_settingsH != NULL)
+	{
+		delete button_settingsH;
+		button_settingsH = NULL;
+	}
+	if(button_exit != NULL)
+	{
+		delete button_exit;
+		button_exit = NULL;
+	}
+	if(button_exitH != NULL)
+	{
+		delete button_exitH;
+		button_exitH = NULL;
+	}
+
+	// Sprites only reference the atlas pages, release it after them
+	if(m_pAtlas != NULL)
 	{
-		delete bullet;
-		bullet = NULL;
+		delete m_pAtlas;
+		m_pAtlas = NULL;
 	}
 	if(m_pBBuffer != NULL)
 	{
@@ -481,112 +767,525 @@ void CGameApp::FrameAdvance()
 	static TCHAR FrameRate[ 50 ];
 	static TCHAR TitleBuffer[ 255 ];
 
+	PROFILE_FUNCTION();
+
 	// Advance the timer
-	m_Timer.Tick( );
+	m_Timer.Tick( FRAME_RATE_LIMIT );
 
 	// Skip if app is inactive
 	if ( !m_bActive ) return;
 	
-	// Get / Display the framerate
-	if ( m_LastFrameRate != m_Timer.GetFrameRate() )
+	// Get / Display the framerate, jitter and CPU load about once a second
+	m_fTitleTime += m_Timer.GetTimeElapsed();
+	if ( m_LastFrameRate != m_Timer.GetFrameRate() || m_fTitleTime > 1.0f )
 	{
 		m_LastFrameRate = m_Timer.GetFrameRate( FrameRate, 50 );
-		sprintf_s( TitleBuffer, _T("Game : %s"), FrameRate );
+		sprintf_s( TitleBuffer, _T("Game : %s, jitter %.2f ms, CPU %d%%"), FrameRate,
+				   m_Timer.GetFrameJitter() * 1000.0f, (int)(m_Timer.GetCpuUsage() * 100.0f + 0.5f) );
+		if ( m_fRenderScale < 1.0f )
+		{
+			size_t nLength = _tcslen( TitleBuffer );
+			sprintf_s( TitleBuffer + nLength, 255 - nLength, _T(", drawn at %d%%"), (int)(m_fRenderScale * 100.0f + 0.5f) );
+		}
+		if ( m_Capture.IsCapturing() )
+		{
+			size_t nLength = _tcslen( TitleBuffer );
+			sprintf_s( TitleBuffer + nLength, 255 - nLength, _T(", capture %lu written %lu dropped"),
+					   m_Capture.GetFramesWritten(), m_Capture.GetFramesDropped() );
+		}
 		SetWindowText( m_hWnd, TitleBuffer );
+		m_fTitleTime = 0.0f;
 
 	} // End if Frame Rate Altered
 
-	// Poll & Process input devices
+	RunFrame();
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunFrame () (Private)
+// Desc : Simulates the fixed ticks the last frame's time adds up to and
+//		draws the result. The time left over, less than a tick, says how far
+//		between the last two ticks the frame is drawn, so motion stays
+//		smooth whatever the frame rate while the game itself always steps
+//		the same way. In pipelined mode the frame is handed to the render
+//		thread, and the simulation moves on while the render thread draws.
+//-----------------------------------------------------------------------------
+void CGameApp::RunFrame()
+{
+	PROFILE_FUNCTION();
+
+	double fSimStart = ReadMilliseconds();
+
+	// Poll input devices, every tick of the frame sees the same input
+	PollInput();
+
+	// A long stall is dropped rather than caught up in one burst of ticks
+	m_fTickTime += min( m_Timer.GetLastFrameTime(), MAX_FRAME_TIME );
+	while ( m_fTickTime >= m_fFixedStep )
+	{
+		SimulateTick();
+		m_fTickTime -= m_fFixedStep;
+	}
+
+	float fSimMs = (float)(ReadMilliseconds() - fSimStart);
+	m_Hud.SetPhaseTimes( fSimMs, m_fDrawMs );
+
+	sFramePacket *pFrame = m_bPipelined ? m_FrameExchange.GetWriteFrame() : &m_SerialFrame;
+	BuildFrame( pFrame, m_fTickTime / m_fFixedStep );
+
+	if ( m_Telemetry.IsRecording() )
+	{
+		sTelemetryRecord Record;
+		Record.nFrame		= pFrame->nFrame;
+		Record.fFrameMs		= m_Timer.GetLastFrameTime() * 1000.0f;
+		Record.fSimMs		= fSimMs;
+		Record.fDrawMs		= m_fDrawMs;
+		Record.nEntities	= (USHORT)pFrame->nCommands;
+		m_Telemetry.Record( Record );
+	}
+
+	if ( m_bPipelined )
+	{
+		m_FrameExchange.Publish();
+		SetEvent( m_hFrameEvent );
+	}
+	else
+	{
+		// Drawing the game objects
+		DrawObjects( m_SerialFrame );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : SimulateTick () (Private)
+// Desc : Advances the game by one fixed time step.
+//-----------------------------------------------------------------------------
+void CGameApp::SimulateTick()
+{
+	PROFILE_FUNCTION();
+
 	ProcessInput();
 
 	// Animate the game objects
 	AnimateObjects();
-	//colisionPixel(CPlayer* obj, CPlayer* obj2);
-	
-	//scrollBackground();
 
-	// Drawing the game objects
-	DrawObjects();
+	ScrollBackground();
 }
 
 //-----------------------------------------------------------------------------
-// Name : ProcessInput () (Private)
-// Desc : Simply polls the input devices and performs basic input operations
+// Name : ScrollBackground () (Private)
+// Desc : Scrolls the background while the player pushes against a screen
+//		edge, the player stops there instead.
 //-----------------------------------------------------------------------------
+void CGameApp::ScrollBackground()
+{
+	int				x, y;
+	GetPlayfieldSize( x, y );
 
-void CGameApp::ProcessInput( )
+	m_fScroll = 0.0f;
+	if(m_pPlayer->Position().x >= x-50)
+	{
+		m_pPlayer->Velocity().x=0;
+		m_fScroll = BACKGROUND_SCROLL_SPEED;
+	}
+	else if(m_pPlayer->Position().x <= 70)
+	{
+		m_pPlayer->Velocity().x=0;
+		m_fScroll = -BACKGROUND_SCROLL_SPEED;
+	}
+
+	for(int i = 0; i < m_BackgroundCount; i++)
+		m_Background[i].Scroll(m_fScroll * GetTickTime(), 0.0f);
+}
+
+//-----------------------------------------------------------------------------
+// Name : StartRenderThread () (Private)
+// Desc : Starts the thread that draws published frames.
+//-----------------------------------------------------------------------------
+bool CGameApp::StartRenderThread()
 {
-	HMONITOR hmon = MonitorFromWindow(m_hWnd, MONITOR_DEFAULTTONEAREST);
-	MONITORINFO mi = { sizeof(mi) };
-	GetMonitorInfo(hmon, &mi);
-	int				x			= mi.rcMonitor.right;
-	int				y			= mi.rcMonitor.bottom;
+	if ( m_hRenderThread ) return true;
 
-	static UCHAR pKeyBuffer[ 256 ];
-	ULONG		Direction = 0, Direction1 = 0;
-	POINT		CursorPos;
-	float		X = 0.0f, Y = 0.0f;
+	// Auto reset, each wake up draws the newest frame
+	if ( !m_hFrameEvent ) m_hFrameEvent = CreateEvent( NULL, FALSE, FALSE, NULL );
+	if ( !m_hFrameEvent ) return false;
 
-	// Retrieve keyboard state
-	if ( !GetKeyboardState( pKeyBuffer ) ) return;
+	m_lRenderQuit	= 0;
+	m_lFramesDrawn	= 0;
+	m_hRenderThread	= CreateThread( NULL, 0, RenderThreadProc, this, 0, NULL );
 
-	// Check the relevant keys for the first player
-	if ( pKeyBuffer[ VK_UP	] & 0xF0 ) Direction |= CPlayer::DIR_FORWARD;
-	if ( pKeyBuffer[ VK_DOWN  ] & 0xF0 ) Direction |= CPlayer::DIR_BACKWARD;
-	if ( pKeyBuffer[ VK_LEFT  ] & 0xF0 ) Direction |= CPlayer::DIR_LEFT;
-	if ( pKeyBuffer[ VK_RIGHT ] & 0xF0 ) Direction |= CPlayer::DIR_RIGHT;
-	
+	return m_hRenderThread != NULL;
+}
 
-	// Move the player
-	Vec2 pos;
-	Vec2 pos2;
-	
-	pos = m_pPlayer->Position();
-	pos2 = bullet->Position();
+//-----------------------------------------------------------------------------
+// Name : StopRenderThread () (Private)
+// Desc : Waits for the render thread to finish its frame and exit.
+//-----------------------------------------------------------------------------
+void CGameApp::StopRenderThread()
+{
+	if ( m_hRenderThread )
+	{
+		InterlockedExchange( &m_lRenderQuit, 1 );
+		SetEvent( m_hFrameEvent );
+		WaitForSingleObject( m_hRenderThread, INFINITE );
+		CloseHandle( m_hRenderThread );
+		m_hRenderThread = NULL;
+	}
 
-	
-	if(pos2.y <= 0 && bullet->Velocity().y != 0)
+	if ( m_hFrameEvent ) CloseHandle( m_hFrameEvent );
+	m_hFrameEvent = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RenderThreadProc () (Static, Private)
+// Desc : Draws the newest published frame each time one is signalled. The
+//		render thread only reads frame packets and the sprites' images,
+//		never the game objects the simulation is updating.
+//-----------------------------------------------------------------------------
+DWORD WINAPI CGameApp::RenderThreadProc( LPVOID pParam )
+{
+	CGameApp *pApp = (CGameApp*)pParam;
+
+	PROFILE_THREAD_NAME( "Render" );
+
+	while ( true )
 	{
-		bullet->stop();
-		attack(m_pPlayer, bullet, 300);
+		WaitForSingleObject( pApp->m_hFrameEvent, INFINITE );
+		if ( pApp->m_lRenderQuit ) break;
+
+		sFramePacket *pFrame = pApp->m_FrameExchange.AcquireLatest();
+		if ( pFrame )
+		{
+			pApp->DrawObjects( *pFrame );
+			InterlockedIncrement( &pApp->m_lFramesDrawn );
+		}
 	}
 
-	if(missile1->Position().y >= y && missile1->Velocity().y != 0)
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunBenchmark () (Private)
+// Desc : Runs the game unlocked and without presenting, first with serial
+//		and then with pipelined rendering, and writes the throughput of each
+//		to benchmark.txt.
+//-----------------------------------------------------------------------------
+int CGameApp::RunBenchmark()
+{
+	ULONG nSerialSim, nSerialDrawn, nPipeSim, nPipeDrawn;
+
+	m_bPresent = false;
+	float fSerial	= MeasureThroughput( false, nSerialSim, nSerialDrawn );
+	float fPipe		= MeasureThroughput( true, nPipeSim, nPipeDrawn );
+
+	FILE *pFile = NULL;
+	if ( fopen_s( &pFile, "benchmark.txt", "w" ) != 0 || !pFile ) return 1;
+
+	fprintf( pFile, "serial    : %lu frames simulated, %lu drawn in %.2f s, %.1f FPS drawn\n",
+			 nSerialSim, nSerialDrawn, fSerial, nSerialDrawn / fSerial );
+	fprintf( pFile, "pipelined : %lu frames simulated, %lu drawn in %.2f s, %.1f FPS drawn, %.1f FPS simulated\n",
+			 nPipeSim, nPipeDrawn, fPipe, nPipeDrawn / fPipe, nPipeSim / fPipe );
+	fprintf( pFile, "speed-up  : %.2fx\n", (nPipeDrawn / fPipe) / (nSerialDrawn / fSerial) );
+	fclose( pFile );
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : MeasureThroughput () (Private)
+// Desc : Runs frames for BENCHMARK_SECONDS and returns the time it took.
+//-----------------------------------------------------------------------------
+float CGameApp::MeasureThroughput( bool bPipelined, ULONG &nSimulated, ULONG &nDrawn )
+{
+	MSG msg;
+	__int64 nFreq, nStart, nNow;
+
+	m_bPipelined = bPipelined;
+	if ( m_bPipelined && !StartRenderThread() ) m_bPipelined = false;
+
+	QueryPerformanceFrequency( (LARGE_INTEGER*)&nFreq );
+	QueryPerformanceCounter( (LARGE_INTEGER*)&nStart );
+	nNow		= nStart;
+	nSimulated	= 0;
+
+	while ( (nNow - nStart) < (__int64)(BENCHMARK_SECONDS * nFreq) )
 	{
-		missile1->stop();
-		attack(m_pPlayer1, missile1, 100);
+		while ( PeekMessage( &msg, NULL, 0, 0, PM_REMOVE ) )
+		{
+			TranslateMessage( &msg );
+			DispatchMessage ( &msg );
+		}
+
+		m_Timer.Tick( );
+		RunFrame( );
+		nSimulated++;
+
+		QueryPerformanceCounter( (LARGE_INTEGER*)&nNow );
 	}
-	if(missile2->Position().y >= y && missile2->Velocity().y != 0)
+
+	nDrawn = m_bPipelined ? 0 : nSimulated;
+	if ( m_bPipelined )
 	{
-		missile2->stop();
-		attack(m_pPlayer2, missile2, 100);
+		StopRenderThread( );
+		nDrawn = m_lFramesDrawn;
 	}
-	if(missile3->Position().y >= y && missile3->Velocity().y != 0)
+
+	return (nNow - nStart) / (float)nFreq;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunGoldenTest () (Private)
+// Desc : Plays the input script with a fixed time step, rendering off
+//		screen. Each frame is hashed and checked against Data/golden.txt (or
+//		stored there with -goldenrecord), and its render time is written to
+//		golden_report.txt. Returns 0 only when every frame had a hash and
+//		matched it.
+//-----------------------------------------------------------------------------
+int CGameApp::RunGoldenTest()
+{
+	MSG			msg;
+	CGoldenLog	*pGolden	= new CGoldenLog;
+	CGoldenLog	*pResult	= new CGoldenLog;
+	bool		bCompare	= !m_bRecordGolden && pGolden->Load( GOLDEN_FILE );
+	ULONG		nMismatches = 0, nMissing = 0, nDumps = 0;
+	double		fTotalMs	= 0.0, fMaxMs = 0.0;
+	__int64		nFreq, nStart, nEnd;
+
+	FILE *pReport = NULL;
+	if ( fopen_s( &pReport, GOLDEN_REPORT_FILE, "w" ) != 0 || !pReport ) { delete pGolden; delete pResult; return 1; }
+
+	// The log cannot hold more, later frames would be neither checked nor stored
+	if ( m_nGoldenFrames > (ULONG)MAX_GOLDEN_FRAMES )
 	{
-		missile3->stop();
-		attack(m_pPlayer3, missile3, 100);
+		fprintf( pReport, "-frames %lu is more than the %d frames a golden run can hold\n", m_nGoldenFrames, MAX_GOLDEN_FRAMES );
+		fclose( pReport );
+		delete pGolden;
+		delete pResult;
+		return 1;
 	}
-	if(missile4->Position().y >= y && missile4->Velocity().y != 0)
+
+	QueryPerformanceFrequency( (LARGE_INTEGER*)&nFreq );
+	m_fFixedStep	= GOLDEN_TIME_STEP;
+	m_bPresent		= false;
+
+	fprintf( pReport, "frame hash             expected         render_ms status\n" );
+	for ( ULONG nFrame = 0; nFrame < m_nGoldenFrames; nFrame++ )
 	{
-		missile4->stop();
-		attack(m_pPlayer4, missile4, 100);
+		while ( PeekMessage( &msg, NULL, 0, 0, PM_REMOVE ) )
+		{
+			TranslateMessage( &msg );
+			DispatchMessage ( &msg );
+		}
+
+		// One tick per frame, drawn where the tick left everything, with the
+		// render timed on its own
+		GetScriptedInput( nFrame, m_pKeyBuffer, &m_ptCursor );
+		SimulateTick();
+		BuildFrame( &m_SerialFrame, 1.0f );
+
+		QueryPerformanceCounter( (LARGE_INTEGER*)&nStart );
+		DrawObjects( m_SerialFrame );
+		GdiFlush();
+		QueryPerformanceCounter( (LARGE_INTEGER*)&nEnd );
+
+		double fMs = (nEnd - nStart) * 1000.0 / nFreq;
+		fTotalMs += fMs;
+		if ( fMs > fMaxMs ) fMaxMs = fMs;
+
+		ULONGLONG Hash = HashFrame( m_pBBuffer->getBits(), m_pBBuffer->width(), m_pBBuffer->height(), m_pBBuffer->pitch() );
+		ULONGLONG Expected = 0;
+		pResult->SetHash( nFrame, Hash );
+
+		LPCSTR strStatus = "-";
+		if ( bCompare )
+		{
+			strStatus = "ok";
+			if ( !pGolden->GetHash( nFrame, Expected ) )
+			{
+				// A short or stale baseline fails rather than passing unchecked
+				strStatus = "MISSING";
+				nMissing++;
+			}
+			else if ( Expected != Hash )
+			{
+				strStatus = "MISMATCH";
+				nMismatches++;
+
+				// Keep the first few bad frames for inspection
+				if ( nDumps < GOLDEN_MAX_DUMPS )
+				{
+					char strFileName[ 64 ];
+					sprintf_s( strFileName, "golden_fail_%04lu.bmp", nFrame );
+					SaveFrameBitmap( strFileName, m_pBBuffer->getBits(), m_pBBuffer->width(), m_pBBuffer->height(), m_pBBuffer->pitch() );
+					nDumps++;
+				}
+			}
+		}
+
+		fprintf( pReport, "%5lu %016llx %016llx %9.3f %s\n", nFrame, (unsigned long long)Hash,
+				 (unsigned long long)Expected, fMs, strStatus );
+	}
+
+	fprintf( pReport, "\n%lu frames, %lu mismatched, %lu missing, render mean %.3f ms, max %.3f ms\n",
+			 m_nGoldenFrames, nMismatches, nMissing, m_nGoldenFrames ? fTotalMs / m_nGoldenFrames : 0.0, fMaxMs );
+	if ( !bCompare && !m_bRecordGolden ) fprintf( pReport, "no golden hashes found in %s, run with -goldenrecord\n", GOLDEN_FILE );
+	fclose( pReport );
+
+	int iResult = ( nMismatches || nMissing ) ? 1 : 0;
+	if ( m_bRecordGolden && !pResult->Save( GOLDEN_FILE ) ) iResult = 1;
+	if ( !m_bRecordGolden && !bCompare ) iResult = 1;
+
+	delete pGolden;
+	delete pResult;
+	return iResult;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunTickBenchmark () (Private)
+// Desc : Plays the golden input script for TICK_BENCHMARK_TICKS ticks with
+//		nothing recorded or drawn, and writes the ticks per second to
+//		tick_benchmark.txt with a hash of the final game state. The ticks
+//		do not depend on the clock, so the hash is the same on every run.
+//		The run fails if the shots are not spawned where they should be.
+//-----------------------------------------------------------------------------
+int CGameApp::RunTickBenchmark()
+{
+	MSG		msg;
+	__int64	nFreq, nStart, nEnd;
+
+	QueryPerformanceFrequency( (LARGE_INTEGER*)&nFreq );
+	m_bPresent = false;
+
+	QueryPerformanceCounter( (LARGE_INTEGER*)&nStart );
+	for ( ULONG nTick = 0; nTick < TICK_BENCHMARK_TICKS; nTick++ )
+	{
+		GetScriptedInput( nTick, m_pKeyBuffer, &m_ptCursor );
+		SimulateTick();
 	}
-	if(missile5->Position().y >= y && missile5->Velocity().y != 0)
+	QueryPerformanceCounter( (LARGE_INTEGER*)&nEnd );
+
+	// Nothing was pumped while ticking, let the window catch up
+	while ( PeekMessage( &msg, NULL, 0, 0, PM_REMOVE ) )
 	{
-		missile5->stop();
-		attack(m_pPlayer5, missile5, 100);
+		TranslateMessage( &msg );
+		DispatchMessage ( &msg );
 	}
-	if(missile6->Position().y >= y && missile6->Velocity().y != 0)
+
+	FILE *pFile = NULL;
+	if ( fopen_s( &pFile, TICK_BENCHMARK_FILE, "w" ) != 0 || !pFile ) return 1;
+
+	double fSeconds = (nEnd - nStart) / (double)nFreq;
+	fprintf( pFile, "ticks      : %lu of %.4f s game time\n", TICK_BENCHMARK_TICKS, m_fFixedStep );
+	fprintf( pFile, "time       : %.3f s, %.1f ticks per second, %.2f us per tick\n",
+			 fSeconds, TICK_BENCHMARK_TICKS / fSeconds, fSeconds * 1e6 / TICK_BENCHMARK_TICKS );
+	fprintf( pFile, "state hash : %016llx\n", (unsigned long long)HashGameState() );
+
+	// A shot fired at the very end of a tick has to come out of the muzzle
+	bool bTiming = CheckShotTiming();
+	fprintf( pFile, "shots      : %s\n", bTiming ? "ok" : "WRONG, a shot fired at the end of a tick is not at the muzzle" );
+
+	bool bResult = ferror( pFile ) == 0 && bTiming;
+	fclose( pFile );
+	return bResult ? 0 : 1;
+}
+
+//-----------------------------------------------------------------------------
+// Name : HashGameState () (Private)
+// Desc : FNV-1a over the player, entity and projectile positions, so two
+//		runs can be checked for taking the same steps.
+//-----------------------------------------------------------------------------
+ULONGLONG CGameApp::HashGameState( )
+{
+	ULONGLONG Hash = 14695981039346656037ULL;
+	float fPlayer[ 2 ] = { m_pPlayer->Position().x, m_pPlayer->Position().y };
+	const float *pArrays[ 5 ] = { fPlayer, m_pEntities->PositionX(), m_pEntities->PositionY(),
+								  m_pProjectiles->PositionX(), m_pProjectiles->PositionY() };
+	int nCounts[ 5 ] = { 2, m_pEntities->GetCount(), m_pEntities->GetCount(),
+						 m_pProjectiles->GetCount(), m_pProjectiles->GetCount() };
+
+	for ( int a = 0; a < 5; a++ )
 	{
-		missile6->stop();
-		attack(m_pPlayer6, missile6, 100);
+		const BYTE *pBytes = (const BYTE*)pArrays[ a ];
+		for ( int i = 0; i < nCounts[ a ] * (int)sizeof(float); i++ )
+		{
+			Hash ^= pBytes[ i ];
+			Hash *= 1099511628211ULL;
+		}
 	}
-	if(missile7->Position().y >= y && missile7->Velocity().y != 0)
+
+	return Hash;
+}
+
+//-----------------------------------------------------------------------------
+// Name : PollInput () (Private)
+// Desc : Reads the keyboard and cursor once per frame. Everything else uses
+//		these copies, so the golden run can substitute scripted input.
+//-----------------------------------------------------------------------------
+void CGameApp::PollInput( )
+{
+	if ( !GetKeyboardState( m_pKeyBuffer ) ) ZeroMemory( m_pKeyBuffer, sizeof(m_pKeyBuffer) );
+	GetCursorPos( &m_ptCursor );
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetPlayfieldSize () (Private)
+// Desc : The area the player is kept inside. The monitor in normal play, the
+//		fixed render size in the golden run.
+//-----------------------------------------------------------------------------
+void CGameApp::GetPlayfieldSize( int &iWidth, int &iHeight )
+{
+	if ( m_bGolden || m_bTickBenchmark )
 	{
-		missile7->stop();
-		attack(m_pPlayer7, missile7, 100);
+		iWidth	= (int)m_nViewWidth;
+		iHeight	= (int)m_nViewHeight;
+		return;
 	}
 
+	HMONITOR hmon = MonitorFromWindow(m_hWnd, MONITOR_DEFAULTTONEAREST);
+	MONITORINFO mi = { sizeof(mi) };
+	GetMonitorInfo(hmon, &mi);
+	iWidth	= mi.rcMonitor.right;
+	iHeight	= mi.rcMonitor.bottom;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetTickTime () (Private)
+// Desc : Seconds to advance the simulation by each tick.
+//-----------------------------------------------------------------------------
+float CGameApp::GetTickTime( )
+{
+	return m_fFixedStep;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ProcessInput () (Private)
+// Desc : Simply polls the input devices and performs basic input operations
+//-----------------------------------------------------------------------------
+
+void CGameApp::ProcessInput( )
+{
+	PROFILE_FUNCTION();
+
+	int				x, y;
+	GetPlayfieldSize( x, y );
+
+	const UCHAR	*pKeyBuffer = m_pKeyBuffer;
+	ULONG		Direction = 0, Direction1 = 0;
+	POINT		CursorPos;
+	float		X = 0.0f, Y = 0.0f;
+
+	// Check the relevant keys for the first player
+	if ( pKeyBuffer[ VK_UP	] & 0xF0 ) Direction |= CPlayer::DIR_FORWARD;
+	if ( pKeyBuffer[ VK_DOWN  ] & 0xF0 ) Direction |= CPlayer::DIR_BACKWARD;
+	if ( pKeyBuffer[ VK_LEFT  ] & 0xF0 ) Direction |= CPlayer::DIR_LEFT;
+	if ( pKeyBuffer[ VK_RIGHT ] & 0xF0 ) Direction |= CPlayer::DIR_RIGHT;
+	
+
+	// Move the player
+	Vec2f pos;
+	
+	pos = m_pPlayer->Position();
+
 	if(pos.x <= x - 50)
 		m_pPlayer->Move(Direction);
 	else
@@ -636,224 +1335,408 @@ void CGameApp::ProcessInput( )
 
 //-----------------------------------------------------------------------------
 // Name : AnimateObjects () (Private)
-// Desc : Animates the objects we currently have loaded.
+// Desc : Animates the objects we currently have loaded. The entities and
+//		the shots are moved by jobs on the worker threads. The animator,
+//		the player and the sounds are not safe to use from the workers, so
+//		the player is updated on this thread while the entities move. The
+//		enemies fire and collision runs here once everything has moved. A
+//		tick comes out the same on any number of threads.
 //-----------------------------------------------------------------------------
 void CGameApp::AnimateObjects()
 {
-	eps += 3.5;
-	eps2 += 3.5;
-
-	m_pPlayer->Update(m_Timer.GetTimeElapsed());
-	m_pPlayer1->Update(m_Timer.GetTimeElapsed());
-	m_pPlayer2->Update(m_Timer.GetTimeElapsed());
-	m_pPlayer3->Update(m_Timer.GetTimeElapsed());
-	m_pPlayer4->Update(m_Timer.GetTimeElapsed());
-	m_pPlayer5->Update(m_Timer.GetTimeElapsed());
-	m_pPlayer6->Update(m_Timer.GetTimeElapsed());
-	m_pPlayer7->Update(m_Timer.GetTimeElapsed());
-
-	missile->Update(m_Timer.GetTimeElapsed());
-	missile1->Update(m_Timer.GetTimeElapsed());
-	missile2->Update(m_Timer.GetTimeElapsed());
-	missile3->Update(m_Timer.GetTimeElapsed());
-	missile4->Update(m_Timer.GetTimeElapsed());
-	missile5->Update(m_Timer.GetTimeElapsed());
-	missile6->Update(m_Timer.GetTimeElapsed());
-	missile7->Update(m_Timer.GetTimeElapsed());
-
-	bullet->Update(m_Timer.GetTimeElapsed());
-
-	//coliziunea avioanelor de sus cu avionul de jos
-	colision(m_pPlayer1,m_pPlayer);
-	colision(m_pPlayer2,m_pPlayer);
-	colision(m_pPlayer3,m_pPlayer);
-	colision(m_pPlayer4,m_pPlayer);
-	colision(m_pPlayer5,m_pPlayer);
-	colision(m_pPlayer6,m_pPlayer);
-	colision(m_pPlayer7,m_pPlayer);
-	
-	//coliziunea rachetelor cu avionul de jos
-	colision(missile1,m_pPlayer);
-	colision(missile2,m_pPlayer);
-	colision(missile3,m_pPlayer);
-	colision(missile4,m_pPlayer);
-	colision(missile5,m_pPlayer);
-	colision(missile6,m_pPlayer);
-	colision(missile7,m_pPlayer);
-
-	//coliziunea glontului cu avioanele de sus
-	colision(bullet, m_pPlayer1);
-	colision(bullet, m_pPlayer2);
-	colision(bullet, m_pPlayer3);
-	colision(bullet, m_pPlayer4);
-	colision(bullet, m_pPlayer5);
-	colision(bullet, m_pPlayer6);
-	colision(bullet, m_pPlayer7);
-	
+	PROFILE_FUNCTION();
+
+	m_pTickJob = m_pJobs->CreateJob(NULL, this);
+	m_pJobs->Run(m_pJobs->CreateParallelFor(IntegrateEntitiesJob, this, m_pEntities->GetCount(),
+											SIMULATION_JOB_GRAIN, m_pTickJob));
+
+	UpdatePlayer();
+
+	m_pJobs->Run(m_pTickJob);
+	m_pJobs->Wait(m_pTickJob);
+
+	UpdateEnemies();
+
+	Collide();
 }
 
-void CGameApp::AI()
+//-----------------------------------------------------------------------------
+// Name : UpdatePlayer () (Private)
+// Desc : Advances the animations and the player, starts the jobs that move
+//		the shots and fires the player's gun.
+//-----------------------------------------------------------------------------
+void CGameApp::UpdatePlayer()
 {
-	
-   //seteaza velocity la toate avioanele de sus 
-	m_pPlayer1->Velocity() = Vec2(0,25);
-	m_pPlayer2->Velocity() = Vec2(0,25);
-	m_pPlayer3->Velocity() = Vec2(0,25);
-	m_pPlayer4->Velocity() = Vec2(0,25);
-	m_pPlayer5->Velocity() = Vec2(0,25);
-	m_pPlayer6->Velocity() = Vec2(0,25);
-	m_pPlayer7->Velocity() = Vec2(0,25);
-
-	m_pPlayer1->Draw();	
-	m_pPlayer2->Draw();
-	m_pPlayer3->Draw();
-	m_pPlayer4->Draw();
-	m_pPlayer5->Draw();
-	m_pPlayer6->Draw();
-	m_pPlayer7->Draw();
-	
-   
-	missile1->Draw();
-	attack(m_pPlayer1, missile1, -100);
+	PROFILE_FUNCTION();
 
-	missile2->Draw();
-	attack(m_pPlayer2, missile2, -100);
+	float dt = GetTickTime();
 
-	missile3->Draw();
-	attack(m_pPlayer3, missile3, -100);
+	// Advance all explosions in one pass, players pick up their frame in Update
+	m_Animator.Update(dt);
 
-	missile4->Draw();
-	attack(m_pPlayer4, missile4, -100);
+	m_pPlayer->Update(dt);
 
-	missile5->Draw();
-	attack(m_pPlayer5, missile5, -100);
+	// Move the shots already in flight, then fire from the player's
+	// position. The new shots are placed where they are at the end of the
+	// tick, the jobs only cover the ones that were there before.
+	m_pJobs->Run(m_pJobs->CreateParallelFor(IntegrateShotsJob, this, m_pProjectiles->GetCount(),
+											SIMULATION_JOB_GRAIN, m_pTickJob));
 
-	missile6->Draw();
-	attack(m_pPlayer6, missile6, -100);
+	int nShots = m_PlayerGun.Update(dt, (m_pKeyBuffer[VK_NUMPAD0] & 0xF0) != 0);
+	m_PlayerGun.Emit(m_pProjectiles, m_pPlayer->Position().x, m_pPlayer->Position().y,
+					 (float)m_ptCursor.x, (float)m_ptCursor.y, nShots);
+}
 
-	missile7->Draw();
-	attack(m_pPlayer7, missile7, -100);
+//-----------------------------------------------------------------------------
+// Name : Collide () (Private)
+// Desc : Ages the entities, culls the shots and settles what hit what, once
+//		everything has moved.
+//-----------------------------------------------------------------------------
+void CGameApp::Collide()
+{
+	PROFILE_FUNCTION();
+
+	float dt = GetTickTime();
+
+	m_pEntities->Age(dt);
+
+	int x, y;
+	GetPlayfieldSize(x, y);
+	RECT rcBounds = { -PROJECTILE_CULL_MARGIN, -PROJECTILE_CULL_MARGIN, x + PROJECTILE_CULL_MARGIN, y + PROJECTILE_CULL_MARGIN };
+	m_pProjectiles->Compact(rcBounds);
+
+	const float *pX = m_pEntities->PositionX();
+	const float *pY = m_pEntities->PositionY();
+	const float *pPrevX = m_pEntities->PreviousX();
+	const float *pPrevY = m_pEntities->PreviousY();
+	const UCHAR *pState = m_pEntities->State();
+	const UCHAR *pSprite = m_pEntities->SpriteId();
+
+	const float *pShotX = m_pProjectiles->PositionX();
+	const float *pShotY = m_pProjectiles->PositionY();
+	const float *pShotPrevX = m_pProjectiles->PreviousX();
+	const float *pShotPrevY = m_pProjectiles->PreviousY();
+	const float *pShotLife = m_pProjectiles->Life();
+	const UCHAR *pShotSprite = m_pProjectiles->SpriteId();
+	const UCHAR *pTeam = m_pProjectiles->Team();
+
+	// Rebuild the broad phase from the sprite rectangles of the enemies and
+	// shots, each stretched over where it was at the start of the frame and
+	// where it is now, so a fast shot cannot jump over a plane on a slow
+	// frame. The user data of each box is its index in the entity store or
+	// the pool. The player is not added, it is queried against them all.
+	RECT rc, rcFrom;
+	m_pBroadPhase->Clear();
+
+	for(int i = 0; i < m_pEntities->GetCount(); i++)
+	{
+		if(pState[i] != ENTITY_ENEMY)
+			continue;
+
+		const Sprite *pEnemySprite = m_pEntities->GetSprite(pSprite[i]);
+		pEnemySprite->getBounds(pX[i], pY[i], -1, rc);
+		pEnemySprite->getBounds(pPrevX[i], pPrevY[i], -1, rcFrom);
+		UnionRect(&rc, &rc, &rcFrom);
+		m_pBroadPhase->AddRect(rc, COLLISION_ENEMY, COLLISION_PLAYER | COLLISION_PLAYER_SHOT, i);
+	}
+
+	for(int i = 0; i < m_pProjectiles->GetCount(); i++)
+	{
+		const Sprite *pBullet = m_pProjectiles->GetSprite(pShotSprite[i]);
+		pBullet->getBounds(pShotX[i], pShotY[i], -1, rc);
+		pBullet->getBounds(pShotPrevX[i], pShotPrevY[i], -1, rcFrom);
+		UnionRect(&rc, &rc, &rcFrom);
+		if(pTeam[i] == PROJECTILE_PLAYER)
+			m_pBroadPhase->AddRect(rc, COLLISION_PLAYER_SHOT, COLLISION_ENEMY, i);
+		else
+			m_pBroadPhase->AddRect(rc, COLLISION_ENEMY_SHOT, COLLISION_PLAYER, i);
+	}
+
+	// The swept boxes are long and thin, which the sorted sweep copes with
+	// better than the grid. The boxes only say the sprites might touch,
+	// the masks swept along each shot's path decide, and when.
+	m_nSweptHits = 0;
+	int nPairs = m_pBroadPhase->FindPairsSweep();
+	const sCollisionPair *pPairs = m_pBroadPhase->GetPairs();
+	for(int i = 0; i < nPairs; i++)
+	{
+		// Only player shots and enemies pair up, put the enemy first
+		int iA = pPairs[i].iA, iB = pPairs[i].iB;
+		if(m_pBroadPhase->GetLayer(iA) != COLLISION_ENEMY)
+		{
+			int iSwap = iA; iA = iB; iB = iSwap;
+		}
+
+		// Sweep the shot relative to the plane, which also moved this frame
+		int iEnemy	= m_pBroadPhase->GetUserData(iA);
+		int iShot	= m_pBroadPhase->GetUserData(iB);
+		float fFromX = pShotPrevX[iShot] + (pX[iEnemy] - pPrevX[iEnemy]);
+		float fFromY = pShotPrevY[iShot] + (pY[iEnemy] - pPrevY[iEnemy]);
+		float fTime;
+
+		if(m_pProjectiles->GetSprite(pShotSprite[iShot])->sweeps(fFromX, fFromY, pShotX[iShot], pShotY[iShot], -1,
+				*m_pEntities->GetSprite(pSprite[iEnemy]), pX[iEnemy], pY[iEnemy], -1, fTime))
+			AddSweptHit(fTime, iEnemy, iShot);
+	}
+
+	//coliziunea gloantelor cu avioanele. A bullet is spent on the first plane it hits,
+	//and a plane is brought down by the first bullet to reach it.
+	qsort(m_pSweptHits, m_nSweptHits, sizeof(sSweptHit), CompareSweptHit);
+	for(int i = 0; i < m_nSweptHits; i++)
+	{
+		int iEnemy	= m_pSweptHits[i].iEnemy;
+		int iShot	= m_pSweptHits[i].iShot;
+		if(pState[iEnemy] != ENTITY_ENEMY || pShotLife[iShot] <= 0.0f)
+			continue;
+
+		ExplodeEntity(iEnemy);
+		m_pProjectiles->Kill(iShot);
+	}
+
+	//coliziunea avioanelor cu avionul de jos, and of the enemy missiles
+	const Sprite *pPlayerSprite = m_pPlayer->GetSprite();
+	float fPlayerX = m_pPlayer->Position().x;
+	float fPlayerY = m_pPlayer->Position().y;
+
+	pPlayerSprite->getBounds(fPlayerX, fPlayerY, -1, rc);
+	int nHits = m_pBroadPhase->QueryRect(rc, COLLISION_PLAYER, COLLISION_ENEMY | COLLISION_ENEMY_SHOT);
+	const int *pHits = m_pBroadPhase->GetQueryResults();
+	for(int i = 0; i < nHits; i++)
+	{
+		int iOther = m_pBroadPhase->GetUserData(pHits[i]);
+		float fTime;
+		bool bHit;
+
+		if(m_pBroadPhase->GetLayer(pHits[i]) == COLLISION_ENEMY)
+			bHit = pPlayerSprite->collides(fPlayerX, fPlayerY, -1, *m_pEntities->GetSprite(pSprite[iOther]),
+										   pX[iOther], pY[iOther], -1);
+		else
+			bHit = m_pProjectiles->GetSprite(pShotSprite[iOther])->sweeps(pShotPrevX[iOther], pShotPrevY[iOther],
+										   pShotX[iOther], pShotY[iOther], -1, *pPlayerSprite, fPlayerX, fPlayerY, -1, fTime);
+
+		if(bHit)
+		{
+			PlayerHit();
+			break;
+		}
+	}
 }
 
+//-----------------------------------------------------------------------------
+// Name : AddSweptHit () (Private)
+// Desc : Keeps a shot hit until the frame's hits are settled, doubling the
+//		list when a busy frame fills it.
+//-----------------------------------------------------------------------------
+void CGameApp::AddSweptHit(float fTime, int iEnemy, int iShot)
+{
+	if(m_nSweptHits >= m_nMaxSweptHits)
+	{
+		sSweptHit *pHits = new sSweptHit[m_nMaxSweptHits * 2];
+		memcpy(pHits, m_pSweptHits, m_nSweptHits * sizeof(sSweptHit));
+		delete []m_pSweptHits;
+		m_pSweptHits	= pHits;
+		m_nMaxSweptHits	*= 2;
+	}
 
-void CGameApp::attack(CPlayer* m_pPlayer, CPlayer* obj, int val)
+	m_pSweptHits[m_nSweptHits].fTime	= fTime;
+	m_pSweptHits[m_nSweptHits].iEnemy	= iEnemy;
+	m_pSweptHits[m_nSweptHits].iShot	= iShot;
+	m_nSweptHits++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IntegrateEntitiesJob () (Static, Private)
+// Desc : Moves a range of the entities.
+//-----------------------------------------------------------------------------
+void CGameApp::IntegrateEntitiesJob(void *pContext, int iBegin, int iEnd)
 {
-	
-	Vec2 pos;
-	pos = m_pPlayer->Position();
-	//verificarea vitezei cu zero pentru a putea seta pozitia 
-	if(obj->Velocity().y == 0)
-		obj->Position() = Vec2(pos.x, pos.y);
+	CGameApp *pApp = (CGameApp*)pContext;
+	pApp->m_pEntities->Integrate(iBegin, iEnd, pApp->GetTickTime());
+}
 
-	obj->Velocity() = Vec2 (0,-val);
+//-----------------------------------------------------------------------------
+// Name : IntegrateShotsJob () (Static, Private)
+// Desc : Moves a range of the shots.
+//-----------------------------------------------------------------------------
+void CGameApp::IntegrateShotsJob(void *pContext, int iBegin, int iEnd)
+{
+	CGameApp *pApp = (CGameApp*)pContext;
+	pApp->m_pProjectiles->Integrate(iBegin, iEnd, pApp->GetTickTime());
 }
 
-void CGameApp::colision(CPlayer* obj, CPlayer* obj2)
-{   
-	Vec2 pos1;
-	Vec2 pos2;
-	pos1 = obj2->Position();
-	pos2 = obj->Position();
-	if(abs(pos2.x - pos1.x) < 60 && abs(pos2.y - pos1.y) < 60)
+//-----------------------------------------------------------------------------
+// Name : UpdateEnemies () (Private)
+// Desc : Fires a volley from every enemy when the enemy gun is due, once
+//		the tick has moved them. The enemies fly straight down at the speed
+//		they were created with.
+//-----------------------------------------------------------------------------
+void CGameApp::UpdateEnemies()
+{
+	PROFILE_FUNCTION();
+
+	const float *pX = m_pEntities->PositionX();
+	const float *pY = m_pEntities->PositionY();
+	const UCHAR *pState = m_pEntities->State();
+	const Vec2f &Target = m_pPlayer->Position();
+
+	int nShots = m_EnemyGun.Update(GetTickTime(), true);
+	for(int i = 0; i < m_pEntities->GetCount(); i++)
 	{
-		obj2->Explode();
-		obj2->AdvanceExplosion();
-		obj2->stop();
-		obj2->Position() = Vec2(80, 5000);
+		if(pState[i] == ENTITY_ENEMY)
+			m_EnemyGun.Emit(m_pProjectiles, pX[i], pY[i], Target.x, Target.y, nShots);
 	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : PlayerHit () (Private)
+// Desc : Blows the player up and parks it off the screen.
+//-----------------------------------------------------------------------------
+void CGameApp::PlayerHit()
+{
+	// The tick benchmark times the simulation alone
+	m_pPlayer->Explode( !m_bTickBenchmark );
+	m_pPlayer->stop();
+	m_pPlayer->Position() = Vec2f(80.0f, 5000.0f);
+}
 
+//-----------------------------------------------------------------------------
+// Name : ExplodeEntity () (Private)
+// Desc : Turns an entity into an explosion that stays where it was hit and
+//		is removed when the animation has played.
+//-----------------------------------------------------------------------------
+void CGameApp::ExplodeEntity(int iIndex)
+{
+	m_pEntities->State()[iIndex]		= ENTITY_EXPLODING;
+	m_pEntities->SpriteId()[iIndex]		= (UCHAR)m_iExplosionSprite;
+	m_pEntities->VelocityX()[iIndex]	= 0.0f;
+	m_pEntities->VelocityY()[iIndex]	= 0.0f;
+	m_pEntities->Animation()[iIndex]	= m_Animator.Play(m_iExplosionClip);
+	m_pEntities->Lifetime()[iIndex]		= m_pExplosionSprite->GetFrameCount() * EXPLOSION_FRAME_TIME;
+
+	// The tick benchmark times the simulation alone
+	if(!m_bTickBenchmark)
+	{
+		PlaySound("data/explosion.wav", NULL, SND_FILENAME | SND_ASYNC);
+		TelemetryCount(TELEMETRY_SOUNDS);
+	}
 }
 
 //--------------------------
 // Name: DrawMenu ()
 // Desc : Draw a pause menu
 //---------------------------
-void CGameApp::DrawMenu()
+void CGameApp::DrawMenu(const sFramePacket &Frame)
 {
-        POINT cursorPos;
-        GetCursorPos(&cursorPos);
-        int x_m = (int) cursorPos.x;
-        int y_m = (int) cursorPos.y;
+        int x_m = (int) Frame.ptCursor.x;
+        int y_m = (int) Frame.ptCursor.y;
 
-        button_play->mPosition = Vec2(650, 250);
-        button_play->draw();
+        button_play->drawAt(650, 250, -1);
         if(x_m >=441 && x_m <= 859 && y_m >= 220 && y_m <= 320)
-        {
-            button_playH->mPosition = Vec2(650, 250);
-            button_playH->draw();
-        }
-        button_settings->mPosition = Vec2(650, 350);
-        button_settings->draw();
+            button_playH->drawAt(650, 250, -1);
+        button_settings->drawAt(650, 350, -1);
         if(x_m >=441 && x_m <= 859 && y_m >= 320 && y_m <= 420)
-        {
-            button_settingsH->mPosition = Vec2(650, 350);
-            button_settingsH->draw();
-        }
-        button_exit->mPosition = Vec2(650, 450);
-        button_exit->draw();
+            button_settingsH->drawAt(650, 350, -1);
+        button_exit->drawAt(650, 450, -1);
         if(x_m >=441 && x_m <= 859 && y_m >= 420 && y_m <= 520)
         {
-            button_exitH->mPosition = Vec2(650, 450);
-            button_exitH->draw();
-            if(GetKeyState(VK_LBUTTON) & 0xF0 )
-                PostQuitMessage(0);
+            button_exitH->drawAt(650, 450, -1);
+            // May run on the render thread, so ask the main thread to quit
+            if(Frame.bMouseDown)
+                PostMessage(m_hWnd, WM_CLOSE, 0, 0);
         }
 }
+
+//-----------------------------------------------------------------------------
+// Name : BuildFrame () (Private)
+// Desc : Records what has to be drawn into a frame packet, fAlpha of the
+//		way from the previous tick to the last one.
+//-----------------------------------------------------------------------------
+void CGameApp::BuildFrame(sFramePacket *pFrame, float fAlpha)
+{
+	PROFILE_FUNCTION();
+
+	pFrame->nFrame		= m_nFrame++;
+	pFrame->nCommands	= 0;
+
+	// The layers wrap, so step them back along the last scroll instead of
+	// blending two offsets
+	float fBack = (1.0f - fAlpha) * GetTickTime();
+	for(int i = 0; i < m_BackgroundCount; i++)
+		m_Background[i].GetScrolledOffset(-m_fScroll * fBack, 0.0f, pFrame->fLayerX[i], pFrame->fLayerY[i]);
+
+	// The renderer gets a copy of the input it needs
+	pFrame->bMenu		= m_pKeyBuffer[0x50] != 0;
+	pFrame->bMouseDown	= (m_pKeyBuffer[VK_LBUTTON] & 0xF0) != 0;
+	pFrame->ptCursor	= m_ptCursor;
+
+	// The golden frames are always drawn at full resolution
+	pFrame->fRenderScale = m_bGolden ? 1.0f : m_fRenderScale;
+
+	pFrame->bHud = m_bShowHud && !m_bGolden;
+	if(pFrame->bHud)
+		m_Hud.GetStats(&pFrame->HudStats, m_Timer);
+
+	m_pPlayer->Record(pFrame, fAlpha);
+	m_pEntities->Record(pFrame, fAlpha);
+
+	m_pProjectiles->Record(pFrame, fAlpha);
+}
+
 //-----------------------------------------------------------------------------
 // Name : DrawObjects () (Private)
-// Desc : Draws the game objects
+// Desc : Draws a recorded frame. Only reads the packet and sprite images, so
+//		it can run on the render thread.
 //-----------------------------------------------------------------------------
-void CGameApp::DrawObjects()
+void CGameApp::DrawObjects(const sFramePacket &Frame)
 {
-	HMONITOR hmon = MonitorFromWindow(m_hWnd, MONITOR_DEFAULTTONEAREST);
-	MONITORINFO mi = { sizeof(mi) };
-	GetMonitorInfo(hmon, &mi);
-	int				y			= mi.rcMonitor.bottom;
-	int				x			= mi.rcMonitor.right;
+	PROFILE_FUNCTION();
+
+	double fDrawStart = ReadMilliseconds();
+
+	// Resizing the surface is left to the thread that draws into it
+	if(Frame.fRenderScale != m_pBBuffer->getRenderScale())
+		m_pBBuffer->setRenderScale(Frame.fRenderScale);
 
 	m_pBBuffer->reset();
 
-	if(m_pPlayer->Position().x >= x-50)
-	{
-		m_pPlayer->Velocity().x=0;
-		m_imgBackground.Paint(m_pBBuffer->getDC(), -eps, 0);
-		m_imgBackground2.Paint(m_pBBuffer->getDC(), -eps2,0);
-	}
-	else 
-	{
-		if(m_pPlayer->Position().x <= 70)
-		{
-			m_pPlayer->Velocity().x=0;
-			m_imgBackground2.Paint(m_pBBuffer->getDC(), eps,0);
-			m_imgBackground.Paint(m_pBBuffer->getDC(), eps2, 0);
-		}
-		else
-		{
-		eps=-4000;
-		eps2=0;
-		m_imgBackground.Paint(m_pBBuffer->getDC(), 0, 0);
-		}
-	}
-	if(eps == 0)
-		{
-			eps=-4000;
-			eps2=0;
-		}
+	for(int i = 0; i < m_BackgroundCount; i++)
+		m_Background[i].PaintLayer(m_pBBuffer->getDC(), m_pBBuffer->viewWidth(), m_pBBuffer->viewHeight(),
+								   Frame.fLayerX[i], Frame.fLayerY[i]);
 
-    if(GetKeyState(0x50))
+    if(Frame.bMenu)
     {
         //m_bActive = false;
-        DrawMenu();
+        DrawMenu(Frame);
     }
 
-	m_pPlayer->Draw();
-	
-	//AI();
+	for(int i = 0; i < Frame.nCommands; i++)
+	{
+		const sDrawCommand &Cmd = Frame.Commands[i];
+		Cmd.pSprite->drawAt(Cmd.fX, Cmd.fY, Cmd.iFrame);
+	}
+
+	// Stretch a reduced resolution scene up to the window size
+	m_pBBuffer->resolve();
+
+	// The overlay writes the pixels directly, after GDI is done with them.
+	// It goes on the window sized image, so the text stays sharp.
+	if(Frame.bHud)
+	{
+		sSurface Surface = { m_pBBuffer->getViewBits(), m_pBBuffer->viewWidth(), m_pBBuffer->viewHeight(), m_pBBuffer->viewPitch() };
+		GdiFlush();
+		m_Hud.Draw(Surface, Frame.HudStats);
+	}
+
+	m_fDrawMs = (float)(ReadMilliseconds() - fDrawStart);
 
-	if(GetKeyState( VK_NUMPAD0 ))
+	if(m_bPresent)
 	{
-		bullet->Draw();
-		attack(m_pPlayer, bullet, 300);
+		m_pBBuffer->present();
+
+		if(m_Capture.IsCapturing())
+		{
+			GdiFlush();
+			m_Capture.Submit(m_pBBuffer->getViewBits(), m_pBBuffer->viewWidth(), m_pBBuffer->viewHeight(), m_pBBuffer->viewPitch());
+		}
 	}
-	m_pBBuffer->present();
 }
@@ -11,22 +11,25 @@
 // CPlayer Specific Includes
 //-----------------------------------------------------------------------------
 #include "CPlayer.h"
+#include "Telemetry.h"
 
 //-----------------------------------------------------------------------------
 // Name : CPlayer () (Constructor)
 // Desc : CPlayer Class Constructor
 //-----------------------------------------------------------------------------
-CPlayer::CPlayer(const BackBuffer *pBackBuffer, valuesImage IMAGE)
+CPlayer::CPlayer(const BackBuffer *pBackBuffer, CSpriteAtlas *pAtlas, CAnimator *pAnimator, valuesImage IMAGE)
 {
-	//m_pSprite = new Sprite("data/planeimg.bmp", "data/planemask.bmp");
+	// All players share the atlas, so every image below is loaded only once.
+	// The planes and projectiles use few colours and are stored indexed.
+	//m_pSprite = new Sprite(pAtlas, "data/planeimg.bmp", "data/planemask.bmp");
 	if(IMAGE == image)
-		m_pSprite = new Sprite("data/planeimgandmask.bmp", RGB(0xff,0x00, 0xff));
+		m_pSprite = new Sprite(pAtlas, "data/planeimgandmask.bmp", RGB(0xff,0x00, 0xff), ATLAS_INDEXED);
 	if(IMAGE == image1)
-		m_pSprite = new Sprite("data/planeimgandmask2.bmp", RGB(0xff, 0x00, 0xff));
+		m_pSprite = new Sprite(pAtlas, "data/planeimgandmask2.bmp", RGB(0xff, 0x00, 0xff), ATLAS_INDEXED);
 	if(IMAGE == image2)
-		m_pSprite = new Sprite("data/Missile.bmp","data/Missile_mask.bmp");
+		m_pSprite = new Sprite(pAtlas, "data/Missile.bmp","data/Missile_mask.bmp", ATLAS_INDEXED);
 	if(IMAGE == image3)
-		m_pSprite = new Sprite("data/bullet.bmp","data/bullet_mask.bmp");
+		m_pSprite = new Sprite(pAtlas, "data/bullet.bmp","data/bullet_mask.bmp", ATLAS_INDEXED);
 	
 	m_pSprite->setBackBuffer( pBackBuffer );
 	m_eSpeedState = SPEED_STOP;
@@ -39,10 +42,17 @@ CPlayer::CPlayer(const BackBuffer *pBackBuffer, valuesImage IMAGE)
 	r.right = 128;
 	r.bottom = 128;
 
-	m_pExplosionSprite	= new AnimatedSprite("data/explosion.bmp", "data/explosionmask.bmp", r, 16);
+	// The explosion sheet holds 16 frames on a 4 x 4 grid
+	m_pExplosionSprite	= new AnimatedSprite(pAtlas, "data/explosion.bmp", "data/explosionmask.bmp", r, 4, 4, 16);
 	m_pExplosionSprite->setBackBuffer( pBackBuffer );
+	m_pExplosionSprite->setBlendMode( BLEND_ALPHA );	// soft edges from the 8 bit mask
 	m_bExplosion		= false;
-	m_iExplosionFrame	= 0;
+
+	// Every player registers the same clip, the animator hands back the shared one
+	m_pAnimator			= pAnimator;
+	m_iExplosionClip	= m_pAnimator->AddClip(0, m_pExplosionSprite->GetFrameCount(), EXPLOSION_FRAME_TIME, false);
+	m_hExplosion		= -1;
+	m_PrevPosition		= m_pSprite->mPosition;
 }
 
 //-----------------------------------------------------------------------------
@@ -51,18 +61,24 @@ CPlayer::CPlayer(const BackBuffer *pBackBuffer, valuesImage IMAGE)
 //-----------------------------------------------------------------------------
 CPlayer::~CPlayer()
 {
+	m_pAnimator->Stop(m_hExplosion);
 	delete m_pSprite;
 	delete m_pExplosionSprite;
 }
 
 void CPlayer::Update(float dt)
 {
+	m_PrevPosition = m_pSprite->mPosition;
+
 	// Update sprite
 	m_pSprite->update(dt);
 
+	// Follow the explosion animation, the animator has already advanced it
+	AdvanceExplosion();
+
 
 	// Get velocity
-	double v = m_pSprite->mVelocity.Magnitude();
+	float v = m_pSprite->mVelocity.Length();
 
 	//// NOTE: for each async sound played Windows creates a thread for you
 	//// but only one, so you cannot play multiple sounds at once.
@@ -113,27 +129,47 @@ void CPlayer::Draw()
 		m_pExplosionSprite->draw();
 }
 
+//-----------------------------------------------------------------------------
+// Name : Record ()
+// Desc : Adds the draw Draw() would do to a frame packet, copying the
+//		position and explosion frame so the renderer never reads the player.
+//		The plane is drawn fAlpha of the way from where it was before the
+//		last Update to where it is now.
+//-----------------------------------------------------------------------------
+void CPlayer::Record(sFramePacket *pFrame, float fAlpha) const
+{
+	const Vec2f &Position = m_pSprite->mPosition;
+	float fBack = 1.0f - fAlpha;
+
+	if(!m_bExplosion)
+		AddDrawCommand(pFrame, m_pSprite, Position.x - (Position.x - m_PrevPosition.x) * fBack,
+					   Position.y - (Position.y - m_PrevPosition.y) * fBack, -1);
+	else
+		AddDrawCommand(pFrame, m_pExplosionSprite, m_pExplosionSprite->mPosition.x, m_pExplosionSprite->mPosition.y,
+					   m_pAnimator->GetFrame(m_hExplosion));
+}
+
 void CPlayer::Move(ULONG ulDirection)
 {
 	if( ulDirection & CPlayer::DIR_LEFT )
-		m_pSprite->mVelocity.x -= .1;
+		m_pSprite->mVelocity.x -= .1f;
 
 	if( ulDirection & CPlayer::DIR_RIGHT )
-		m_pSprite->mVelocity.x += .1;
+		m_pSprite->mVelocity.x += .1f;
 
 	if( ulDirection & CPlayer::DIR_FORWARD )
-		m_pSprite->mVelocity.y -= .1;
+		m_pSprite->mVelocity.y -= .1f;
 
 	if( ulDirection & CPlayer::DIR_BACKWARD )
-		m_pSprite->mVelocity.y += .1;
+		m_pSprite->mVelocity.y += .1f;
 }
 
-Vec2& CPlayer::Position()
+Vec2f& CPlayer::Position()
 {
 	return m_pSprite->mPosition;
 }
 
-Vec2& CPlayer::Velocity()
+Vec2f& CPlayer::Velocity()
 {
 	return m_pSprite->mVelocity;
 }
@@ -146,11 +182,19 @@ void CPlayer::stop()
 }
 
 
-void CPlayer::Explode()
+void CPlayer::Explode(bool bSound)
 {
 	m_pExplosionSprite->mPosition = m_pSprite->mPosition;
 	m_pExplosionSprite->SetFrame(0);
-	PlaySound("data/explosion.wav", NULL, SND_FILENAME | SND_ASYNC);
+	if(bSound)
+	{
+		PlaySound("data/explosion.wav", NULL, SND_FILENAME | SND_ASYNC);
+		TelemetryCount(TELEMETRY_SOUNDS);
+	}
+
+	// Restarting an explosion that is still playing starts it over
+	m_pAnimator->Stop(m_hExplosion);
+	m_hExplosion = m_pAnimator->Play(m_iExplosionClip);
 	m_bExplosion = true;
 }
 
@@ -158,15 +202,16 @@ bool CPlayer::AdvanceExplosion()
 {
 	if(m_bExplosion)
 	{
-		m_pExplosionSprite->SetFrame(m_iExplosionFrame++);
-		if(m_iExplosionFrame==m_pExplosionSprite->GetFrameCount())
+		if(!m_pAnimator->IsPlaying(m_hExplosion))
 		{
 			m_bExplosion = false;
-			m_iExplosionFrame = 0;
-			m_pSprite->mVelocity = Vec2(0,0);
+			m_hExplosion = -1;
+			m_pSprite->mVelocity = Vec2f();
 			m_eSpeedState = SPEED_STOP;
 			return false;
 		}
+
+		m_pExplosionSprite->SetFrame(m_pAnimator->GetFrame(m_hExplosion));
 	}
 
 	return true;
@@ -13,6 +13,17 @@
 //-----------------------------------------------------------------------------
 #include "CTimer.h"
 #include <math.h>
+#include <float.h>
+#include "Profiler.h"
+
+#pragma comment(lib, "winmm.lib")
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION	0x00000002	// Windows 10 1803 and later
+#endif
 
 
 //-----------------------------------------------------------------------------
@@ -39,9 +50,36 @@ CTimer::CTimer()
 
 	// Clear any needed values
 	m_SampleCount		= 0;
+	m_SampleNext		= 0;
+	m_SampleSum			= 0.0;
+	m_SampleSumSq		= 0.0;
+	m_HistoryCount		= 0;
+	m_HistoryNext		= 0;
+	m_StatsWindow		= DEFAULT_STATS_WINDOW;
+	m_StutterCount		= 0;
+	m_TotalStutters		= 0;
+	ZeroMemory( m_Histogram, sizeof(m_Histogram) );
 	m_FrameRate			= 0;
 	m_FPSFrameCount		= 0;
 	m_FPSTimeElapsed	= 0.0f;
+	m_TimeElapsed		= 0.0f;
+	m_LastFrameTime		= 0.0f;
+
+	// Prefer a high resolution waitable timer for frame locking. Older
+	// systems only have the default one, so raise the scheduler resolution
+	// to 1ms to make its sleeps reasonably short.
+	m_hWaitTimer = CreateWaitableTimerEx( NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS );
+	m_RaisedPeriod = (m_hWaitTimer == NULL);
+	if ( m_RaisedPeriod )
+	{
+		m_hWaitTimer = CreateWaitableTimer( NULL, TRUE, NULL );
+		timeBeginPeriod( 1 );
+	}
+	m_SleepError		= 0.001f;
+
+	m_CpuTime			= ReadCpuTime();
+	m_CpuSampleTime		= ReadCounter();
+	m_CpuUsage			= 0.0f;
 }
 
 //-----------------------------------------------------------------------------
@@ -50,89 +88,67 @@ CTimer::CTimer()
 //-----------------------------------------------------------------------------
 CTimer::~CTimer()
 {
+	if ( m_hWaitTimer ) CloseHandle( m_hWaitTimer );
+	if ( m_RaisedPeriod ) timeEndPeriod( 1 );
 }
 
 //-----------------------------------------------------------------------------
 // Name : Tick () 
 // Desc : Function which signals that frame has advanced
 // Note : You can specify a number of frames per second to lock the frame rate
-//			to. This will simply soak up the remaining time to hit that target.
+//			to. The remaining time is mostly slept off, see WaitForFrame.
 //-----------------------------------------------------------------------------
 void CTimer::Tick( float fLockFPS )
 {
 	float fTimeElapsed; 
 
-	// Is performance hardware available?
-	if ( m_PerfHardware ) 
-	{
-		// Query high-resolution performance hardware
-		QueryPerformanceCounter((LARGE_INTEGER *)&m_CurrentTime);
-	} 
-	else 
-	{
-		// Fall back to less accurate timer
-		m_CurrentTime = timeGetTime();
-
-	} // End If no hardware available
-
 	// Calculate elapsed time in seconds
+	m_CurrentTime = ReadCounter();
 	fTimeElapsed = (m_CurrentTime - m_LastTime) * m_TimeScale;
 
 	// Smoothly ramp up frame rate to prevent jittering
 	//if ( fLockFPS == 0.0f ) fLockFPS = (1.0f / GetTimeElapsed()) + 20.0f;
 	
 	// Should we lock the frame rate ?
-	if ( fLockFPS > 0.0f )
+	if ( fLockFPS > 0.0f && fTimeElapsed < (1.0f / fLockFPS) )
 	{
-		while ( fTimeElapsed < (1.0f / fLockFPS))
-		{
-			// Is performance hardware available?
-			if ( m_PerfHardware ) 
-			{
-				// Query high-resolution performance hardware
-				QueryPerformanceCounter((LARGE_INTEGER*)&m_CurrentTime);
-			} 
-			else 
-			{
-				// Fall back to less accurate timer
-				m_CurrentTime = timeGetTime();
-
-			} // End If no hardware available
-
-			// Calculate elapsed time in seconds
-			fTimeElapsed = (m_CurrentTime - m_LastTime) * m_TimeScale;
-
-		} // End While
+		WaitForFrame( 1.0f / fLockFPS );
+
+		m_CurrentTime = ReadCounter();
+		fTimeElapsed = (m_CurrentTime - m_LastTime) * m_TimeScale;
+
 	} // End If
 
 	// Save current frame time
 	m_LastTime = m_CurrentTime;
+	m_LastFrameTime = fTimeElapsed;
 
-	// Filter out values wildly different from current average
-	if ( fabsf(fTimeElapsed - m_TimeElapsed) < 1.0f  )
-	{
-		// Wrap FIFO frame time buffer.
-		memmove( &m_FrameTime[1], m_FrameTime, (MAX_SAMPLE_COUNT - 1) * sizeof(float) );
-		m_FrameTime[ 0 ] = fTimeElapsed;
-		if ( m_SampleCount < MAX_SAMPLE_COUNT ) m_SampleCount++;
+	// The statistics see every frame. A stutter is judged against the
+	// average of the frames before it.
+	AddHistory( fTimeElapsed, m_SampleCount > 0 && fTimeElapsed > m_TimeElapsed * STUTTER_FACTOR );
 
-	} // End if
-	
+	// Filter out values wildly different from current average
+	if ( fabsf(fTimeElapsed - m_TimeElapsed) < 1.0f  ) AddSample( fTimeElapsed );
 
 	// Calculate Frame Rate
 	m_FPSFrameCount++;
-	m_FPSTimeElapsed += m_TimeElapsed;
+	m_FPSTimeElapsed += fTimeElapsed;
 	if ( m_FPSTimeElapsed > 1.0f) 
 	{
 		m_FrameRate			= m_FPSFrameCount;
 		m_FPSFrameCount		= 0;
 		m_FPSTimeElapsed	= 0.0f;
+
+		// CPU time is in 100ns units, as a fraction of one core
+		__int64 nCpuTime	= ReadCpuTime();
+		float fWallTime		= (m_CurrentTime - m_CpuSampleTime) * m_TimeScale;
+		if ( fWallTime > 0.0f ) m_CpuUsage = (nCpuTime - m_CpuTime) * 1e-7f / fWallTime;
+		m_CpuTime			= nCpuTime;
+		m_CpuSampleTime		= m_CurrentTime;
 	} // End If Second Elapsed
 
-	// Count up the new average elapsed time
-	m_TimeElapsed = 0.0f;
-	for ( ULONG i = 0; i < m_SampleCount; i++ ) m_TimeElapsed += m_FrameTime[ i ];
-	if ( m_SampleCount > 0 ) m_TimeElapsed /= m_SampleCount;
+	// The new average elapsed time
+	if ( m_SampleCount > 0 ) m_TimeElapsed = (float)(m_SampleSum / m_SampleCount);
 
 }
 
@@ -164,3 +180,265 @@ float CTimer::GetTimeElapsed() const
 {
 	return m_TimeElapsed;
 }
+
+//-----------------------------------------------------------------------------
+// Name : GetLastFrameTime () 
+// Desc : Returns the length of the last frame alone, without smoothing (Seconds)
+//-----------------------------------------------------------------------------
+float CTimer::GetLastFrameTime() const
+{
+	return m_LastFrameTime;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetFrameJitter () 
+// Desc : Returns the standard deviation of the sampled frame times (Seconds)
+//-----------------------------------------------------------------------------
+float CTimer::GetFrameJitter() const
+{
+	if ( m_SampleCount < 2 ) return 0.0f;
+
+	double fMean = m_SampleSum / m_SampleCount;
+	double fVariance = m_SampleSumSq / m_SampleCount - fMean * fMean;
+
+	return fVariance > 0.0 ? (float)sqrt( fVariance ) : 0.0f;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetCpuUsage () 
+// Desc : Returns the process CPU time over the last second as a fraction of
+//		one core, so a busy-waiting single thread reads close to 1.
+//-----------------------------------------------------------------------------
+float CTimer::GetCpuUsage() const
+{
+	return m_CpuUsage;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetStatsWindow () 
+// Desc : Sets how many of the latest frames GetFrameStats covers. A shorter
+//		window drops the oldest frames at once, a longer one fills up as
+//		new frames come in.
+//-----------------------------------------------------------------------------
+void CTimer::SetStatsWindow( ULONG nFrames )
+{
+	m_StatsWindow = max( 1UL, min( nFrames, MAX_HISTORY_COUNT ) );
+	while ( m_HistoryCount > m_StatsWindow ) DropOldestHistory();
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetFrameStats () 
+// Desc : Fills in the frame time statistics of the window. The percentiles
+//		come from the histogram, so they cost the same for any window.
+//-----------------------------------------------------------------------------
+void CTimer::GetFrameStats( sFrameStats *pStats ) const
+{
+	ZeroMemory( pStats, sizeof(sFrameStats) );
+	pStats->nFrames			= m_HistoryCount;
+	pStats->nStutters		= m_StutterCount;
+	pStats->nTotalStutters	= m_TotalStutters;
+	if ( m_HistoryCount == 0 ) return;
+
+	// Exact minimum, maximum and mean
+	float fMin = FLT_MAX, fMax = 0.0f;
+	double fSum = 0.0;
+	ULONG iOldest = (m_HistoryNext + MAX_HISTORY_COUNT - m_HistoryCount) % MAX_HISTORY_COUNT;
+	for ( ULONG i = 0; i < m_HistoryCount; i++ )
+	{
+		float fTime = m_History[ (iOldest + i) % MAX_HISTORY_COUNT ];
+		fMin = min( fMin, fTime );
+		fMax = max( fMax, fTime );
+		fSum += fTime;
+	}
+
+	pStats->fMin	= fMin;
+	pStats->fMax	= fMax;
+	pStats->fMean	= (float)(fSum / m_HistoryCount);
+	pStats->fP50	= GetPercentile( 0.50f, fMax );
+	pStats->fP95	= GetPercentile( 0.95f, fMax );
+	pStats->fP99	= GetPercentile( 0.99f, fMax );
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetFrameHistory () 
+// Desc : Copies up to nMaxTimes of the latest frame times (seconds), oldest
+//		first, and returns how many were copied.
+//-----------------------------------------------------------------------------
+ULONG CTimer::GetFrameHistory( float *pTimes, ULONG nMaxTimes ) const
+{
+	ULONG nTimes = min( nMaxTimes, m_HistoryCount );
+	ULONG iFirst = (m_HistoryNext + MAX_HISTORY_COUNT - nTimes) % MAX_HISTORY_COUNT;
+
+	for ( ULONG i = 0; i < nTimes; i++ ) pTimes[ i ] = m_History[ (iFirst + i) % MAX_HISTORY_COUNT ];
+
+	return nTimes;
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddSample () (Private)
+// Desc : Adds a frame to the averaged ring, replacing the oldest one once it
+//		is full, and keeps the running sums up to date.
+//-----------------------------------------------------------------------------
+void CTimer::AddSample( float fFrameTime )
+{
+	if ( m_SampleCount == MAX_SAMPLE_COUNT )
+	{
+		double fOldest = m_FrameTime[ m_SampleNext ];
+		m_SampleSum		-= fOldest;
+		m_SampleSumSq	-= fOldest * fOldest;
+	}
+	else m_SampleCount++;
+
+	m_FrameTime[ m_SampleNext ] = fFrameTime;
+	m_SampleSum		+= fFrameTime;
+	m_SampleSumSq	+= (double)fFrameTime * fFrameTime;
+	m_SampleNext	= (m_SampleNext + 1) % MAX_SAMPLE_COUNT;
+}
+
+//-----------------------------------------------------------------------------
+// Name : HistogramBucket ()
+// Desc : Histogram bucket of a frame time, the last one holds all the long
+//		frames.
+//-----------------------------------------------------------------------------
+static ULONG HistogramBucket( float fFrameTime )
+{
+	if ( fFrameTime <= 0.0f ) return 0;
+	return min( (ULONG)(fFrameTime / HISTOGRAM_RESOLUTION), HISTOGRAM_BUCKETS );
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddHistory () (Private)
+// Desc : Adds a frame to the statistics window.
+//-----------------------------------------------------------------------------
+void CTimer::AddHistory( float fFrameTime, bool bStutter )
+{
+	while ( m_HistoryCount >= m_StatsWindow ) DropOldestHistory();
+
+	m_History[ m_HistoryNext ]	= fFrameTime;
+	m_Stutter[ m_HistoryNext ]	= bStutter;
+	m_HistoryNext = (m_HistoryNext + 1) % MAX_HISTORY_COUNT;
+	m_HistoryCount++;
+
+	m_Histogram[ HistogramBucket( fFrameTime ) ]++;
+	if ( bStutter )
+	{
+		m_StutterCount++;
+		m_TotalStutters++;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : DropOldestHistory () (Private)
+// Desc : Takes the oldest frame out of the statistics window.
+//-----------------------------------------------------------------------------
+void CTimer::DropOldestHistory()
+{
+	if ( m_HistoryCount == 0 ) return;
+
+	ULONG iOldest = (m_HistoryNext + MAX_HISTORY_COUNT - m_HistoryCount) % MAX_HISTORY_COUNT;
+	m_Histogram[ HistogramBucket( m_History[ iOldest ] ) ]--;
+	if ( m_Stutter[ iOldest ] ) m_StutterCount--;
+	m_HistoryCount--;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetPercentile () (Private)
+// Desc : Walks the histogram to the bucket holding the nearest-rank
+//		percentile and returns its upper edge, or fMax past the last one.
+//-----------------------------------------------------------------------------
+float CTimer::GetPercentile( float fFraction, float fMax ) const
+{
+	// The small bias keeps float fractions such as 0.99f from rounding up
+	ULONG nRank = (ULONG)ceil( (double)fFraction * m_HistoryCount - 0.001 );
+	if ( nRank < 1 ) nRank = 1;
+
+	ULONG nCount = 0;
+	for ( ULONG i = 0; i < HISTOGRAM_BUCKETS; i++ )
+	{
+		nCount += m_Histogram[ i ];
+		if ( nCount >= nRank ) return min( (i + 1) * HISTOGRAM_RESOLUTION, fMax );
+	}
+
+	return fMax;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ReadCounter () (Private)
+// Desc : Reads the performance counter, or timeGetTime without one.
+//-----------------------------------------------------------------------------
+__int64 CTimer::ReadCounter() const
+{
+	__int64 nTime;
+
+	// Is performance hardware available?
+	if ( m_PerfHardware ) 
+	{
+		// Query high-resolution performance hardware
+		QueryPerformanceCounter((LARGE_INTEGER *)&nTime);
+	} 
+	else 
+	{
+		// Fall back to less accurate timer
+		nTime = timeGetTime();
+
+	} // End If no hardware available
+
+	return nTime;
+}
+
+__int64 CTimer::ReadCpuTime() const
+{
+	FILETIME ftCreation, ftExit, ftKernel, ftUser;
+	if ( !GetProcessTimes( GetCurrentProcess(), &ftCreation, &ftExit, &ftKernel, &ftUser ) ) return 0;
+
+	ULARGE_INTEGER nKernel, nUser;
+	nKernel.LowPart		= ftKernel.dwLowDateTime;
+	nKernel.HighPart	= ftKernel.dwHighDateTime;
+	nUser.LowPart		= ftUser.dwLowDateTime;
+	nUser.HighPart		= ftUser.dwHighDateTime;
+
+	return (__int64)(nKernel.QuadPart + nUser.QuadPart);
+}
+
+//-----------------------------------------------------------------------------
+// Name : WaitForFrame () (Private)
+// Desc : Waits until fFrameTime seconds have passed since the last frame.
+//		Most of the time is slept away, only the last stretch is spent
+//		spinning on the counter. The spin is sized from how late recent
+//		sleeps woke up, so a precise timer leaves almost nothing to spin.
+//-----------------------------------------------------------------------------
+void CTimer::WaitForFrame( float fFrameTime )
+{
+	PROFILE_FUNCTION();
+
+	float fSpin = min( max( m_SleepError * 2.0f, MIN_SPIN_TIME ), MAX_SPIN_TIME );
+	float fSleep = fFrameTime - (ReadCounter() - m_LastTime) * m_TimeScale - fSpin;
+
+	if ( fSleep > 0.0f )
+	{
+		__int64 nStart = ReadCounter();
+
+		if ( m_hWaitTimer )
+		{
+			// Relative due time, in 100ns units
+			LARGE_INTEGER DueTime;
+			DueTime.QuadPart = -(LONGLONG)(fSleep * 1e7f);
+			if ( SetWaitableTimer( m_hWaitTimer, &DueTime, 0, NULL, NULL, FALSE ) )
+				WaitForSingleObject( m_hWaitTimer, INFINITE );
+		}
+		else
+		{
+			Sleep( (DWORD)(fSleep * 1000.0f) );
+		}
+
+		// Track the oversleep, a quick rise and a slow decay
+		float fLate = (ReadCounter() - nStart) * m_TimeScale - fSleep;
+		if ( fLate > m_SleepError )	m_SleepError += (fLate - m_SleepError) * 0.5f;
+		else						m_SleepError += (max( fLate, 0.0f ) - m_SleepError) * 0.05f;
+
+	} // End If time left to sleep
+
+	// Spin away the rest
+	while ( (ReadCounter() - m_LastTime) * m_TimeScale < fFrameTime )
+		YieldProcessor();
+}
@@ -0,0 +1,139 @@
+//-----------------------------------------------------------------------------
+// File: CollisionMask.cpp
+//
+// Desc: One bit per pixel collision masks. A mask is built once when an
+//		image is loaded, a set bit for every pixel that is drawn, and packed
+//		64 pixels to a word so two sprites are tested 64 pixels at a time.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CCollisionMask Specific Includes
+//-----------------------------------------------------------------------------
+#include "CollisionMask.h"
+
+//-----------------------------------------------------------------------------
+// CCollisionMask Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CCollisionMask () (Constructor)
+// Desc : CCollisionMask Class Constructor
+//-----------------------------------------------------------------------------
+CCollisionMask::CCollisionMask()
+{
+	m_pBits		= NULL;
+	m_nWidth	= 0;
+	m_nHeight	= 0;
+	m_nWords	= 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CCollisionMask () (Destructor)
+// Desc : CCollisionMask Class Destructor
+//-----------------------------------------------------------------------------
+CCollisionMask::~CCollisionMask()
+{
+	Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Build ()
+// Desc : Packs the solid pixels of an image into bits.
+//-----------------------------------------------------------------------------
+bool CCollisionMask::Build(const DWORD *pPixels, int nPitch, int nWidth, int nHeight)
+{
+	Release();
+	if(!pPixels || nWidth <= 0 || nHeight <= 0)
+		return false;
+
+	m_nWidth	= nWidth;
+	m_nHeight	= nHeight;
+	m_nWords	= (nWidth + 63) >> 6;
+	m_pBits		= new ULONGLONG[m_nWords * nHeight];
+	ZeroMemory(m_pBits, m_nWords * nHeight * sizeof(ULONGLONG));
+
+	for(int y = 0; y < nHeight; y++)
+	{
+		const DWORD *pRow	= pPixels + y * nPitch;
+		ULONGLONG *pBits	= m_pBits + y * m_nWords;
+
+		for(int x = 0; x < nWidth; x++)
+		{
+			if((pRow[x] >> 24) >= (DWORD)COLLISION_ALPHA_THRESHOLD)
+				pBits[x >> 6] |= (ULONGLONG)1 << (x & 63);
+		}
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Frees the bits, the mask is empty afterwards.
+//-----------------------------------------------------------------------------
+void CCollisionMask::Release()
+{
+	delete []m_pBits;
+	m_pBits		= NULL;
+	m_nWidth	= 0;
+	m_nHeight	= 0;
+	m_nWords	= 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Extract () (Private)
+// Desc : Returns the 64 pixels of a row starting at nColumn, as if the row
+//		began there. Pixels past the end of the row read as clear.
+//-----------------------------------------------------------------------------
+ULONGLONG CCollisionMask::Extract(int nRow, int nColumn) const
+{
+	const ULONGLONG *pRow = m_pBits + nRow * m_nWords;
+	int iWord	= nColumn >> 6;
+	int nShift	= nColumn & 63;
+
+	ULONGLONG nBits = pRow[iWord] >> nShift;
+	if(nShift && iWord + 1 < m_nWords)
+		nBits |= pRow[iWord + 1] << (64 - nShift);
+
+	return nBits;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Overlap () (Static)
+// Desc : Works out the screen rectangle both frames cover, then walks its
+//		rows, lining each mask up with the rectangle's left edge and
+//		ANDing 64 columns at a time. Stops at the first shared pixel.
+//-----------------------------------------------------------------------------
+bool CCollisionMask::Overlap(const CCollisionMask &A, const RECT &rcA, int nAX, int nAY,
+							 const CCollisionMask &B, const RECT &rcB, int nBX, int nBY)
+{
+	assert(rcA.left >= 0 && rcA.top >= 0 && rcA.right <= A.m_nWidth && rcA.bottom <= A.m_nHeight);
+	assert(rcB.left >= 0 && rcB.top >= 0 && rcB.right <= B.m_nWidth && rcB.bottom <= B.m_nHeight);
+
+	int nLeft	= max(nAX, nBX);
+	int nTop	= max(nAY, nBY);
+	int nRight	= min(nAX + (int)(rcA.right - rcA.left), nBX + (int)(rcB.right - rcB.left));
+	int nBottom	= min(nAY + (int)(rcA.bottom - rcA.top), nBY + (int)(rcB.bottom - rcB.top));
+	if(nLeft >= nRight || nTop >= nBottom)
+		return false;
+
+	// Where the shared rectangle starts inside each mask
+	int nColumnA	= rcA.left + nLeft - nAX;
+	int nRowA		= rcA.top + nTop - nAY;
+	int nColumnB	= rcB.left + nLeft - nBX;
+	int nRowB		= rcB.top + nTop - nBY;
+	int nWidth		= nRight - nLeft;
+
+	for(int y = 0; y < nBottom - nTop; y++)
+	{
+		for(int x = 0; x < nWidth; x += 64)
+		{
+			// A frame of a sheet must not pick up its neighbour's pixels
+			ULONGLONG nKeep = nWidth - x >= 64 ? ~(ULONGLONG)0 : ((ULONGLONG)1 << (nWidth - x)) - 1;
+			if(A.Extract(nRowA + y, nColumnA + x) & B.Extract(nRowB + y, nColumnB + x) & nKeep)
+				return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,344 @@
+//-----------------------------------------------------------------------------
+// File: EntityStore.cpp
+//
+// Desc: Storage for the game's many small objects (enemies and their
+//		explosions). Every field lives in its own packed array, so one pass
+//		over the store updates all of them.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CEntityStore Specific Includes
+//-----------------------------------------------------------------------------
+#include "EntityStore.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+#include "VecMath.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int	BENCHMARK_SIZES[]		= { 100, 1000, 10000, 100000 };
+const int	BENCHMARK_UPDATES		= 4000000;	// Entity updates timed per size
+const float	BENCHMARK_TIME_STEP		= 1.0f / 60.0f;
+
+//-----------------------------------------------------------------------------
+// CEntityStore Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CEntityStore () (Constructor)
+// Desc : CEntityStore Class Constructor
+//-----------------------------------------------------------------------------
+CEntityStore::CEntityStore(int nCapacity, CAnimator *pAnimator)
+{
+	assert(nCapacity > 0);
+
+	m_pAnimator		= pAnimator;
+	m_nSprites		= 0;
+	m_nCapacity		= nCapacity;
+	m_nCount		= 0;
+
+	m_pPosX			= new float[nCapacity];
+	m_pPosY			= new float[nCapacity];
+	m_pPrevX		= new float[nCapacity];
+	m_pPrevY		= new float[nCapacity];
+	m_pVelX			= new float[nCapacity];
+	m_pVelY			= new float[nCapacity];
+	m_pLifetime		= new float[nCapacity];
+	m_pSprite		= new UCHAR[nCapacity];
+	m_pState		= new UCHAR[nCapacity];
+	m_pAnim			= new int[nCapacity];
+
+	ZeroMemory(m_pSprites, sizeof(m_pSprites));
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CEntityStore () (Destructor)
+// Desc : CEntityStore Class Destructor
+//-----------------------------------------------------------------------------
+CEntityStore::~CEntityStore()
+{
+	Clear();
+
+	delete []m_pPosX;
+	delete []m_pPosY;
+	delete []m_pPrevX;
+	delete []m_pPrevY;
+	delete []m_pVelX;
+	delete []m_pVelY;
+	delete []m_pLifetime;
+	delete []m_pSprite;
+	delete []m_pState;
+	delete []m_pAnim;
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddSprite ()
+// Desc : Registers a sprite entities can be drawn with, returns its id. The
+//		same sprite added twice gets the same id.
+//-----------------------------------------------------------------------------
+int CEntityStore::AddSprite(Sprite *pSprite)
+{
+	for(int i = 0; i < m_nSprites; i++)
+		if(m_pSprites[i] == pSprite)
+			return i;
+
+	if(m_nSprites >= MAX_ENTITY_SPRITES)
+		return -1;
+
+	m_pSprites[m_nSprites] = pSprite;
+	return m_nSprites++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Create ()
+// Desc : Adds an entity at the end of the arrays.
+//-----------------------------------------------------------------------------
+int CEntityStore::Create(EEntityState eState, int iSprite, float fX, float fY, float fVelX, float fVelY, float fLifetime)
+{
+	assert(iSprite >= 0 && iSprite < m_nSprites);
+	if(m_nCount >= m_nCapacity)
+		return -1;
+
+	int i = m_nCount++;
+
+	m_pPosX[i]		= fX;
+	m_pPosY[i]		= fY;
+	m_pPrevX[i]		= fX;
+	m_pPrevY[i]		= fY;
+	m_pVelX[i]		= fVelX;
+	m_pVelY[i]		= fVelY;
+	m_pLifetime[i]	= fLifetime;
+	m_pSprite[i]	= (UCHAR)iSprite;
+	m_pState[i]		= (UCHAR)eState;
+	m_pAnim[i]		= -1;
+
+	return i;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DestroyAt ()
+// Desc : Removes the entity at an index and moves the last entity into the
+//		hole. A loop over the indices that destroys as it goes should not
+//		advance past the index it just destroyed.
+//-----------------------------------------------------------------------------
+void CEntityStore::DestroyAt(int iIndex)
+{
+	assert(iIndex >= 0 && iIndex < m_nCount);
+
+	if(m_pAnimator && m_pAnim[iIndex] >= 0)
+		m_pAnimator->Stop(m_pAnim[iIndex]);
+
+	int iLast = --m_nCount;
+	if(iIndex != iLast)
+	{
+		m_pPosX[iIndex]		= m_pPosX[iLast];
+		m_pPosY[iIndex]		= m_pPosY[iLast];
+		m_pPrevX[iIndex]	= m_pPrevX[iLast];
+		m_pPrevY[iIndex]	= m_pPrevY[iLast];
+		m_pVelX[iIndex]		= m_pVelX[iLast];
+		m_pVelY[iIndex]		= m_pVelY[iLast];
+		m_pLifetime[iIndex]	= m_pLifetime[iLast];
+		m_pSprite[iIndex]	= m_pSprite[iLast];
+		m_pState[iIndex]	= m_pState[iLast];
+		m_pAnim[iIndex]		= m_pAnim[iLast];
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : Clear ()
+// Desc : Destroys every entity.
+//-----------------------------------------------------------------------------
+void CEntityStore::Clear()
+{
+	while(m_nCount > 0)
+		DestroyAt(m_nCount - 1);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Update ()
+// Desc : Integrates every position in one pass over the packed arrays, then
+//		counts down the lifetimes and removes the entities that ran out.
+//		The old positions are kept for drawing between updates.
+//-----------------------------------------------------------------------------
+void CEntityStore::Update(float dt)
+{
+	PROFILE_FUNCTION();
+
+	Integrate(0, m_nCount, dt);
+	Age(dt);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Integrate ()
+// Desc : Moves entities iBegin to iEnd - 1, keeping where they were.
+//-----------------------------------------------------------------------------
+void CEntityStore::Integrate(int iBegin, int iEnd, float dt)
+{
+	if(iEnd <= iBegin)
+		return;
+
+	memcpy(&m_pPrevX[iBegin], &m_pPosX[iBegin], (iEnd - iBegin) * sizeof(float));
+	memcpy(&m_pPrevY[iBegin], &m_pPosY[iBegin], (iEnd - iBegin) * sizeof(float));
+	IntegrateMany(&m_pPosX[iBegin], &m_pPosY[iBegin], &m_pVelX[iBegin], &m_pVelY[iBegin], dt, iEnd - iBegin);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Age ()
+// Desc : Counts the lifetimes down and destroys the entities that run out.
+//-----------------------------------------------------------------------------
+void CEntityStore::Age(float dt)
+{
+	for(int i = 0; i < m_nCount; )
+	{
+		if(m_pLifetime[i] > 0.0f)
+		{
+			m_pLifetime[i] -= dt;
+			if(m_pLifetime[i] <= 0.0f)
+			{
+				// the last entity is moved into i, so do not advance
+				DestroyAt(i);
+				continue;
+			}
+		}
+		i++;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : Record ()
+// Desc : Records every entity into a frame packet. Entities whose animation
+//		has already ended are left out, and so is anything past the packet's
+//		command limit.
+//-----------------------------------------------------------------------------
+void CEntityStore::Record(sFramePacket *pFrame, float fAlpha) const
+{
+	float fBack = 1.0f - fAlpha;
+	for(int i = 0; i < m_nCount && pFrame->nCommands < MAX_DRAW_COMMANDS; i++)
+	{
+		int iFrame = -1;
+		if(m_pAnim[i] >= 0)
+		{
+			iFrame = m_pAnimator ? m_pAnimator->GetFrame(m_pAnim[i]) : -1;
+			if(iFrame < 0)
+				continue;
+		}
+
+		AddDrawCommand(pFrame, m_pSprites[m_pSprite[i]], m_pPosX[i] - (m_pPosX[i] - m_pPrevX[i]) * fBack,
+					   m_pPosY[i] - (m_pPosY[i] - m_pPrevY[i]) * fBack, iFrame);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Entity Benchmark
+//-----------------------------------------------------------------------------
+// One heap object per entity, the way CPlayer kept each plane and missile
+typedef struct
+{
+	Vec2	Position;
+	Vec2	Velocity;
+	float	fLifetime;
+} sBenchObject;
+
+//-----------------------------------------------------------------------------
+// Name : TimeStore ()
+// Desc : Runs update passes over nCount entities, replacing the expired ones
+//		so the count stays the same. Returns nanoseconds per entity update.
+//-----------------------------------------------------------------------------
+static double TimeStore(int nCount, int nPasses)
+{
+	CEntityStore Store(nCount);
+	ULONG nSeed = 1;
+	__int64 nStart, nEnd;
+
+	// Nothing is drawn, the entities need no sprite
+	int iSprite = Store.AddSprite(NULL);
+
+	nStart = BenchTime();
+	for(int nPass = 0; nPass < nPasses; nPass++)
+	{
+		while(Store.GetCount() < nCount)
+			Store.Create(ENTITY_ENEMY, iSprite, BenchRandom(nSeed) * 1280.0f, BenchRandom(nSeed) * 720.0f,
+						 BenchRandom(nSeed) * 200.0f - 100.0f, BenchRandom(nSeed) * 200.0f - 100.0f,
+						 0.5f + BenchRandom(nSeed) * 4.5f);
+		Store.Update(BENCHMARK_TIME_STEP);
+	}
+	nEnd = BenchTime();
+
+	return BenchSeconds(nStart, nEnd) * 1e9 / ((double)nCount * nPasses);
+}
+
+//-----------------------------------------------------------------------------
+// Name : TimeObjects ()
+// Desc : The same work with one heap object per entity. Expired objects are
+//		deleted and allocated again, as the game did with new and delete.
+//-----------------------------------------------------------------------------
+static double TimeObjects(int nCount, int nPasses)
+{
+	sBenchObject **ppObjects = new sBenchObject*[nCount];
+	ULONG nSeed = 1;
+	__int64 nStart, nEnd;
+
+	for(int i = 0; i < nCount; i++)
+		ppObjects[i] = NULL;
+
+	nStart = BenchTime();
+	for(int nPass = 0; nPass < nPasses; nPass++)
+	{
+		for(int i = 0; i < nCount; i++)
+		{
+			if(!ppObjects[i])
+			{
+				ppObjects[i] = new sBenchObject;
+				ppObjects[i]->Position	= Vec2(BenchRandom(nSeed) * 1280.0, BenchRandom(nSeed) * 720.0);
+				ppObjects[i]->Velocity	= Vec2(BenchRandom(nSeed) * 200.0 - 100.0, BenchRandom(nSeed) * 200.0 - 100.0);
+				ppObjects[i]->fLifetime	= 0.5f + BenchRandom(nSeed) * 4.5f;
+			}
+		}
+
+		for(int i = 0; i < nCount; i++)
+		{
+			sBenchObject *pObject = ppObjects[i];
+			pObject->Position += pObject->Velocity * BENCHMARK_TIME_STEP;
+			pObject->fLifetime -= BENCHMARK_TIME_STEP;
+			if(pObject->fLifetime <= 0.0f)
+			{
+				delete pObject;
+				ppObjects[i] = NULL;
+			}
+		}
+	}
+	nEnd = BenchTime();
+
+	for(int i = 0; i < nCount; i++)
+		delete ppObjects[i];
+	delete []ppObjects;
+
+	return BenchSeconds(nStart, nEnd) * 1e9 / ((double)nCount * nPasses);
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunEntityBenchmark ()
+// Desc : Writes the cost of one entity update for each size, with the store
+//		and with separate objects.
+//-----------------------------------------------------------------------------
+bool RunEntityBenchmark(LPCSTR strFileName)
+{
+	FILE *pFile = BenchOpen(strFileName);
+	if(!pFile)
+		return false;
+
+	fprintf(pFile, "entities  passes  store ns  objects ns  speed-up\n");
+	for(int i = 0; i < (int)(sizeof(BENCHMARK_SIZES) / sizeof(BENCHMARK_SIZES[0])); i++)
+	{
+		int nCount	= BENCHMARK_SIZES[i];
+		int nPasses	= BENCHMARK_UPDATES / nCount;
+
+		double fStore	= TimeStore(nCount, nPasses);
+		double fObjects	= TimeObjects(nCount, nPasses);
+
+		fprintf(pFile, "%8d  %6d  %8.2f  %10.2f  %7.2fx\n", nCount, nPasses, fStore, fObjects, fObjects / fStore);
+	}
+
+	return BenchClose(pFile);
+}
@@ -0,0 +1,343 @@
+//-----------------------------------------------------------------------------
+// File: FrameCapture.cpp
+//
+// Desc: Records presented frames to a Y4M or raw YUV 4:2:0 video file. The
+//		game only copies each frame into a ring of preallocated buffers, a
+//		writer thread converts and writes them.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CFrameCapture Specific Includes
+//-----------------------------------------------------------------------------
+#include "FrameCapture.h"
+#include "Simd.h"
+#include "Profiler.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+// BT.601 limited range, 8 bit fixed point. The chroma offset folds the +128
+// bias and the rounding into one positive constant so that a logical shift
+// gives the same result as an arithmetic one.
+const int Y_R = 66,  Y_G = 129, Y_B = 25;
+const int U_R = -38, U_G = -74, U_B = 112;
+const int V_R = 112, V_G = -94, V_B = -18;
+const int CHROMA_BIAS = (128 << 8) + 128;
+
+//-----------------------------------------------------------------------------
+// Scalar Conversion
+//-----------------------------------------------------------------------------
+// The reference implementation, also used for the pixels left over by the
+// SIMD loop, so both must produce identical results.
+static inline BYTE LumaOf(DWORD c)
+{
+	int r = (c >> 16) & 0xFF, g = (c >> 8) & 0xFF, b = c & 0xFF;
+	return (BYTE)(((Y_R * r + Y_G * g + Y_B * b + 128) >> 8) + 16);
+}
+
+// Rounds up like the SSE2 byte average
+static inline int Avg(int a, int b)
+{
+	return (a + b + 1) >> 1;
+}
+
+static void ConvertRowsScalar(const DWORD *pRow0, const DWORD *pRow1, int iFirst, int iWidth,
+							  BYTE *pY0, BYTE *pY1, BYTE *pU, BYTE *pV)
+{
+	for(int x = iFirst; x < iWidth; x += 2)
+	{
+		pY0[x]		= LumaOf(pRow0[x]);
+		pY0[x + 1]	= LumaOf(pRow0[x + 1]);
+		pY1[x]		= LumaOf(pRow1[x]);
+		pY1[x + 1]	= LumaOf(pRow1[x + 1]);
+
+		// Average the 2 x 2 block, rows first
+		int c[3];
+		for(int i = 0; i < 3; i++)
+		{
+			int iShift = i * 8;
+			int a = Avg((pRow0[x] >> iShift) & 0xFF, (pRow1[x] >> iShift) & 0xFF);
+			int b = Avg((pRow0[x + 1] >> iShift) & 0xFF, (pRow1[x + 1] >> iShift) & 0xFF);
+			c[i] = Avg(a, b);
+		}
+
+		pU[x >> 1] = (BYTE)((U_R * c[2] + U_G * c[1] + U_B * c[0] + CHROMA_BIAS) >> 8);
+		pV[x >> 1] = (BYTE)((V_R * c[2] + V_G * c[1] + V_B * c[0] + CHROMA_BIAS) >> 8);
+	}
+}
+
+#if defined(SIMD_SSE2)
+//-----------------------------------------------------------------------------
+// SSE2 Conversion
+//-----------------------------------------------------------------------------
+// Weighted sum of the colour channels of 4 pixels, one 32 bit result each.
+// The pixel bytes are widened to 16 bits so madd forms B*wb + G*wg and
+// R*wr + 0 per pixel, then the two halves of each pixel are added.
+static inline __m128i Dot4(__m128i px, __m128i vWeights)
+{
+	__m128i zero	= _mm_setzero_si128();
+	__m128i lo		= _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), vWeights);
+	__m128i hi		= _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), vWeights);
+	lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+	hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+	return _mm_unpacklo_epi64(_mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 3, 2, 0)),
+							  _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 3, 2, 0)));
+}
+
+static inline __m128i Luma4(__m128i px)
+{
+	const __m128i vWeights	= _mm_set_epi16(0, Y_R, Y_G, Y_B, 0, Y_R, Y_G, Y_B);
+	__m128i y = _mm_srli_epi32(_mm_add_epi32(Dot4(px, vWeights), _mm_set1_epi32(128)), 8);
+	return _mm_add_epi32(y, _mm_set1_epi32(16));
+}
+
+// Averages each horizontal pair of 4 pixels into dwords 0 and 2
+static inline __m128i PairAverage(__m128i r0, __m128i r1)
+{
+	__m128i v = _mm_avg_epu8(r0, r1);
+	return _mm_avg_epu8(v, _mm_srli_epi64(v, 32));
+}
+
+static void ConvertRowsSSE2(const DWORD *pRow0, const DWORD *pRow1, int iWidth,
+							BYTE *pY0, BYTE *pY1, BYTE *pU, BYTE *pV)
+{
+	const __m128i vWeightsU	= _mm_set_epi16(0, U_R, U_G, U_B, 0, U_R, U_G, U_B);
+	const __m128i vWeightsV	= _mm_set_epi16(0, V_R, V_G, V_B, 0, V_R, V_G, V_B);
+	const __m128i vBias		= _mm_set1_epi32(CHROMA_BIAS);
+
+	int x = 0;
+	for(; x + 8 <= iWidth; x += 8)
+	{
+		__m128i a0 = _mm_loadu_si128((const __m128i*)&pRow0[x]);
+		__m128i b0 = _mm_loadu_si128((const __m128i*)&pRow0[x + 4]);
+		__m128i a1 = _mm_loadu_si128((const __m128i*)&pRow1[x]);
+		__m128i b1 = _mm_loadu_si128((const __m128i*)&pRow1[x + 4]);
+
+		__m128i y0 = _mm_packs_epi32(Luma4(a0), Luma4(b0));
+		__m128i y1 = _mm_packs_epi32(Luma4(a1), Luma4(b1));
+		_mm_storel_epi64((__m128i*)&pY0[x], _mm_packus_epi16(y0, y0));
+		_mm_storel_epi64((__m128i*)&pY1[x], _mm_packus_epi16(y1, y1));
+
+		// Four 2 x 2 block averages, then both chroma planes at once
+		__m128i ca = PairAverage(a0, a1);
+		__m128i cb = PairAverage(b0, b1);
+		__m128i c  = _mm_unpacklo_epi64(_mm_shuffle_epi32(ca, _MM_SHUFFLE(3, 3, 2, 0)),
+										_mm_shuffle_epi32(cb, _MM_SHUFFLE(3, 3, 2, 0)));
+
+		__m128i u  = _mm_srli_epi32(_mm_add_epi32(Dot4(c, vWeightsU), vBias), 8);
+		__m128i v  = _mm_srli_epi32(_mm_add_epi32(Dot4(c, vWeightsV), vBias), 8);
+		__m128i uv = _mm_packs_epi32(u, v);
+		uv = _mm_packus_epi16(uv, uv);
+
+		*(int*)&pU[x >> 1] = _mm_cvtsi128_si32(uv);
+		*(int*)&pV[x >> 1] = _mm_cvtsi128_si32(_mm_srli_si128(uv, 4));
+	}
+
+	ConvertRowsScalar(pRow0, pRow1, x, iWidth, pY0, pY1, pU, pV);
+}
+#endif // SIMD_SSE2
+
+//-----------------------------------------------------------------------------
+// Name : ConvertToI420 ()
+// Desc : Converts two rows at a time, since each chroma sample covers a
+//		2 x 2 block of pixels.
+//-----------------------------------------------------------------------------
+void ConvertToI420(const DWORD *pSrc, int iPitch, int iWidth, int iHeight,
+				   BYTE *pY, BYTE *pU, BYTE *pV)
+{
+	for(int y = 0; y < iHeight; y += 2)
+	{
+		const DWORD *pRow0 = pSrc + y * iPitch;
+		const DWORD *pRow1 = pRow0 + iPitch;
+		BYTE *pY0 = pY + y * iWidth;
+		BYTE *pU0 = pU + (y >> 1) * (iWidth >> 1);
+		BYTE *pV0 = pV + (y >> 1) * (iWidth >> 1);
+
+#if defined(SIMD_SSE2)
+		ConvertRowsSSE2(pRow0, pRow1, iWidth, pY0, pY0 + iWidth, pU0, pV0);
+#else
+		ConvertRowsScalar(pRow0, pRow1, 0, iWidth, pY0, pY0 + iWidth, pU0, pV0);
+#endif
+	}
+}
+
+//-----------------------------------------------------------------------------
+// CFrameCapture Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CFrameCapture () (Constructor)
+// Desc : CFrameCapture Class Constructor
+//-----------------------------------------------------------------------------
+CFrameCapture::CFrameCapture()
+{
+	m_pFile			= NULL;
+	m_eFormat		= CAPTURE_Y4M;
+	m_iWidth		= 0;
+	m_iHeight		= 0;
+	m_pYUV			= NULL;
+	m_hThread		= NULL;
+	m_hWakeEvent	= NULL;
+	m_lWritten		= 0;
+	m_lRead			= 0;
+	m_lDropped		= 0;
+	m_lQuit			= 0;
+
+	for(int i = 0; i < CAPTURE_RING_SIZE; i++)
+		m_pSlots[i] = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CFrameCapture () (Destructor)
+// Desc : CFrameCapture Class Destructor
+//-----------------------------------------------------------------------------
+CFrameCapture::~CFrameCapture()
+{
+	Stop();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Start ()
+// Desc : Opens the file, allocates every buffer up front and starts the
+//		writer thread. Odd sizes lose their last row or column.
+//-----------------------------------------------------------------------------
+bool CFrameCapture::Start(LPCSTR strFileName, ECaptureFormat eFormat, int iWidth, int iHeight, int iFrameRate)
+{
+	Stop();
+
+	m_eFormat	= eFormat;
+	m_iWidth	= iWidth & ~1;
+	m_iHeight	= iHeight & ~1;
+	if(m_iWidth <= 0 || m_iHeight <= 0)
+		return false;
+
+	if(fopen_s(&m_pFile, strFileName, "wb") != 0 || !m_pFile)
+	{
+		m_pFile = NULL;
+		return false;
+	}
+
+	if(m_eFormat == CAPTURE_Y4M)
+		fprintf(m_pFile, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n", m_iWidth, m_iHeight, iFrameRate);
+
+	for(int i = 0; i < CAPTURE_RING_SIZE; i++)
+		m_pSlots[i] = new DWORD[m_iWidth * m_iHeight];
+	m_pYUV = new BYTE[m_iWidth * m_iHeight * 3 / 2];
+
+	m_lWritten		= 0;
+	m_lRead			= 0;
+	m_lDropped		= 0;
+	m_lQuit			= 0;
+	m_hWakeEvent	= CreateEvent(NULL, FALSE, FALSE, NULL);
+	m_hThread		= m_hWakeEvent ? CreateThread(NULL, 0, WriterThreadProc, this, 0, NULL) : NULL;
+
+	if(!m_hThread)
+	{
+		Stop();
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Stop ()
+// Desc : Lets the writer finish the queued frames, then closes the file.
+//-----------------------------------------------------------------------------
+void CFrameCapture::Stop()
+{
+	if(m_hThread)
+	{
+		InterlockedExchange(&m_lQuit, 1);
+		SetEvent(m_hWakeEvent);
+		WaitForSingleObject(m_hThread, INFINITE);
+		CloseHandle(m_hThread);
+		m_hThread = NULL;
+	}
+
+	if(m_hWakeEvent) CloseHandle(m_hWakeEvent);
+	m_hWakeEvent = NULL;
+
+	if(m_pFile) fclose(m_pFile);
+	m_pFile = NULL;
+
+	for(int i = 0; i < CAPTURE_RING_SIZE; i++)
+	{
+		delete []m_pSlots[i];
+		m_pSlots[i] = NULL;
+	}
+
+	delete []m_pYUV;
+	m_pYUV = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Submit ()
+// Desc : Copies a frame into the next free slot. Called from the thread that
+//		presents; it never waits for the writer. Frames smaller than the
+//		capture size (after the window shrinks) are dropped too.
+//-----------------------------------------------------------------------------
+void CFrameCapture::Submit(const DWORD *pBits, int iWidth, int iHeight, int iPitch)
+{
+	if(!m_hThread)
+		return;
+
+	// Every slot is still waiting to be written
+	if(m_lWritten - m_lRead >= CAPTURE_RING_SIZE || iWidth < m_iWidth || iHeight < m_iHeight)
+	{
+		InterlockedIncrement(&m_lDropped);
+		return;
+	}
+
+	DWORD *pSlot = m_pSlots[m_lWritten % CAPTURE_RING_SIZE];
+	for(int y = 0; y < m_iHeight; y++)
+		memcpy(pSlot + y * m_iWidth, pBits + y * iPitch, m_iWidth * sizeof(DWORD));
+
+	// The increment is a full barrier, the slot is complete before it is queued
+	InterlockedIncrement(&m_lWritten);
+	SetEvent(m_hWakeEvent);
+}
+
+//-----------------------------------------------------------------------------
+// Name : WritePending () (Private)
+// Desc : Converts and writes every queued frame, oldest first.
+//-----------------------------------------------------------------------------
+void CFrameCapture::WritePending()
+{
+	int iLumaSize = m_iWidth * m_iHeight;
+
+	while(m_lRead != m_lWritten)
+	{
+		PROFILE_ZONE("WriteCaptureFrame");
+
+		ConvertToI420(m_pSlots[m_lRead % CAPTURE_RING_SIZE], m_iWidth, m_iWidth, m_iHeight,
+					  m_pYUV, m_pYUV + iLumaSize, m_pYUV + iLumaSize + iLumaSize / 4);
+
+		if(m_eFormat == CAPTURE_Y4M)
+			fputs("FRAME\n", m_pFile);
+		fwrite(m_pYUV, 1, iLumaSize * 3 / 2, m_pFile);
+
+		// Hands the slot back to Submit
+		InterlockedIncrement(&m_lRead);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : WriterThreadProc () (Static, Private)
+// Desc : Sleeps until frames are queued. On Stop it writes what is left.
+//-----------------------------------------------------------------------------
+DWORD WINAPI CFrameCapture::WriterThreadProc(LPVOID pParam)
+{
+	CFrameCapture *pCapture = (CFrameCapture*)pParam;
+
+	PROFILE_THREAD_NAME("Capture writer");
+
+	while(true)
+	{
+		WaitForSingleObject(pCapture->m_hWakeEvent, INFINITE);
+		pCapture->WritePending();
+		if(pCapture->m_lQuit) break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------
+// File: FramePipeline.cpp
+//
+// Desc: Hand-off between the simulation and the renderer. The simulation
+//		describes each frame as a packet of draw commands and the renderer
+//		draws from the newest complete packet, so both can run on separate
+//		threads without sharing any mutable game state.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CFrameExchange Specific Includes
+//-----------------------------------------------------------------------------
+#include "FramePipeline.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const LONG FRAME_INDEX_MASK	= 0x3;
+const LONG FRESH_FRAME		= 0x4;		// Set in m_Latest until the consumer takes it
+
+//-----------------------------------------------------------------------------
+// Name : AddDrawCommand ()
+// Desc : Appends a sprite draw, commands past MAX_DRAW_COMMANDS are dropped.
+//-----------------------------------------------------------------------------
+void AddDrawCommand(sFramePacket *pFrame, Sprite *pSprite, float fX, float fY, int iFrame)
+{
+	assert(pFrame->nCommands < MAX_DRAW_COMMANDS && "Too many draw commands in one frame!");
+	if(pFrame->nCommands >= MAX_DRAW_COMMANDS)
+		return;
+
+	sDrawCommand &cmd = pFrame->Commands[pFrame->nCommands++];
+	cmd.pSprite	= pSprite;
+	cmd.fX		= fX;
+	cmd.fY		= fY;
+	cmd.iFrame	= iFrame;
+}
+
+//-----------------------------------------------------------------------------
+// CFrameExchange Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CFrameExchange () (Constructor)
+// Desc : CFrameExchange Class Constructor
+//-----------------------------------------------------------------------------
+CFrameExchange::CFrameExchange()
+{
+	ZeroMemory(m_Frames, sizeof(m_Frames));
+	m_iWrite	= 0;
+	m_Latest	= 1;
+	m_iRead		= 2;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Publish ()
+// Desc : Makes the packet just written the newest frame and takes back the
+//		previous newest one (or a drawn one) to write the next frame into.
+//-----------------------------------------------------------------------------
+void CFrameExchange::Publish()
+{
+	// InterlockedExchange is a full barrier, so the packet contents are
+	// visible to the consumer before the index is.
+	LONG lPrevious = InterlockedExchange(&m_Latest, m_iWrite | FRESH_FRAME);
+	m_iWrite = lPrevious & FRAME_INDEX_MASK;
+}
+
+//-----------------------------------------------------------------------------
+// Name : AcquireLatest ()
+// Desc : Hands the consumer the newest frame in exchange for the one it
+//		was drawing. The returned packet stays valid until the next call.
+//-----------------------------------------------------------------------------
+sFramePacket* CFrameExchange::AcquireLatest()
+{
+	if(!(m_Latest & FRESH_FRAME))
+		return NULL;
+
+	LONG lLatest = InterlockedExchange(&m_Latest, m_iRead);
+	m_iRead = lLatest & FRAME_INDEX_MASK;
+
+	return &m_Frames[m_iRead];
+}
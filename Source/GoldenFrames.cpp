@@ -0,0 +1,229 @@
+//-----------------------------------------------------------------------------
+// File: GoldenFrames.cpp
+//
+// Desc: Support for the golden frame regression run. A fixed input script
+//		drives the game, every rendered frame is hashed and the hashes are
+//		compared with a stored list, so a renderer change can be proven to
+//		leave the output untouched.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CGoldenLog Specific Includes
+//-----------------------------------------------------------------------------
+#include "GoldenFrames.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const ULONGLONG FNV_OFFSET_BASIS	= 0xCBF29CE484222325ULL;
+const ULONGLONG FNV_PRIME			= 0x00000100000001B3ULL;
+
+const UCHAR KEY_DOWN		= 0x80;		// GetKeyboardState bits
+const UCHAR KEY_TOGGLED		= 0x01;
+
+// One step of the input script, held for iFrames frames
+typedef struct
+{
+	int		iFrames;
+	UCHAR	Keys[4];		// Virtual keys held down, 0 for unused
+	bool	bMenu;			// Pause menu toggled on
+} sScriptStep;
+
+// Flies around the screen, fires, and opens the menu. The script repeats
+// for runs longer than one pass.
+const sScriptStep SCRIPT[] =
+{
+	{  30, { 0 },							false },
+	{  90, { VK_LEFT },						false },
+	{  60, { VK_UP, VK_NUMPAD0 },			false },
+	{ 120, { VK_RIGHT, VK_NUMPAD0 },		false },
+	{  45, { VK_DOWN, VK_LEFT },			false },
+	{  40, { 0 },							true  },
+	{  75, { VK_UP, VK_RIGHT, VK_NUMPAD0 },	false },
+	{  60, { VK_DOWN },						false },
+};
+const int SCRIPT_STEPS		= sizeof(SCRIPT) / sizeof(SCRIPT[0]);
+const POINT SCRIPT_CURSOR	= { 650, 250 };		// Over the menu's play button
+
+//-----------------------------------------------------------------------------
+// Name : HashFrame ()
+// Desc : Hashes the red, green and blue bytes of every pixel, row by row.
+//-----------------------------------------------------------------------------
+ULONGLONG HashFrame(const DWORD *pBits, int iWidth, int iHeight, int iPitch)
+{
+	ULONGLONG Hash = FNV_OFFSET_BASIS;
+
+	for(int y = 0; y < iHeight; y++)
+	{
+		const DWORD *pRow = pBits + y * iPitch;
+		for(int x = 0; x < iWidth; x++)
+		{
+			DWORD c = pRow[x];
+			Hash = (Hash ^ (c & 0xFF)) * FNV_PRIME;
+			Hash = (Hash ^ ((c >> 8) & 0xFF)) * FNV_PRIME;
+			Hash = (Hash ^ ((c >> 16) & 0xFF)) * FNV_PRIME;
+		}
+	}
+
+	return Hash;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SaveFrameBitmap ()
+// Desc : Saves a frame so a mismatch can be looked at.
+//-----------------------------------------------------------------------------
+bool SaveFrameBitmap(LPCSTR strFileName, const DWORD *pBits, int iWidth, int iHeight, int iPitch)
+{
+	FILE *pFile = NULL;
+	if(fopen_s(&pFile, strFileName, "wb") != 0 || !pFile)
+		return false;
+
+	// Rows of a 24 bit bitmap are padded to 4 bytes
+	int iRowSize = (iWidth * 3 + 3) & ~3;
+
+	BITMAPFILEHEADER bf;
+	BITMAPINFOHEADER bi;
+	ZeroMemory(&bf, sizeof(bf));
+	ZeroMemory(&bi, sizeof(bi));
+	bf.bfType		= 0x4D42;	// "BM"
+	bf.bfOffBits	= sizeof(bf) + sizeof(bi);
+	bf.bfSize		= bf.bfOffBits + iRowSize * iHeight;
+	bi.biSize		= sizeof(bi);
+	bi.biWidth		= iWidth;
+	bi.biHeight		= iHeight;
+	bi.biPlanes		= 1;
+	bi.biBitCount	= 24;
+	bi.biCompression= BI_RGB;
+
+	fwrite(&bf, sizeof(bf), 1, pFile);
+	fwrite(&bi, sizeof(bi), 1, pFile);
+
+	BYTE *pRow = new BYTE[iRowSize];
+	ZeroMemory(pRow, iRowSize);
+	for(int y = iHeight - 1; y >= 0; y--)
+	{
+		const DWORD *pSrc = pBits + y * iPitch;
+		for(int x = 0; x < iWidth; x++)
+		{
+			pRow[x * 3 + 0] = (BYTE)(pSrc[x]);
+			pRow[x * 3 + 1] = (BYTE)(pSrc[x] >> 8);
+			pRow[x * 3 + 2] = (BYTE)(pSrc[x] >> 16);
+		}
+		fwrite(pRow, iRowSize, 1, pFile);
+	}
+	delete []pRow;
+
+	bool bResult = ferror(pFile) == 0;
+	fclose(pFile);
+	return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetScriptedInput ()
+// Desc : Finds the script step for the frame and presses its keys.
+//-----------------------------------------------------------------------------
+void GetScriptedInput(ULONG nFrame, UCHAR *pKeys, POINT *pCursor)
+{
+	int iLength = 0;
+	for(int i = 0; i < SCRIPT_STEPS; i++)
+		iLength += SCRIPT[i].iFrames;
+
+	int iFrame	= (int)(nFrame % iLength);
+	int iStep	= 0;
+	while(iFrame >= SCRIPT[iStep].iFrames)
+		iFrame -= SCRIPT[iStep++].iFrames;
+
+	ZeroMemory(pKeys, 256);
+	for(int i = 0; i < 4; i++)
+		if(SCRIPT[iStep].Keys[i])
+			pKeys[SCRIPT[iStep].Keys[i]] = KEY_DOWN;
+
+	// The menu key is read as a toggle
+	if(SCRIPT[iStep].bMenu)
+		pKeys['P'] = KEY_TOGGLED;
+
+	*pCursor = SCRIPT_CURSOR;
+}
+
+//-----------------------------------------------------------------------------
+// CGoldenLog Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CGoldenLog () (Constructor)
+// Desc : CGoldenLog Class Constructor
+//-----------------------------------------------------------------------------
+CGoldenLog::CGoldenLog()
+{
+	m_nFrames = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Load ()
+// Desc : Reads a hash list written by Save.
+//-----------------------------------------------------------------------------
+bool CGoldenLog::Load(LPCSTR strFileName)
+{
+	FILE *pFile = NULL;
+	if(fopen_s(&pFile, strFileName, "r") != 0 || !pFile)
+		return false;
+
+	unsigned long nFrame;
+	unsigned long long Hash;
+	m_nFrames = 0;
+	while(fscanf_s(pFile, "%lu %llx", &nFrame, &Hash) == 2)
+		SetHash(nFrame, Hash);
+
+	fclose(pFile);
+	return m_nFrames > 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Save ()
+// Desc : Writes the hash list.
+//-----------------------------------------------------------------------------
+bool CGoldenLog::Save(LPCSTR strFileName) const
+{
+	FILE *pFile = NULL;
+	if(fopen_s(&pFile, strFileName, "w") != 0 || !pFile)
+		return false;
+
+	for(ULONG i = 0; i < m_nFrames; i++)
+		fprintf(pFile, "%lu %016llx\n", i, (unsigned long long)m_Hashes[i]);
+
+	bool bResult = ferror(pFile) == 0;
+	fclose(pFile);
+	return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetHash ()
+// Desc : Stores the hash of a frame. Frames past MAX_GOLDEN_FRAMES are not
+//		kept.
+//-----------------------------------------------------------------------------
+void CGoldenLog::SetHash(ULONG nFrame, ULONGLONG Hash)
+{
+	if(nFrame >= (ULONG)MAX_GOLDEN_FRAMES)
+		return;
+
+	// Frames skipped over have no hash
+	for(ULONG i = m_nFrames; i < nFrame; i++)
+		m_Hashes[i] = 0;
+
+	m_Hashes[nFrame] = Hash;
+	if(nFrame >= m_nFrames)
+		m_nFrames = nFrame + 1;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetHash ()
+// Desc : Returns false if there is no expected hash for the frame.
+//-----------------------------------------------------------------------------
+bool CGoldenLog::GetHash(ULONG nFrame, ULONGLONG &Hash) const
+{
+	if(nFrame >= m_nFrames || m_Hashes[nFrame] == 0)
+		return false;
+
+	Hash = m_Hashes[nFrame];
+	return true;
+}
@@ -0,0 +1,268 @@
+//-----------------------------------------------------------------------------
+// File: Hud.cpp
+//
+// Desc: Performance overlay drawn straight into the back buffer: frame rate,
+//		frame time percentiles, per-phase timings and a rolling frame time
+//		graph, written with a cached bitmap font.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CHud Specific Includes
+//-----------------------------------------------------------------------------
+#include "Hud.h"
+#include "Profiler.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int	HUD_X				= 8;		// Top left corner of the panel
+const int	HUD_Y				= 8;
+const int	HUD_PADDING			= 4;
+const int	HUD_LINES			= 3;
+const int	HUD_GRAPH_HEIGHT	= 64;
+const int	HUD_BAR_WIDTH		= 2;
+const float	HUD_PIXELS_PER_MS	= 2.0f;		// Graph covers 0 - 32 ms
+const float	HUD_TARGET_MS		= 1000.0f / 60.0f;
+
+const DWORD	HUD_TEXT_COLOR		= 0xFFFFFF;
+const DWORD	HUD_GOOD_COLOR		= 0x40E040;	// Made the 60 Hz target
+const DWORD	HUD_SLOW_COLOR		= 0xE0E040;	// Missed one refresh
+const DWORD	HUD_STUTTER_COLOR	= 0xE04040;	// Missed more than one
+const DWORD	HUD_GUIDE_COLOR		= 0x808080;
+
+//-----------------------------------------------------------------------------
+// Local Functions
+//-----------------------------------------------------------------------------
+// Clips a rectangle to the surface, returns false if nothing is left
+static bool ClipRect(const sSurface &dst, int &x, int &y, int &w, int &h)
+{
+	if(x < 0) { w += x; x = 0; }
+	if(y < 0) { h += y; y = 0; }
+	if(x + w > dst.iWidth)	w = dst.iWidth - x;
+	if(y + h > dst.iHeight)	h = dst.iHeight - y;
+	return w > 0 && h > 0;
+}
+
+// Halves the brightness behind the panel so the text stays readable
+static void ShadeRect(const sSurface &dst, int x, int y, int w, int h)
+{
+	if(!ClipRect(dst, x, y, w, h)) return;
+
+	for(int j = 0; j < h; j++)
+	{
+		DWORD *pRow = dst.pBits + (y + j) * dst.iPitch + x;
+		for(int i = 0; i < w; i++)
+			pRow[i] = (pRow[i] >> 1) & 0x7F7F7F;
+	}
+}
+
+static void FillRect(const sSurface &dst, int x, int y, int w, int h, DWORD dwColor)
+{
+	if(!ClipRect(dst, x, y, w, h)) return;
+
+	for(int j = 0; j < h; j++)
+	{
+		DWORD *pRow = dst.pBits + (y + j) * dst.iPitch + x;
+		for(int i = 0; i < w; i++)
+			pRow[i] = dwColor;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// CHud Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CHud () (Constructor)
+// Desc : CHud Class Constructor
+//-----------------------------------------------------------------------------
+CHud::CHud()
+{
+	ZeroMemory(m_Glyphs, sizeof(m_Glyphs));
+	m_iGlyphWidth	= 0;
+	m_iGlyphHeight	= 0;
+	m_fSimMs		= 0.0f;
+	m_fDrawMs		= 0.0f;
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildFont ()
+// Desc : Renders every printable character of a fixed pitch font once into
+//		a small DIB section and keeps the lit pixels as bits.
+//-----------------------------------------------------------------------------
+bool CHud::BuildFont(LPCTSTR strFace, int iHeight)
+{
+	HDC hDC = CreateCompatibleDC(NULL);
+	if(!hDC) return false;
+
+	HFONT hFont = CreateFont(-iHeight, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+							 OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, NONANTIALIASED_QUALITY,
+							 FIXED_PITCH | FF_MODERN, strFace);
+	HGDIOBJ hOldFont = SelectObject(hDC, hFont);
+
+	TEXTMETRIC tm;
+	GetTextMetrics(hDC, &tm);
+	m_iGlyphWidth	= min((int)tm.tmAveCharWidth, HUD_MAX_GLYPH_SIZE);
+	m_iGlyphHeight	= min((int)tm.tmHeight, HUD_MAX_GLYPH_SIZE);
+
+	BITMAPINFO bmi;
+	ZeroMemory(&bmi, sizeof(bmi));
+	bmi.bmiHeader.biSize		= sizeof(BITMAPINFOHEADER);
+	bmi.bmiHeader.biWidth		= HUD_MAX_GLYPH_SIZE;
+	bmi.bmiHeader.biHeight		= -HUD_MAX_GLYPH_SIZE;
+	bmi.bmiHeader.biPlanes		= 1;
+	bmi.bmiHeader.biBitCount	= 32;
+	bmi.bmiHeader.biCompression	= BI_RGB;
+
+	DWORD	*pBits		= NULL;
+	HBITMAP	hSurface	= CreateDIBSection(hDC, &bmi, DIB_RGB_COLORS, (void**)&pBits, NULL, 0);
+	if(!hSurface || m_iGlyphWidth <= 0)
+	{
+		SelectObject(hDC, hOldFont);
+		DeleteObject(hFont);
+		DeleteDC(hDC);
+		return false;
+	}
+
+	HGDIOBJ hOldSurface = SelectObject(hDC, hSurface);
+	SetBkMode(hDC, TRANSPARENT);
+	SetTextColor(hDC, RGB(255, 255, 255));
+
+	for(int c = HUD_FIRST_GLYPH; c <= HUD_LAST_GLYPH; c++)
+	{
+		char ch = (char)c;
+		ZeroMemory(pBits, HUD_MAX_GLYPH_SIZE * HUD_MAX_GLYPH_SIZE * sizeof(DWORD));
+		TextOutA(hDC, 0, 0, &ch, 1);
+		GdiFlush();
+
+		DWORD *pGlyph = m_Glyphs[c - HUD_FIRST_GLYPH];
+		for(int y = 0; y < m_iGlyphHeight; y++)
+		{
+			pGlyph[y] = 0;
+			for(int x = 0; x < m_iGlyphWidth; x++)
+				if((pBits[y * HUD_MAX_GLYPH_SIZE + x] & 0xFF) >= 0x80)
+					pGlyph[y] |= 1u << x;
+		}
+	}
+
+	SelectObject(hDC, hOldSurface);
+	SelectObject(hDC, hOldFont);
+	DeleteObject(hSurface);
+	DeleteObject(hFont);
+	DeleteDC(hDC);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetPhaseTimes ()
+// Desc : Records how long the last frame spent simulating and drawing.
+//-----------------------------------------------------------------------------
+void CHud::SetPhaseTimes(float fSimMs, float fDrawMs)
+{
+	m_fSimMs	= fSimMs;
+	m_fDrawMs	= fDrawMs;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetStats ()
+// Desc : Takes a snapshot of the timer's statistics and the latest frame
+//		times for the graph, converted to milliseconds.
+//-----------------------------------------------------------------------------
+void CHud::GetStats(sHudStats *pStats, const CTimer &Timer) const
+{
+	pStats->nSamples = (int)Timer.GetFrameHistory(pStats->fFrameMs, HUD_GRAPH_SAMPLES);
+	for(int i = 0; i < pStats->nSamples; i++)
+		pStats->fFrameMs[i] *= 1000.0f;
+
+	sFrameStats FrameStats;
+	Timer.GetFrameStats(&FrameStats);
+
+	pStats->fMinMs		= FrameStats.fMin * 1000.0f;
+	pStats->fP50Ms		= FrameStats.fP50 * 1000.0f;
+	pStats->fP95Ms		= FrameStats.fP95 * 1000.0f;
+	pStats->fP99Ms		= FrameStats.fP99 * 1000.0f;
+	pStats->fMaxMs		= FrameStats.fMax * 1000.0f;
+	pStats->nStutters	= FrameStats.nStutters;
+
+	pStats->nFrameRate	= Timer.GetFrameRate();
+	pStats->fCpuUsage	= Timer.GetCpuUsage();
+	pStats->fSimMs		= m_fSimMs;
+	pStats->fDrawMs		= m_fDrawMs;
+}
+
+//-----------------------------------------------------------------------------
+// Name : DrawString ()
+// Desc : Draws a line of text with its top left corner at (x, y) and returns
+//		its width. Characters without a glyph are drawn as spaces.
+//-----------------------------------------------------------------------------
+int CHud::DrawString(const sSurface &dst, int x, int y, LPCSTR strText, DWORD dwColor) const
+{
+	int iStart = x;
+
+	for(; *strText; strText++, x += m_iGlyphWidth)
+	{
+		int c = (unsigned char)*strText;
+		if(c <= HUD_FIRST_GLYPH || c > HUD_LAST_GLYPH) continue;
+
+		// Skip glyphs that are not entirely on the surface
+		if(x < 0 || y < 0 || x + m_iGlyphWidth > dst.iWidth || y + m_iGlyphHeight > dst.iHeight) continue;
+
+		const DWORD *pGlyph = m_Glyphs[c - HUD_FIRST_GLYPH];
+		for(int j = 0; j < m_iGlyphHeight; j++)
+		{
+			DWORD *pRow = dst.pBits + (y + j) * dst.iPitch + x;
+			int i = 0;
+			for(DWORD dwBits = pGlyph[j]; dwBits; dwBits >>= 1, i++)
+				if(dwBits & 1) pRow[i] = dwColor;
+		}
+	}
+
+	return x - iStart;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Draw ()
+// Desc : Draws the statistics panel and the frame time graph. Only reads
+//		the glyph cache and the snapshot, so it is safe on the render thread.
+//-----------------------------------------------------------------------------
+void CHud::Draw(const sSurface &dst, const sHudStats &Stats) const
+{
+	PROFILE_FUNCTION();
+
+	char strLines[HUD_LINES][96];
+	sprintf_s(strLines[0], "FPS %lu  frame %.2f ms  stutters %lu", Stats.nFrameRate,
+			  Stats.nSamples ? Stats.fFrameMs[Stats.nSamples - 1] : 0.0f, Stats.nStutters);
+	sprintf_s(strLines[1], "min %.1f p50 %.1f p95 %.1f p99 %.1f max %.1f",
+			  Stats.fMinMs, Stats.fP50Ms, Stats.fP95Ms, Stats.fP99Ms, Stats.fMaxMs);
+	sprintf_s(strLines[2], "sim %.2f ms  draw %.2f ms  CPU %d%%",
+			  Stats.fSimMs, Stats.fDrawMs, (int)(Stats.fCpuUsage * 100.0f + 0.5f));
+
+	int iWidth = HUD_GRAPH_SAMPLES * HUD_BAR_WIDTH;
+	for(int i = 0; i < HUD_LINES; i++)
+		iWidth = max(iWidth, (int)strlen(strLines[i]) * m_iGlyphWidth);
+
+	int iTextHeight = HUD_LINES * GetLineHeight();
+	ShadeRect(dst, HUD_X, HUD_Y, iWidth + HUD_PADDING * 2, iTextHeight + HUD_GRAPH_HEIGHT + HUD_PADDING * 3);
+
+	int x = HUD_X + HUD_PADDING;
+	int y = HUD_Y + HUD_PADDING;
+	for(int i = 0; i < HUD_LINES; i++, y += GetLineHeight())
+		DrawString(dst, x, y, strLines[i], HUD_TEXT_COLOR);
+
+	// Bars grow up from the bottom of the graph, newest on the right
+	int iBottom = y + HUD_PADDING + HUD_GRAPH_HEIGHT;
+	int iBarX	= x + (HUD_GRAPH_SAMPLES - Stats.nSamples) * HUD_BAR_WIDTH;
+	for(int i = 0; i < Stats.nSamples; i++, iBarX += HUD_BAR_WIDTH)
+	{
+		float fMs	= Stats.fFrameMs[i];
+		int iHeight	= min((int)(fMs * HUD_PIXELS_PER_MS + 0.5f), HUD_GRAPH_HEIGHT);
+		DWORD dwColor = fMs <= HUD_TARGET_MS * 1.05f ? HUD_GOOD_COLOR :
+						fMs <= HUD_TARGET_MS * 2.05f ? HUD_SLOW_COLOR : HUD_STUTTER_COLOR;
+		FillRect(dst, iBarX, iBottom - iHeight, HUD_BAR_WIDTH, iHeight, dwColor);
+	}
+
+	// Guides at one and two refreshes
+	for(int i = 1; i <= 2; i++)
+		FillRect(dst, x, iBottom - (int)(HUD_TARGET_MS * i * HUD_PIXELS_PER_MS + 0.5f),
+				 HUD_GRAPH_SAMPLES * HUD_BAR_WIDTH, 1, HUD_GUIDE_COLOR);
+}
@@ -2,6 +2,7 @@
 // by Mihai Popescu
 // March 2009
 #include "ImageFile.h"
+#include "Profiler.h"
 
 extern HINSTANCE g_hInst;
 
@@ -10,11 +11,14 @@ CImageFile::CImageFile() : height(m_biInfo.biHeight), width(m_biInfo.biWidth)
 {
 	m_hBMP = 0;
 	m_pRGB = NULL;
+	m_bDirty = true;
 	ZeroMemory(&m_biInfo, sizeof(BITMAPINFOHEADER));
 }
 
 bool CImageFile::LoadBitmapFromFile(const char *szFileName, HDC hdc)
 {
+	PROFILE_FUNCTION();
+
 	BYTE *pData;
 	HDC mdc = CreateCompatibleDC(hdc);
 
@@ -91,23 +95,46 @@ void CImageFile::Reload(HDC hdc)
 
 void CImageFile::Paint(HDC hdc, int x, int y)
 {
-	if(!m_pRGB)
-		return;
+	PaintRect(hdc, x, y, 0, 0, width, height);
+}
 
-	if(!m_hBMP)
-		m_hBMP = CreateCompatibleBitmap(hdc, width, height);
+void CImageFile::PaintRect(HDC hdc, int x, int y, int srcX, int srcY, int w, int h)
+{
+	if(!Upload(hdc))
+		return;
 
 	HDC mdc = CreateCompatibleDC(hdc);
 
-	SelectObject(mdc, m_hBMP);
-
-	SetDIBits(mdc, m_hBMP, 0, height, m_pRGB, (BITMAPINFO*)&m_biInfo, DIB_RGB_COLORS);
+	HGDIOBJ oldObj = SelectObject(mdc, m_hBMP);
 
-	BitBlt(hdc, x, y, width, height, mdc, 0, 0, SRCCOPY);
+	BitBlt(hdc, x, y, w, h, mdc, srcX, srcY, SRCCOPY);
 
+	SelectObject(mdc, oldObj);
 	DeleteDC(mdc);
 }
 
+bool CImageFile::Upload(HDC hdc)
+{
+	if(!m_pRGB)
+		return false;
+
+	if(!m_hBMP)
+	{
+		m_hBMP = CreateCompatibleBitmap(hdc, width, height);
+		m_bDirty = true;
+	}
+
+	// Copying the whole image to the device bitmap is expensive, so only
+	// do it when the pixels have changed since the last upload.
+	if(m_bDirty)
+	{
+		SetDIBits(hdc, m_hBMP, 0, height, m_pRGB, (BITMAPINFO*)&m_biInfo, DIB_RGB_COLORS);
+		m_bDirty = false;
+	}
+
+	return true;
+}
+
 
 CImageFile::~CImageFile(void)
 {
@@ -269,6 +296,8 @@ void CImageFile::PasteMonoImage(const BYTE *img, EColorChannel chn, const RECT*
 	if(chn >= ECC_EXCLUSIVERED)
 		Clear();
 
+	m_bDirty = true;
+
 	switch(chn)
 	{
 
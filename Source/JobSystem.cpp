@@ -0,0 +1,538 @@
+//-----------------------------------------------------------------------------
+// File: JobSystem.cpp
+//
+// Desc: Work stealing job system. Every thread, the one that created the
+//		system included, owns a queue of jobs. A thread runs the jobs of its
+//		own queue newest first and steals the oldest job of another queue
+//		when its own is empty. Jobs can be split over a range of indices
+//		(parallel for), can wait on child jobs and can start other jobs when
+//		they finish, which chains whole frames of work into a graph.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CJobSystem Specific Includes
+//-----------------------------------------------------------------------------
+#include "JobSystem.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int	BENCHMARK_ITEMS			= 1 << 20;		// Shots updated per pass
+const int	BENCHMARK_GRAIN			= 4096;
+const int	BENCHMARK_PASSES		= 20;
+const int	BENCHMARK_SUBSTEPS		= 8;			// Integration steps per item per pass
+const float	BENCHMARK_TIME_STEP		= 1.0f / 60.0f;
+
+//-----------------------------------------------------------------------------
+// Local Variables
+//-----------------------------------------------------------------------------
+// The system and worker slot of the calling thread
+static __declspec(thread) CJobSystem	*t_pJobSystem	= NULL;
+static __declspec(thread) int			t_iJobThread	= -1;
+
+//-----------------------------------------------------------------------------
+// CJobQueue Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : Push ()
+// Desc : Stores the job, then publishes it by moving the bottom.
+//-----------------------------------------------------------------------------
+bool CJobQueue::Push(sJob *pJob)
+{
+	LONG lBottom = m_lBottom;
+	if(lBottom - m_lTop >= JOB_QUEUE_SIZE)
+		return false;
+
+	m_pJobs[lBottom & (JOB_QUEUE_SIZE - 1)] = pJob;
+	InterlockedExchange(&m_lBottom, lBottom + 1);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Pop ()
+// Desc : Takes the newest job. The bottom is claimed before the top is
+//		read, so a thief and the owner can only both reach the last job,
+//		and the compare and swap gives it to one of them.
+//-----------------------------------------------------------------------------
+sJob* CJobQueue::Pop()
+{
+	LONG lBottom = m_lBottom - 1;
+	InterlockedExchange(&m_lBottom, lBottom);
+
+	LONG lTop = m_lTop;
+	if(lTop > lBottom)
+	{
+		// Empty, put the bottom back
+		m_lBottom = lTop;
+		return NULL;
+	}
+
+	sJob *pJob = m_pJobs[lBottom & (JOB_QUEUE_SIZE - 1)];
+	if(lTop != lBottom)
+		return pJob;
+
+	if(InterlockedCompareExchange(&m_lTop, lTop + 1, lTop) != lTop)
+		pJob = NULL;
+
+	m_lBottom = lTop + 1;
+	return pJob;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Steal ()
+// Desc : Takes the oldest job, or nothing when another thread got it first.
+//-----------------------------------------------------------------------------
+sJob* CJobQueue::Steal()
+{
+	LONG lTop = m_lTop;
+	MemoryBarrier();
+	LONG lBottom = m_lBottom;
+	if(lTop >= lBottom)
+		return NULL;
+
+	sJob *pJob = m_pJobs[lTop & (JOB_QUEUE_SIZE - 1)];
+	if(InterlockedCompareExchange(&m_lTop, lTop + 1, lTop) != lTop)
+		return NULL;
+
+	return pJob;
+}
+
+//-----------------------------------------------------------------------------
+// CJobSystem Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CJobSystem () (Constructor)
+// Desc : CJobSystem Class Constructor
+//-----------------------------------------------------------------------------
+CJobSystem::CJobSystem(int nThreads)
+{
+	if(nThreads <= 0)
+	{
+		SYSTEM_INFO Info;
+		GetSystemInfo(&Info);
+		nThreads = (int)Info.dwNumberOfProcessors;
+	}
+
+	m_lSleeping	= 0;
+	m_lQuit		= 0;
+	// No useful maximum: wake ups Run hands out while no one sleeps stay
+	// counted, and the destructor still has to add one per worker on top
+	m_hWake		= CreateSemaphore(NULL, 0, MAXLONG, NULL);
+
+	// Without the semaphore the workers could never sleep, run on one thread
+	m_nThreads	= m_hWake ? max(1, min(nThreads, MAX_JOB_THREADS)) : 1;
+	m_pWorkers	= new sWorker[m_nThreads];
+
+	for(int i = 0; i < m_nThreads; i++)
+	{
+		m_pWorkers[i].pJobs			= new sJob[JOB_POOL_SIZE];
+		m_pWorkers[i].nAllocated	= 0;
+		m_pWorkers[i].nSeed			= i + 1;
+		m_pWorkers[i].hThread		= NULL;
+		m_pWorkers[i].pSystem		= this;
+		m_pWorkers[i].iIndex		= i;
+	}
+
+	// The creating thread is worker 0
+	t_pJobSystem	= this;
+	t_iJobThread	= 0;
+
+	// A worker that fails to start only leaves its queue empty
+	for(int i = 1; i < m_nThreads; i++)
+		m_pWorkers[i].hThread = CreateThread(NULL, 0, WorkerThreadProc, &m_pWorkers[i], 0, NULL);
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CJobSystem () (Destructor)
+// Desc : CJobSystem Class Destructor. Jobs still queued are not run.
+//-----------------------------------------------------------------------------
+CJobSystem::~CJobSystem()
+{
+	InterlockedExchange(&m_lQuit, 1);
+	if(m_hWake)
+		ReleaseSemaphore(m_hWake, m_nThreads, NULL);
+
+	for(int i = 0; i < m_nThreads; i++)
+	{
+		if(m_pWorkers[i].hThread)
+		{
+			WaitForSingleObject(m_pWorkers[i].hThread, INFINITE);
+			CloseHandle(m_pWorkers[i].hThread);
+		}
+		delete []m_pWorkers[i].pJobs;
+	}
+
+	if(m_hWake)
+		CloseHandle(m_hWake);
+
+	delete []m_pWorkers;
+
+	if(t_pJobSystem == this)
+	{
+		t_pJobSystem	= NULL;
+		t_iJobThread	= -1;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetWorker () (Private)
+// Desc : The calling thread's worker.
+//-----------------------------------------------------------------------------
+CJobSystem::sWorker* CJobSystem::GetWorker()
+{
+	assert(t_pJobSystem == this && t_iJobThread >= 0);
+	return &m_pWorkers[t_iJobThread];
+}
+
+//-----------------------------------------------------------------------------
+// Name : AllocateJob () (Private)
+// Desc : Takes the next job of the calling thread's pool.
+//-----------------------------------------------------------------------------
+sJob* CJobSystem::AllocateJob()
+{
+	sWorker *pWorker = GetWorker();
+	return &pWorker->pJobs[pWorker->nAllocated++ & (JOB_POOL_SIZE - 1)];
+}
+
+//-----------------------------------------------------------------------------
+// Name : CreateRangeJob () (Private)
+// Desc : Fills in a new job and counts it against its parent.
+//-----------------------------------------------------------------------------
+sJob* CJobSystem::CreateRangeJob(LPJOBFUNCTION pFunction, void *pContext, int iBegin, int iEnd, int nGrain, sJob *pParent)
+{
+	sJob *pJob = AllocateJob();
+	pJob->pFunction			= pFunction;
+	pJob->pContext			= pContext;
+	pJob->iBegin			= iBegin;
+	pJob->iEnd				= iEnd;
+	pJob->nGrain			= nGrain;
+	pJob->pParent			= pParent;
+	pJob->lUnfinished		= 1;
+	pJob->lContinuations	= 0;
+
+	if(pParent)
+		InterlockedIncrement(&pParent->lUnfinished);
+
+	return pJob;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CreateJob ()
+// Desc : A job that runs once, without a range.
+//-----------------------------------------------------------------------------
+sJob* CJobSystem::CreateJob(LPJOBFUNCTION pFunction, void *pContext, sJob *pParent)
+{
+	return CreateRangeJob(pFunction, pContext, 0, 0, 0, pParent);
+}
+
+//-----------------------------------------------------------------------------
+// Name : CreateParallelFor ()
+// Desc : A job over 0 to nCount - 1 that Execute splits up. The grain is
+//		raised when needed so the pieces fit in the pools.
+//-----------------------------------------------------------------------------
+sJob* CJobSystem::CreateParallelFor(LPJOBFUNCTION pFunction, void *pContext, int nCount, int nGrain, sJob *pParent)
+{
+	nGrain = max(nGrain, nCount / MAX_JOB_SPLITS + 1);
+	return CreateRangeJob(pFunction, pContext, 0, nCount, nGrain, pParent);
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddContinuation ()
+// Desc : Remembers a job to run when pJob finishes.
+//-----------------------------------------------------------------------------
+void CJobSystem::AddContinuation(sJob *pJob, sJob *pContinuation)
+{
+	LONG i = InterlockedIncrement(&pJob->lContinuations) - 1;
+	assert(i < MAX_JOB_CONTINUATIONS);
+	pJob->pContinuations[i] = pContinuation;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Run ()
+// Desc : Queues the job on the calling thread and wakes a sleeping worker
+//		to take it. A full queue runs the job straight away.
+//-----------------------------------------------------------------------------
+void CJobSystem::Run(sJob *pJob)
+{
+	if(!GetWorker()->Queue.Push(pJob))
+	{
+		Execute(pJob);
+		return;
+	}
+
+	if(m_lSleeping > 0)
+		ReleaseSemaphore(m_hWake, 1, NULL);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Wait ()
+// Desc : Helps with any job until pJob has finished, so waiting never
+//		leaves a thread idle.
+//-----------------------------------------------------------------------------
+void CJobSystem::Wait(const sJob *pJob)
+{
+	sWorker *pWorker = GetWorker();
+	while(pJob->lUnfinished > 0)
+	{
+		sJob *pNext = GetJob(pWorker);
+		if(pNext)
+			Execute(pNext);
+		else
+			YieldProcessor();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : ParallelFor ()
+// Desc : Runs pFunction over 0 to nCount - 1 and returns when it is done.
+//-----------------------------------------------------------------------------
+void CJobSystem::ParallelFor(LPJOBFUNCTION pFunction, void *pContext, int nCount, int nGrain)
+{
+	sJob *pJob = CreateParallelFor(pFunction, pContext, nCount, nGrain);
+	Run(pJob);
+	Wait(pJob);
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetJob () (Private)
+// Desc : The worker's own newest job, or the oldest job of another worker,
+//		trying the others from a random one on.
+//-----------------------------------------------------------------------------
+sJob* CJobSystem::GetJob(sWorker *pWorker)
+{
+	sJob *pJob = pWorker->Queue.Pop();
+	if(pJob || m_nThreads == 1)
+		return pJob;
+
+	pWorker->nSeed = pWorker->nSeed * 1664525UL + 1013904223UL;
+	int iFirst = (int)((pWorker->nSeed >> 8) % (ULONG)m_nThreads);
+	for(int i = 0; i < m_nThreads; i++)
+	{
+		int iVictim = (iFirst + i) % m_nThreads;
+		if(iVictim == pWorker->iIndex)
+			continue;
+
+		pJob = m_pWorkers[iVictim].Queue.Steal();
+		if(pJob)
+			return pJob;
+	}
+
+	return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Execute () (Private)
+// Desc : Runs a job. A range longer than its grain queues its upper half
+//		for other threads and carries on splitting the lower half, so the
+//		work is spread in large pieces first.
+//-----------------------------------------------------------------------------
+void CJobSystem::Execute(sJob *pJob)
+{
+	while(pJob->nGrain > 0 && pJob->iEnd - pJob->iBegin > pJob->nGrain)
+	{
+		int iMiddle = pJob->iBegin + (pJob->iEnd - pJob->iBegin) / 2;
+		Run(CreateRangeJob(pJob->pFunction, pJob->pContext, iMiddle, pJob->iEnd, pJob->nGrain, pJob));
+		pJob->iEnd = iMiddle;
+	}
+
+	if(pJob->pFunction)
+		pJob->pFunction(pJob->pContext, pJob->iBegin, pJob->iEnd);
+
+	Finish(pJob);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Finish () (Private)
+// Desc : Counts one part of the job done. The last part starts the
+//		continuations and counts the job done in its parent.
+//-----------------------------------------------------------------------------
+void CJobSystem::Finish(sJob *pJob)
+{
+	if(InterlockedDecrement(&pJob->lUnfinished) != 0)
+		return;
+
+	for(LONG i = 0; i < pJob->lContinuations; i++)
+		Run(pJob->pContinuations[i]);
+
+	if(pJob->pParent)
+		Finish(pJob->pParent);
+}
+
+//-----------------------------------------------------------------------------
+// Name : WorkerThreadProc () (Static, Private)
+// Desc : Runs jobs until the system shuts down. An idle worker spins for a
+//		while, since the next frame's jobs are usually close, then sleeps
+//		until Run wakes it.
+//-----------------------------------------------------------------------------
+DWORD WINAPI CJobSystem::WorkerThreadProc(LPVOID pParam)
+{
+	sWorker *pWorker		= (sWorker*)pParam;
+	CJobSystem *pSystem		= pWorker->pSystem;
+
+	t_pJobSystem	= pSystem;
+	t_iJobThread	= pWorker->iIndex;
+	PROFILE_THREAD_NAME("Jobs");
+
+	int nIdle = 0;
+	while(!pSystem->m_lQuit)
+	{
+		sJob *pJob = pSystem->GetJob(pWorker);
+		if(pJob)
+		{
+			pSystem->Execute(pJob);
+			nIdle = 0;
+			continue;
+		}
+
+		if(++nIdle < JOB_SPIN_COUNT)
+		{
+			YieldProcessor();
+			continue;
+		}
+
+		// Look once more after saying we sleep, so a job that Run queued
+		// without seeing us is not left behind
+		InterlockedIncrement(&pSystem->m_lSleeping);
+		pJob = pSystem->GetJob(pWorker);
+		if(!pJob)
+			WaitForSingleObject(pSystem->m_hWake, INFINITE);
+		InterlockedDecrement(&pSystem->m_lSleeping);
+
+		if(pJob)
+			pSystem->Execute(pJob);
+		nIdle = 0;
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+// What the benchmark kernel works on, each item only touches its own slots
+typedef struct
+{
+	float	*pX;
+	float	*pY;
+	float	*pVelX;
+	float	*pVelY;
+} sBenchScene;
+
+//-----------------------------------------------------------------------------
+// Name : ResetBenchScene ()
+// Desc : Puts every item back where the first pass starts.
+//-----------------------------------------------------------------------------
+static void ResetBenchScene(sBenchScene &Scene)
+{
+	ULONG nSeed = 1;
+	for(int i = 0; i < BENCHMARK_ITEMS; i++)
+	{
+		Scene.pX[i]		= BenchRandom(nSeed) * 1280.0f;
+		Scene.pY[i]		= BenchRandom(nSeed) * 720.0f;
+		Scene.pVelX[i]	= BenchRandom(nSeed) * 600.0f - 300.0f;
+		Scene.pVelY[i]	= BenchRandom(nSeed) * 600.0f - 300.0f;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : IntegrateBenchJob ()
+// Desc : Moves the items with a few small steps, wrapping at the edges.
+//-----------------------------------------------------------------------------
+static void IntegrateBenchJob(void *pContext, int iBegin, int iEnd)
+{
+	sBenchScene *pScene = (sBenchScene*)pContext;
+	float dt = BENCHMARK_TIME_STEP / BENCHMARK_SUBSTEPS;
+
+	for(int i = iBegin; i < iEnd; i++)
+	{
+		float fX = pScene->pX[i], fY = pScene->pY[i];
+		for(int s = 0; s < BENCHMARK_SUBSTEPS; s++)
+		{
+			fX += pScene->pVelX[i] * dt;
+			fY += pScene->pVelY[i] * dt;
+			if(fX < 0.0f) fX += 1280.0f; else if(fX >= 1280.0f) fX -= 1280.0f;
+			if(fY < 0.0f) fY += 720.0f; else if(fY >= 720.0f) fY -= 720.0f;
+		}
+
+		pScene->pX[i] = fX;
+		pScene->pY[i] = fY;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : TimeBenchJob ()
+// Desc : Milliseconds per pass of the kernel, from a fresh scene.
+//-----------------------------------------------------------------------------
+static double TimeBenchJob(CJobSystem &Jobs, sBenchScene &Scene)
+{
+	__int64 nStart, nEnd;
+
+	ResetBenchScene(Scene);
+	nStart = BenchTime();
+	for(int nPass = 0; nPass < BENCHMARK_PASSES; nPass++)
+		Jobs.ParallelFor(IntegrateBenchJob, &Scene, BENCHMARK_ITEMS, BENCHMARK_GRAIN);
+	nEnd = BenchTime();
+
+	return BenchSeconds(nStart, nEnd) * 1000.0 / BENCHMARK_PASSES;
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunJobBenchmark ()
+// Desc : Doubles the threads from 1 up to one per core. The single thread
+//		results are kept and every other run must match them exactly.
+//-----------------------------------------------------------------------------
+bool RunJobBenchmark(LPCSTR strFileName)
+{
+	FILE *pFile = BenchOpen(strFileName);
+	if(!pFile)
+		return false;
+
+	SYSTEM_INFO Info;
+	GetSystemInfo(&Info);
+	int nCores = max(1, min((int)Info.dwNumberOfProcessors, MAX_JOB_THREADS));
+
+	sBenchScene Scene;
+	Scene.pX		= new float[BENCHMARK_ITEMS];
+	Scene.pY		= new float[BENCHMARK_ITEMS];
+	Scene.pVelX		= new float[BENCHMARK_ITEMS];
+	Scene.pVelY		= new float[BENCHMARK_ITEMS];
+
+	float *pExpectedX	= new float[BENCHMARK_ITEMS];
+	double fBase		= 0.0;
+	bool bMatch			= true;
+
+	fprintf(pFile, "%d items, grain %d, %d cores\n", BENCHMARK_ITEMS, BENCHMARK_GRAIN, nCores);
+	fprintf(pFile, "threads  integrate ms  speed-up  match\n");
+	for(int nThreads = 1; ; nThreads = min(nThreads * 2, nCores))
+	{
+		CJobSystem Jobs(nThreads);
+
+		double fIntegrate = TimeBenchJob(Jobs, Scene);
+		bool bSame = true;
+		if(nThreads == 1)
+		{
+			memcpy(pExpectedX, Scene.pX, BENCHMARK_ITEMS * sizeof(float));
+			fBase = fIntegrate;
+		}
+		else
+			bSame = memcmp(pExpectedX, Scene.pX, BENCHMARK_ITEMS * sizeof(float)) == 0;
+
+		bMatch = bMatch && bSame;
+		fprintf(pFile, "%7d  %12.3f  %7.2fx  %s\n", Jobs.GetThreadCount(), fIntegrate, fBase / fIntegrate,
+				bSame ? "yes" : "NO");
+
+		if(nThreads == nCores)
+			break;
+	}
+
+	delete []Scene.pX;
+	delete []Scene.pY;
+	delete []Scene.pVelX;
+	delete []Scene.pVelY;
+	delete []pExpectedX;
+
+	return BenchClose(pFile, bMatch);
+}
@@ -0,0 +1,397 @@
+//-----------------------------------------------------------------------------
+// File: OverlapBatch.cpp
+//
+// Desc: Batched overlap tests. One box or circle is tested against a whole
+//		structure of arrays batch of boxes or circles, four or eight at a
+//		time with SSE2 or AVX2, and the answer comes back as a hit bitmask
+//		that can be turned into a list of indices.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// OverlapBatch Specific Includes
+//-----------------------------------------------------------------------------
+#include "OverlapBatch.h"
+#include "Benchmark.h"
+#include "Simd.h"
+
+//-----------------------------------------------------------------------------
+// Local Types
+//-----------------------------------------------------------------------------
+// The query shape, passed to the batch functions as one struct
+typedef struct
+{
+	float		fMinX, fMinY, fMaxX, fMaxY;		// Box queries
+	float		fX, fY, fRadius;				// Circle queries
+} sOverlapQuery;
+
+typedef void (*BOX_BATCH_FUNC)(const sOverlapQuery &q, const sBoxBatch &b, BYTE *pHitBits);
+typedef void (*CIRCLE_BATCH_FUNC)(const sOverlapQuery &q, const sCircleBatch &b, BYTE *pHitBits);
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const BYTE	BITS_IN_NIBBLE[16]		= { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+const int	BENCHMARK_SIZES[]		= { 16, 64, 256, 1024, 4096 };
+const int	BENCHMARK_TESTS			= 32000000;		// Shape tests timed per size and path
+const float	BENCHMARK_WORLD			= 1024.0f;		// Side of the square the shapes are in
+const float	BENCHMARK_MAX_SIZE		= 64.0f;		// Largest box side or circle radius
+
+//-----------------------------------------------------------------------------
+// Local Variables
+//-----------------------------------------------------------------------------
+// The fastest batch functions the CPU has, picked by the first query
+static BOX_BATCH_FUNC		g_pfnBox	= NULL;
+static CIRCLE_BATCH_FUNC	g_pfnCircle	= NULL;
+
+//-----------------------------------------------------------------------------
+// Scalar Batch Functions
+//-----------------------------------------------------------------------------
+// These are the reference implementation and also finish the entries left
+// over by the SIMD loops, starting at iStart which is a multiple of eight.
+static void BoxBatchScalar(const sOverlapQuery &q, const sBoxBatch &b, BYTE *pHitBits, int iStart)
+{
+	for(int i = iStart; i < b.nCount; i++)
+	{
+		if((i & 7) == 0)
+			pHitBits[i >> 3] = 0;
+
+		if(q.fMinX < b.pMaxX[i] && b.pMinX[i] < q.fMaxX && q.fMinY < b.pMaxY[i] && b.pMinY[i] < q.fMaxY)
+			pHitBits[i >> 3] |= (BYTE)(1 << (i & 7));
+	}
+}
+
+static void CircleBatchScalar(const sOverlapQuery &q, const sCircleBatch &b, BYTE *pHitBits, int iStart)
+{
+	for(int i = iStart; i < b.nCount; i++)
+	{
+		if((i & 7) == 0)
+			pHitBits[i >> 3] = 0;
+
+		float dx = b.pX[i] - q.fX;
+		float dy = b.pY[i] - q.fY;
+		float r = b.pRadius[i] + q.fRadius;
+		if(dx * dx + dy * dy < r * r)
+			pHitBits[i >> 3] |= (BYTE)(1 << (i & 7));
+	}
+}
+
+static void BoxBatch(const sOverlapQuery &q, const sBoxBatch &b, BYTE *pHitBits)			{ BoxBatchScalar(q, b, pHitBits, 0); }
+static void CircleBatch(const sOverlapQuery &q, const sCircleBatch &b, BYTE *pHitBits)	{ CircleBatchScalar(q, b, pHitBits, 0); }
+
+#if defined(SIMD_SSE2)
+//-----------------------------------------------------------------------------
+// SSE2 Batch Functions
+//-----------------------------------------------------------------------------
+// Two groups of four make up each byte of hit bits.
+static inline int BoxHits4(const sBoxBatch &b, int i, __m128 qMinX, __m128 qMinY, __m128 qMaxX, __m128 qMaxY)
+{
+	__m128 h = _mm_and_ps(_mm_cmplt_ps(qMinX, _mm_loadu_ps(&b.pMaxX[i])), _mm_cmplt_ps(_mm_loadu_ps(&b.pMinX[i]), qMaxX));
+	h = _mm_and_ps(h, _mm_and_ps(_mm_cmplt_ps(qMinY, _mm_loadu_ps(&b.pMaxY[i])), _mm_cmplt_ps(_mm_loadu_ps(&b.pMinY[i]), qMaxY)));
+	return _mm_movemask_ps(h);
+}
+
+static void BoxBatchSSE2(const sOverlapQuery &q, const sBoxBatch &b, BYTE *pHitBits)
+{
+	__m128 qMinX = _mm_set1_ps(q.fMinX), qMinY = _mm_set1_ps(q.fMinY);
+	__m128 qMaxX = _mm_set1_ps(q.fMaxX), qMaxY = _mm_set1_ps(q.fMaxY);
+
+	int i = 0;
+	for(; i + 8 <= b.nCount; i += 8)
+	{
+		pHitBits[i >> 3] = (BYTE)(BoxHits4(b, i, qMinX, qMinY, qMaxX, qMaxY) |
+								  (BoxHits4(b, i + 4, qMinX, qMinY, qMaxX, qMaxY) << 4));
+	}
+
+	BoxBatchScalar(q, b, pHitBits, i);
+}
+
+static inline int CircleHits4(const sCircleBatch &b, int i, __m128 qX, __m128 qY, __m128 qRadius)
+{
+	__m128 dx = _mm_sub_ps(_mm_loadu_ps(&b.pX[i]), qX);
+	__m128 dy = _mm_sub_ps(_mm_loadu_ps(&b.pY[i]), qY);
+	__m128 r = _mm_add_ps(_mm_loadu_ps(&b.pRadius[i]), qRadius);
+	__m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+	return _mm_movemask_ps(_mm_cmplt_ps(d2, _mm_mul_ps(r, r)));
+}
+
+static void CircleBatchSSE2(const sOverlapQuery &q, const sCircleBatch &b, BYTE *pHitBits)
+{
+	__m128 qX = _mm_set1_ps(q.fX), qY = _mm_set1_ps(q.fY), qRadius = _mm_set1_ps(q.fRadius);
+
+	int i = 0;
+	for(; i + 8 <= b.nCount; i += 8)
+	{
+		pHitBits[i >> 3] = (BYTE)(CircleHits4(b, i, qX, qY, qRadius) |
+								  (CircleHits4(b, i + 4, qX, qY, qRadius) << 4));
+	}
+
+	CircleBatchScalar(q, b, pHitBits, i);
+}
+#endif // SIMD_SSE2
+
+#if defined(SIMD_AVX2)
+//-----------------------------------------------------------------------------
+// AVX2 Batch Functions
+//-----------------------------------------------------------------------------
+// Same as the SSE2 versions with one group of eight per byte.
+static void BoxBatchAVX2(const sOverlapQuery &q, const sBoxBatch &b, BYTE *pHitBits)
+{
+	__m256 qMinX = _mm256_set1_ps(q.fMinX), qMinY = _mm256_set1_ps(q.fMinY);
+	__m256 qMaxX = _mm256_set1_ps(q.fMaxX), qMaxY = _mm256_set1_ps(q.fMaxY);
+
+	int i = 0;
+	for(; i + 8 <= b.nCount; i += 8)
+	{
+		__m256 h = _mm256_and_ps(_mm256_cmp_ps(qMinX, _mm256_loadu_ps(&b.pMaxX[i]), _CMP_LT_OQ),
+								 _mm256_cmp_ps(_mm256_loadu_ps(&b.pMinX[i]), qMaxX, _CMP_LT_OQ));
+		h = _mm256_and_ps(h, _mm256_and_ps(_mm256_cmp_ps(qMinY, _mm256_loadu_ps(&b.pMaxY[i]), _CMP_LT_OQ),
+										   _mm256_cmp_ps(_mm256_loadu_ps(&b.pMinY[i]), qMaxY, _CMP_LT_OQ)));
+		pHitBits[i >> 3] = (BYTE)_mm256_movemask_ps(h);
+	}
+
+	BoxBatchScalar(q, b, pHitBits, i);
+}
+
+static void CircleBatchAVX2(const sOverlapQuery &q, const sCircleBatch &b, BYTE *pHitBits)
+{
+	__m256 qX = _mm256_set1_ps(q.fX), qY = _mm256_set1_ps(q.fY), qRadius = _mm256_set1_ps(q.fRadius);
+
+	int i = 0;
+	for(; i + 8 <= b.nCount; i += 8)
+	{
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&b.pX[i]), qX);
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&b.pY[i]), qY);
+		__m256 r = _mm256_add_ps(_mm256_loadu_ps(&b.pRadius[i]), qRadius);
+		__m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+		pHitBits[i >> 3] = (BYTE)_mm256_movemask_ps(_mm256_cmp_ps(d2, _mm256_mul_ps(r, r), _CMP_LT_OQ));
+	}
+
+	CircleBatchScalar(q, b, pHitBits, i);
+}
+#endif // SIMD_AVX2
+
+static void SelectBatchFuncs(BOX_BATCH_FUNC &pfnBox, CIRCLE_BATCH_FUNC &pfnCircle)
+{
+	pfnBox		= BoxBatch;
+	pfnCircle	= CircleBatch;
+
+#if defined(SIMD_SSE2)
+	pfnBox		= BoxBatchSSE2;
+	pfnCircle	= CircleBatchSSE2;
+#endif
+
+#if defined(SIMD_AVX2)
+	if(CpuHasAVX2())
+	{
+		pfnBox		= BoxBatchAVX2;
+		pfnCircle	= CircleBatchAVX2;
+	}
+#endif
+}
+
+static int CountHits(const BYTE *pHitBits, int nCount)
+{
+	int nHits = 0;
+	for(int i = 0; i < (nCount + 7) >> 3; i++)
+		nHits += BITS_IN_NIBBLE[pHitBits[i] & 15] + BITS_IN_NIBBLE[pHitBits[i] >> 4];
+
+	return nHits;
+}
+
+//-----------------------------------------------------------------------------
+// Name : OverlapBoxBatch ()
+// Desc : Tests a box against every box of the batch.
+//-----------------------------------------------------------------------------
+int OverlapBoxBatch(float fMinX, float fMinY, float fMaxX, float fMaxY, const sBoxBatch &Batch, BYTE *pHitBits)
+{
+	if(!g_pfnBox)
+		SelectBatchFuncs(g_pfnBox, g_pfnCircle);
+
+	sOverlapQuery q = { fMinX, fMinY, fMaxX, fMaxY, 0.0f, 0.0f, 0.0f };
+	g_pfnBox(q, Batch, pHitBits);
+	return CountHits(pHitBits, Batch.nCount);
+}
+
+//-----------------------------------------------------------------------------
+// Name : OverlapCircleBatch ()
+// Desc : Tests a circle against every circle of the batch.
+//-----------------------------------------------------------------------------
+int OverlapCircleBatch(float fX, float fY, float fRadius, const sCircleBatch &Batch, BYTE *pHitBits)
+{
+	if(!g_pfnCircle)
+		SelectBatchFuncs(g_pfnBox, g_pfnCircle);
+
+	sOverlapQuery q = { 0.0f, 0.0f, 0.0f, 0.0f, fX, fY, fRadius };
+	g_pfnCircle(q, Batch, pHitBits);
+	return CountHits(pHitBits, Batch.nCount);
+}
+
+//-----------------------------------------------------------------------------
+// Name : HitBitsToIndices ()
+// Desc : Skips empty bytes whole, hits are usually few.
+//-----------------------------------------------------------------------------
+int HitBitsToIndices(const BYTE *pHitBits, int nCount, int *pIndices)
+{
+	int nHits = 0;
+	for(int i = 0; i < (nCount + 7) >> 3; i++)
+	{
+		for(int nBits = pHitBits[i], j = i << 3; nBits; nBits >>= 1, j++)
+		{
+			if(nBits & 1)
+				pIndices[nHits++] = j;
+		}
+	}
+
+	return nHits;
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : TimeBoxes ()
+// Desc : Nanoseconds per box test of one path. Returns -1 when the path
+//		does not set the same bits as the scalar one.
+//-----------------------------------------------------------------------------
+static double TimeBoxes(BOX_BATCH_FUNC pfnBox, const sOverlapQuery *pQueries, int nQueries,
+						const sBoxBatch &b, BYTE *pHitBits, BYTE *pCheckBits, int nPasses)
+{
+	__int64 nStart, nEnd;
+	int nBytes = (b.nCount + 7) >> 3;
+
+	for(int i = 0; i < nQueries; i++)
+	{
+		BoxBatch(pQueries[i], b, pCheckBits);
+		pfnBox(pQueries[i], b, pHitBits);
+		if(memcmp(pHitBits, pCheckBits, nBytes) != 0)
+			return -1.0;
+	}
+
+	nStart = BenchTime();
+	for(int nPass = 0; nPass < nPasses; nPass++)
+		pfnBox(pQueries[nPass % nQueries], b, pHitBits);
+	nEnd = BenchTime();
+
+	return BenchSeconds(nStart, nEnd) * 1e9 / ((double)b.nCount * nPasses);
+}
+
+static double TimeCircles(CIRCLE_BATCH_FUNC pfnCircle, const sOverlapQuery *pQueries, int nQueries,
+						  const sCircleBatch &b, BYTE *pHitBits, BYTE *pCheckBits, int nPasses)
+{
+	__int64 nStart, nEnd;
+	int nBytes = (b.nCount + 7) >> 3;
+
+	for(int i = 0; i < nQueries; i++)
+	{
+		CircleBatch(pQueries[i], b, pCheckBits);
+		pfnCircle(pQueries[i], b, pHitBits);
+		if(memcmp(pHitBits, pCheckBits, nBytes) != 0)
+			return -1.0;
+	}
+
+	nStart = BenchTime();
+	for(int nPass = 0; nPass < nPasses; nPass++)
+		pfnCircle(pQueries[nPass % nQueries], b, pHitBits);
+	nEnd = BenchTime();
+
+	return BenchSeconds(nStart, nEnd) * 1e9 / ((double)b.nCount * nPasses);
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunOverlapBenchmark ()
+// Desc : Writes nanoseconds per test for each path and size. Every path
+//		is first checked against the scalar one on all the queries.
+//-----------------------------------------------------------------------------
+bool RunOverlapBenchmark(LPCSTR strFileName)
+{
+	FILE *pFile = BenchOpen(strFileName);
+	if(!pFile)
+		return false;
+
+	const int nQueries = 64;
+	int nMaxCount = BENCHMARK_SIZES[sizeof(BENCHMARK_SIZES) / sizeof(BENCHMARK_SIZES[0]) - 1];
+	float *pData = new float[nMaxCount * 5];
+	BYTE *pHitBits = new BYTE[(nMaxCount + 7) / 8];
+	BYTE *pCheckBits = new BYTE[(nMaxCount + 7) / 8];
+	sOverlapQuery Queries[nQueries];
+	ULONG nSeed = 1;
+
+	// Columns are x, y, box max x, box max y and circle radius. The boxes'
+	// min corners are the circles' centres.
+	for(int i = 0; i < nMaxCount; i++)
+	{
+		pData[i]				= BenchRandom(nSeed) * BENCHMARK_WORLD;
+		pData[nMaxCount + i]	= BenchRandom(nSeed) * BENCHMARK_WORLD;
+		pData[2 * nMaxCount + i] = pData[i] + BenchRandom(nSeed) * BENCHMARK_MAX_SIZE;
+		pData[3 * nMaxCount + i] = pData[nMaxCount + i] + BenchRandom(nSeed) * BENCHMARK_MAX_SIZE;
+		pData[4 * nMaxCount + i] = BenchRandom(nSeed) * BENCHMARK_MAX_SIZE;
+	}
+	for(int i = 0; i < nQueries; i++)
+	{
+		sOverlapQuery &q = Queries[i];
+		q.fX = q.fMinX	= BenchRandom(nSeed) * BENCHMARK_WORLD;
+		q.fY = q.fMinY	= BenchRandom(nSeed) * BENCHMARK_WORLD;
+		q.fRadius		= BenchRandom(nSeed) * BENCHMARK_MAX_SIZE;
+		q.fMaxX			= q.fMinX + q.fRadius * 2.0f;
+		q.fMaxY			= q.fMinY + q.fRadius * 2.0f;
+	}
+
+	BOX_BATCH_FUNC pfnBoxes[3]			= { BoxBatch, NULL, NULL };
+	CIRCLE_BATCH_FUNC pfnCircles[3]		= { CircleBatch, NULL, NULL };
+#if defined(SIMD_SSE2)
+	pfnBoxes[1] = BoxBatchSSE2;
+	pfnCircles[1] = CircleBatchSSE2;
+#endif
+#if defined(SIMD_AVX2)
+	if(CpuHasAVX2())
+	{
+		pfnBoxes[2] = BoxBatchAVX2;
+		pfnCircles[2] = CircleBatchAVX2;
+	}
+#endif
+
+	bool bMatch = true;
+	fprintf(pFile, "Nanoseconds per shape test, - where the path is not available\n");
+	fprintf(pFile, "and WRONG where it disagrees with the scalar path\n\n");
+	fprintf(pFile, "shape    batch  scalar    sse2    avx2\n");
+	for(int nShape = 0; nShape < 2; nShape++)
+	{
+		for(int i = 0; i < (int)(sizeof(BENCHMARK_SIZES) / sizeof(BENCHMARK_SIZES[0])); i++)
+		{
+			int nCount	= BENCHMARK_SIZES[i];
+			int nPasses	= BENCHMARK_TESTS / nCount;
+			sBoxBatch Boxes			= { pData, pData + nMaxCount, pData + 2 * nMaxCount, pData + 3 * nMaxCount, nCount };
+			sCircleBatch Circles	= { pData, pData + nMaxCount, pData + 4 * nMaxCount, nCount };
+
+			fprintf(pFile, "%-6s  %6d", nShape == 0 ? "box" : "circle", nCount);
+
+			for(int nPath = 0; nPath < 3; nPath++)
+			{
+				if(nShape == 0 ? !pfnBoxes[nPath] : !pfnCircles[nPath])
+				{
+					fprintf(pFile, "  %6s", "-");
+					continue;
+				}
+
+				double fNs = nShape == 0 ?
+					TimeBoxes(pfnBoxes[nPath], Queries, nQueries, Boxes, pHitBits, pCheckBits, nPasses) :
+					TimeCircles(pfnCircles[nPath], Queries, nQueries, Circles, pHitBits, pCheckBits, nPasses);
+
+				bMatch = bMatch && fNs >= 0.0;
+				if(fNs >= 0.0)
+					fprintf(pFile, "  %6.3f", fNs);
+				else
+					fprintf(pFile, "  %6s", "WRONG");
+			}
+			fprintf(pFile, "\n");
+		}
+	}
+
+	delete []pData;
+	delete []pHitBits;
+	delete []pCheckBits;
+
+	return BenchClose(pFile, bMatch);
+}
@@ -0,0 +1,205 @@
+//-----------------------------------------------------------------------------
+// File: Palette.cpp
+//
+// Desc: Colour quantization for indexed sprites. Images are reduced to a
+//		256 entry palette at load time with median cut.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Palette Specific Includes
+//-----------------------------------------------------------------------------
+#include "Palette.h"
+#include <stdlib.h>
+
+//-----------------------------------------------------------------------------
+// Local Types
+//-----------------------------------------------------------------------------
+typedef struct
+{
+	DWORD	dwColor;
+	int		iCount;			// Number of pixels with this colour
+	int		iIndex;			// Palette entry the colour ends up in
+} sColorCount;
+
+typedef struct
+{
+	int		iFirst;			// Range of colours in the histogram
+	int		iCount;
+} sColorBox;
+
+// Channel qsort compares on, quantization only runs while loading
+static int s_iSortShift = 0;
+
+static int CompareColor(const void *a, const void *b)
+{
+	DWORD ca = ((const sColorCount*)a)->dwColor, cb = ((const sColorCount*)b)->dwColor;
+	return (ca < cb) ? -1 : (ca > cb) ? 1 : 0;
+}
+
+static int CompareChannel(const void *a, const void *b)
+{
+	int ca = (((const sColorCount*)a)->dwColor >> s_iSortShift) & 0xFF;
+	int cb = (((const sColorCount*)b)->dwColor >> s_iSortShift) & 0xFF;
+	return ca - cb;
+}
+
+//-----------------------------------------------------------------------------
+// Local Functions
+//-----------------------------------------------------------------------------
+// Widest channel of a box, returns its range and the channel shift
+static int WidestChannel(const sColorCount *pColors, const sColorBox &box, int &iShift)
+{
+	int iBest = -1;
+
+	for(int c = 0; c < 32; c += 8)
+	{
+		int lo = 255, hi = 0;
+		for(int i = box.iFirst; i < box.iFirst + box.iCount; i++)
+		{
+			int v = (pColors[i].dwColor >> c) & 0xFF;
+			lo = min(lo, v);
+			hi = max(hi, v);
+		}
+
+		if(hi - lo > iBest)
+		{
+			iBest	= hi - lo;
+			iShift	= c;
+		}
+	}
+
+	return iBest;
+}
+
+static DWORD AverageColor(const sColorCount *pColors, const sColorBox &box)
+{
+	double fSum[4] = { 0.0, 0.0, 0.0, 0.0 };
+	double fWeight = 0.0;
+
+	for(int i = box.iFirst; i < box.iFirst + box.iCount; i++)
+	{
+		for(int c = 0; c < 4; c++)
+			fSum[c] += (double)((pColors[i].dwColor >> (c * 8)) & 0xFF) * pColors[i].iCount;
+		fWeight += pColors[i].iCount;
+	}
+
+	DWORD dwColor = 0;
+	for(int c = 0; c < 4; c++)
+		dwColor |= (DWORD)(fSum[c] / fWeight + 0.5) << (c * 8);
+
+	return dwColor;
+}
+
+//-----------------------------------------------------------------------------
+// Name : QuantizeImage ()
+// Desc : Median cut: the colour box with the widest channel is repeatedly
+//		split at the pixel weighted median of that channel, until there is a
+//		box per palette entry or every box holds a single colour.
+//-----------------------------------------------------------------------------
+int QuantizeImage(const DWORD *pPixels, int iCount, DWORD *pPalette, BYTE *pIndices)
+{
+	ZeroMemory(pPalette, PALETTE_SIZE * sizeof(DWORD));
+
+	// Histogram of the visible colours
+	sColorCount *pColors = new sColorCount[iCount + 1];
+	int iColors = 0;
+
+	for(int i = 0; i < iCount; i++)
+	{
+		if(pPixels[i] == 0)
+			continue;
+
+		pColors[iColors].dwColor	= pPixels[i];
+		pColors[iColors].iCount		= 1;
+		iColors++;
+	}
+
+	qsort(pColors, iColors, sizeof(sColorCount), CompareColor);
+
+	int iUnique = 0;
+	for(int i = 0; i < iColors; i++)
+	{
+		if(iUnique > 0 && pColors[iUnique - 1].dwColor == pColors[i].dwColor)
+			pColors[iUnique - 1].iCount++;
+		else
+			pColors[iUnique++] = pColors[i];
+	}
+
+	// Entry 0 is reserved for transparent pixels
+	sColorBox boxes[PALETTE_SIZE - 1];
+	int iBoxes = 0;
+
+	if(iUnique > 0)
+	{
+		boxes[0].iFirst	= 0;
+		boxes[0].iCount	= iUnique;
+		iBoxes			= 1;
+	}
+
+	while(iBoxes < PALETTE_SIZE - 1)
+	{
+		int iSplit = -1, iSplitShift = 0, iBestRange = 0;
+		for(int b = 0; b < iBoxes; b++)
+		{
+			if(boxes[b].iCount < 2)
+				continue;
+
+			int iShift, iRange = WidestChannel(pColors, boxes[b], iShift);
+			if(iRange > iBestRange)
+			{
+				iSplit		= b;
+				iSplitShift	= iShift;
+				iBestRange	= iRange;
+			}
+		}
+
+		if(iSplit < 0)
+			break;
+
+		sColorBox &box = boxes[iSplit];
+		s_iSortShift = iSplitShift;
+		qsort(&pColors[box.iFirst], box.iCount, sizeof(sColorCount), CompareChannel);
+
+		int iTotal = 0;
+		for(int i = box.iFirst; i < box.iFirst + box.iCount; i++)
+			iTotal += pColors[i].iCount;
+
+		// weighted median, both halves keep at least one colour
+		int iHalf = 0, iMid = box.iFirst;
+		while(iMid < box.iFirst + box.iCount - 1 && (iHalf += pColors[iMid].iCount) * 2 < iTotal)
+			iMid++;
+		iMid = max(iMid, box.iFirst) + 1;
+		iMid = min(iMid, box.iFirst + box.iCount - 1);
+
+		boxes[iBoxes].iFirst	= iMid;
+		boxes[iBoxes].iCount	= box.iFirst + box.iCount - iMid;
+		box.iCount				= iMid - box.iFirst;
+		iBoxes++;
+	}
+
+	for(int b = 0; b < iBoxes; b++)
+	{
+		pPalette[b + 1] = AverageColor(pColors, boxes[b]);
+		for(int i = boxes[b].iFirst; i < boxes[b].iFirst + boxes[b].iCount; i++)
+			pColors[i].iIndex = b + 1;
+	}
+
+	// Map the pixels through the colour sorted histogram
+	qsort(pColors, iUnique, sizeof(sColorCount), CompareColor);
+
+	for(int i = 0; i < iCount; i++)
+	{
+		pIndices[i] = 0;
+		if(pPixels[i] == 0)
+			continue;
+
+		sColorCount key;
+		key.dwColor = pPixels[i];
+		const sColorCount *pFound = (const sColorCount*)bsearch(&key, pColors, iUnique, sizeof(sColorCount), CompareColor);
+		pIndices[i] = (BYTE)pFound->iIndex;
+	}
+
+	delete[] pColors;
+	return iBoxes + 1;
+}
@@ -0,0 +1,262 @@
+//-----------------------------------------------------------------------------
+// File: Profiler.cpp
+//
+// Desc: Scoped timing zones for the hot paths. Each thread records into a
+//		buffer of its own without locks; a capture is written out as Chrome
+//		trace event JSON, which chrome://tracing and Perfetto can open.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Profiler Specific Includes
+//-----------------------------------------------------------------------------
+#include "Profiler.h"
+
+//-----------------------------------------------------------------------------
+// Main Type Declarations
+//-----------------------------------------------------------------------------
+typedef struct
+{
+	LPCSTR		strName;
+	__int64		nStart;				// Performance counter values
+	__int64		nEnd;
+} sProfileEvent;
+
+// Only the owning thread writes the events and the count. The count is
+// published after the event it covers, so a reader never sees a half
+// written event.
+typedef struct
+{
+	volatile LONG	lReady;			// Set once the thread id is filled in
+	DWORD			dwThreadId;
+	char			strName[PROFILE_NAME_LENGTH];
+	volatile LONG	lGeneration;	// Capture the events belong to
+	volatile LONG	lCount;
+	volatile LONG	lDropped;		// Zones that did not fit
+	sProfileEvent	Events[PROFILE_MAX_EVENTS];
+} sProfileBuffer;
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+// Kept static rather than allocated, pages of unused buffers are never touched
+static sProfileBuffer		g_Buffers[PROFILE_MAX_THREADS];
+static volatile LONG		g_lBufferCount	= 0;		// Slots claimed, may pass PROFILE_MAX_THREADS
+static volatile LONG		g_lRecording	= 0;
+static volatile LONG		g_lGeneration	= 0;		// Bumped by every ProfilerStart
+static __int64				g_nCaptureStart	= 0;
+
+static __declspec(thread) sProfileBuffer	*t_pBuffer		= NULL;
+static __declspec(thread) bool				t_bNoBuffer		= false;
+
+//-----------------------------------------------------------------------------
+// Name : ReadCounter ()
+// Desc : Current performance counter value.
+//-----------------------------------------------------------------------------
+static inline __int64 ReadCounter()
+{
+	__int64 nTime;
+	QueryPerformanceCounter((LARGE_INTEGER*)&nTime);
+	return nTime;
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetThreadBuffer ()
+// Desc : Returns the calling thread's buffer, claiming a free one the first
+//		time. Threads past PROFILE_MAX_THREADS get none.
+//-----------------------------------------------------------------------------
+static sProfileBuffer *GetThreadBuffer()
+{
+	if(t_pBuffer || t_bNoBuffer)
+		return t_pBuffer;
+
+	LONG lSlot = InterlockedIncrement(&g_lBufferCount) - 1;
+	if(lSlot >= PROFILE_MAX_THREADS)
+	{
+		t_bNoBuffer = true;
+		return NULL;
+	}
+
+	sProfileBuffer *pBuffer = &g_Buffers[lSlot];
+	pBuffer->dwThreadId		= GetCurrentThreadId();
+	pBuffer->lGeneration	= g_lGeneration;
+	pBuffer->lCount			= 0;
+	pBuffer->lDropped		= 0;
+	sprintf_s(pBuffer->strName, "Thread %lu", pBuffer->dwThreadId);
+	InterlockedExchange(&pBuffer->lReady, 1);
+
+	t_pBuffer = pBuffer;
+	return pBuffer;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ProfilerStart ()
+// Desc : Starts a new capture. Buffers from an older one are emptied by
+//		their own thread the next time it records, so no thread is touched
+//		from here.
+//-----------------------------------------------------------------------------
+void ProfilerStart()
+{
+	g_nCaptureStart = ReadCounter();
+	InterlockedIncrement(&g_lGeneration);
+	InterlockedExchange(&g_lRecording, 1);
+}
+
+//-----------------------------------------------------------------------------
+// Name : ProfilerStop ()
+// Desc : Stops recording. Zones still open are dropped.
+//-----------------------------------------------------------------------------
+void ProfilerStop()
+{
+	InterlockedExchange(&g_lRecording, 0);
+}
+
+//-----------------------------------------------------------------------------
+// Name : ProfilerIsRecording ()
+// Desc : True while a capture runs.
+//-----------------------------------------------------------------------------
+bool ProfilerIsRecording()
+{
+	return g_lRecording != 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ProfilerSetThreadName ()
+// Desc : Names the calling thread in the trace.
+//-----------------------------------------------------------------------------
+void ProfilerSetThreadName(LPCSTR strName)
+{
+	sProfileBuffer *pBuffer = GetThreadBuffer();
+	if(pBuffer)
+		strncpy_s(pBuffer->strName, strName, _TRUNCATE);
+}
+
+//-----------------------------------------------------------------------------
+// Name : WriteJsonString ()
+// Desc : Writes a quoted JSON string.
+//-----------------------------------------------------------------------------
+static void WriteJsonString(FILE *pFile, LPCSTR strText)
+{
+	fputc('"', pFile);
+	for(; *strText; strText++)
+	{
+		if(*strText == '"' || *strText == '\\') fputc('\\', pFile);
+		if((unsigned char)*strText >= 0x20) fputc(*strText, pFile);
+	}
+	fputc('"', pFile);
+}
+
+//-----------------------------------------------------------------------------
+// Name : ProfilerWriteTrace ()
+// Desc : Writes every thread's zones as complete ("X") events with times in
+//		microseconds from the start of the capture, plus a name record for
+//		each thread.
+//-----------------------------------------------------------------------------
+bool ProfilerWriteTrace(LPCSTR strFileName)
+{
+	FILE *pFile = NULL;
+	if(fopen_s(&pFile, strFileName, "w") != 0 || !pFile)
+		return false;
+
+	__int64 nFrequency;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&nFrequency);
+	double fToMicroseconds = 1e6 / (double)nFrequency;
+
+	fprintf(pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool bFirst = true;
+
+	LONG lGeneration	= g_lGeneration;
+	LONG nBuffers		= min(g_lBufferCount, (LONG)PROFILE_MAX_THREADS);
+	for(LONG i = 0; i < nBuffers; i++)
+	{
+		const sProfileBuffer &Buffer = g_Buffers[i];
+		if(!Buffer.lReady || Buffer.lGeneration != lGeneration)
+			continue;
+
+		char strName[PROFILE_NAME_LENGTH + 32];
+		if(Buffer.lDropped > 0)
+			sprintf_s(strName, "%s (%ld zones dropped)", Buffer.strName, Buffer.lDropped);
+		else
+			sprintf_s(strName, "%s", Buffer.strName);
+
+		fprintf(pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":",
+				bFirst ? "" : ",\n", Buffer.dwThreadId);
+		WriteJsonString(pFile, strName);
+		fprintf(pFile, "}}");
+		bFirst = false;
+
+		// Only the events published so far, the thread may still be adding
+		LONG nEvents = Buffer.lCount;
+		MemoryBarrier();
+		for(LONG j = 0; j < nEvents; j++)
+		{
+			const sProfileEvent &Event = Buffer.Events[j];
+			if(Event.nStart < g_nCaptureStart)
+				continue;
+
+			fprintf(pFile, ",\n{\"name\":");
+			WriteJsonString(pFile, Event.strName);
+			fprintf(pFile, ",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}",
+					Buffer.dwThreadId,
+					(Event.nStart - g_nCaptureStart) * fToMicroseconds,
+					(Event.nEnd - Event.nStart) * fToMicroseconds);
+		}
+	}
+
+	fprintf(pFile, "\n]}\n");
+
+	bool bResult = ferror(pFile) == 0;
+	fclose(pFile);
+	return bResult;
+}
+
+//-----------------------------------------------------------------------------
+// CProfileZone Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CProfileZone () (Constructor)
+// Desc : Starts timing, if a capture is running.
+//-----------------------------------------------------------------------------
+CProfileZone::CProfileZone(LPCSTR strName)
+{
+	m_strName	= strName;
+	m_nStart	= g_lRecording ? ReadCounter() : 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CProfileZone () (Destructor)
+// Desc : Appends the zone to the thread's buffer.
+//-----------------------------------------------------------------------------
+CProfileZone::~CProfileZone()
+{
+	if(!m_nStart || !g_lRecording)
+		return;
+
+	__int64 nEnd = ReadCounter();
+
+	sProfileBuffer *pBuffer = GetThreadBuffer();
+	if(!pBuffer)
+		return;
+
+	// First zone of a new capture
+	LONG lGeneration = g_lGeneration;
+	if(pBuffer->lGeneration != lGeneration)
+	{
+		pBuffer->lCount			= 0;
+		pBuffer->lDropped		= 0;
+		InterlockedExchange(&pBuffer->lGeneration, lGeneration);
+	}
+
+	LONG n = pBuffer->lCount;
+	if(n >= PROFILE_MAX_EVENTS)
+	{
+		pBuffer->lDropped++;
+		return;
+	}
+
+	sProfileEvent &Event = pBuffer->Events[n];
+	Event.strName	= m_strName;
+	Event.nStart	= m_nStart;
+	Event.nEnd		= nEnd;
+	InterlockedExchange(&pBuffer->lCount, n + 1);
+}
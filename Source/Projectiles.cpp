@@ -0,0 +1,356 @@
+//-----------------------------------------------------------------------------
+// File: Projectiles.cpp
+//
+// Desc: Bullets and missiles. Projectiles live in a fixed size pool that is
+//		moved and culled in one pass per frame, and are spawned by emitters
+//		that play firing patterns described by plain data tables.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CProjectilePool Specific Includes
+//-----------------------------------------------------------------------------
+#include "Projectiles.h"
+#include "Profiler.h"
+#include "VecMath.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const float TWO_PI = (float)(2.0 * PI);
+const int	EMIT_BATCH = 32;		// Velocities worked out together by PolarMany
+const float	CHECK_TIME_STEP		= 0.25f;	// Tick and shot interval of CheckShotTiming,
+const float	CHECK_SHOT_RATE		= 2.0f;		// exact in floating point
+const float	CHECK_SHOT_SPEED	= 100.0f;
+const float	CHECK_TOLERANCE		= 0.01f;	// Pixels, the velocities come from PolarMany
+
+//-----------------------------------------------------------------------------
+// CProjectilePool Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CProjectilePool () (Constructor)
+// Desc : CProjectilePool Class Constructor
+//-----------------------------------------------------------------------------
+CProjectilePool::CProjectilePool(int nCapacity)
+{
+	assert(nCapacity > 0);
+
+	m_nSprites		= 0;
+	m_nCapacity		= nCapacity;
+	m_nCount		= 0;
+	m_nDropped		= 0;
+
+	m_pPosX			= new float[nCapacity];
+	m_pPosY			= new float[nCapacity];
+	m_pPrevX		= new float[nCapacity];
+	m_pPrevY		= new float[nCapacity];
+	m_pVelX			= new float[nCapacity];
+	m_pVelY			= new float[nCapacity];
+	m_pLife			= new float[nCapacity];
+	m_pSprite		= new UCHAR[nCapacity];
+	m_pTeam			= new UCHAR[nCapacity];
+
+	ZeroMemory(m_pSprites, sizeof(m_pSprites));
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CProjectilePool () (Destructor)
+// Desc : CProjectilePool Class Destructor
+//-----------------------------------------------------------------------------
+CProjectilePool::~CProjectilePool()
+{
+	delete []m_pPosX;
+	delete []m_pPosY;
+	delete []m_pPrevX;
+	delete []m_pPrevY;
+	delete []m_pVelX;
+	delete []m_pVelY;
+	delete []m_pLife;
+	delete []m_pSprite;
+	delete []m_pTeam;
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddSprite ()
+// Desc : Registers a sprite projectiles can be drawn with, returns its id.
+//-----------------------------------------------------------------------------
+int CProjectilePool::AddSprite(Sprite *pSprite)
+{
+	for(int i = 0; i < m_nSprites; i++)
+		if(m_pSprites[i] == pSprite)
+			return i;
+
+	if(m_nSprites >= MAX_PROJECTILE_SPRITES)
+		return -1;
+
+	m_pSprites[m_nSprites] = pSprite;
+	return m_nSprites++;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Spawn ()
+// Desc : Appends a projectile.
+//-----------------------------------------------------------------------------
+bool CProjectilePool::Spawn(EProjectileTeam eTeam, int iSprite, float fX, float fY, float fVelX, float fVelY,
+							float fLifetime, float fAge)
+{
+	assert(iSprite >= 0 && iSprite < m_nSprites);
+	if(m_nCount >= m_nCapacity)
+	{
+		m_nDropped++;
+		return false;
+	}
+
+	int i = m_nCount++;
+	m_pPosX[i]		= fX + fVelX * fAge;
+	m_pPosY[i]		= fY + fVelY * fAge;
+	m_pPrevX[i]		= fX;
+	m_pPrevY[i]		= fY;
+	m_pVelX[i]		= fVelX;
+	m_pVelY[i]		= fVelY;
+	m_pLife[i]		= fLifetime - fAge;
+	m_pSprite[i]	= (UCHAR)iSprite;
+	m_pTeam[i]		= (UCHAR)eTeam;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Update ()
+// Desc : Integrates each projectile and writes the survivors back packed,
+//		keeping their order, so the pool never has holes to skip. Where a
+//		projectile was is kept, so collision can test the whole path.
+//-----------------------------------------------------------------------------
+void CProjectilePool::Update(float dt, const RECT &rcBounds)
+{
+	PROFILE_FUNCTION();
+
+	Integrate(0, m_nCount, dt);
+	Compact(rcBounds);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Integrate ()
+// Desc : Moves projectiles iBegin to iEnd - 1 and counts their lives down,
+//		keeping where they were.
+//-----------------------------------------------------------------------------
+void CProjectilePool::Integrate(int iBegin, int iEnd, float dt)
+{
+	if(iEnd <= iBegin)
+		return;
+
+	memcpy(&m_pPrevX[iBegin], &m_pPosX[iBegin], (iEnd - iBegin) * sizeof(float));
+	memcpy(&m_pPrevY[iBegin], &m_pPosY[iBegin], (iEnd - iBegin) * sizeof(float));
+	IntegrateMany(&m_pPosX[iBegin], &m_pPosY[iBegin], &m_pVelX[iBegin], &m_pVelY[iBegin], dt, iEnd - iBegin);
+
+	for(int i = iBegin; i < iEnd; i++)
+		m_pLife[i] -= dt;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Compact ()
+// Desc : Removes the spent and expired projectiles and those outside
+//		rcBounds, keeping the rest in order.
+//-----------------------------------------------------------------------------
+void CProjectilePool::Compact(const RECT &rcBounds)
+{
+	float fLeft		= (float)rcBounds.left;
+	float fTop		= (float)rcBounds.top;
+	float fRight	= (float)rcBounds.right;
+	float fBottom	= (float)rcBounds.bottom;
+
+	int j = 0;
+	for(int i = 0; i < m_nCount; i++)
+	{
+		float fX = m_pPosX[i], fY = m_pPosY[i];
+		if(m_pLife[i] <= 0.0f || fX < fLeft || fX >= fRight || fY < fTop || fY >= fBottom)
+			continue;
+
+		m_pPrevX[j]		= m_pPrevX[i];
+		m_pPrevY[j]		= m_pPrevY[i];
+		m_pPosX[j]		= fX;
+		m_pPosY[j]		= fY;
+		m_pVelX[j]		= m_pVelX[i];
+		m_pVelY[j]		= m_pVelY[i];
+		m_pLife[j]		= m_pLife[i];
+		m_pSprite[j]	= m_pSprite[i];
+		m_pTeam[j]		= m_pTeam[i];
+		j++;
+	}
+
+	m_nCount = j;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Record ()
+// Desc : Records the live projectiles, up to the packet's command limit.
+//-----------------------------------------------------------------------------
+void CProjectilePool::Record(sFramePacket *pFrame, float fAlpha) const
+{
+	// Measured back from the current position, so 1 gives it exactly
+	float fBack = 1.0f - fAlpha;
+	for(int i = 0; i < m_nCount && pFrame->nCommands < MAX_DRAW_COMMANDS; i++)
+	{
+		if(m_pLife[i] > 0.0f)
+			AddDrawCommand(pFrame, m_pSprites[m_pSprite[i]], m_pPosX[i] - (m_pPosX[i] - m_pPrevX[i]) * fBack,
+						   m_pPosY[i] - (m_pPosY[i] - m_pPrevY[i]) * fBack, -1);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// CEmitter Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CEmitter () (Constructor)
+// Desc : CEmitter Class Constructor
+//-----------------------------------------------------------------------------
+CEmitter::CEmitter()
+{
+	m_pDesc			= NULL;
+	m_eTeam			= PROJECTILE_PLAYER;
+	m_iSprite		= 0;
+	m_fTimer		= 0.0f;
+	m_fSpinAngle	= 0.0f;
+}
+
+//-----------------------------------------------------------------------------
+// Name : SetPattern ()
+// Desc : Selects the pattern to fire. The clock carries on, so switching
+//		patterns cannot be used to fire faster.
+//-----------------------------------------------------------------------------
+void CEmitter::SetPattern(const sEmitterDesc *pDesc, EProjectileTeam eTeam, int iSprite)
+{
+	m_pDesc			= pDesc;
+	m_eTeam			= eTeam;
+	m_iSprite		= iSprite;
+	m_fSpinAngle	= 0.0f;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Update ()
+// Desc : Counts down to the next shot. After a long frame at most
+//		MAX_EMITTER_SHOTS are made up for.
+//-----------------------------------------------------------------------------
+int CEmitter::Update(float dt, bool bTrigger)
+{
+	if(!m_pDesc || m_pDesc->fRate <= 0.0f)
+		return 0;
+
+	if(!bTrigger)
+	{
+		m_fTimer = max(m_fTimer - dt, 0.0f);
+		return 0;
+	}
+
+	float fInterval = 1.0f / m_pDesc->fRate;
+	int nShots = 0;
+
+	m_fTimer -= dt;
+	while(m_fTimer <= 0.0f && nShots < MAX_EMITTER_SHOTS)
+	{
+		m_fTimer		+= fInterval;
+		m_fSpinAngle	+= m_pDesc->fSpin;
+		nShots++;
+	}
+
+	if(m_fTimer <= 0.0f)
+		m_fTimer = fInterval;
+	m_fSpinAngle = fmodf(m_fSpinAngle, TWO_PI);
+
+	return nShots;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Emit ()
+// Desc : Spawns the projectiles of each shot. The last shot went off
+//		(interval - timer) seconds before the end of the tick and each
+//		earlier one an interval before that; a projectile starts as far
+//		along as it would have got by the end of the tick.
+//-----------------------------------------------------------------------------
+int CEmitter::Emit(CProjectilePool *pPool, float fX, float fY, float fAimX, float fAimY, int nShots) const
+{
+	if(!m_pDesc || nShots <= 0)
+		return 0;
+
+	const sEmitterDesc &Desc = *m_pDesc;
+	float fInterval	= 1.0f / Desc.fRate;
+	float fBase		= Desc.fAngle;
+	if(Desc.ePattern == EMIT_AIMED)
+		fBase = FastAtan2(fAimY - fY, fAimX - fX);
+
+	int nCount = Desc.ePattern == EMIT_STREAM ? 1 : max(Desc.nCount, 1);
+	float fFirst = 0.0f, fStep = 0.0f;
+	if(Desc.ePattern == EMIT_RING)
+	{
+		fStep = TWO_PI / nCount;
+	}
+	else if(nCount > 1)
+	{
+		fFirst	= -0.5f * Desc.fSpread;
+		fStep	= Desc.fSpread / (nCount - 1);
+	}
+
+	int nSpawned = 0;
+	for(int iShot = 0; iShot < nShots; iShot++)
+	{
+		int iLater		= nShots - 1 - iShot;		// Shots fired after this one
+		float fAge		= iLater * fInterval + (fInterval - m_fTimer);
+		float fAngle	= fBase + m_fSpinAngle - (iLater + 1) * Desc.fSpin + fFirst;
+
+		if(fAge >= Desc.fLifetime)
+			continue;
+
+		for(int iBatch = 0; iBatch < nCount; iBatch += EMIT_BATCH)
+		{
+			float fAngles[EMIT_BATCH], fSpeeds[EMIT_BATCH], fVelX[EMIT_BATCH], fVelY[EMIT_BATCH];
+			int nBatch = min(nCount - iBatch, EMIT_BATCH);
+			for(int i = 0; i < nBatch; i++, fAngle += fStep)
+			{
+				fAngles[i] = fAngle;
+				fSpeeds[i] = Desc.fSpeed;
+			}
+			PolarMany(fSpeeds, fAngles, fVelX, fVelY, nBatch);
+
+			for(int i = 0; i < nBatch; i++)
+			{
+				if(pPool->Spawn(m_eTeam, m_iSprite, fX, fY, fVelX[i], fVelY[i], Desc.fLifetime, fAge))
+					nSpawned++;
+			}
+		}
+	}
+
+	return nSpawned;
+}
+
+//-----------------------------------------------------------------------------
+// Shot Timing Check
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CheckShotTiming ()
+// Desc : The first shot goes off as the trigger is pressed, at the start of
+//		the first tick, and the second one interval later, which is exactly
+//		the end of the second tick. After both ticks the second shot must be
+//		at the muzzle and the first one a whole interval along.
+//-----------------------------------------------------------------------------
+bool CheckShotTiming()
+{
+	const sEmitterDesc Desc = { EMIT_STREAM, 1, 0.0f, 0.0f, 0.0f, CHECK_SHOT_SPEED, CHECK_SHOT_RATE, 10.0f };
+	const float fMuzzleX = 10.0f, fMuzzleY = 20.0f;
+
+	// Nothing is drawn, the shots need no sprite
+	CProjectilePool Pool(4);
+	CEmitter Gun;
+	Gun.SetPattern(&Desc, PROJECTILE_PLAYER, Pool.AddSprite(NULL));
+
+	for(int nTick = 0; nTick < 2; nTick++)
+	{
+		Pool.Integrate(0, Pool.GetCount(), CHECK_TIME_STEP);
+		Gun.Emit(&Pool, fMuzzleX, fMuzzleY, 0.0f, 0.0f, Gun.Update(CHECK_TIME_STEP, true));
+	}
+
+	if(Pool.GetCount() != 2)
+		return false;
+
+	float fFirstX = fMuzzleX + CHECK_SHOT_SPEED / CHECK_SHOT_RATE;
+	return fabsf(Pool.PositionX()[0] - fFirstX) < CHECK_TOLERANCE && fabsf(Pool.PositionY()[0] - fMuzzleY) < CHECK_TOLERANCE &&
+		   fabsf(Pool.PositionX()[1] - fMuzzleX) < CHECK_TOLERANCE && fabsf(Pool.PositionY()[1] - fMuzzleY) < CHECK_TOLERANCE;
+}
@@ -0,0 +1,51 @@
+//-----------------------------------------------------------------------------
+// File: Simd.cpp
+//
+// Desc: SIMD instruction set selection shared by the software renderer and
+//		the batch math code. SSE2 is used whenever the compiler targets it,
+//		AVX2 paths are compiled in and picked at run time if the CPU has it.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Simd Specific Includes
+//-----------------------------------------------------------------------------
+#include "Simd.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//-----------------------------------------------------------------------------
+// Name : CpuHasAVX2 ()
+// Desc : Queries CPUID once. The OS must also save the YMM registers on
+//		context switch, which XGETBV reports.
+//-----------------------------------------------------------------------------
+bool CpuHasAVX2()
+{
+#if defined(SIMD_AVX2) && defined(_MSC_VER)
+	static int iHasAVX2 = -1;
+
+	if(iHasAVX2 < 0)
+	{
+		int info[4];
+		iHasAVX2 = 0;
+
+		__cpuid(info, 1);
+		bool bOSXSave = (info[2] & (1 << 27)) != 0;
+		bool bAVX = (info[2] & (1 << 28)) != 0;
+
+		if(bOSXSave && bAVX && (_xgetbv(0) & 6) == 6)
+		{
+			__cpuidex(info, 7, 0);
+			iHasAVX2 = (info[1] & (1 << 5)) ? 1 : 0;
+		}
+	}
+
+	return iHasAVX2 != 0;
+#elif defined(SIMD_AVX2)
+	// built with -mavx2, the whole program already requires it
+	return true;
+#else
+	return false;
+#endif
+}
@@ -1,4 +1,11 @@
 #include "Sprite.h"
+#include "BroadPhase.h"
+#include "Profiler.h"
+#include "Telemetry.h"
+
+// Most masks sampled along one swept move, a very long move is sampled
+// more sparsely rather than taking longer
+const int MAX_SWEEP_STEPS = 64;
 
 extern HINSTANCE g_hInst;
 
@@ -18,6 +25,10 @@ Sprite::Sprite(int imageID, int maskID)
 
 	mcTransparentColor = 0;
 	mhSpriteDC = 0;
+	mpBackBuffer = NULL;
+	mpAtlas = NULL;
+	miAtlasEntry = -1;
+	initTransform();
 }
 
 Sprite::Sprite(const char *szImageFile, const char *szMaskFile)
@@ -35,6 +46,10 @@ Sprite::Sprite(const char *szImageFile, const char *szMaskFile)
 
 	mcTransparentColor = 0;
 	mhSpriteDC = 0;
+	mpBackBuffer = NULL;
+	mpAtlas = NULL;
+	miAtlasEntry = -1;
+	initTransform();
 }
 
 Sprite::Sprite(const char *szImageFile, COLORREF crTransparentColor)
@@ -44,11 +59,74 @@ Sprite::Sprite(const char *szImageFile, COLORREF crTransparentColor)
 	mhMask = 0;
 	mhSpriteDC = 0;
 	mcTransparentColor = crTransparentColor;
+	mpBackBuffer = NULL;
+	mpAtlas = NULL;
+	miAtlasEntry = -1;
+	initTransform();
 
 	// Get the BITMAP structure for the bitmap.
 	GetObject(mhImage, sizeof(BITMAP), &mImageBM);
 }
 
+Sprite::Sprite(CSpriteAtlas *pAtlas, const char *szImageFile, const char *szMaskFile)
+{
+	initAtlas(pAtlas, pAtlas->AddImage(szImageFile, szMaskFile, ATLAS_RGB));
+}
+
+Sprite::Sprite(CSpriteAtlas *pAtlas, const char *szImageFile, COLORREF crTransparentColor)
+{
+	// The atlas turns the colour key into a mask when packing the image,
+	// so keyed sprites are drawn exactly like masked ones afterwards.
+	initAtlas(pAtlas, pAtlas->AddImage(szImageFile, crTransparentColor, ATLAS_RGB));
+}
+
+Sprite::Sprite(CSpriteAtlas *pAtlas, const char *szImageFile, const char *szMaskFile, EAtlasFormat eFormat)
+{
+	initAtlas(pAtlas, pAtlas->AddImage(szImageFile, szMaskFile, eFormat));
+}
+
+Sprite::Sprite(CSpriteAtlas *pAtlas, const char *szImageFile, COLORREF crTransparentColor, EAtlasFormat eFormat)
+{
+	initAtlas(pAtlas, pAtlas->AddImage(szImageFile, crTransparentColor, eFormat));
+}
+
+void Sprite::initAtlas(CSpriteAtlas *pAtlas, int iEntry)
+{
+	mhImage = 0;
+	mhMask = 0;
+	mhSpriteDC = 0;
+	mcTransparentColor = 0;
+	mpBackBuffer = NULL;
+	mpAtlas = pAtlas;
+	miAtlasEntry = iEntry;
+	initTransform();
+
+	ZeroMemory(&mImageBM, sizeof(BITMAP));
+	if(iEntry >= 0)
+	{
+		const RECT &rc = pAtlas->GetRect(iEntry);
+		mImageBM.bmWidth = rc.right - rc.left;
+		mImageBM.bmHeight = rc.bottom - rc.top;
+	}
+	mMaskBM = mImageBM;
+}
+
+void Sprite::initTransform()
+{
+	mfAngle = 0.0f;
+	mfScaleX = 1.0f;
+	mfScaleY = 1.0f;
+	meFilter = BLIT_NEAREST;
+	meBlend = BLEND_MASK;
+}
+
+void Sprite::setTransform(float fAngle, float fScaleX, float fScaleY)
+{
+	mfAngle = fAngle;
+	mfScaleX = fScaleX;
+	mfScaleY = fScaleY;
+}
+
 Sprite::~Sprite()
 {
 	// Free the resources we created in the constructor.
@@ -69,7 +147,9 @@ void Sprite::update(float dt)
 void Sprite::setBackBuffer(const BackBuffer *pBackBuffer)
 {
 	mpBackBuffer = pBackBuffer;
-	if(mpBackBuffer)
+
+	// Atlas sprites blit straight from the atlas page DCs
+	if(mpBackBuffer && !mpAtlas)
 	{
 		DeleteDC(mhSpriteDC);
 		mhSpriteDC = CreateCompatibleDC(mpBackBuffer->getDC());
@@ -78,19 +158,24 @@ void Sprite::setBackBuffer(const BackBuffer *pBackBuffer)
 
 void Sprite::draw()
 {
-	if( mhMask != 0 )
-		drawMask();
+	drawAt(mPosition.x, mPosition.y, -1);
+}
+
+void Sprite::drawAt(float fX, float fY, int iFrame)
+{
+	PROFILE_ZONE("Sprite::draw");
+
+	if( mhMask != 0 || mpAtlas != NULL )
+		drawMask(fX, fY);
 	else
-		drawTransparent();
+		drawTransparent(fX, fY);
 }
 
-void Sprite::drawMask()
+void Sprite::drawMask(float fX, float fY)
 {
 	if( mpBackBuffer == NULL )
 		return;
 
-	HDC hBackBufferDC = mpBackBuffer->getDC();
-
 	// The position BitBlt wants is not the sprite's center
 	// position; rather, it wants the upper-left position,
 	// so compute that.
@@ -98,12 +183,135 @@ void Sprite::drawMask()
 	int h = height();
 
 	// Upper-left corner.
-	int x = (int)mPosition.x - (w / 2);
-	int y = (int)mPosition.y - (h / 2);
+	int x = (int)fX - (w / 2);
+	int y = (int)fY - (h / 2);
+
+	blitMasked(x, y, w, h, 0, 0);
+}
+
+void Sprite::getFrameRect(int iFrame, RECT &rc) const
+{
+	SetRect(&rc, 0, 0, mImageBM.bmWidth, mImageBM.bmHeight);
+}
+
+void Sprite::getBounds(float fX, float fY, int iFrame, RECT &rc) const
+{
+	RECT rcFrame;
+	getFrameRect(iFrame, rcFrame);
+
+	// Same upper-left corner as drawMask
+	int w = rcFrame.right - rcFrame.left;
+	int h = rcFrame.bottom - rcFrame.top;
+	rc.left = (int)fX - (w / 2);
+	rc.top = (int)fY - (h / 2);
+	rc.right = rc.left + w;
+	rc.bottom = rc.top + h;
+}
+
+bool Sprite::collides(float fX, float fY, int iFrame, const Sprite &other, float fOtherX, float fOtherY, int iOtherFrame) const
+{
+	RECT rcA, rcB, rcShared;
+	getBounds(fX, fY, iFrame, rcA);
+	other.getBounds(fOtherX, fOtherY, iOtherFrame, rcB);
+	if( !IntersectRect(&rcShared, &rcA, &rcB) )
+		return false;
+
+	const CCollisionMask *pMask = (mpAtlas && miAtlasEntry >= 0) ? mpAtlas->GetCollisionMask(miAtlasEntry) : NULL;
+	const CCollisionMask *pOtherMask = (other.mpAtlas && other.miAtlasEntry >= 0) ? other.mpAtlas->GetCollisionMask(other.miAtlasEntry) : NULL;
+
+	// A sprite without a mask is solid, so the other one decides alone
+	RECT rcFrame, rcOtherFrame;
+	getFrameRect(iFrame, rcFrame);
+	other.getFrameRect(iOtherFrame, rcOtherFrame);
+	if( pMask && pOtherMask )
+		return CCollisionMask::Overlap(*pMask, rcFrame, rcA.left, rcA.top, *pOtherMask, rcOtherFrame, rcB.left, rcB.top);
+
+	if( !pMask && !pOtherMask )
+		return true;
+
+	// Test the masked sprite's pixels inside the shared rectangle
+	const CCollisionMask *pSolid = pMask ? pMask : pOtherMask;
+	const RECT &rcSolid = pMask ? rcFrame : rcOtherFrame;
+	const RECT &rcPlaced = pMask ? rcA : rcB;
+	for( int y = rcShared.top; y < rcShared.bottom; y++ )
+		for( int x = rcShared.left; x < rcShared.right; x++ )
+			if( pSolid->IsSolid(rcSolid.left + x - rcPlaced.left, rcSolid.top + y - rcPlaced.top) )
+				return true;
+
+	return false;
+}
+
+bool Sprite::sweeps(float fFromX, float fFromY, float fToX, float fToY, int iFrame,
+					const Sprite &other, float fOtherX, float fOtherY, int iOtherFrame, float &fTime) const
+{
+	// The boxes give the part of the move where the sprites can touch at all
+	RECT rcFrom, rcOther;
+	getBounds(fFromX, fFromY, iFrame, rcFrom);
+	other.getBounds(fOtherX, fOtherY, iOtherFrame, rcOther);
+
+	float fDeltaX = fToX - fFromX;
+	float fDeltaY = fToY - fFromY;
+	float fEnter, fExit;
+	if( !SweepRect(rcFrom, fDeltaX, fDeltaY, rcOther, fEnter, fExit) )
+		return false;
+
+	// Step by half the smallest side so a solid sprite cannot step over
+	// the other one, then test the masks at each step.
+	int nSide = min(min(rcFrom.right - rcFrom.left, rcFrom.bottom - rcFrom.top),
+					min(rcOther.right - rcOther.left, rcOther.bottom - rcOther.top));
+	float fStep = max(nSide * 0.5f, 1.0f);
+	float fLength = sqrtf(fDeltaX * fDeltaX + fDeltaY * fDeltaY) * (fExit - fEnter);
+	int nSteps = min((int)ceilf(fLength / fStep), MAX_SWEEP_STEPS);
+
+	for( int i = 0; i <= nSteps; i++ )
+	{
+		float t = nSteps ? fEnter + (fExit - fEnter) * i / nSteps : fEnter;
+		if( collides(fFromX + fDeltaX * t, fFromY + fDeltaY * t, iFrame, other, fOtherX, fOtherY, iOtherFrame) )
+		{
+			fTime = t;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Sprite::blitMasked(int x, int y, int w, int h, int srcX, int srcY)
+{
+	HDC hBackBufferDC = mpBackBuffer->getDC();
+
+	TelemetryCount(TELEMETRY_SPRITES);
+	TelemetryCount(TELEMETRY_PIXELS, w * h);
 
 	// Note: For this masking technique to work, it is assumed
 	// the backbuffer bitmap has been cleared to some
 	// non-zero value.
+	if( mpAtlas != NULL )
+	{
+		if( miAtlasEntry < 0 )
+			return;
+
+		// Indexed pages have no DC, they are always drawn in software
+		if( mpAtlas->GetFormat(miAtlasEntry) == ATLAS_INDEXED )
+		{
+			if( !blitTransformed(x, y, w, h, srcX, srcY) )
+				blitIndexed(x, y, w, h, srcX, srcY);
+			return;
+		}
+
+		if( blitTransformed(x, y, w, h, srcX, srcY) || blitBlended(x, y, w, h, srcX, srcY) )
+			return;
+
+		// The atlas pages stay selected into their own DCs, so all that
+		// is needed is to offset the source by the sprite's place in the page.
+		int iPage = mpAtlas->GetPage(miAtlasEntry);
+		const RECT &rc = mpAtlas->GetRect(miAtlasEntry);
+
+		BitBlt(hBackBufferDC, x, y, w, h, mpAtlas->GetMaskDC(iPage), rc.left + srcX, rc.top + srcY, SRCAND);
+		BitBlt(hBackBufferDC, x, y, w, h, mpAtlas->GetImageDC(iPage), rc.left + srcX, rc.top + srcY, SRCPAINT);
+		return;
+	}
+
 	// Select the mask bitmap.
 	HGDIOBJ oldObj = SelectObject(mhSpriteDC, mhMask);
 
@@ -111,7 +319,7 @@ void Sprite::drawMask()
 	// only draws the black pixels in the mask to the backbuffer,
 	// thereby marking the pixels we want to draw the sprite
 	// image onto.
-	BitBlt(hBackBufferDC, x, y, w, h, mhSpriteDC, 0, 0, SRCAND);
+	BitBlt(hBackBufferDC, x, y, w, h, mhSpriteDC, srcX, srcY, SRCAND);
 
 	// Now select the image bitmap.
 	SelectObject(mhSpriteDC, mhImage);
@@ -119,13 +327,107 @@ void Sprite::drawMask()
 	// Draw the image to the backbuffer with SRCPAINT. This
 	// will only draw the image onto the pixels that where previously
 	// marked black by the mask.
-	BitBlt(hBackBufferDC, x, y, w, h, mhSpriteDC, 0, 0, SRCPAINT);
+	BitBlt(hBackBufferDC, x, y, w, h, mhSpriteDC, srcX, srcY, SRCPAINT);
 
 	// Restore the original bitmap object.
 	SelectObject(mhSpriteDC, oldObj);
 }
 
-void Sprite::drawTransparent()
+bool Sprite::blitTransformed(int x, int y, int w, int h, int srcX, int srcY)
+{
+	// Upright, unscaled sprites are left to GDI
+	if( mfAngle == 0.0f && mfScaleX == 1.0f && mfScaleY == 1.0f )
+		return false;
+
+	DWORD *pBits = mpBackBuffer->getBits();
+	if( pBits == NULL )
+		return false;
+
+	int iPage = mpAtlas->GetPage(miAtlasEntry);
+	const RECT &rc = mpAtlas->GetRect(miAtlasEntry);
+
+	sSurface dst = { pBits, mpBackBuffer->width(), mpBackBuffer->height(), mpBackBuffer->pitch() };
+	RECT rcSrc = { rc.left + srcX, rc.top + srcY, rc.left + srcX + w, rc.top + srcY + h };
+
+	// Positions are in window coordinates, the surface may be smaller
+	float fRenderScale = mpBackBuffer->getRenderScale();
+
+	sBlitTransform xf;
+	xf.fCenterX = (x + w * 0.5f) * fRenderScale;
+	xf.fCenterY = (y + h * 0.5f) * fRenderScale;
+	xf.fAngle = mfAngle;
+	xf.fScaleX = mfScaleX * fRenderScale;
+	xf.fScaleY = mfScaleY * fRenderScale;
+	xf.eFilter = meFilter;
+
+	// Make sure GDI has finished drawing into the backbuffer
+	// before writing its pixels directly.
+	GdiFlush();
+
+	// Indexed sprites blend through their palette as they do upright
+	if( mpAtlas->GetFormat(miAtlasEntry) == ATLAS_INDEXED )
+	{
+		sSurface8 src = { mpAtlas->GetIndexBits(iPage), ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE };
+		BlitAffineIndexed(dst, src, rcSrc, mpAtlas->GetPalette(miAtlasEntry), meBlend, xf);
+		return true;
+	}
+
+	sSurface src = { mpAtlas->GetImageBits(iPage), ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE };
+	sSurface mask = { mpAtlas->GetMaskBits(iPage), ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE };
+	BlitAffine(dst, src, rcSrc, &mask, false, 0, xf);
+	return true;
+}
+
+bool Sprite::blitBlended(int x, int y, int w, int h, int srcX, int srcY)
+{
+	if( meBlend == BLEND_MASK )
+		return false;
+
+	DWORD *pBits = mpBackBuffer->getBits();
+	if( pBits == NULL )
+		return false;
+
+	int iPage = mpAtlas->GetPage(miAtlasEntry);
+	const RECT &rc = mpAtlas->GetRect(miAtlasEntry);
+
+	sSurface dst = { pBits, mpBackBuffer->width(), mpBackBuffer->height(), mpBackBuffer->pitch() };
+	sSurface src = { mpAtlas->GetImageBits(iPage), ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE };
+
+	RECT rcSrc = { rc.left + srcX, rc.top + srcY, rc.left + srcX + w, rc.top + srcY + h };
+
+	GdiFlush();
+	float fRenderScale = mpBackBuffer->getRenderScale();
+	if( fRenderScale < 1.0f )
+		BlitBlendScaled(dst, x * fRenderScale, y * fRenderScale, fRenderScale, src, rcSrc, meBlend);
+	else
+		BlitBlend(dst, x, y, src, rcSrc, meBlend);
+	return true;
+}
+
+void Sprite::blitIndexed(int x, int y, int w, int h, int srcX, int srcY)
+{
+	DWORD *pBits = mpBackBuffer->getBits();
+	if( pBits == NULL )
+		return;
+
+	int iPage = mpAtlas->GetPage(miAtlasEntry);
+	const RECT &rc = mpAtlas->GetRect(miAtlasEntry);
+
+	sSurface dst = { pBits, mpBackBuffer->width(), mpBackBuffer->height(), mpBackBuffer->pitch() };
+	sSurface8 src = { mpAtlas->GetIndexBits(iPage), ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE };
+
+	RECT rcSrc = { rc.left + srcX, rc.top + srcY, rc.left + srcX + w, rc.top + srcY + h };
+
+	GdiFlush();
+	float fRenderScale = mpBackBuffer->getRenderScale();
+	if( fRenderScale < 1.0f )
+		BlitIndexedScaled(dst, x * fRenderScale, y * fRenderScale, fRenderScale, src, rcSrc,
+						  mpAtlas->GetPalette(miAtlasEntry), meBlend);
+	else
+		BlitIndexed(dst, x, y, src, rcSrc, mpAtlas->GetPalette(miAtlasEntry), meBlend);
+}
+
+void Sprite::drawTransparent(float fX, float fY)
 {
 	if( mpBackBuffer == NULL )
 		return;
@@ -136,8 +438,8 @@ void Sprite::drawTransparent()
 	int h = height();
 
 	// Upper-left corner.
-	int x = (int)mPosition.x - (w / 2);
-	int y = (int)mPosition.y - (h / 2);
+	int x = (int)fX - (w / 2);
+	int y = (int)fY - (h / 2);
 
 	COLORREF crOldBack = SetBkColor(hBackBuffer, RGB(255, 255, 255));
 	COLORREF crOldText = SetTextColor(hBackBuffer, RGB(0, 0, 0));
@@ -179,63 +481,69 @@ void Sprite::drawTransparent()
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-AnimatedSprite::AnimatedSprite(const char *szImageFile, const char *szMaskFile, const RECT& rcFirstFrame, int iFrameCount) 
-			: Sprite (szImageFile, szMaskFile)
+AnimatedSprite::AnimatedSprite(const char *szImageFile, const char *szMaskFile, const RECT& rcFirstFrame, int iColumns, int iRows, int iFrameCount) 
+			: Sprite (szImageFile, szMaskFile), mSheet(rcFirstFrame, iColumns, iRows, iFrameCount)
+{
+	miFrameWidth = mSheet.GetFrameWidth();
+	miFrameHeight = mSheet.GetFrameHeight();
+	SetFrame(0);
+}
+
+AnimatedSprite::AnimatedSprite(CSpriteAtlas *pAtlas, const char *szImageFile, const char *szMaskFile, const RECT& rcFirstFrame, int iColumns, int iRows, int iFrameCount) 
+			: Sprite (pAtlas, szImageFile, szMaskFile), mSheet(rcFirstFrame, iColumns, iRows, iFrameCount)
 {
-	mptFrameCrop.x = rcFirstFrame.left;
-	mptFrameCrop.y = rcFirstFrame.top;
-	mptFrameStartCrop = mptFrameCrop;
-	miFrameWidth = rcFirstFrame.right - rcFirstFrame.left;
-	miFrameHeight = rcFirstFrame.bottom - rcFirstFrame.top;
-	miFrameCount = iFrameCount;
+	// The whole sheet is packed as one atlas entry, frame crops stay
+	// relative to the sheet and blitMasked adds the page offset.
+	miFrameWidth = mSheet.GetFrameWidth();
+	miFrameHeight = mSheet.GetFrameHeight();
+	SetFrame(0);
 }
 
 void AnimatedSprite::SetFrame(int iIndex)
 {
 	// index must be in range
-	assert(iIndex >= 0 && iIndex < miFrameCount && "AnimatedSprite frame Index must be in range!");
+	assert(iIndex >= 0 && iIndex < mSheet.GetFrameCount() && "AnimatedSprite frame Index must be in range!");
 
-	mptFrameCrop.x = mptFrameStartCrop.x + iIndex%4*miFrameWidth;
-	mptFrameCrop.y = mptFrameStartCrop.y + (int)iIndex/4*miFrameHeight;
+	const RECT &rc = mSheet.GetFrame(iIndex);
+	mptFrameCrop.x = rc.left;
+	mptFrameCrop.y = rc.top;
 }
 
-void AnimatedSprite::draw()
+void AnimatedSprite::getFrameRect(int iFrame, RECT &rc) const
 {
+	if( iFrame >= 0 )
+	{
+		rc = mSheet.GetFrame(iFrame);
+		return;
+	}
+
+	SetRect(&rc, mptFrameCrop.x, mptFrameCrop.y, mptFrameCrop.x + miFrameWidth, mptFrameCrop.y + miFrameHeight);
+}
+
+void AnimatedSprite::drawAt(float fX, float fY, int iFrame)
+{
+	PROFILE_ZONE("AnimatedSprite::draw");
+
 	if( mpBackBuffer == NULL )
 		return;
 
+	POINT ptCrop = mptFrameCrop;
+	if( iFrame >= 0 )
+	{
+		const RECT &rc = mSheet.GetFrame(iFrame);
+		ptCrop.x = rc.left;
+		ptCrop.y = rc.top;
+	}
+
 	// The position BitBlt wants is not the sprite's center
 	// position; rather, it wants the upper-left position,
 	// so compute that.
 	int w = miFrameWidth;
 	int h = miFrameHeight;
 
-	HDC hBackBufferDC = mpBackBuffer->getDC();
-
 	// Upper-left corner.
-	int x = (int)mPosition.x - (w / 2);
-	int y = (int)mPosition.y - (h / 2);
+	int x = (int)fX - (w / 2);
+	int y = (int)fY - (h / 2);
 
-	// Note: For this masking technique to work, it is assumed
-	// the backbuffer bitmap has been cleared to some
-	// non-zero value.
-	// Select the mask bitmap.
-	HGDIOBJ oldObj = SelectObject(mhSpriteDC, mhMask);
-
-	// Draw the mask to the backbuffer with SRCAND. This
-	// only draws the black pixels in the mask to the backbuffer,
-	// thereby marking the pixels we want to draw the sprite
-	// image onto.
-	BitBlt(hBackBufferDC, x, y, w, h, mhSpriteDC, mptFrameCrop.x, mptFrameCrop.y, SRCAND);
-
-	// Now select the image bitmap.
-	SelectObject(mhSpriteDC, mhImage);
-
-	// Draw the image to the backbuffer with SRCPAINT. This
-	// will only draw the image onto the pixels that where previously
-	// marked black by the mask.
-	BitBlt(hBackBufferDC, x, y, w, h, mhSpriteDC, mptFrameCrop.x, mptFrameCrop.y, SRCPAINT);
-
-	// Restore the original bitmap object.
-	SelectObject(mhSpriteDC, oldObj);
+	blitMasked(x, y, w, h, ptCrop.x, ptCrop.y);
 }
\ No newline at end of file
@@ -0,0 +1,435 @@
+//-----------------------------------------------------------------------------
+// File: SpriteAtlas.cpp
+//
+// Desc: Load-time sprite atlas. Sprite images and their masks are packed into
+//		a few large 32 bit pages so that drawing never has to switch the
+//		bitmap selected into a DC and neighbouring sprites share memory.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CSpriteAtlas Specific Includes
+//-----------------------------------------------------------------------------
+#include "SpriteAtlas.h"
+#include "Profiler.h"
+
+extern HINSTANCE g_hInst;
+
+//-----------------------------------------------------------------------------
+// CSkylinePacker Member Functions
+//-----------------------------------------------------------------------------
+CSkylinePacker::CSkylinePacker(int iWidth, int iHeight)
+{
+	m_Width		= iWidth;
+	m_Height	= iHeight;
+
+	// Start with a single segment lying on the floor of the bin
+	m_Nodes[0].x		= 0;
+	m_Nodes[0].y		= 0;
+	m_Nodes[0].width	= iWidth;
+	m_NodeCount			= 1;
+}
+
+bool CSkylinePacker::Insert(int w, int h, int &x, int &y)
+{
+	int iBestNode	= -1;
+	int iBestY		= m_Height;
+	int iBestWidth	= m_Width;
+
+	// every segment adds at most one node, so stop when there is no room left
+	if(m_NodeCount >= ATLAS_MAX_ENTRIES + 1)
+		return false;
+
+	for(int i = 0; i < m_NodeCount; i++)
+	{
+		int iY = Fit(i, w, h);
+		if(iY < 0)
+			continue;
+
+		// bottom-left rule, break ties with the narrowest segment
+		if(iY < iBestY || (iY == iBestY && m_Nodes[i].width < iBestWidth))
+		{
+			iBestNode	= i;
+			iBestY		= iY;
+			iBestWidth	= m_Nodes[i].width;
+		}
+	}
+
+	if(iBestNode < 0)
+		return false;
+
+	x = m_Nodes[iBestNode].x;
+	y = iBestY;
+	AddLevel(iBestNode, x, y, w, h);
+	return true;
+}
+
+int CSkylinePacker::Fit(int iNode, int w, int h) const
+{
+	int x = m_Nodes[iNode].x;
+	if(x + w > m_Width)
+		return -1;
+
+	// the rectangle rests on the highest segment it spans
+	int y = m_Nodes[iNode].y;
+	int iWidthLeft = w;
+	for(int i = iNode; iWidthLeft > 0; i++)
+	{
+		y = max(y, m_Nodes[i].y);
+		if(y + h > m_Height)
+			return -1;
+		iWidthLeft -= m_Nodes[i].width;
+	}
+
+	return y;
+}
+
+void CSkylinePacker::AddLevel(int iNode, int x, int y, int w, int h)
+{
+	// insert the new top edge
+	memmove(&m_Nodes[iNode + 1], &m_Nodes[iNode], (m_NodeCount - iNode) * sizeof(sSkylineNode));
+	m_Nodes[iNode].x		= x;
+	m_Nodes[iNode].y		= y + h;
+	m_Nodes[iNode].width	= w;
+	m_NodeCount++;
+
+	// shrink or drop the segments now hidden under it
+	for(int i = iNode + 1; i < m_NodeCount; )
+	{
+		int iPrevEnd = m_Nodes[i - 1].x + m_Nodes[i - 1].width;
+		if(m_Nodes[i].x >= iPrevEnd)
+			break;
+
+		int iShrink = iPrevEnd - m_Nodes[i].x;
+		m_Nodes[i].x		+= iShrink;
+		m_Nodes[i].width	-= iShrink;
+
+		if(m_Nodes[i].width > 0)
+			break;
+
+		RemoveNode(i);
+	}
+
+	// merge neighbours at the same height
+	for(int i = 0; i < m_NodeCount - 1; )
+	{
+		if(m_Nodes[i].y == m_Nodes[i + 1].y)
+		{
+			m_Nodes[i].width += m_Nodes[i + 1].width;
+			RemoveNode(i + 1);
+		}
+		else
+			i++;
+	}
+}
+
+void CSkylinePacker::RemoveNode(int iNode)
+{
+	memmove(&m_Nodes[iNode], &m_Nodes[iNode + 1], (m_NodeCount - iNode - 1) * sizeof(sSkylineNode));
+	m_NodeCount--;
+}
+
+//-----------------------------------------------------------------------------
+// CSpriteAtlas Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CSpriteAtlas () (Constructor)
+// Desc : CSpriteAtlas Class Constructor
+//-----------------------------------------------------------------------------
+CSpriteAtlas::CSpriteAtlas()
+{
+	ZeroMemory(m_Pages, sizeof(m_Pages));
+	ZeroMemory(m_Entries, sizeof(m_Entries));
+	m_PageCount		= 0;
+	m_EntryCount	= 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CSpriteAtlas () (Destructor)
+// Desc : CSpriteAtlas Class Destructor
+//-----------------------------------------------------------------------------
+CSpriteAtlas::~CSpriteAtlas()
+{
+	for(int i = 0; i < m_PageCount; i++)
+	{
+		sAtlasPage &page = m_Pages[i];
+
+		if(page.eFormat == ATLAS_RGB)
+		{
+			SelectObject(page.hImageDC, page.hOldImage);
+			SelectObject(page.hMaskDC, page.hOldMask);
+			DeleteDC(page.hImageDC);
+			DeleteDC(page.hMaskDC);
+			DeleteObject(page.hImage);
+			DeleteObject(page.hMask);
+		}
+
+		delete[] page.pIndexBits;
+		delete page.pPacker;
+	}
+
+	for(int i = 0; i < m_EntryCount; i++)
+		delete m_Entries[i].pCollision;
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddImage ()
+// Desc : Packs an image that comes with a separate mask file. Returns the
+//		entry index or -1 if the files could not be loaded or packed.
+//-----------------------------------------------------------------------------
+int CSpriteAtlas::AddImage(const char *szImageFile, const char *szMaskFile, EAtlasFormat eFormat)
+{
+	int iEntry = FindEntry(szImageFile, szMaskFile, 0, eFormat);
+	if(iEntry >= 0)
+		return iEntry;
+
+	return AddEntry(szImageFile, szMaskFile, 0, eFormat);
+}
+
+//-----------------------------------------------------------------------------
+// Name : AddImage ()
+// Desc : Packs a colour keyed image, its mask is built from the key colour.
+//-----------------------------------------------------------------------------
+int CSpriteAtlas::AddImage(const char *szImageFile, COLORREF crTransparentColor, EAtlasFormat eFormat)
+{
+	int iEntry = FindEntry(szImageFile, "", crTransparentColor, eFormat);
+	if(iEntry >= 0)
+		return iEntry;
+
+	return AddEntry(szImageFile, "", crTransparentColor, eFormat);
+}
+
+int CSpriteAtlas::FindEntry(const char *szImageFile, const char *szMaskFile, COLORREF crTransparentColor, EAtlasFormat eFormat) const
+{
+	for(int i = 0; i < m_EntryCount; i++)
+	{
+		const sAtlasEntry &e = m_Entries[i];
+		if(_stricmp(e.szImageFile, szImageFile) == 0 &&
+		   _stricmp(e.szMaskFile, szMaskFile) == 0 &&
+		   e.crTransparentColor == crTransparentColor &&
+		   e.eFormat == eFormat)
+			return i;
+	}
+
+	return -1;
+}
+
+int CSpriteAtlas::AddEntry(const char *szImageFile, const char *szMaskFile, COLORREF crTransparentColor, EAtlasFormat eFormat)
+{
+	PROFILE_FUNCTION();
+
+	if(m_EntryCount >= ATLAS_MAX_ENTRIES)
+		return -1;
+
+	int w, h;
+	DWORD *pImage = LoadBits(szImageFile, w, h);
+	if(!pImage)
+		return -1;
+
+	DWORD *pMask = NULL;
+	if(szMaskFile[0])
+	{
+		int mw, mh;
+		pMask = LoadBits(szMaskFile, mw, mh);
+
+		// Image and Mask should be the same dimensions.
+		if(!pMask || mw != w || mh != h)
+		{
+			delete[] pImage;
+			delete[] pMask;
+			return -1;
+		}
+	}
+	else
+	{
+		// Build the mask once here instead of on every draw: white where
+		// the key colour is, black elsewhere. The keyed pixels are turned
+		// black so the image can be drawn with SRCPAINT like any other.
+		// GDI stores COLORREF as 0x00BBGGRR, DIB pixels are 0x00RRGGBB
+		DWORD dwKey = (GetRValue(crTransparentColor) << 16) | (GetGValue(crTransparentColor) << 8) | GetBValue(crTransparentColor);
+
+		pMask = new DWORD[w * h];
+		for(int i = 0; i < w * h; i++)
+		{
+			bool bTransparent = (pImage[i] & 0x00FFFFFF) == dwKey;
+			pMask[i] = bTransparent ? 0x00FFFFFF : 0;
+		}
+	}
+
+	// Grey levels in the mask become alpha (black = opaque), and the
+	// colour is premultiplied by it so blending needs one multiply.
+	for(int i = 0; i < w * h; i++)
+	{
+		DWORD m		= pMask[i];
+		DWORD a		= 255 - ((((m >> 16) & 0xFF) * 77 + ((m >> 8) & 0xFF) * 150 + (m & 0xFF) * 29) >> 8);
+		DWORD c		= pImage[i];
+		pImage[i]	= (a << 24) |
+					  (((((c >> 16) & 0xFF) * a + 127) / 255) << 16) |
+					  (((((c >> 8) & 0xFF) * a + 127) / 255) << 8) |
+					  (((c & 0xFF) * a + 127) / 255);
+	}
+
+	int iPage, x, y;
+	if(!Allocate(w + ATLAS_PADDING, h + ATLAS_PADDING, eFormat, iPage, x, y))
+	{
+		delete[] pImage;
+		delete[] pMask;
+		return -1;
+	}
+
+	sAtlasPage &page = m_Pages[iPage];
+	sAtlasEntry &e = m_Entries[m_EntryCount];
+
+	// The alpha now holds the mask whatever it came from, file or key
+	e.pCollision = new CCollisionMask;
+	e.pCollision->Build(pImage, w, w, h);
+
+	if(eFormat == ATLAS_INDEXED)
+	{
+		// An image that already has at most 255 colours (such as an 8 bit
+		// source) keeps them exactly, others are reduced by median cut.
+		BYTE *pIndices = new BYTE[w * h];
+		QuantizeImage(pImage, w * h, e.dwPalette, pIndices);
+
+		for(int j = 0; j < h; j++)
+			memcpy(&page.pIndexBits[(y + j) * ATLAS_PAGE_SIZE + x], &pIndices[j * w], w);
+
+		delete[] pIndices;
+	}
+	else
+	{
+		// Make sure GDI is done with the page before touching its bits
+		GdiFlush();
+
+		for(int j = 0; j < h; j++)
+		{
+			memcpy(&page.pImageBits[(y + j) * ATLAS_PAGE_SIZE + x], &pImage[j * w], w * sizeof(DWORD));
+			memcpy(&page.pMaskBits[(y + j) * ATLAS_PAGE_SIZE + x], &pMask[j * w], w * sizeof(DWORD));
+		}
+	}
+
+	delete[] pImage;
+	delete[] pMask;
+
+	strcpy_s(e.szImageFile, MAX_PATH, szImageFile);
+	strcpy_s(e.szMaskFile, MAX_PATH, szMaskFile);
+	e.crTransparentColor	= crTransparentColor;
+	e.eFormat				= eFormat;
+	e.iPage					= iPage;
+	e.rc.left				= x;
+	e.rc.top				= y;
+	e.rc.right				= x + w;
+	e.rc.bottom				= y + h;
+
+	return m_EntryCount++;
+}
+
+bool CSpriteAtlas::Allocate(int w, int h, EAtlasFormat eFormat, int &iPage, int &x, int &y)
+{
+	if(w > ATLAS_PAGE_SIZE || h > ATLAS_PAGE_SIZE)
+		return false;
+
+	// try the existing pages first, the last one is usually the emptiest
+	for(int i = m_PageCount - 1; i >= 0; i--)
+	{
+		if(m_Pages[i].eFormat == eFormat && m_Pages[i].pPacker->Insert(w, h, x, y))
+		{
+			iPage = i;
+			return true;
+		}
+	}
+
+	if(!CreatePage(eFormat))
+		return false;
+
+	iPage = m_PageCount - 1;
+	return m_Pages[iPage].pPacker->Insert(w, h, x, y);
+}
+
+bool CSpriteAtlas::CreatePage(EAtlasFormat eFormat)
+{
+	if(m_PageCount >= ATLAS_MAX_PAGES)
+		return false;
+
+	sAtlasPage &page = m_Pages[m_PageCount];
+	page.eFormat = eFormat;
+
+	if(eFormat == ATLAS_INDEXED)
+	{
+		// Index 0 is transparent in every palette, so the padding is too
+		page.pIndexBits = new BYTE[ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE];
+		ZeroMemory(page.pIndexBits, ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE);
+	}
+	else
+	{
+		BITMAPINFO bi;
+		ZeroMemory(&bi, sizeof(BITMAPINFO));
+		bi.bmiHeader.biSize			= sizeof(BITMAPINFOHEADER);
+		bi.bmiHeader.biWidth		= ATLAS_PAGE_SIZE;
+		bi.bmiHeader.biHeight		= -ATLAS_PAGE_SIZE;	// top-down
+		bi.bmiHeader.biPlanes		= 1;
+		bi.bmiHeader.biBitCount		= 32;
+		bi.bmiHeader.biCompression	= BI_RGB;
+
+		page.hImage = CreateDIBSection(NULL, &bi, DIB_RGB_COLORS, (void**)&page.pImageBits, NULL, 0);
+		page.hMask = CreateDIBSection(NULL, &bi, DIB_RGB_COLORS, (void**)&page.pMaskBits, NULL, 0);
+		if(!page.hImage || !page.hMask)
+		{
+			DeleteObject(page.hImage);
+			DeleteObject(page.hMask);
+			ZeroMemory(&page, sizeof(sAtlasPage));
+			return false;
+		}
+
+		// Unused image area is black and unused mask area is white, so the
+		// padding never shows up with the SRCAND / SRCPAINT technique.
+		ZeroMemory(page.pImageBits, ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * sizeof(DWORD));
+		memset(page.pMaskBits, 0xFF, ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * sizeof(DWORD));
+
+		// The page bitmaps stay selected for the lifetime of the atlas
+		page.hImageDC	= CreateCompatibleDC(NULL);
+		page.hMaskDC	= CreateCompatibleDC(NULL);
+		page.hOldImage	= SelectObject(page.hImageDC, page.hImage);
+		page.hOldMask	= SelectObject(page.hMaskDC, page.hMask);
+	}
+
+	page.pPacker	= new CSkylinePacker(ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+
+	m_PageCount++;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : LoadBits () (Static)
+// Desc : Loads a bitmap file of any depth as top-down 32 bit pixels.
+//-----------------------------------------------------------------------------
+DWORD* CSpriteAtlas::LoadBits(const char *szFileName, int &w, int &h)
+{
+	HBITMAP hBMP = (HBITMAP)LoadImage(g_hInst, szFileName, IMAGE_BITMAP, 0, 0, LR_CREATEDIBSECTION | LR_LOADFROMFILE);
+	if(!hBMP)
+		return NULL;
+
+	BITMAP bm;
+	GetObject(hBMP, sizeof(BITMAP), &bm);
+	w = bm.bmWidth;
+	h = bm.bmHeight;
+
+	BITMAPINFO bi;
+	ZeroMemory(&bi, sizeof(BITMAPINFO));
+	bi.bmiHeader.biSize			= sizeof(BITMAPINFOHEADER);
+	bi.bmiHeader.biWidth		= w;
+	bi.bmiHeader.biHeight		= -h;
+	bi.bmiHeader.biPlanes		= 1;
+	bi.bmiHeader.biBitCount		= 32;
+	bi.bmiHeader.biCompression	= BI_RGB;
+
+	DWORD *pBits = new DWORD[w * h];
+
+	// GetDIBits converts palettized and 24 bit sources for us
+	HDC mdc = CreateCompatibleDC(NULL);
+	GetDIBits(mdc, hBMP, 0, h, pBits, &bi, DIB_RGB_COLORS);
+	DeleteDC(mdc);
+
+	DeleteObject(hBMP);
+	return pBits;
+}
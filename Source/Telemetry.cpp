@@ -0,0 +1,294 @@
+//-----------------------------------------------------------------------------
+// File: Telemetry.cpp
+//
+// Desc: Per-frame metrics logged to a compact binary or CSV file, so frame
+//		budgets can be compared across machines offline. The game only fills
+//		a record into a preallocated ring; a writer thread flushes the ring
+//		to disk in batches. Tools/TelemetryReader.cpp summarizes a log.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CTelemetry Specific Includes
+//-----------------------------------------------------------------------------
+#include "Telemetry.h"
+#include "Profiler.h"
+
+//-----------------------------------------------------------------------------
+// Global Variables
+//-----------------------------------------------------------------------------
+static volatile LONG	g_lCounters[TELEMETRY_COUNTERS];
+static volatile LONG	g_lCountersEnabled = 0;
+
+#if defined(_DEBUG)
+static _CRT_ALLOC_HOOK	g_pfnPreviousAllocHook = NULL;
+
+//-----------------------------------------------------------------------------
+// Name : AllocHook ()
+// Desc : Debug CRT hook counting heap allocations, then passing them on to
+//		any hook installed before it.
+//-----------------------------------------------------------------------------
+static int __cdecl AllocHook(int nAllocType, void *pvData, size_t nSize, int nBlockUse,
+							 long lRequest, const unsigned char *szFileName, int nLine)
+{
+	if(nAllocType == _HOOK_ALLOC || nAllocType == _HOOK_REALLOC)
+		TelemetryCount(TELEMETRY_ALLOCATIONS);
+
+	if(g_pfnPreviousAllocHook)
+		return g_pfnPreviousAllocHook(nAllocType, pvData, nSize, nBlockUse, lRequest, szFileName, nLine);
+	return TRUE;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// Name : TelemetryCount ()
+// Desc : Adds to a counter while the counters are enabled.
+//-----------------------------------------------------------------------------
+void TelemetryCount(ETelemetryCounter eCounter, LONG nAmount)
+{
+	if(g_lCountersEnabled)
+		InterlockedExchangeAdd(&g_lCounters[eCounter], nAmount);
+}
+
+//-----------------------------------------------------------------------------
+// Name : TelemetryReadCounter ()
+// Desc : Returns a counter's running total. It wraps, take differences.
+//-----------------------------------------------------------------------------
+ULONG TelemetryReadCounter(ETelemetryCounter eCounter)
+{
+	return (ULONG)g_lCounters[eCounter];
+}
+
+//-----------------------------------------------------------------------------
+// Name : TelemetryEnableCounters ()
+// Desc : Turns the counters on or off, along with the allocation hook.
+//-----------------------------------------------------------------------------
+void TelemetryEnableCounters(bool bEnable)
+{
+	if((g_lCountersEnabled != 0) == bEnable)
+		return;
+
+#if defined(_DEBUG)
+	if(bEnable)
+		g_pfnPreviousAllocHook = _CrtSetAllocHook(AllocHook);
+	else
+		_CrtSetAllocHook(g_pfnPreviousAllocHook);
+#endif
+
+	InterlockedExchange(&g_lCountersEnabled, bEnable ? 1 : 0);
+}
+
+//-----------------------------------------------------------------------------
+// Name : TelemetryWriteCsv ()
+// Desc : Writes one record as a CSV line, or the header line with NULL.
+//-----------------------------------------------------------------------------
+void TelemetryWriteCsv(FILE *pFile, const sTelemetryRecord *pRecord)
+{
+	if(!pRecord)
+	{
+		fputs("frame,frame_ms,sim_ms,draw_ms,entities,sprites,pixels,allocations,sounds\n", pFile);
+		return;
+	}
+
+	fprintf(pFile, "%lu,%.3f,%.3f,%.3f,%u,%u,%lu,%u,%u\n", pRecord->nFrame,
+			pRecord->fFrameMs, pRecord->fSimMs, pRecord->fDrawMs,
+			(unsigned)pRecord->nEntities, (unsigned)pRecord->nSpritesDrawn, pRecord->nPixelsBlitted,
+			(unsigned)pRecord->nAllocations, (unsigned)pRecord->nSoundsPlayed);
+}
+
+//-----------------------------------------------------------------------------
+// CTelemetry Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CTelemetry () (Constructor)
+// Desc : CTelemetry Class Constructor
+//-----------------------------------------------------------------------------
+CTelemetry::CTelemetry()
+{
+	m_pFile			= NULL;
+	m_eFormat		= TELEMETRY_BINARY;
+	m_pRing			= NULL;
+	m_hThread		= NULL;
+	m_hWakeEvent	= NULL;
+	m_lWritten		= 0;
+	m_lRead			= 0;
+	m_lDropped		= 0;
+	m_lQuit			= 0;
+	ZeroMemory(m_nLastCounters, sizeof(m_nLastCounters));
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CTelemetry () (Destructor)
+// Desc : CTelemetry Class Destructor
+//-----------------------------------------------------------------------------
+CTelemetry::~CTelemetry()
+{
+	Stop();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Start ()
+// Desc : Opens the log, writes its header, allocates the ring and starts the
+//		writer thread.
+//-----------------------------------------------------------------------------
+bool CTelemetry::Start(LPCSTR strFileName, ETelemetryFormat eFormat)
+{
+	Stop();
+
+	m_eFormat = eFormat;
+	if(fopen_s(&m_pFile, strFileName, eFormat == TELEMETRY_CSV ? "w" : "wb") != 0 || !m_pFile)
+	{
+		m_pFile = NULL;
+		return false;
+	}
+
+	if(m_eFormat == TELEMETRY_CSV)
+	{
+		TelemetryWriteCsv(m_pFile, NULL);
+	}
+	else
+	{
+		sTelemetryHeader Header;
+		memcpy(Header.Magic, TELEMETRY_MAGIC, sizeof(Header.Magic));
+		Header.nVersion		= TELEMETRY_VERSION;
+		Header.nRecordSize	= sizeof(sTelemetryRecord);
+		fwrite(&Header, sizeof(Header), 1, m_pFile);
+	}
+
+	m_pRing = new sTelemetryRecord[TELEMETRY_RING_SIZE];
+
+	TelemetryEnableCounters(true);
+	for(int i = 0; i < TELEMETRY_COUNTERS; i++)
+		m_nLastCounters[i] = TelemetryReadCounter((ETelemetryCounter)i);
+
+	m_lWritten		= 0;
+	m_lRead			= 0;
+	m_lDropped		= 0;
+	m_lQuit			= 0;
+	m_hWakeEvent	= CreateEvent(NULL, FALSE, FALSE, NULL);
+	m_hThread		= m_hWakeEvent ? CreateThread(NULL, 0, WriterThreadProc, this, 0, NULL) : NULL;
+
+	if(!m_hThread)
+	{
+		Stop();
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Stop ()
+// Desc : Lets the writer flush the queued records, then closes the log.
+//-----------------------------------------------------------------------------
+void CTelemetry::Stop()
+{
+	if(m_hThread)
+	{
+		InterlockedExchange(&m_lQuit, 1);
+		SetEvent(m_hWakeEvent);
+		WaitForSingleObject(m_hThread, INFINITE);
+		CloseHandle(m_hThread);
+		m_hThread = NULL;
+		TelemetryEnableCounters(false);
+	}
+
+	if(m_hWakeEvent) CloseHandle(m_hWakeEvent);
+	m_hWakeEvent = NULL;
+
+	if(m_pFile) fclose(m_pFile);
+	m_pFile = NULL;
+
+	delete []m_pRing;
+	m_pRing = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Record ()
+// Desc : Adds the counter increases since the previous record and queues a
+//		copy. Called once per frame from the simulation thread; it never
+//		waits for the writer, which is only woken once a batch is ready.
+//-----------------------------------------------------------------------------
+void CTelemetry::Record(sTelemetryRecord &Record)
+{
+	if(!m_hThread)
+		return;
+
+	ULONG nDelta[TELEMETRY_COUNTERS];
+	for(int i = 0; i < TELEMETRY_COUNTERS; i++)
+	{
+		ULONG nCounter = TelemetryReadCounter((ETelemetryCounter)i);
+		nDelta[i] = nCounter - m_nLastCounters[i];
+		m_nLastCounters[i] = nCounter;
+	}
+
+	Record.nSpritesDrawn	= (USHORT)min(nDelta[TELEMETRY_SPRITES], 0xFFFFUL);
+	Record.nPixelsBlitted	= nDelta[TELEMETRY_PIXELS];
+	Record.nAllocations		= (USHORT)min(nDelta[TELEMETRY_ALLOCATIONS], 0xFFFFUL);
+	Record.nSoundsPlayed	= (USHORT)min(nDelta[TELEMETRY_SOUNDS], 0xFFFFUL);
+
+	if(m_lWritten - m_lRead >= TELEMETRY_RING_SIZE)
+	{
+		InterlockedIncrement(&m_lDropped);
+		return;
+	}
+
+	m_pRing[m_lWritten % TELEMETRY_RING_SIZE] = Record;
+
+	// The increment is a full barrier, the record is complete before it is queued
+	if(InterlockedIncrement(&m_lWritten) % TELEMETRY_FLUSH_RECORDS == 0)
+		SetEvent(m_hWakeEvent);
+}
+
+//-----------------------------------------------------------------------------
+// Name : WritePending () (Private)
+// Desc : Writes every queued record, a contiguous run of the ring at a time,
+//		and flushes the file so a crash loses little.
+//-----------------------------------------------------------------------------
+void CTelemetry::WritePending()
+{
+	if(m_lRead == m_lWritten)
+		return;
+
+	while(m_lRead != m_lWritten)
+	{
+		LONG lRead	= m_lRead;
+		int iFirst	= lRead % TELEMETRY_RING_SIZE;
+		int nCount	= min(m_lWritten - lRead, (LONG)(TELEMETRY_RING_SIZE - iFirst));
+
+		if(m_eFormat == TELEMETRY_CSV)
+		{
+			for(int i = 0; i < nCount; i++)
+				TelemetryWriteCsv(m_pFile, &m_pRing[iFirst + i]);
+		}
+		else
+		{
+			fwrite(&m_pRing[iFirst], sizeof(sTelemetryRecord), nCount, m_pFile);
+		}
+
+		// Hands the slots back to Record
+		InterlockedExchangeAdd(&m_lRead, nCount);
+	}
+
+	fflush(m_pFile);
+}
+
+//-----------------------------------------------------------------------------
+// Name : WriterThreadProc () (Static, Private)
+// Desc : Sleeps until a batch is queued. On Stop it writes what is left.
+//-----------------------------------------------------------------------------
+DWORD WINAPI CTelemetry::WriterThreadProc(LPVOID pParam)
+{
+	CTelemetry *pTelemetry = (CTelemetry*)pParam;
+
+	PROFILE_THREAD_NAME("Telemetry writer");
+
+	while(true)
+	{
+		WaitForSingleObject(pTelemetry->m_hWakeEvent, INFINITE);
+		pTelemetry->WritePending();
+		if(pTelemetry->m_lQuit) break;
+	}
+
+	return 0;
+}
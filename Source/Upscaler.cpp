@@ -0,0 +1,295 @@
+//-----------------------------------------------------------------------------
+// File: Upscaler.cpp
+//
+// Desc: Stretches a frame rendered at a reduced resolution up to the window
+//		size. Uses the ResizeEngine filters to place the samples, reduced to
+//		two taps per axis so that each pass is a single lerp.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// CUpscaler Specific Includes
+//-----------------------------------------------------------------------------
+#include "Upscaler.h"
+#include "ResizeEngine.h"
+#include "Simd.h"
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const int TAP_ONE			= 256;		// Weight of a whole source pixel
+
+//-----------------------------------------------------------------------------
+// Name : LerpPixel ()
+// Desc : a * (256 - w) + b * w per channel, the same rounding as the SSE2
+//		path so that both give identical frames.
+//-----------------------------------------------------------------------------
+static inline DWORD LerpPixel(DWORD a, DWORD b, int w)
+{
+	int wa = TAP_ONE - w;
+	DWORD r = 0;
+	for(int iShift = 0; iShift < 32; iShift += 8)
+	{
+		DWORD c = (((a >> iShift) & 0xFF) * wa + ((b >> iShift) & 0xFF) * w) >> 8;
+		r |= c << iShift;
+	}
+	return r;
+}
+
+#if defined(SIMD_SSE2)
+//-----------------------------------------------------------------------------
+// Name : Lerp4 ()
+// Desc : LerpPixel for four pixels. wlo and whi hold the 16 bit weights of
+//		pixels 0-1 and 2-3, repeated for each channel.
+//-----------------------------------------------------------------------------
+static inline __m128i Lerp4(__m128i a, __m128i b, __m128i wlo, __m128i whi)
+{
+	const __m128i vZero	= _mm_setzero_si128();
+	const __m128i vOne	= _mm_set1_epi16(TAP_ONE);
+
+	__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, vZero), _mm_sub_epi16(vOne, wlo)),
+							   _mm_mullo_epi16(_mm_unpacklo_epi8(b, vZero), wlo));
+	__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, vZero), _mm_sub_epi16(vOne, whi)),
+							   _mm_mullo_epi16(_mm_unpackhi_epi8(b, vZero), whi));
+
+	return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// Name : ScaleRowH ()
+// Desc : Horizontal pass of one source row.
+//-----------------------------------------------------------------------------
+static void ScaleRowH(DWORD *pDst, const DWORD *pSrc, const int *pIndex, const int *pWeight, int iWidth)
+{
+	int x = 0;
+
+#if defined(SIMD_SSE2)
+	// Each tap reads its pixel pair with a single 64 bit load, then the
+	// pairs are split into the left and right pixels
+	for(; x + 4 <= iWidth; x += 4)
+	{
+		__m128i p01 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)&pSrc[pIndex[x]]),
+										 _mm_loadl_epi64((const __m128i*)&pSrc[pIndex[x + 1]]));
+		__m128i p23 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)&pSrc[pIndex[x + 2]]),
+										 _mm_loadl_epi64((const __m128i*)&pSrc[pIndex[x + 3]]));
+		p01 = _mm_shuffle_epi32(p01, _MM_SHUFFLE(3, 1, 2, 0));
+		p23 = _mm_shuffle_epi32(p23, _MM_SHUFFLE(3, 1, 2, 0));
+
+		__m128i a = _mm_unpacklo_epi64(p01, p23);
+		__m128i b = _mm_unpackhi_epi64(p01, p23);
+
+		__m128i wlo = _mm_set_epi16((short)pWeight[x + 1], (short)pWeight[x + 1], (short)pWeight[x + 1], (short)pWeight[x + 1],
+									(short)pWeight[x], (short)pWeight[x], (short)pWeight[x], (short)pWeight[x]);
+		__m128i whi = _mm_set_epi16((short)pWeight[x + 3], (short)pWeight[x + 3], (short)pWeight[x + 3], (short)pWeight[x + 3],
+									(short)pWeight[x + 2], (short)pWeight[x + 2], (short)pWeight[x + 2], (short)pWeight[x + 2]);
+
+		_mm_storeu_si128((__m128i*)&pDst[x], Lerp4(a, b, wlo, whi));
+	}
+#endif
+
+	for(; x < iWidth; x++)
+		pDst[x] = LerpPixel(pSrc[pIndex[x]], pSrc[pIndex[x] + 1], pWeight[x]);
+}
+
+//-----------------------------------------------------------------------------
+// Name : BlendRowsV ()
+// Desc : Vertical pass, blending two horizontally scaled rows.
+//-----------------------------------------------------------------------------
+static void BlendRowsV(DWORD *pDst, const DWORD *pTop, const DWORD *pBottom, int iWeight, int iWidth)
+{
+	if(iWeight == 0)
+	{
+		memcpy(pDst, pTop, iWidth * sizeof(DWORD));
+		return;
+	}
+
+	int x = 0;
+
+#if defined(SIMD_SSE2)
+	const __m128i w = _mm_set1_epi16((short)iWeight);
+	for(; x + 4 <= iWidth; x += 4)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)&pTop[x]);
+		__m128i b = _mm_loadu_si128((const __m128i*)&pBottom[x]);
+		_mm_storeu_si128((__m128i*)&pDst[x], Lerp4(a, b, w, w));
+	}
+#endif
+
+	for(; x < iWidth; x++)
+		pDst[x] = LerpPixel(pTop[x], pBottom[x], iWeight);
+}
+
+//-----------------------------------------------------------------------------
+// CUpscaler Member Functions
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : CUpscaler () (Constructor)
+// Desc : CUpscaler Class Constructor
+//-----------------------------------------------------------------------------
+CUpscaler::CUpscaler()
+{
+	m_iSrcWidth		= 0;
+	m_iSrcHeight	= 0;
+	m_iDstWidth		= 0;
+	m_iDstHeight	= 0;
+	m_pColIndex		= NULL;
+	m_pColWeight	= NULL;
+	m_pRowIndex		= NULL;
+	m_pRowWeight	= NULL;
+	m_pRows[0]		= NULL;
+	m_pRows[1]		= NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Name : ~CUpscaler () (Destructor)
+// Desc : CUpscaler Class Destructor
+//-----------------------------------------------------------------------------
+CUpscaler::~CUpscaler()
+{
+	Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name : Init ()
+// Desc : Builds the tap tables for a pair of sizes.
+//-----------------------------------------------------------------------------
+bool CUpscaler::Init(int iSrcWidth, int iSrcHeight, int iDstWidth, int iDstHeight, EBlitFilter eFilter)
+{
+	Release();
+
+	if(iSrcWidth < 2 || iSrcHeight < 2 || iSrcWidth > iDstWidth || iSrcHeight > iDstHeight)
+		return false;
+
+	m_iSrcWidth		= iSrcWidth;
+	m_iSrcHeight	= iSrcHeight;
+	m_iDstWidth		= iDstWidth;
+	m_iDstHeight	= iDstHeight;
+
+	m_pColIndex		= new int[iDstWidth];
+	m_pColWeight	= new int[iDstWidth];
+	m_pRowIndex		= new int[iDstHeight];
+	m_pRowWeight	= new int[iDstHeight];
+	m_pRows[0]		= new DWORD[iDstWidth];
+	m_pRows[1]		= new DWORD[iDstWidth];
+
+	BuildTaps(iDstWidth, iSrcWidth, eFilter, m_pColIndex, m_pColWeight);
+	BuildTaps(iDstHeight, iSrcHeight, eFilter, m_pRowIndex, m_pRowWeight);
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Release ()
+// Desc : Frees the tap tables and row cache.
+//-----------------------------------------------------------------------------
+void CUpscaler::Release()
+{
+	delete []m_pColIndex;
+	delete []m_pColWeight;
+	delete []m_pRowIndex;
+	delete []m_pRowWeight;
+	delete []m_pRows[0];
+	delete []m_pRows[1];
+
+	m_pColIndex		= NULL;
+	m_pColWeight	= NULL;
+	m_pRowIndex		= NULL;
+	m_pRowWeight	= NULL;
+	m_pRows[0]		= NULL;
+	m_pRows[1]		= NULL;
+	m_iSrcWidth		= 0;
+	m_iSrcHeight	= 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name : Upscale ()
+// Desc : Stretches src over dst. Both must have the sizes given to Init.
+//-----------------------------------------------------------------------------
+void CUpscaler::Upscale(const sSurface &dst, const sSurface &src)
+{
+	if(!m_pColIndex || src.iWidth != m_iSrcWidth || src.iHeight != m_iSrcHeight ||
+	   dst.iWidth != m_iDstWidth || dst.iHeight != m_iDstHeight)
+		return;
+
+	// The source changes every frame, nothing cached carries over
+	m_iCachedRow[0] = m_iCachedRow[1] = -1;
+
+	for(int y = 0; y < m_iDstHeight; y++)
+	{
+		int iRow = m_pRowIndex[y];
+		const DWORD *pTop		= GetRow(src, iRow);
+		const DWORD *pBottom	= GetRow(src, iRow + 1);
+		BlendRowsV(&dst.pBits[y * dst.iPitch], pTop, pBottom, m_pRowWeight[y], m_iDstWidth);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : GetRow () (Private)
+// Desc : Returns a horizontally scaled source row, scaling it on first use.
+//		Destination rows only ever move down the source, and the two rows
+//		a destination row needs differ in parity, so two slots are enough.
+//-----------------------------------------------------------------------------
+const DWORD *CUpscaler::GetRow(const sSurface &src, int iRow)
+{
+	int iSlot = iRow & 1;
+	if(m_iCachedRow[iSlot] != iRow)
+	{
+		ScaleRowH(m_pRows[iSlot], &src.pBits[iRow * src.iPitch], m_pColIndex, m_pColWeight, m_iDstWidth);
+		m_iCachedRow[iSlot] = iRow;
+	}
+	return m_pRows[iSlot];
+}
+
+//-----------------------------------------------------------------------------
+// Name : BuildTaps () (Private)
+// Desc : Reduces the filter's weights for each destination pixel to the
+//		point they are centred on, which is then sampled with two taps. This
+//		is exact for the box and bilinear filters, the wider ResizeEngine
+//		filters degrade to bilinear. Nearest sampling snaps the weight to
+//		either tap. The right tap is kept inside the source.
+//-----------------------------------------------------------------------------
+void CUpscaler::BuildTaps(int iDstSize, int iSrcSize, EBlitFilter eFilter, int *pIndex, int *pWeight) const
+{
+	CBoxFilter		Box;
+	CBilinearFilter	Bilinear;
+	CWeightsTable	Weights(eFilter == BLIT_NEAREST ? (CGenericFilter*)&Box : (CGenericFilter*)&Bilinear,
+							iDstSize, iSrcSize);
+
+	for(int i = 0; i < iDstSize; i++)
+	{
+		int iLeft	= Weights.getLeftBoundary(i);
+		int iRight	= Weights.getRightBoundary(i);
+
+		double dCenter = 0.0, dTotal = 0.0;
+		for(int j = iLeft; j <= iRight; j++)
+		{
+			double dWeight = Weights.getWeight(i, j - iLeft);
+			dCenter += dWeight * j;
+			dTotal	+= dWeight;
+		}
+		// Past the last source pixel the weights can all be zero
+		if(dTotal > 0.0)
+			dCenter /= dTotal;
+		else
+			dCenter = (iLeft + iRight) * 0.5;
+
+		int iIndex	= (int)floor(dCenter);
+		int iFrac	= (int)((dCenter - iIndex) * TAP_ONE + 0.5);
+		if(eFilter == BLIT_NEAREST)
+			iFrac = (iFrac >= TAP_ONE / 2) ? TAP_ONE : 0;
+
+		if(iIndex < 0)
+		{
+			iIndex	= 0;
+			iFrac	= 0;
+		}
+		if(iIndex >= iSrcSize - 1)
+		{
+			iIndex	= iSrcSize - 2;
+			iFrac	= TAP_ONE;
+		}
+
+		pIndex[i]	= iIndex;
+		pWeight[i]	= iFrac;
+	}
+}
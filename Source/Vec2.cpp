@@ -12,42 +12,42 @@
 #include "Vec2.h"
 #include "main.h"
 
-Vec2& Vec2::operator-()
+Vec2 Vec2::operator-() const
 {
-	x = -x;
-	y = -y;
-	return *this;
+	return Vec2(-x, -y);
 }
 
-bool Vec2::operator==(Vec2 v)
+bool Vec2::operator==(const Vec2 &v) const
 {
 	return (x == v.x && y == v.y);
 }
 
-bool Vec2::operator!=(Vec2 v)
+bool Vec2::operator!=(const Vec2 &v) const
 {
 	return (x != v.x || y != v.y);
 }
 
-Vec2 Vec2::operator+(Vec2 v)
+Vec2 Vec2::operator+(const Vec2 &v) const
 {
 	return Vec2(x + v.x, y + v.y);
 }
 
-Vec2 Vec2::operator-(Vec2 v)
+Vec2 Vec2::operator-(const Vec2 &v) const
 {
 	return Vec2(x - v.x, y - v.y);
 }
 
-Vec2& Vec2::operator+=(Vec2 v)
+Vec2& Vec2::operator+=(const Vec2 &v)
 {
-	*this = *this + v;
+	x += v.x;
+	y += v.y;
 	return *this;
 }
 
-Vec2& Vec2::operator-=(Vec2 v)
+Vec2& Vec2::operator-=(const Vec2 &v)
 {
-	*this = *this - v;
+	x -= v.x;
+	y -= v.y;
 	return *this;
 }
 
@@ -72,7 +72,7 @@ double Vec2::Argument() const
 	}
 }
 
-double Vec2::Distance(Vec2 v) const // Euclidean distance
+double Vec2::Distance(const Vec2 &v) const // Euclidean distance
 {
 	double dx = x - v.x;
 	double dy = y - v.y;
@@ -92,25 +92,26 @@ Vec2 Polar(double r, double radians)
 	return result;
 }
 
-double Vec2::operator*(Vec2 v)  // dot product
+double Vec2::operator*(const Vec2 &v) const  // dot product
 {  
 	return x*v.x + y*v.y;
 }
 
 void Vec2::Rotate(double radians)
 {
-	double xx = cos(radians)*x - sin(radians)*y;
-	double yy = sin(radians)*x + cos(radians)*y;
+	double c = cos(radians), s = sin(radians);
+	double xx = c*x - s*y;
+	double yy = s*x + c*y;
 	x = xx;
 	y = yy;
 }
 
-Vec2 Vec2::operator*(double s) // scale
+Vec2 Vec2::operator*(double s) const // scale
 {
 	return Vec2(s*x, s*y);
 }
 
-Vec2 Vec2::operator/(double s) // scale
+Vec2 Vec2::operator/(double s) const // scale
 {
 	return Vec2(x/s, y/s);
 }
@@ -0,0 +1,1185 @@
+//-----------------------------------------------------------------------------
+// File: VecMath.cpp
+//
+// Desc: Float vector math. Vec2f is a small value type whose operators
+//		take const references and can be evaluated at compile time, and the
+//		batch functions work on structure of arrays positions (an x array
+//		and a y array), four or eight vectors at a time with SSE2 or AVX2.
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// VecMath Specific Includes
+//-----------------------------------------------------------------------------
+#include "VecMath.h"
+#include "Benchmark.h"
+#include "Simd.h"
+
+//-----------------------------------------------------------------------------
+// Local Types
+//-----------------------------------------------------------------------------
+// The arguments of any batch function, so each path can be called the same way
+typedef struct
+{
+	float		*pX;
+	float		*pY;
+	const float	*pVelX;			// IntegrateMany
+	const float	*pVelY;
+	float		*pOut;			// DistanceMany and the arctangent kernel
+	const float	*pAngle;		// Radians of the sine, RotateMany and PolarMany kernels
+	const float	*pRadius;		// PolarMany
+	float		fA;				// dt, scale, point x or the cosine
+	float		fB;				// Point y or the sine
+	int			nCount;
+} sVecArgs;
+
+typedef void (*VEC_BATCH_FUNC)(const sVecArgs &a);
+
+// The scalar, SSE2 and AVX2 paths of one batch function, NULL where the
+// build has no such path
+typedef struct
+{
+	LPCSTR			strName;
+	VEC_BATCH_FUNC	pfnPath[3];
+} sVecKernel;
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+#if defined(SIMD_SSE2)
+	#define SSE2_PATH(Name)	Name##SSE2
+#else
+	#define SSE2_PATH(Name)	NULL
+#endif
+
+#if defined(SIMD_AVX2)
+	#define AVX2_PATH(Name)	Name##AVX2
+#else
+	#define AVX2_PATH(Name)	NULL
+#endif
+
+enum
+{
+	KERNEL_INTEGRATE, KERNEL_SCALE, KERNEL_NORMALIZE, KERNEL_DISTANCE, KERNEL_ROTATE,
+	KERNEL_SINCOS, KERNEL_ATAN2, KERNEL_ROTATE_EACH, KERNEL_POLAR, KERNEL_COUNT
+};
+
+// Sine and cosine reduce the angle by a multiple of pi / 2, which is split
+// in three so the first products are exact (Cody and Waite), then use the
+// minimax polynomials of the Cephes library on [-pi / 4, pi / 4]
+const float	TRIG_TWO_OVER_PI		= 0.636619772f;
+const float	TRIG_ROUND				= 12582912.0f;	// 1.5 * 2^23, adding it rounds to an integer
+const float	TRIG_PIO2_1				= 1.5703125f;
+const float	TRIG_PIO2_2				= 4.837512969970703125e-4f;
+const float	TRIG_PIO2_3				= 7.54978995489188216e-8f;
+const float	TRIG_SIN_1				= -1.6666654611e-1f;
+const float	TRIG_SIN_2				= 8.3321608736e-3f;
+const float	TRIG_SIN_3				= -1.9515295891e-4f;
+const float	TRIG_COS_1				= 4.166664568298827e-2f;
+const float	TRIG_COS_2				= -1.388731625493765e-3f;
+const float	TRIG_COS_3				= 2.443315711809948e-5f;
+
+// Arctangent works on min / max of |x| and |y|, in [0, 1], and above
+// tan(pi / 8) on (t - 1) / (t + 1) plus pi / 4
+const float	TRIG_TAN_PI_8			= 0.414213562f;
+const float	TRIG_QUARTER_PI			= 0.785398163f;
+const float	TRIG_HALF_PI			= 1.57079633f;
+const float	TRIG_PI					= 3.14159265f;
+const float	TRIG_ATAN_1				= -3.33329491539e-1f;
+const float	TRIG_ATAN_2				= 1.99777106478e-1f;
+const float	TRIG_ATAN_3				= -1.38776856032e-1f;
+const float	TRIG_ATAN_4				= 8.05374449538e-2f;
+
+const int	BENCHMARK_SIZES[]		= { 256, 4096, 65536 };
+const int	BENCHMARK_VECTORS		= 16000000;		// Vectors timed per size and path
+const int	TRIG_TEST_COUNT			= 1 << 22;		// Angles or points per accuracy sweep
+const int	TRIG_BENCHMARK_COUNT	= 4096;			// Values per timed batch
+
+//-----------------------------------------------------------------------------
+// Scalar Batch Functions
+//-----------------------------------------------------------------------------
+// These are the reference implementation and also finish the vectors left
+// over by the SIMD loops, starting at iStart.
+static void IntegrateScalar(const sVecArgs &a, int iStart)
+{
+	for(int i = iStart; i < a.nCount; i++)
+	{
+		a.pX[i] += a.pVelX[i] * a.fA;
+		a.pY[i] += a.pVelY[i] * a.fA;
+	}
+}
+
+static void ScaleScalar(const sVecArgs &a, int iStart)
+{
+	for(int i = iStart; i < a.nCount; i++)
+	{
+		a.pX[i] *= a.fA;
+		a.pY[i] *= a.fA;
+	}
+}
+
+static void NormalizeScalar(const sVecArgs &a, int iStart)
+{
+	for(int i = iStart; i < a.nCount; i++)
+	{
+		float fLength = sqrtf(a.pX[i] * a.pX[i] + a.pY[i] * a.pY[i]);
+		if(fLength > 0.0f)
+		{
+			a.pX[i] /= fLength;
+			a.pY[i] /= fLength;
+		}
+	}
+}
+
+static void DistanceScalar(const sVecArgs &a, int iStart)
+{
+	for(int i = iStart; i < a.nCount; i++)
+	{
+		float dx = a.pX[i] - a.fA;
+		float dy = a.pY[i] - a.fB;
+		a.pOut[i] = sqrtf(dx * dx + dy * dy);
+	}
+}
+
+static void RotateScalar(const sVecArgs &a, int iStart)
+{
+	for(int i = iStart; i < a.nCount; i++)
+	{
+		float fX = a.pX[i], fY = a.pY[i];
+		a.pX[i] = a.fA * fX - a.fB * fY;
+		a.pY[i] = a.fB * fX + a.fA * fY;
+	}
+}
+
+static void Integrate(const sVecArgs &a)	{ IntegrateScalar(a, 0); }
+static void Scale(const sVecArgs &a)		{ ScaleScalar(a, 0); }
+static void Normalize(const sVecArgs &a)	{ NormalizeScalar(a, 0); }
+static void Distance(const sVecArgs &a)		{ DistanceScalar(a, 0); }
+static void Rotate(const sVecArgs &a)		{ RotateScalar(a, 0); }
+
+//-----------------------------------------------------------------------------
+// Scalar Trigonometry
+//-----------------------------------------------------------------------------
+// The SIMD versions below repeat these steps exactly, selecting where these
+// branch, so every path gives the same bits.
+static inline void SinCos1(float x, float &fSin, float &fCos)
+{
+	float fK	= (x * TRIG_TWO_OVER_PI + TRIG_ROUND) - TRIG_ROUND;
+	int k		= (int)fK;
+	float r		= ((x - fK * TRIG_PIO2_1) - fK * TRIG_PIO2_2) - fK * TRIG_PIO2_3;
+	float z		= r * r;
+
+	float s = ((TRIG_SIN_3 * z + TRIG_SIN_2) * z + TRIG_SIN_1) * z * r + r;
+	float c = ((TRIG_COS_3 * z + TRIG_COS_2) * z + TRIG_COS_1) * z * z - 0.5f * z + 1.0f;
+
+	// Quadrant k turns (s, c) by k quarter turns
+	if(k & 1)
+	{
+		float t = s; s = c; c = t;
+	}
+	fSin = (k & 2) ? -s : s;
+	fCos = ((k + 1) & 2) ? -c : c;
+}
+
+static inline float Atan21(float y, float x)
+{
+	float ax = fabsf(x), ay = fabsf(y);
+	float fMax = ax > ay ? ax : ay;
+	float fMin = ax > ay ? ay : ax;
+	float t = fMax > 0.0f ? fMin / fMax : 0.0f;
+
+	float fBase = 0.0f;
+	if(t > TRIG_TAN_PI_8)
+	{
+		t = (t - 1.0f) / (t + 1.0f);
+		fBase = TRIG_QUARTER_PI;
+	}
+
+	float z = t * t;
+	float r = fBase + ((((TRIG_ATAN_4 * z + TRIG_ATAN_3) * z + TRIG_ATAN_2) * z + TRIG_ATAN_1) * z * t + t);
+
+	if(ay > ax)	r = TRIG_HALF_PI - r;
+	if(x < 0.0f)	r = TRIG_PI - r;
+	if(y < 0.0f)	r = -r;
+	return r;
+}
+
+static void SinCosScalar(const sVecArgs &a, int iStart)
+{
+	for(int i = iStart; i < a.nCount; i++)
+		SinCos1(a.pAngle[i], a.pX[i], a.pY[i]);
+}
+
+static void Atan2Scalar(const sVecArgs &a, int iStart)
+{
+	for(int i = iStart; i < a.nCount; i++)
+		a.pOut[i] = Atan21(a.pY[i], a.pX[i]);
+}
+
+static void RotateEachScalar(const sVecArgs &a, int iStart)
+{
+	for(int i = iStart; i < a.nCount; i++)
+	{
+		float s, c, fX = a.pX[i], fY = a.pY[i];
+		SinCos1(a.pAngle[i], s, c);
+		a.pX[i] = c * fX - s * fY;
+		a.pY[i] = s * fX + c * fY;
+	}
+}
+
+static void PolarScalar(const sVecArgs &a, int iStart)
+{
+	for(int i = iStart; i < a.nCount; i++)
+	{
+		float s, c;
+		SinCos1(a.pAngle[i], s, c);
+		a.pX[i] = a.pRadius[i] * c;
+		a.pY[i] = a.pRadius[i] * s;
+	}
+}
+
+static void SinCos(const sVecArgs &a)		{ SinCosScalar(a, 0); }
+static void Atan2(const sVecArgs &a)		{ Atan2Scalar(a, 0); }
+static void RotateEach(const sVecArgs &a)	{ RotateEachScalar(a, 0); }
+static void Polar(const sVecArgs &a)		{ PolarScalar(a, 0); }
+
+#if defined(SIMD_SSE2)
+//-----------------------------------------------------------------------------
+// SSE2 Batch Functions
+//-----------------------------------------------------------------------------
+// The same operations in the same order as the scalar ones, four at a time.
+static void IntegrateSSE2(const sVecArgs &a)
+{
+	__m128 dt = _mm_set1_ps(a.fA);
+
+	int i = 0;
+	for(; i + 4 <= a.nCount; i += 4)
+	{
+		_mm_storeu_ps(&a.pX[i], _mm_add_ps(_mm_loadu_ps(&a.pX[i]), _mm_mul_ps(_mm_loadu_ps(&a.pVelX[i]), dt)));
+		_mm_storeu_ps(&a.pY[i], _mm_add_ps(_mm_loadu_ps(&a.pY[i]), _mm_mul_ps(_mm_loadu_ps(&a.pVelY[i]), dt)));
+	}
+
+	IntegrateScalar(a, i);
+}
+
+static void ScaleSSE2(const sVecArgs &a)
+{
+	__m128 s = _mm_set1_ps(a.fA);
+
+	int i = 0;
+	for(; i + 4 <= a.nCount; i += 4)
+	{
+		_mm_storeu_ps(&a.pX[i], _mm_mul_ps(_mm_loadu_ps(&a.pX[i]), s));
+		_mm_storeu_ps(&a.pY[i], _mm_mul_ps(_mm_loadu_ps(&a.pY[i]), s));
+	}
+
+	ScaleScalar(a, i);
+}
+
+// Zero vectors divide to NaN, the mask keeps the originals there
+static void NormalizeSSE2(const sVecArgs &a)
+{
+	__m128 zero = _mm_setzero_ps();
+
+	int i = 0;
+	for(; i + 4 <= a.nCount; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&a.pX[i]), y = _mm_loadu_ps(&a.pY[i]);
+		__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+		__m128 keep = _mm_cmpgt_ps(len, zero);
+		_mm_storeu_ps(&a.pX[i], _mm_or_ps(_mm_and_ps(keep, _mm_div_ps(x, len)), _mm_andnot_ps(keep, x)));
+		_mm_storeu_ps(&a.pY[i], _mm_or_ps(_mm_and_ps(keep, _mm_div_ps(y, len)), _mm_andnot_ps(keep, y)));
+	}
+
+	NormalizeScalar(a, i);
+}
+
+static void DistanceSSE2(const sVecArgs &a)
+{
+	__m128 px = _mm_set1_ps(a.fA), py = _mm_set1_ps(a.fB);
+
+	int i = 0;
+	for(; i + 4 <= a.nCount; i += 4)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(&a.pX[i]), px);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(&a.pY[i]), py);
+		_mm_storeu_ps(&a.pOut[i], _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))));
+	}
+
+	DistanceScalar(a, i);
+}
+
+static void RotateSSE2(const sVecArgs &a)
+{
+	__m128 c = _mm_set1_ps(a.fA), s = _mm_set1_ps(a.fB);
+
+	int i = 0;
+	for(; i + 4 <= a.nCount; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&a.pX[i]), y = _mm_loadu_ps(&a.pY[i]);
+		_mm_storeu_ps(&a.pX[i], _mm_sub_ps(_mm_mul_ps(c, x), _mm_mul_ps(s, y)));
+		_mm_storeu_ps(&a.pY[i], _mm_add_ps(_mm_mul_ps(s, x), _mm_mul_ps(c, y)));
+	}
+
+	RotateScalar(a, i);
+}
+//-----------------------------------------------------------------------------
+// SSE2 Trigonometry
+//-----------------------------------------------------------------------------
+// Both quadrant choices are computed and the masks pick, as the scalar
+// code branches.
+static inline void SinCos4(__m128 x, __m128 &vSin, __m128 &vCos)
+{
+	__m128 fK	= _mm_sub_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(TRIG_TWO_OVER_PI)), _mm_set1_ps(TRIG_ROUND)), _mm_set1_ps(TRIG_ROUND));
+	__m128i k	= _mm_cvttps_epi32(fK);
+	__m128 r	= _mm_sub_ps(x, _mm_mul_ps(fK, _mm_set1_ps(TRIG_PIO2_1)));
+	r			= _mm_sub_ps(r, _mm_mul_ps(fK, _mm_set1_ps(TRIG_PIO2_2)));
+	r			= _mm_sub_ps(r, _mm_mul_ps(fK, _mm_set1_ps(TRIG_PIO2_3)));
+	__m128 z	= _mm_mul_ps(r, r);
+
+	__m128 s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(TRIG_SIN_3), z),
+					_mm_set1_ps(TRIG_SIN_2)), z), _mm_set1_ps(TRIG_SIN_1)), z), r), r);
+	__m128 c = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(TRIG_COS_3), z),
+					_mm_set1_ps(TRIG_COS_2)), z), _mm_set1_ps(TRIG_COS_1)), z), z), _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1.0f));
+
+	__m128 swap		= _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(k, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+	__m128 fSinSign	= _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(k, _mm_set1_epi32(2)), 30));
+	__m128 fCosSign	= _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(k, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+
+	vSin = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), fSinSign);
+	vCos = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), fCosSign);
+}
+
+static inline __m128 Atan24(__m128 y, __m128 x)
+{
+	__m128 zero		= _mm_setzero_ps();
+	__m128 abs		= _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 ax		= _mm_and_ps(x, abs), ay = _mm_and_ps(y, abs);
+	__m128 yBigger	= _mm_cmpgt_ps(ay, ax);
+	__m128 fMax		= _mm_or_ps(_mm_and_ps(yBigger, ay), _mm_andnot_ps(yBigger, ax));
+	__m128 fMin		= _mm_or_ps(_mm_and_ps(yBigger, ax), _mm_andnot_ps(yBigger, ay));
+	__m128 t		= _mm_and_ps(_mm_cmpgt_ps(fMax, zero), _mm_div_ps(fMin, fMax));
+
+	__m128 one		= _mm_set1_ps(1.0f);
+	__m128 big		= _mm_cmpgt_ps(t, _mm_set1_ps(TRIG_TAN_PI_8));
+	t				= _mm_or_ps(_mm_and_ps(big, _mm_div_ps(_mm_sub_ps(t, one), _mm_add_ps(t, one))), _mm_andnot_ps(big, t));
+	__m128 fBase	= _mm_and_ps(big, _mm_set1_ps(TRIG_QUARTER_PI));
+
+	__m128 z = _mm_mul_ps(t, t);
+	__m128 p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(TRIG_ATAN_4), z), _mm_set1_ps(TRIG_ATAN_3));
+	p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(TRIG_ATAN_2));
+	p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(TRIG_ATAN_1));
+	__m128 r = _mm_add_ps(fBase, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, z), t), t));
+
+	r = _mm_or_ps(_mm_and_ps(yBigger, _mm_sub_ps(_mm_set1_ps(TRIG_HALF_PI), r)), _mm_andnot_ps(yBigger, r));
+	__m128 xNeg = _mm_cmplt_ps(x, zero);
+	r = _mm_or_ps(_mm_and_ps(xNeg, _mm_sub_ps(_mm_set1_ps(TRIG_PI), r)), _mm_andnot_ps(xNeg, r));
+	// Flip the sign bit, so a zero r turns into -0 as it does in Atan21
+	__m128 yNeg = _mm_cmplt_ps(y, zero);
+	return _mm_xor_ps(r, _mm_and_ps(yNeg, _mm_set1_ps(-0.0f)));
+}
+
+static void SinCosSSE2(const sVecArgs &a)
+{
+	int i = 0;
+	for(; i + 4 <= a.nCount; i += 4)
+	{
+		__m128 s, c;
+		SinCos4(_mm_loadu_ps(&a.pAngle[i]), s, c);
+		_mm_storeu_ps(&a.pX[i], s);
+		_mm_storeu_ps(&a.pY[i], c);
+	}
+
+	SinCosScalar(a, i);
+}
+
+static void Atan2SSE2(const sVecArgs &a)
+{
+	int i = 0;
+	for(; i + 4 <= a.nCount; i += 4)
+		_mm_storeu_ps(&a.pOut[i], Atan24(_mm_loadu_ps(&a.pY[i]), _mm_loadu_ps(&a.pX[i])));
+
+	Atan2Scalar(a, i);
+}
+
+static void RotateEachSSE2(const sVecArgs &a)
+{
+	int i = 0;
+	for(; i + 4 <= a.nCount; i += 4)
+	{
+		__m128 s, c, x = _mm_loadu_ps(&a.pX[i]), y = _mm_loadu_ps(&a.pY[i]);
+		SinCos4(_mm_loadu_ps(&a.pAngle[i]), s, c);
+		_mm_storeu_ps(&a.pX[i], _mm_sub_ps(_mm_mul_ps(c, x), _mm_mul_ps(s, y)));
+		_mm_storeu_ps(&a.pY[i], _mm_add_ps(_mm_mul_ps(s, x), _mm_mul_ps(c, y)));
+	}
+
+	RotateEachScalar(a, i);
+}
+
+static void PolarSSE2(const sVecArgs &a)
+{
+	int i = 0;
+	for(; i + 4 <= a.nCount; i += 4)
+	{
+		__m128 s, c, fRadius = _mm_loadu_ps(&a.pRadius[i]);
+		SinCos4(_mm_loadu_ps(&a.pAngle[i]), s, c);
+		_mm_storeu_ps(&a.pX[i], _mm_mul_ps(fRadius, c));
+		_mm_storeu_ps(&a.pY[i], _mm_mul_ps(fRadius, s));
+	}
+
+	PolarScalar(a, i);
+}
+#endif // SIMD_SSE2
+
+#if defined(SIMD_AVX2)
+//-----------------------------------------------------------------------------
+// AVX2 Batch Functions
+//-----------------------------------------------------------------------------
+// Same as the SSE2 versions eight at a time. No fused multiply-add, which
+// would round differently from the scalar path.
+static void IntegrateAVX2(const sVecArgs &a)
+{
+	__m256 dt = _mm256_set1_ps(a.fA);
+
+	int i = 0;
+	for(; i + 8 <= a.nCount; i += 8)
+	{
+		_mm256_storeu_ps(&a.pX[i], _mm256_add_ps(_mm256_loadu_ps(&a.pX[i]), _mm256_mul_ps(_mm256_loadu_ps(&a.pVelX[i]), dt)));
+		_mm256_storeu_ps(&a.pY[i], _mm256_add_ps(_mm256_loadu_ps(&a.pY[i]), _mm256_mul_ps(_mm256_loadu_ps(&a.pVelY[i]), dt)));
+	}
+
+	IntegrateScalar(a, i);
+}
+
+static void ScaleAVX2(const sVecArgs &a)
+{
+	__m256 s = _mm256_set1_ps(a.fA);
+
+	int i = 0;
+	for(; i + 8 <= a.nCount; i += 8)
+	{
+		_mm256_storeu_ps(&a.pX[i], _mm256_mul_ps(_mm256_loadu_ps(&a.pX[i]), s));
+		_mm256_storeu_ps(&a.pY[i], _mm256_mul_ps(_mm256_loadu_ps(&a.pY[i]), s));
+	}
+
+	ScaleScalar(a, i);
+}
+
+static void NormalizeAVX2(const sVecArgs &a)
+{
+	__m256 zero = _mm256_setzero_ps();
+
+	int i = 0;
+	for(; i + 8 <= a.nCount; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(&a.pX[i]), y = _mm256_loadu_ps(&a.pY[i]);
+		__m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)));
+		__m256 keep = _mm256_cmp_ps(len, zero, _CMP_GT_OQ);
+		_mm256_storeu_ps(&a.pX[i], _mm256_blendv_ps(x, _mm256_div_ps(x, len), keep));
+		_mm256_storeu_ps(&a.pY[i], _mm256_blendv_ps(y, _mm256_div_ps(y, len), keep));
+	}
+
+	NormalizeScalar(a, i);
+}
+
+static void DistanceAVX2(const sVecArgs &a)
+{
+	__m256 px = _mm256_set1_ps(a.fA), py = _mm256_set1_ps(a.fB);
+
+	int i = 0;
+	for(; i + 8 <= a.nCount; i += 8)
+	{
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&a.pX[i]), px);
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&a.pY[i]), py);
+		_mm256_storeu_ps(&a.pOut[i], _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy))));
+	}
+
+	DistanceScalar(a, i);
+}
+
+static void RotateAVX2(const sVecArgs &a)
+{
+	__m256 c = _mm256_set1_ps(a.fA), s = _mm256_set1_ps(a.fB);
+
+	int i = 0;
+	for(; i + 8 <= a.nCount; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(&a.pX[i]), y = _mm256_loadu_ps(&a.pY[i]);
+		_mm256_storeu_ps(&a.pX[i], _mm256_sub_ps(_mm256_mul_ps(c, x), _mm256_mul_ps(s, y)));
+		_mm256_storeu_ps(&a.pY[i], _mm256_add_ps(_mm256_mul_ps(s, x), _mm256_mul_ps(c, y)));
+	}
+
+	RotateScalar(a, i);
+}
+//-----------------------------------------------------------------------------
+// AVX2 Trigonometry
+//-----------------------------------------------------------------------------
+static inline void SinCos8(__m256 x, __m256 &vSin, __m256 &vCos)
+{
+	__m256 fK	= _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(TRIG_TWO_OVER_PI)), _mm256_set1_ps(TRIG_ROUND)), _mm256_set1_ps(TRIG_ROUND));
+	__m256i k	= _mm256_cvttps_epi32(fK);
+	__m256 r	= _mm256_sub_ps(x, _mm256_mul_ps(fK, _mm256_set1_ps(TRIG_PIO2_1)));
+	r			= _mm256_sub_ps(r, _mm256_mul_ps(fK, _mm256_set1_ps(TRIG_PIO2_2)));
+	r			= _mm256_sub_ps(r, _mm256_mul_ps(fK, _mm256_set1_ps(TRIG_PIO2_3)));
+	__m256 z	= _mm256_mul_ps(r, r);
+
+	__m256 s = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(TRIG_SIN_3), z), _mm256_set1_ps(TRIG_SIN_2));
+	s = _mm256_add_ps(_mm256_mul_ps(s, z), _mm256_set1_ps(TRIG_SIN_1));
+	s = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(s, z), r), r);
+	__m256 c = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(TRIG_COS_3), z), _mm256_set1_ps(TRIG_COS_2));
+	c = _mm256_add_ps(_mm256_mul_ps(c, z), _mm256_set1_ps(TRIG_COS_1));
+	c = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(c, z), z), _mm256_mul_ps(_mm256_set1_ps(0.5f), z)), _mm256_set1_ps(1.0f));
+
+	__m256 swap		= _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(k, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+	__m256 fSinSign	= _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(k, _mm256_set1_epi32(2)), 30));
+	__m256 fCosSign	= _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(k, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+
+	vSin = _mm256_xor_ps(_mm256_blendv_ps(s, c, swap), fSinSign);
+	vCos = _mm256_xor_ps(_mm256_blendv_ps(c, s, swap), fCosSign);
+}
+
+static inline __m256 Atan28(__m256 y, __m256 x)
+{
+	__m256 zero		= _mm256_setzero_ps();
+	__m256 abs		= _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	__m256 ax		= _mm256_and_ps(x, abs), ay = _mm256_and_ps(y, abs);
+	__m256 yBigger	= _mm256_cmp_ps(ay, ax, _CMP_GT_OQ);
+	__m256 fMax		= _mm256_blendv_ps(ax, ay, yBigger);
+	__m256 fMin		= _mm256_blendv_ps(ay, ax, yBigger);
+	__m256 t		= _mm256_and_ps(_mm256_cmp_ps(fMax, zero, _CMP_GT_OQ), _mm256_div_ps(fMin, fMax));
+
+	__m256 one		= _mm256_set1_ps(1.0f);
+	__m256 big		= _mm256_cmp_ps(t, _mm256_set1_ps(TRIG_TAN_PI_8), _CMP_GT_OQ);
+	t				= _mm256_blendv_ps(t, _mm256_div_ps(_mm256_sub_ps(t, one), _mm256_add_ps(t, one)), big);
+	__m256 fBase	= _mm256_and_ps(big, _mm256_set1_ps(TRIG_QUARTER_PI));
+
+	__m256 z = _mm256_mul_ps(t, t);
+	__m256 p = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(TRIG_ATAN_4), z), _mm256_set1_ps(TRIG_ATAN_3));
+	p = _mm256_add_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(TRIG_ATAN_2));
+	p = _mm256_add_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(TRIG_ATAN_1));
+	__m256 r = _mm256_add_ps(fBase, _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(p, z), t), t));
+
+	r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(TRIG_HALF_PI), r), yBigger);
+	r = _mm256_blendv_ps(r, _mm256_sub_ps(_mm256_set1_ps(TRIG_PI), r), _mm256_cmp_ps(x, zero, _CMP_LT_OQ));
+	return _mm256_xor_ps(r, _mm256_and_ps(_mm256_cmp_ps(y, zero, _CMP_LT_OQ), _mm256_set1_ps(-0.0f)));
+}
+
+static void SinCosAVX2(const sVecArgs &a)
+{
+	int i = 0;
+	for(; i + 8 <= a.nCount; i += 8)
+	{
+		__m256 s, c;
+		SinCos8(_mm256_loadu_ps(&a.pAngle[i]), s, c);
+		_mm256_storeu_ps(&a.pX[i], s);
+		_mm256_storeu_ps(&a.pY[i], c);
+	}
+
+	SinCosScalar(a, i);
+}
+
+static void Atan2AVX2(const sVecArgs &a)
+{
+	int i = 0;
+	for(; i + 8 <= a.nCount; i += 8)
+		_mm256_storeu_ps(&a.pOut[i], Atan28(_mm256_loadu_ps(&a.pY[i]), _mm256_loadu_ps(&a.pX[i])));
+
+	Atan2Scalar(a, i);
+}
+
+static void RotateEachAVX2(const sVecArgs &a)
+{
+	int i = 0;
+	for(; i + 8 <= a.nCount; i += 8)
+	{
+		__m256 s, c, x = _mm256_loadu_ps(&a.pX[i]), y = _mm256_loadu_ps(&a.pY[i]);
+		SinCos8(_mm256_loadu_ps(&a.pAngle[i]), s, c);
+		_mm256_storeu_ps(&a.pX[i], _mm256_sub_ps(_mm256_mul_ps(c, x), _mm256_mul_ps(s, y)));
+		_mm256_storeu_ps(&a.pY[i], _mm256_add_ps(_mm256_mul_ps(s, x), _mm256_mul_ps(c, y)));
+	}
+
+	RotateEachScalar(a, i);
+}
+
+static void PolarAVX2(const sVecArgs &a)
+{
+	int i = 0;
+	for(; i + 8 <= a.nCount; i += 8)
+	{
+		__m256 s, c, fRadius = _mm256_loadu_ps(&a.pRadius[i]);
+		SinCos8(_mm256_loadu_ps(&a.pAngle[i]), s, c);
+		_mm256_storeu_ps(&a.pX[i], _mm256_mul_ps(fRadius, c));
+		_mm256_storeu_ps(&a.pY[i], _mm256_mul_ps(fRadius, s));
+	}
+
+	PolarScalar(a, i);
+}
+#endif // SIMD_AVX2
+
+//-----------------------------------------------------------------------------
+// Local Variables
+//-----------------------------------------------------------------------------
+static const sVecKernel KERNELS[KERNEL_COUNT] =
+{
+	{ "integrate",	{ Integrate,	SSE2_PATH(Integrate),	AVX2_PATH(Integrate) } },
+	{ "scale",		{ Scale,		SSE2_PATH(Scale),		AVX2_PATH(Scale) } },
+	{ "normalize",	{ Normalize,	SSE2_PATH(Normalize),	AVX2_PATH(Normalize) } },
+	{ "distance",	{ Distance,		SSE2_PATH(Distance),	AVX2_PATH(Distance) } },
+	{ "rotate",		{ Rotate,		SSE2_PATH(Rotate),		AVX2_PATH(Rotate) } },
+	{ "sincos",		{ SinCos,		SSE2_PATH(SinCos),		AVX2_PATH(SinCos) } },
+	{ "atan2",		{ Atan2,		SSE2_PATH(Atan2),		AVX2_PATH(Atan2) } },
+	{ "rotate each",{ RotateEach,	SSE2_PATH(RotateEach),	AVX2_PATH(RotateEach) } },
+	{ "polar",		{ Polar,		SSE2_PATH(Polar),		AVX2_PATH(Polar) } },
+};
+
+//-----------------------------------------------------------------------------
+// Name : RunKernel ()
+// Desc : Calls the fastest path the build and the CPU have.
+//-----------------------------------------------------------------------------
+static void RunKernel(int iKernel, const sVecArgs &a)
+{
+	const sVecKernel &Kernel = KERNELS[iKernel];
+
+	if(Kernel.pfnPath[2] && CpuHasAVX2())
+		Kernel.pfnPath[2](a);
+	else if(Kernel.pfnPath[1])
+		Kernel.pfnPath[1](a);
+	else
+		Kernel.pfnPath[0](a);
+}
+
+//-----------------------------------------------------------------------------
+// Name : MakeArgs ()
+// Desc : Fills in the arguments every batch function uses.
+//-----------------------------------------------------------------------------
+static sVecArgs MakeArgs(float *pX, float *pY, int nCount, float fA = 0.0f, float fB = 0.0f)
+{
+	sVecArgs a = { pX, pY, NULL, NULL, NULL, NULL, NULL, fA, fB, nCount };
+	return a;
+}
+
+//-----------------------------------------------------------------------------
+// Name : IntegrateMany ()
+// Desc : Moves every vector by its velocity over dt.
+//-----------------------------------------------------------------------------
+void IntegrateMany(float *pX, float *pY, const float *pVelX, const float *pVelY, float dt, int nCount)
+{
+	sVecArgs a = MakeArgs(pX, pY, nCount, dt);
+	a.pVelX = pVelX;
+	a.pVelY = pVelY;
+	RunKernel(KERNEL_INTEGRATE, a);
+}
+
+//-----------------------------------------------------------------------------
+// Name : ScaleMany ()
+// Desc : Scales every vector.
+//-----------------------------------------------------------------------------
+void ScaleMany(float *pX, float *pY, float fScale, int nCount)
+{
+	RunKernel(KERNEL_SCALE, MakeArgs(pX, pY, nCount, fScale));
+}
+
+//-----------------------------------------------------------------------------
+// Name : NormalizeMany ()
+// Desc : Makes every non zero vector unit length.
+//-----------------------------------------------------------------------------
+void NormalizeMany(float *pX, float *pY, int nCount)
+{
+	RunKernel(KERNEL_NORMALIZE, MakeArgs(pX, pY, nCount));
+}
+
+//-----------------------------------------------------------------------------
+// Name : DistanceMany ()
+// Desc : Distance from every vector to one point.
+//-----------------------------------------------------------------------------
+void DistanceMany(const float *pX, const float *pY, float fX, float fY, float *pDistance, int nCount)
+{
+	// The distance kernel only reads the vectors
+	sVecArgs a = MakeArgs((float*)pX, (float*)pY, nCount, fX, fY);
+	a.pOut = pDistance;
+	RunKernel(KERNEL_DISTANCE, a);
+}
+
+//-----------------------------------------------------------------------------
+// Name : RotateMany ()
+// Desc : Rotates every vector by fRadians, the sine and cosine are taken
+//		once for the whole batch.
+//-----------------------------------------------------------------------------
+void RotateMany(float *pX, float *pY, float fRadians, int nCount)
+{
+	RunKernel(KERNEL_ROTATE, MakeArgs(pX, pY, nCount, cosf(fRadians), sinf(fRadians)));
+}
+
+//-----------------------------------------------------------------------------
+// Name : FastAtan2 ()
+// Desc : One arctangent, the same value the arctangent kernel gives.
+//-----------------------------------------------------------------------------
+float FastAtan2(float fY, float fX)
+{
+	return Atan21(fY, fX);
+}
+
+//-----------------------------------------------------------------------------
+// Name : RotateMany ()
+// Desc : Rotates every vector by its own angle.
+//-----------------------------------------------------------------------------
+void RotateMany(float *pX, float *pY, const float *pRadians, int nCount)
+{
+	sVecArgs a = MakeArgs(pX, pY, nCount);
+	a.pAngle = pRadians;
+	RunKernel(KERNEL_ROTATE_EACH, a);
+}
+
+//-----------------------------------------------------------------------------
+// Name : PolarMany ()
+// Desc : Vectors from lengths and angles.
+//-----------------------------------------------------------------------------
+void PolarMany(const float *pRadius, const float *pRadians, float *pX, float *pY, int nCount)
+{
+	sVecArgs a = MakeArgs(pX, pY, nCount);
+	a.pAngle	= pRadians;
+	a.pRadius	= pRadius;
+	RunKernel(KERNEL_POLAR, a);
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// Name : RunVec2Kernel ()
+// Desc : The batch function's work written with Vec2, as game code that
+//		keeps an array of objects would do it.
+//-----------------------------------------------------------------------------
+static void RunVec2Kernel(int iKernel, Vec2 *pPos, const Vec2 *pVel, double *pOut, const sVecArgs &a)
+{
+	Vec2 Point(a.fA, a.fB);
+	double fAngle = atan2(a.fB, a.fA);
+
+	switch(iKernel)
+	{
+	case KERNEL_INTEGRATE:
+		for(int i = 0; i < a.nCount; i++)
+			pPos[i] += pVel[i] * a.fA;
+		break;
+	case KERNEL_SCALE:
+		for(int i = 0; i < a.nCount; i++)
+			pPos[i] = pPos[i] * a.fA;
+		break;
+	case KERNEL_NORMALIZE:
+		for(int i = 0; i < a.nCount; i++)
+			pPos[i] = pPos[i].Normalize();
+		break;
+	case KERNEL_DISTANCE:
+		for(int i = 0; i < a.nCount; i++)
+			pOut[i] = pPos[i].Distance(Point);
+		break;
+	case KERNEL_ROTATE:
+		for(int i = 0; i < a.nCount; i++)
+			pPos[i].Rotate(fAngle);
+		break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunVec2fKernel ()
+// Desc : The same with Vec2f, as the sprites keep their positions.
+//-----------------------------------------------------------------------------
+static void RunVec2fKernel(int iKernel, Vec2f *pPos, const Vec2f *pVel, float *pOut, const sVecArgs &a)
+{
+	Vec2f Point(a.fA, a.fB);
+	float fAngle = atan2f(a.fB, a.fA);
+
+	switch(iKernel)
+	{
+	case KERNEL_INTEGRATE:
+		for(int i = 0; i < a.nCount; i++)
+			pPos[i] += pVel[i] * a.fA;
+		break;
+	case KERNEL_SCALE:
+		for(int i = 0; i < a.nCount; i++)
+			pPos[i] *= a.fA;
+		break;
+	case KERNEL_NORMALIZE:
+		for(int i = 0; i < a.nCount; i++)
+			pPos[i] = pPos[i].Normalized();
+		break;
+	case KERNEL_DISTANCE:
+		for(int i = 0; i < a.nCount; i++)
+			pOut[i] = pPos[i].Distance(Point);
+		break;
+	case KERNEL_ROTATE:
+		for(int i = 0; i < a.nCount; i++)
+			pPos[i] = pPos[i].Rotated(fAngle);
+		break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunVectorBenchmark ()
+// Desc : Writes nanoseconds per vector for each batch function, on Vec2,
+//		on Vec2f and on each path. Every path is first checked to match the scalar
+//		one exactly, from the same starting vectors.
+//-----------------------------------------------------------------------------
+bool RunVectorBenchmark(LPCSTR strFileName)
+{
+	FILE *pFile = BenchOpen(strFileName);
+	if(!pFile)
+		return false;
+
+	int nMaxCount	= BENCHMARK_SIZES[sizeof(BENCHMARK_SIZES) / sizeof(BENCHMARK_SIZES[0]) - 1];
+	float *pStart	= new float[nMaxCount * 4];		// x, y, velocity x, velocity y
+	float *pData	= new float[nMaxCount * 3];		// x, y and the distances
+	float *pCheck	= new float[nMaxCount * 3];
+	Vec2 *pPos		= new Vec2[nMaxCount];
+	Vec2 *pVel		= new Vec2[nMaxCount];
+	double *pOut	= new double[nMaxCount];
+	Vec2f *pPosF	= new Vec2f[nMaxCount];
+	Vec2f *pVelF	= new Vec2f[nMaxCount];
+	float *pOutF	= new float[nMaxCount];
+	ULONG nSeed		= 1;
+
+	// A few zero vectors so normalize meets them too
+	for(int i = 0; i < nMaxCount * 4; i++)
+		pStart[i] = (i % 61 == 0) ? 0.0f : BenchRandom(nSeed) * 200.0f - 100.0f;
+	for(int i = 0; i < nMaxCount; i++)
+	{
+		pVel[i]		= Vec2((double)pStart[2 * nMaxCount + i], (double)pStart[3 * nMaxCount + i]);
+		pVelF[i]	= Vec2f(pStart[2 * nMaxCount + i], pStart[3 * nMaxCount + i]);
+	}
+
+	// Scale by -1 and rotate by a small angle so repeated passes stay in range
+	float fArgA[KERNEL_SINCOS] = { 1.0f / 60.0f, -1.0f, 0.0f, 12.5f, cosf(0.01f) };
+	float fArgB[KERNEL_SINCOS] = { 0.0f, 0.0f, 0.0f, -40.0f, sinf(0.01f) };
+
+	__int64 nStart, nEnd;
+
+	bool bMatch = true;
+	fprintf(pFile, "Nanoseconds per vector, - where the path is not available\n");
+	fprintf(pFile, "and WRONG where it disagrees with the scalar path\n\n");
+	fprintf(pFile, "function   vectors    Vec2   Vec2f  scalar    sse2    avx2\n");
+	for(int iKernel = 0; iKernel < KERNEL_SINCOS; iKernel++)
+	{
+		for(int iSize = 0; iSize < (int)(sizeof(BENCHMARK_SIZES) / sizeof(BENCHMARK_SIZES[0])); iSize++)
+		{
+			int nCount	= BENCHMARK_SIZES[iSize];
+			int nPasses	= BENCHMARK_VECTORS / nCount;
+
+			sVecArgs a	= MakeArgs(pData, pData + nMaxCount, nCount, fArgA[iKernel], fArgB[iKernel]);
+			a.pVelX		= pStart + 2 * nMaxCount;
+			a.pVelY		= pStart + 3 * nMaxCount;
+			a.pOut		= pData + 2 * nMaxCount;
+
+			sVecArgs Check	= a;
+			Check.pX	= pCheck;
+			Check.pY	= pCheck + nMaxCount;
+			Check.pOut	= pCheck + 2 * nMaxCount;
+
+			memcpy(pCheck, pStart, nMaxCount * 2 * sizeof(float));
+			KERNELS[iKernel].pfnPath[0](Check);
+
+			fprintf(pFile, "%-9s  %7d", KERNELS[iKernel].strName, nCount);
+
+			for(int i = 0; i < nCount; i++)
+				pPos[i] = Vec2((double)pStart[i], (double)pStart[nMaxCount + i]);
+
+			nStart = BenchTime();
+			for(int nPass = 0; nPass < nPasses; nPass++)
+				RunVec2Kernel(iKernel, pPos, pVel, pOut, a);
+			nEnd = BenchTime();
+			fprintf(pFile, "  %6.2f", BenchSeconds(nStart, nEnd) * 1e9 / ((double)nCount * nPasses));
+
+			for(int i = 0; i < nCount; i++)
+				pPosF[i] = Vec2f(pStart[i], pStart[nMaxCount + i]);
+
+			nStart = BenchTime();
+			for(int nPass = 0; nPass < nPasses; nPass++)
+				RunVec2fKernel(iKernel, pPosF, pVelF, pOutF, a);
+			nEnd = BenchTime();
+			fprintf(pFile, "  %6.2f", BenchSeconds(nStart, nEnd) * 1e9 / ((double)nCount * nPasses));
+
+			for(int nPath = 0; nPath < 3; nPath++)
+			{
+				VEC_BATCH_FUNC pfnPath = KERNELS[iKernel].pfnPath[nPath];
+				if(!pfnPath || (nPath == 2 && !CpuHasAVX2()))
+				{
+					fprintf(pFile, "  %6s", "-");
+					continue;
+				}
+
+				memcpy(pData, pStart, nMaxCount * 2 * sizeof(float));
+				pfnPath(a);
+				bool bSame = memcmp(pData, pCheck, nCount * sizeof(float)) == 0 &&
+							 memcmp(pData + nMaxCount, pCheck + nMaxCount, nCount * sizeof(float)) == 0;
+				if(iKernel == KERNEL_DISTANCE)
+					bSame = memcmp(a.pOut, Check.pOut, nCount * sizeof(float)) == 0;
+				if(!bSame)
+				{
+					fprintf(pFile, "  %6s", "WRONG");
+					bMatch = false;
+					continue;
+				}
+
+				nStart = BenchTime();
+				for(int nPass = 0; nPass < nPasses; nPass++)
+					pfnPath(a);
+				nEnd = BenchTime();
+				fprintf(pFile, "  %6.2f", BenchSeconds(nStart, nEnd) * 1e9 / ((double)nCount * nPasses));
+			}
+
+			fprintf(pFile, "\n");
+		}
+	}
+
+	delete []pStart;
+	delete []pData;
+	delete []pCheck;
+	delete []pPos;
+	delete []pVel;
+	delete []pOut;
+	delete []pPosF;
+	delete []pVelF;
+	delete []pOutF;
+
+	return BenchClose(pFile, bMatch);
+}
+
+//-----------------------------------------------------------------------------
+// Name : CheckTrigPaths ()
+// Desc : Runs every path of a kernel on the same arguments and returns
+//		false unless the SIMD ones write exactly the scalar one's bits. The
+//		rotation starts each path from pStartX, pStartY. The results are
+//		left in the output arrays.
+//-----------------------------------------------------------------------------
+static bool CheckTrigPaths(int iKernel, const sVecArgs &a, const float *pStartX, const float *pStartY,
+						   float *pCheckX, float *pCheckY)
+{
+	int nBytes		= a.nCount * (int)sizeof(float);
+	float *pOutX	= iKernel == KERNEL_ATAN2 ? a.pOut : a.pX;
+	bool bSame		= true;
+
+	for(int nPath = 0; nPath < 3; nPath++)
+	{
+		VEC_BATCH_FUNC pfnPath = KERNELS[iKernel].pfnPath[nPath];
+		if(!pfnPath || (nPath == 2 && !CpuHasAVX2()))
+			continue;
+
+		if(pStartX)
+		{
+			memcpy(a.pX, pStartX, nBytes);
+			memcpy(a.pY, pStartY, nBytes);
+		}
+		pfnPath(a);
+
+		if(nPath == 0)
+		{
+			memcpy(pCheckX, pOutX, nBytes);
+			memcpy(pCheckY, a.pY, nBytes);
+		}
+		else if(memcmp(pCheckX, pOutX, nBytes) != 0 || memcmp(pCheckY, a.pY, nBytes) != 0)
+		{
+			bSame = false;
+		}
+	}
+
+	return bSame;
+}
+
+//-----------------------------------------------------------------------------
+// Name : TrigError ()
+// Desc : The larger of fError and |fValue - fExact|. A NaN stays, so it
+//		fails the limit instead of being skipped.
+//-----------------------------------------------------------------------------
+static double TrigError(double fError, float fValue, double fExact)
+{
+	double fDiff = fabs(fValue - fExact);
+	return (fDiff <= fError || fError != fError) ? fError : fDiff;
+}
+
+//-----------------------------------------------------------------------------
+// Name : TimeTrig ()
+// Desc : Nanoseconds per value of one path, or of libm for nPath -1.
+//-----------------------------------------------------------------------------
+static double TimeTrig(int iKernel, int nPath, const sVecArgs &a)
+{
+	__int64 nStart, nEnd;
+	int nPasses = BENCHMARK_VECTORS / a.nCount;
+	VEC_BATCH_FUNC pfnPath = nPath >= 0 ? KERNELS[iKernel].pfnPath[nPath] : NULL;
+
+	nStart = BenchTime();
+	for(int nPass = 0; nPass < nPasses; nPass++)
+	{
+		if(pfnPath)
+		{
+			pfnPath(a);
+			continue;
+		}
+
+		for(int i = 0; i < a.nCount; i++)
+		{
+			switch(iKernel)
+			{
+			case KERNEL_SINCOS:
+				a.pX[i] = sinf(a.pAngle[i]);
+				a.pY[i] = cosf(a.pAngle[i]);
+				break;
+			case KERNEL_ATAN2:
+				a.pOut[i] = atan2f(a.pY[i], a.pX[i]);
+				break;
+			case KERNEL_ROTATE_EACH:
+			{
+				float s = sinf(a.pAngle[i]), c = cosf(a.pAngle[i]), fX = a.pX[i], fY = a.pY[i];
+				a.pX[i] = c * fX - s * fY;
+				a.pY[i] = s * fX + c * fY;
+				break;
+			}
+			case KERNEL_POLAR:
+				a.pX[i] = a.pRadius[i] * cosf(a.pAngle[i]);
+				a.pY[i] = a.pRadius[i] * sinf(a.pAngle[i]);
+				break;
+			}
+		}
+	}
+	nEnd = BenchTime();
+
+	return BenchSeconds(nStart, nEnd) * 1e9 / ((double)a.nCount * nPasses);
+}
+
+//-----------------------------------------------------------------------------
+// Name : RunTrigBenchmark ()
+// Desc : Sweeps sine and cosine over evenly spaced angles up to a full turn
+//		and up to TRIG_MAX_ANGLE, and the arctangent over random points and
+//		the axes, taking the largest error against double precision. Then
+//		writes nanoseconds per value of libm and each path.
+//-----------------------------------------------------------------------------
+bool RunTrigBenchmark(LPCSTR strFileName)
+{
+	FILE *pFile = BenchOpen(strFileName);
+	if(!pFile)
+		return false;
+
+	float *pAngle	= new float[TRIG_TEST_COUNT];
+	float *pX		= new float[TRIG_TEST_COUNT];
+	float *pY		= new float[TRIG_TEST_COUNT];
+	float *pOut		= new float[TRIG_TEST_COUNT];
+	float *pCheckX	= new float[TRIG_TEST_COUNT];
+	float *pCheckY	= new float[TRIG_TEST_COUNT];
+	ULONG nSeed		= 1;
+	bool bResult	= true;
+
+	sVecArgs a	= MakeArgs(pX, pY, TRIG_TEST_COUNT);
+	a.pAngle	= pAngle;
+	a.pRadius	= pCheckX;
+	a.pOut		= pOut;
+
+	fprintf(pFile, "Largest absolute error against double precision\n\n");
+	fprintf(pFile, "function  range           error     limit  paths agree\n");
+
+	const float fRanges[2] = { (float)(2.0 * PI), TRIG_MAX_ANGLE };
+	for(int iRange = 0; iRange < 2; iRange++)
+	{
+		for(int i = 0; i < TRIG_TEST_COUNT; i++)
+			pAngle[i] = (float)(fRanges[iRange] * (2.0 * i / (TRIG_TEST_COUNT - 1) - 1.0));
+
+		bool bSame = CheckTrigPaths(KERNEL_SINCOS, a, NULL, NULL, pCheckX, pCheckY);
+		double fError = 0.0;
+		for(int i = 0; i < TRIG_TEST_COUNT; i++)
+		{
+			fError = TrigError(fError, pX[i], sin((double)pAngle[i]));
+			fError = TrigError(fError, pY[i], cos((double)pAngle[i]));
+		}
+
+		bool bPass = bSame && fError <= TRIG_SINCOS_MAX_ERROR;
+		bResult = bResult && bPass;
+		fprintf(pFile, "sincos    +-%-10.4f  %.2e  %.2e  %s\n", fRanges[iRange], fError, TRIG_SINCOS_MAX_ERROR,
+				bSame ? (bPass ? "yes" : "yes, ERROR TOO LARGE") : "NO");
+	}
+
+	// Random points from small to large, with the axes and the origin mixed
+	// in. Every 16th point scales x and y apart, far enough for y / x to
+	// underflow, which checks the sign of a zero angle.
+	for(int i = 0; i < TRIG_TEST_COUNT; i++)
+	{
+		float fScale = powf(10.0f, BenchRandom(nSeed) * 8.0f - 4.0f);
+		pX[i] = (BenchRandom(nSeed) * 2.0f - 1.0f) * fScale;
+		pY[i] = (BenchRandom(nSeed) * 2.0f - 1.0f) * fScale;
+		if(i % 16 == 0)
+		{
+			pX[i] *= powf(10.0f, BenchRandom(nSeed) * 60.0f - 30.0f);
+			pY[i] *= powf(10.0f, BenchRandom(nSeed) * 60.0f - 30.0f);
+		}
+		if(i % 97 == 0)			pX[i] = 0.0f;
+		else if(i % 89 == 0)	pY[i] = 0.0f;
+	}
+
+	bool bSame = CheckTrigPaths(KERNEL_ATAN2, a, NULL, NULL, pCheckX, pCheckY);
+	double fError = 0.0;
+	for(int i = 0; i < TRIG_TEST_COUNT; i++)
+		fError = TrigError(fError, pOut[i], atan2((double)pY[i], (double)pX[i]));
+
+	bool bPass = bSame && fError <= TRIG_ATAN2_MAX_ERROR;
+	bResult = bResult && bPass;
+	fprintf(pFile, "atan2     any           %.2e  %.2e  %s\n", fError, TRIG_ATAN2_MAX_ERROR,
+			bSame ? (bPass ? "yes" : "yes, ERROR TOO LARGE") : "NO");
+
+	// The rotation and polar kernels only have to agree across the paths
+	memcpy(pOut, pX, TRIG_TEST_COUNT * sizeof(float));
+	memcpy(pAngle, pY, TRIG_TEST_COUNT * sizeof(float));
+	bSame = CheckTrigPaths(KERNEL_ROTATE_EACH, a, pOut, pAngle, pCheckX, pCheckY);
+	fprintf(pFile, "rotate each                                   %s\n", bSame ? "yes" : "NO");
+	bResult = bResult && bSame;
+
+	memcpy(pOut, pX, TRIG_TEST_COUNT * sizeof(float));
+	a.pRadius = pOut;
+	bSame = CheckTrigPaths(KERNEL_POLAR, a, NULL, NULL, pCheckX, pCheckY);
+	fprintf(pFile, "polar                                         %s\n", bSame ? "yes" : "NO");
+	bResult = bResult && bSame;
+
+	// Throughput on batches that stay in the cache
+	for(int i = 0; i < TRIG_BENCHMARK_COUNT; i++)
+	{
+		pAngle[i]	= (BenchRandom(nSeed) * 2.0f - 1.0f) * (float)PI;
+		pOut[i]		= BenchRandom(nSeed) * 100.0f;
+		pX[i]		= BenchRandom(nSeed) * 2.0f - 1.0f;
+		pY[i]		= BenchRandom(nSeed) * 2.0f - 1.0f;
+	}
+
+	sVecArgs Timed	= MakeArgs(pX, pY, TRIG_BENCHMARK_COUNT);
+	Timed.pAngle	= pAngle;
+	Timed.pRadius	= pOut;
+	Timed.pOut		= pCheckX;
+
+	// Rotation by angles below a turn keeps the vectors bounded over the passes
+	fprintf(pFile, "\nNanoseconds per value, - where the path is not available\n\n");
+	fprintf(pFile, "function       libm  scalar    sse2    avx2\n");
+	for(int iKernel = KERNEL_SINCOS; iKernel < KERNEL_COUNT; iKernel++)
+	{
+		// Atan2 reads pX, pY, which the other kernels write
+		if(iKernel == KERNEL_ATAN2)
+		{
+			for(int i = 0; i < TRIG_BENCHMARK_COUNT; i++)
+			{
+				pX[i] = BenchRandom(nSeed) * 2.0f - 1.0f;
+				pY[i] = BenchRandom(nSeed) * 2.0f - 1.0f;
+			}
+		}
+
+		fprintf(pFile, "%-11s  %6.2f", KERNELS[iKernel].strName, TimeTrig(iKernel, -1, Timed));
+		for(int nPath = 0; nPath < 3; nPath++)
+		{
+			if(!KERNELS[iKernel].pfnPath[nPath] || (nPath == 2 && !CpuHasAVX2()))
+				fprintf(pFile, "  %6s", "-");
+			else
+				fprintf(pFile, "  %6.2f", TimeTrig(iKernel, nPath, Timed));
+		}
+		fprintf(pFile, "\n");
+	}
+
+	delete []pAngle;
+	delete []pX;
+	delete []pY;
+	delete []pOut;
+	delete []pCheckX;
+	delete []pCheckY;
+
+	return BenchClose(pFile, bResult);
+}
@@ -0,0 +1,233 @@
+//-----------------------------------------------------------------------------
+// File: TelemetryReader.cpp
+//
+// Desc: Console tool summarizing a telemetry log written with -telemetry or
+//		-telemetrycsv: frame time percentiles, phase averages, counter totals
+//		and the frames that missed the budget.
+//
+//		Usage : TelemetryReader <telemetry.bin | telemetry.csv> [budget ms]
+//		Build : cl /O2 TelemetryReader.cpp
+//
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// TelemetryReader Specific Includes
+//-----------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//-----------------------------------------------------------------------------
+// Definitions, Macros & Constants
+//-----------------------------------------------------------------------------
+const char		TELEMETRY_MAGIC[4]		= { 'P', 'G', 'T', 'L' };
+const unsigned	TELEMETRY_VERSION		= 1;
+const float		DEFAULT_BUDGET_MS		= 1000.0f / 60.0f;
+
+//-----------------------------------------------------------------------------
+// Main Type Declarations
+//-----------------------------------------------------------------------------
+// Same layout as sTelemetryRecord in Include/Telemetry.h, which needs
+// windows.h. ULONG is 32 bits there.
+typedef struct
+{
+	unsigned int	nFrame;
+	float			fFrameMs;
+	float			fSimMs;
+	float			fDrawMs;
+	unsigned short	nEntities;
+	unsigned short	nSpritesDrawn;
+	unsigned int	nPixelsBlitted;
+	unsigned short	nAllocations;
+	unsigned short	nSoundsPlayed;
+} sRecord;
+
+typedef struct
+{
+	char			Magic[4];
+	unsigned int	nVersion;
+	unsigned int	nRecordSize;
+} sHeader;
+
+//-----------------------------------------------------------------------------
+// Name : LoadBinary ()
+// Desc : Reads the records of a binary log, after its header was checked.
+//-----------------------------------------------------------------------------
+static int LoadBinary(FILE *pFile, const sHeader &Header, sRecord **ppRecords)
+{
+	if(Header.nVersion != TELEMETRY_VERSION || Header.nRecordSize != sizeof(sRecord))
+	{
+		fprintf(stderr, "Unsupported log version %u, record size %u\n", Header.nVersion, Header.nRecordSize);
+		return -1;
+	}
+
+	int nCapacity = 4096, nCount = 0;
+	sRecord *pRecords = (sRecord*)malloc(nCapacity * sizeof(sRecord));
+
+	while(true)
+	{
+		if(nCount == nCapacity)
+		{
+			nCapacity *= 2;
+			pRecords = (sRecord*)realloc(pRecords, nCapacity * sizeof(sRecord));
+		}
+
+		size_t nRead = fread(&pRecords[nCount], sizeof(sRecord), nCapacity - nCount, pFile);
+		nCount += (int)nRead;
+		if(nCount < nCapacity) break;
+	}
+
+	*ppRecords = pRecords;
+	return nCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : LoadCsv ()
+// Desc : Reads the records of a CSV log, skipping its column names.
+//-----------------------------------------------------------------------------
+static int LoadCsv(FILE *pFile, sRecord **ppRecords)
+{
+	int nCapacity = 4096, nCount = 0;
+	sRecord *pRecords = (sRecord*)malloc(nCapacity * sizeof(sRecord));
+
+	char strLine[256];
+	while(fgets(strLine, sizeof(strLine), pFile))
+	{
+		unsigned nFrame, nEntities, nSprites, nPixels, nAllocations, nSounds;
+		float fFrame, fSim, fDraw;
+		if(sscanf(strLine, "%u,%f,%f,%f,%u,%u,%u,%u,%u", &nFrame, &fFrame, &fSim, &fDraw,
+				  &nEntities, &nSprites, &nPixels, &nAllocations, &nSounds) != 9)
+			continue;
+
+		if(nCount == nCapacity)
+		{
+			nCapacity *= 2;
+			pRecords = (sRecord*)realloc(pRecords, nCapacity * sizeof(sRecord));
+		}
+
+		sRecord &Record			= pRecords[nCount++];
+		Record.nFrame			= nFrame;
+		Record.fFrameMs			= fFrame;
+		Record.fSimMs			= fSim;
+		Record.fDrawMs			= fDraw;
+		Record.nEntities		= (unsigned short)nEntities;
+		Record.nSpritesDrawn	= (unsigned short)nSprites;
+		Record.nPixelsBlitted	= nPixels;
+		Record.nAllocations		= (unsigned short)nAllocations;
+		Record.nSoundsPlayed	= (unsigned short)nSounds;
+	}
+
+	*ppRecords = pRecords;
+	return nCount;
+}
+
+//-----------------------------------------------------------------------------
+// Name : CompareFloat ()
+// Desc : qsort callback, ascending.
+//-----------------------------------------------------------------------------
+static int CompareFloat(const void *pA, const void *pB)
+{
+	float a = *(const float*)pA, b = *(const float*)pB;
+	return (a > b) - (a < b);
+}
+
+//-----------------------------------------------------------------------------
+// Name : Percentile ()
+// Desc : Nearest rank percentile of sorted values, as CTimer computes it.
+//-----------------------------------------------------------------------------
+static float Percentile(const float *pSorted, int nCount, float fPercent)
+{
+	int iRank = (int)(fPercent / 100.0f * nCount - 0.001f);
+	if(iRank < 0) iRank = 0;
+	if(iRank >= nCount) iRank = nCount - 1;
+	return pSorted[iRank];
+}
+
+//-----------------------------------------------------------------------------
+// Name : main ()
+// Desc : Loads the log named on the command line and prints its summary.
+//-----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+	if(argc < 2)
+	{
+		fprintf(stderr, "Usage : %s <telemetry.bin | telemetry.csv> [budget ms]\n", argv[0]);
+		return 1;
+	}
+
+	float fBudgetMs = argc > 2 ? (float)atof(argv[2]) : DEFAULT_BUDGET_MS;
+	if(fBudgetMs <= 0.0f) fBudgetMs = DEFAULT_BUDGET_MS;
+
+	FILE *pFile = fopen(argv[1], "rb");
+	if(!pFile)
+	{
+		fprintf(stderr, "Cannot open %s\n", argv[1]);
+		return 1;
+	}
+
+	// Binary logs start with the magic, anything else is read as CSV
+	sRecord *pRecords = NULL;
+	sHeader Header;
+	int nCount;
+	if(fread(&Header, sizeof(Header), 1, pFile) == 1 && memcmp(Header.Magic, TELEMETRY_MAGIC, 4) == 0)
+	{
+		nCount = LoadBinary(pFile, Header, &pRecords);
+	}
+	else
+	{
+		rewind(pFile);
+		nCount = LoadCsv(pFile, &pRecords);
+	}
+	fclose(pFile);
+
+	if(nCount <= 0)
+	{
+		if(nCount == 0) fprintf(stderr, "No records in %s\n", argv[1]);
+		free(pRecords);
+		return 1;
+	}
+
+	double fTotalMs = 0.0, fSimMs = 0.0, fDrawMs = 0.0;
+	double nSprites = 0.0, nPixels = 0.0, nAllocations = 0.0, nSounds = 0.0;
+	int nMaxEntities = 0, nOverBudget = 0, iWorst = 0;
+	float *pFrameMs = (float*)malloc(nCount * sizeof(float));
+
+	for(int i = 0; i < nCount; i++)
+	{
+		const sRecord &Record = pRecords[i];
+		pFrameMs[i]		= Record.fFrameMs;
+		fTotalMs		+= Record.fFrameMs;
+		fSimMs			+= Record.fSimMs;
+		fDrawMs			+= Record.fDrawMs;
+		nSprites		+= Record.nSpritesDrawn;
+		nPixels			+= Record.nPixelsBlitted;
+		nAllocations	+= Record.nAllocations;
+		nSounds			+= Record.nSoundsPlayed;
+		if(Record.nEntities > nMaxEntities) nMaxEntities = Record.nEntities;
+		if(Record.fFrameMs > fBudgetMs) nOverBudget++;
+		if(Record.fFrameMs > pRecords[iWorst].fFrameMs) iWorst = i;
+	}
+
+	qsort(pFrameMs, nCount, sizeof(float), CompareFloat);
+
+	printf("%s\n", argv[1]);
+	printf("  frames        %d (%u to %u), %.2f s\n", nCount, pRecords[0].nFrame,
+		   pRecords[nCount - 1].nFrame, fTotalMs / 1000.0);
+	printf("  frame ms      mean %.3f  min %.3f  max %.3f (frame %u)\n", fTotalMs / nCount,
+		   pFrameMs[0], pFrameMs[nCount - 1], pRecords[iWorst].nFrame);
+	printf("                p50 %.3f  p95 %.3f  p99 %.3f\n", Percentile(pFrameMs, nCount, 50.0f),
+		   Percentile(pFrameMs, nCount, 95.0f), Percentile(pFrameMs, nCount, 99.0f));
+	printf("  sim ms        mean %.3f\n", fSimMs / nCount);
+	printf("  draw ms       mean %.3f\n", fDrawMs / nCount);
+	printf("  entities      max %d\n", nMaxEntities);
+	printf("  sprites       %.0f (%.1f per frame)\n", nSprites, nSprites / nCount);
+	printf("  pixels        %.0f (%.0f per frame)\n", nPixels, nPixels / nCount);
+	printf("  allocations   %.0f\n", nAllocations);
+	printf("  sounds        %.0f\n", nSounds);
+	printf("  over %.2f ms  %d frames (%.2f%%)\n", fBudgetMs, nOverBudget, 100.0 * nOverBudget / nCount);
+
+	free(pFrameMs);
+	free(pRecords);
+	return 0;
+}